@@ -0,0 +1,548 @@
+//     Copyright (c) 2012 Vadym Kliuchnikov sqct(dot)software(at)gmail(dot)com, Dmitri Maslov, Michele Mosca
+//
+//     This file is part of SQCT.
+// 
+//     SQCT is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     SQCT is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+// 
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with SQCT.  If not, see <http://www.gnu.org/licenses/>.
+// 
+
+
+#include "columntree.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+
+/// \brief Header of the file with columnTree, sections are aligned to mappedFile::alignment
+struct columnTreeHeader
+{
+    char     magic[8];          ///< Always ctreeMagic
+    uint32_t version;           ///< Format version, ctreeVersion
+    uint32_t layers_count;      ///< Number of layers the tree is built for
+    uint64_t tree_nodes_count;  ///< Number of nodes of the tree
+    uint64_t entries_count;     ///< Number of epsilon net nodes
+    uint64_t blocks_count;      ///< Number of blocks
+    uint64_t numbers_count;     ///< Number of numbers in blocks
+    uint64_t layers_offset;     ///< Offset of sizes of the layers, see layerSize
+    uint64_t tree_nodes_offset; ///< Offset of nodes of the tree
+    uint64_t entries_offset;    ///< Offset of epsilon net nodes
+    uint64_t blocks_offset;     ///< Offset of blocks
+    uint64_t re_offset;         ///< Offset of real parts of numbers
+    uint64_t im_offset;         ///< Offset of imaginary parts of numbers
+    uint64_t orig_offset;       ///< Offset of indexes of numbers in their epsilon nets
+    uint64_t data_checksum;     ///< Checksum of all sections, see dataChecksum
+    uint64_t header_checksum;   ///< Checksum of the header with this field set to zero
+};
+
+/// \brief Sizes and checksum of a layer, used to check that the tree was built for the loaded layers
+struct layerSize
+{
+    uint64_t nodes;     ///< epsilonnet::nodesSize
+    uint64_t numbers;   ///< epsilonnet::numbersSize
+    uint64_t checksum;  ///< epsilonnet::dataChecksum
+};
+
+static const char     ctreeMagic[8] = { 'S','Q','C','T','T','R','E','E' };
+static const uint32_t ctreeVersion = 2;
+
+/// \brief Allowed error of floating point distances, box distances have to
+/// exceed the best distance by more than this to skip a box
+static const double ctreeSlack = 1e-12;
+
+/// \brief Checksum of the header, computed with header_checksum set to zero
+static uint64_t headerChecksum( const columnTreeHeader& th )
+{
+    columnTreeHeader tmp = th;
+    tmp.header_checksum = 0;
+    return mappedFile::checksum( &tmp, sizeof(tmp) );
+}
+
+/// \brief Checksum of the sections of a tree file with header th, stored at base.
+/// Sections are checksummed without the padding between them.
+static uint64_t dataChecksum( const columnTreeHeader& th, const char* base )
+{
+    uint64_t h = mappedFile::checksum( base + th.layers_offset, th.layers_count * sizeof(layerSize) );
+    h = mappedFile::checksum( base + th.tree_nodes_offset, th.tree_nodes_count * sizeof(columnTreeNode), h );
+    h = mappedFile::checksum( base + th.entries_offset, th.entries_count * sizeof(columnEntry), h );
+    h = mappedFile::checksum( base + th.blocks_offset, th.blocks_count * sizeof(columnBlock), h );
+    h = mappedFile::checksum( base + th.re_offset, th.numbers_count * sizeof(double), h );
+    h = mappedFile::checksum( base + th.im_offset, th.numbers_count * sizeof(double), h );
+    return mappedFile::checksum( base + th.orig_offset, th.numbers_count * sizeof(uint64_t), h );
+}
+
+/// \brief True if the sections of th are aligned, in order and inside a file of length bytes
+static bool isValidLayout( const columnTreeHeader& th, uint64_t length )
+{
+    const uint64_t a = mappedFile::alignment;
+    return th.layers_offset >= sizeof(th) &&
+           th.tree_nodes_offset >= th.layers_offset + th.layers_count * sizeof(layerSize) &&
+           th.entries_offset >= th.tree_nodes_offset + th.tree_nodes_count * sizeof(columnTreeNode) &&
+           th.blocks_offset >= th.entries_offset + th.entries_count * sizeof(columnEntry) &&
+           th.re_offset >= th.blocks_offset + th.blocks_count * sizeof(columnBlock) &&
+           th.im_offset >= th.re_offset + th.numbers_count * sizeof(double) &&
+           th.orig_offset >= th.im_offset + th.numbers_count * sizeof(double) &&
+           th.orig_offset + th.numbers_count * sizeof(uint64_t) <= length &&
+           th.layers_offset % a == 0 && th.tree_nodes_offset % a == 0 &&
+           th.entries_offset % a == 0 && th.blocks_offset % a == 0 &&
+           th.re_offset % a == 0 && th.im_offset % a == 0 && th.orig_offset % a == 0;
+}
+
+/// \brief Distance squared from z to the box
+static inline double boxDist( const complex<double>& z, const columnBox& b )
+{
+    double dre = max( 0.0, max( b.re_min - z.real(), z.real() - b.re_max ) );
+    double dim = max( 0.0, max( b.im_min - z.imag(), z.imag() - b.im_max ) );
+    return dre * dre + dim * dim;
+}
+
+/// \brief Lower bound of distance squared from vec to columns (x,y) and (y,x)
+/// with x in bx and y in by
+static inline double pairDist( const epsilonnet::vector2double& vec, const columnBox& bx, const columnBox& by )
+{
+    return min( boxDist( vec.first, bx ) + boxDist( vec.second, by ),
+                boxDist( vec.first, by ) + boxDist( vec.second, bx ) );
+}
+
+/// \brief Extends a by b
+static void unite( columnBox& a, const columnBox& b )
+{
+    a.re_min = min( a.re_min, b.re_min );
+    a.re_max = max( a.re_max, b.re_max );
+    a.im_min = min( a.im_min, b.im_min );
+    a.im_max = max( a.im_max, b.im_max );
+}
+
+/// \brief Box that contains nothing
+static columnBox emptyBox()
+{
+    const double inf = numeric_limits<double>::infinity();
+    columnBox b = { inf, -inf, inf, -inf };
+    return b;
+}
+
+struct columnBest
+{
+    double   dist;      ///< Distance squared to the column
+    bool     found;     ///< True if some column was found
+    int      layer_id;  ///< Layer of the column
+    int      node_id;   ///< Node of the column
+    uint64_t i;         ///< Number from the first part of the node
+    uint64_t j;         ///< Complementary number
+    bool     tw;        ///< True if the complementary number goes first
+
+    /// \brief True if the column precedes the best one in the order of the exhaustive search
+    bool precedes( int l, int n, uint64_t ci, uint64_t cj, bool ctw ) const
+    {
+        if( l != layer_id ) return l < layer_id;
+        if( n != node_id ) return n < node_id;
+        if( ci != i ) return ci < i;
+        if( cj != j ) return cj < j;
+        return !ctw && tw;
+    }
+};
+
+columnTree::columnTree() :
+    m_tree_nodes(0), m_entries(0), m_entries_count(0), m_blocks(0),
+    m_re(0), m_im(0), m_orig(0)
+{
+}
+
+/// \brief Orders numbers of a layer by argument
+struct argComparator
+{
+    const double* re;
+    const double* im;
+    bool operator()( size_t a, size_t b ) const
+    {
+        double aa = atan2( im[a], re[a] ), ab = atan2( im[b], re[b] );
+        if( aa != ab ) return aa < ab;
+        return a < b;
+    }
+};
+
+void columnTree::addBlocks( const epsilonnet& layer, size_t b, size_t e )
+{
+    const double* re = layer.numbersRe();
+    const double* im = layer.numbersIm();
+    vector<size_t> order;
+    for( size_t i = b; i < e; ++i )
+        order.push_back( i );
+    argComparator ac = { re, im };
+    sort( order.begin(), order.end(), ac );
+
+    for( size_t k = 0; k < order.size(); k += block_size )
+    {
+        // numbers inside a block keep their order in the epsilon net,
+        // so the search resolves ties within a block as the exhaustive search does
+        size_t ke = min( order.size(), k + block_size );
+        sort( order.begin() + k, order.begin() + ke );
+
+        columnBlock bl;
+        bl.box = emptyBox();
+        bl.begin = m_built_re.size();
+        for( size_t t = k; t < ke; ++t )
+        {
+            size_t n = order[t];
+            columnBox p = { re[n], re[n], im[n], im[n] };
+            unite( bl.box, p );
+            m_built_re.push_back( re[n] );
+            m_built_im.push_back( im[n] );
+            m_built_orig.push_back( n );
+        }
+        bl.end = m_built_re.size();
+        m_built_blocks.push_back( bl );
+    }
+}
+
+/// \brief Orders entries by a coordinate of the centers of their boxes
+struct entryComparator
+{
+    int axis;
+    static double center( const columnEntry& en, int axis )
+    {
+        switch( axis )
+        {
+        case 0: return en.box_x.re_min + en.box_x.re_max;
+        case 1: return en.box_x.im_min + en.box_x.im_max;
+        case 2: return en.box_y.re_min + en.box_y.re_max;
+        default: return en.box_y.im_min + en.box_y.im_max;
+        }
+    }
+    bool operator()( const columnEntry& a, const columnEntry& b ) const
+    {
+        return center( a, axis ) < center( b, axis );
+    }
+};
+
+uint64_t columnTree::buildSubtree( uint64_t b, uint64_t e )
+{
+    columnTreeNode nd;
+    nd.box_x = emptyBox();
+    nd.box_y = emptyBox();
+    nd.begin = b;
+    nd.end = e;
+    nd.left = nd.right = 0;
+    for( uint64_t k = b; k < e; ++k )
+    {
+        unite( nd.box_x, m_built_entries[k].box_x );
+        unite( nd.box_y, m_built_entries[k].box_y );
+    }
+
+    uint64_t id = m_built_tree_nodes.size();
+    m_built_tree_nodes.push_back( nd );
+    if( e - b <= leaf_size )
+        return id;
+
+    // split by the median of the coordinate with the largest spread
+    int axis = 0;
+    double spread = -1.0;
+    for( int a = 0; a < 4; ++a )
+    {
+        double lo = numeric_limits<double>::infinity(), hi = -lo;
+        for( uint64_t k = b; k < e; ++k )
+        {
+            double c = entryComparator::center( m_built_entries[k], a );
+            lo = min( lo, c );
+            hi = max( hi, c );
+        }
+        if( hi - lo > spread )
+        {
+            spread = hi - lo;
+            axis = a;
+        }
+    }
+
+    uint64_t mid = b + ( e - b ) / 2;
+    entryComparator ec = { axis };
+    nth_element( m_built_entries.begin() + b, m_built_entries.begin() + mid,
+                 m_built_entries.begin() + e, ec );
+
+    uint64_t left = buildSubtree( b, mid );
+    uint64_t right = buildSubtree( mid, e );
+    m_built_tree_nodes[id].left = left;
+    m_built_tree_nodes[id].right = right;
+    return id;
+}
+
+void columnTree::build( const layersVector& layers )
+{
+    m_mapping.reset();
+    m_layers.clear();
+    m_built_tree_nodes.clear();
+    m_built_entries.clear();
+    m_built_blocks.clear();
+    m_built_re.clear();
+    m_built_im.clear();
+    m_built_orig.clear();
+
+    for( size_t l = 0; l < layers.size(); ++l )
+    {
+        const epsilonnet& layer = *layers[l];
+        m_layers.push_back( &layer );
+        const enetNode* nd = layer.nodesData();
+        // the last node only terminates the list
+        for( size_t n = 0; n + 1 < layer.nodesSize(); ++n )
+        {
+            size_t ib = nd[n].num_offset;
+            size_t jb = layer.complOffset( n );
+            size_t je = nd[n + 1].num_offset;
+            if( ib == jb || jb == je )
+                continue;
+
+            columnEntry en;
+            en.layer_id = l;
+            en.node_id = n;
+            en.blocks_begin = m_built_blocks.size();
+            addBlocks( layer, ib, jb );
+            en.blocks_compl = m_built_blocks.size();
+            addBlocks( layer, jb, je );
+            en.blocks_end = m_built_blocks.size();
+
+            en.box_x = emptyBox();
+            en.box_y = emptyBox();
+            for( uint64_t k = en.blocks_begin; k < en.blocks_compl; ++k )
+                unite( en.box_x, m_built_blocks[k].box );
+            for( uint64_t k = en.blocks_compl; k < en.blocks_end; ++k )
+                unite( en.box_y, m_built_blocks[k].box );
+            m_built_entries.push_back( en );
+        }
+    }
+
+    if( !m_built_entries.empty() )
+        buildSubtree( 0, m_built_entries.size() );
+    useBuilt();
+}
+
+void columnTree::useBuilt()
+{
+    m_tree_nodes = m_built_tree_nodes.data();
+    m_entries = m_built_entries.data();
+    m_entries_count = m_built_entries.size();
+    m_blocks = m_built_blocks.data();
+    m_re = m_built_re.data();
+    m_im = m_built_im.data();
+    m_orig = m_built_orig.data();
+}
+
+bool columnTree::saveToFile( const char* filename ) const
+{
+    if( !isReady() || m_mapping )
+        return false;
+
+    columnTreeHeader th;
+    memset( &th, 0, sizeof(th) );
+    memcpy( th.magic, ctreeMagic, sizeof(ctreeMagic) );
+    th.version = ctreeVersion;
+    th.layers_count = m_layers.size();
+    th.tree_nodes_count = m_built_tree_nodes.size();
+    th.entries_count = m_built_entries.size();
+    th.blocks_count = m_built_blocks.size();
+    th.numbers_count = m_built_re.size();
+    th.layers_offset = mappedFile::align( sizeof(th) );
+    th.tree_nodes_offset = mappedFile::align( th.layers_offset + th.layers_count * sizeof(layerSize) );
+    th.entries_offset = mappedFile::align( th.tree_nodes_offset + th.tree_nodes_count * sizeof(columnTreeNode) );
+    th.blocks_offset = mappedFile::align( th.entries_offset + th.entries_count * sizeof(columnEntry) );
+    th.re_offset = mappedFile::align( th.blocks_offset + th.blocks_count * sizeof(columnBlock) );
+    th.im_offset = mappedFile::align( th.re_offset + th.numbers_count * sizeof(double) );
+    th.orig_offset = mappedFile::align( th.im_offset + th.numbers_count * sizeof(double) );
+
+    vector<layerSize> sizes;
+    for( size_t l = 0; l < m_layers.size(); ++l )
+    {
+        layerSize ls = { m_layers[l]->nodesSize(), m_layers[l]->numbersSize(), m_layers[l]->dataChecksum() };
+        sizes.push_back( ls );
+    }
+
+    // same sections as dataChecksum reads from the file
+    uint64_t h = mappedFile::checksum( sizes.data(), sizes.size() * sizeof(layerSize) );
+    h = mappedFile::checksum( m_built_tree_nodes.data(), th.tree_nodes_count * sizeof(columnTreeNode), h );
+    h = mappedFile::checksum( m_built_entries.data(), th.entries_count * sizeof(columnEntry), h );
+    h = mappedFile::checksum( m_built_blocks.data(), th.blocks_count * sizeof(columnBlock), h );
+    h = mappedFile::checksum( m_built_re.data(), th.numbers_count * sizeof(double), h );
+    h = mappedFile::checksum( m_built_im.data(), th.numbers_count * sizeof(double), h );
+    th.data_checksum = mappedFile::checksum( m_built_orig.data(), th.numbers_count * sizeof(uint64_t), h );
+    th.header_checksum = headerChecksum( th );
+
+    mappedFileWriter out( filename );
+    out.write( &th, sizeof(th) );
+    out.padTo( th.layers_offset );
+    out.write( sizes.data(), sizes.size() * sizeof(layerSize) );
+    out.padTo( th.tree_nodes_offset );
+    out.write( m_built_tree_nodes.data(), th.tree_nodes_count * sizeof(columnTreeNode) );
+    out.padTo( th.entries_offset );
+    out.write( m_built_entries.data(), th.entries_count * sizeof(columnEntry) );
+    out.padTo( th.blocks_offset );
+    out.write( m_built_blocks.data(), th.blocks_count * sizeof(columnBlock) );
+    out.padTo( th.re_offset );
+    out.write( m_built_re.data(), th.numbers_count * sizeof(double) );
+    out.padTo( th.im_offset );
+    out.write( m_built_im.data(), th.numbers_count * sizeof(double) );
+    out.padTo( th.orig_offset );
+    out.write( m_built_orig.data(), th.numbers_count * sizeof(uint64_t) );
+    return out.commit();
+}
+
+bool columnTree::loadFromFile( const char* filename, const layersVector& layers )
+{
+    size_t length = 0;
+    shared_ptr<const void> file = mappedFile::map( filename, length );
+    columnTreeHeader th;
+    if( !file || length < sizeof(th) )
+        return false;
+    memcpy( &th, file.get(), sizeof(th) );
+
+    if( memcmp( th.magic, ctreeMagic, sizeof(ctreeMagic) ) != 0 ||
+        th.version != ctreeVersion ||
+        th.header_checksum != headerChecksum( th ) ||
+        th.layers_count != layers.size() ||
+        th.entries_count == 0 ||
+        ! isValidLayout( th, length ) )
+        return false;
+
+    // the indexes in the tree are used without bounds checks, so a truncated
+    // or corrupt tree is rejected and built again; verified once per file
+    const char* base = (const char*) file.get();
+    if( ! mappedFile::isVerified( filename, th.data_checksum ) )
+    {
+        if( dataChecksum( th, base ) != th.data_checksum )
+            return false;
+        mappedFile::markVerified( filename, th.data_checksum );
+    }
+
+    const layerSize* sizes = (const layerSize*)( base + th.layers_offset );
+    for( size_t l = 0; l < layers.size(); ++l )
+        if( sizes[l].nodes != layers[l]->nodesSize() ||
+            sizes[l].numbers != layers[l]->numbersSize() ||
+            sizes[l].checksum != layers[l]->dataChecksum() )
+            return false;
+
+    m_layers.clear();
+    for( size_t l = 0; l < layers.size(); ++l )
+        m_layers.push_back( layers[l].get() );
+
+    m_mapping = file;
+    m_tree_nodes = (const columnTreeNode*)( base + th.tree_nodes_offset );
+    m_entries = (const columnEntry*)( base + th.entries_offset );
+    m_entries_count = th.entries_count;
+    m_blocks = (const columnBlock*)( base + th.blocks_offset );
+    m_re = (const double*)( base + th.re_offset );
+    m_im = (const double*)( base + th.im_offset );
+    m_orig = (const uint64_t*)( base + th.orig_offset );
+    return true;
+}
+
+void columnTree::searchEntry( const epsilonnet::vector2double& vec, const columnEntry& en, columnBest& best ) const
+{
+    // lower bounds for all pairs of blocks of the node, closest first
+    vector< pair<double, pair<uint64_t,uint64_t> > > pairs;
+    for( uint64_t x = en.blocks_begin; x < en.blocks_compl; ++x )
+        for( uint64_t y = en.blocks_compl; y < en.blocks_end; ++y )
+        {
+            double lb = pairDist( vec, m_blocks[x].box, m_blocks[y].box );
+            if( lb - ctreeSlack <= best.dist )
+                pairs.push_back( make_pair( lb, make_pair( x, y ) ) );
+        }
+    sort( pairs.begin(), pairs.end() );
+
+    for( size_t k = 0; k < pairs.size(); ++k )
+    {
+        if( pairs[k].first - ctreeSlack > best.dist )
+            break;
+        const columnBlock& bx = m_blocks[ pairs[k].second.first ];
+        const columnBlock& by = m_blocks[ pairs[k].second.second ];
+
+        // once a column is found, accept columns at its distance too, they may precede it
+        double dist = best.found ? nextafter( best.dist, numeric_limits<double>::infinity() ) : best.dist;
+        enetPair bp = { bx.begin, by.begin, true, false };
+        epsilonnet::findClosestPair( vec, m_re, m_im, bx.begin, bx.end, by.begin, by.end, dist, bp );
+        if( !bp.found )
+            continue;
+
+        uint64_t i = m_orig[bp.i], j = m_orig[bp.j];
+        if( !best.found || dist < best.dist ||
+            best.precedes( en.layer_id, en.node_id, i, j, bp.tw ) )
+        {
+            best.dist = dist;
+            best.found = true;
+            best.layer_id = en.layer_id;
+            best.node_id = en.node_id;
+            best.i = i;
+            best.j = j;
+            best.tw = bp.tw;
+        }
+    }
+}
+
+double columnTree::findApproximation( const epsilonnet::vector2double& vec, epsilonnet::vi& result, double bdist ) const
+{
+    columnBest best = { bdist, false, 0, 0, 0, 0, false };
+    if( !isReady() )
+        return bdist;
+
+    // depth first, the closer child first
+    vector<uint64_t> stack( 1, 0 );
+    while( !stack.empty() )
+    {
+        const columnTreeNode& nd = m_tree_nodes[ stack.back() ];
+        stack.pop_back();
+        if( pairDist( vec, nd.box_x, nd.box_y ) - ctreeSlack > best.dist )
+            continue;
+
+        if( nd.left == 0 )
+        {
+            for( uint64_t k = nd.begin; k < nd.end; ++k )
+            {
+                const columnEntry& en = m_entries[k];
+                if( pairDist( vec, en.box_x, en.box_y ) - ctreeSlack <= best.dist )
+                    searchEntry( vec, en, best );
+            }
+            continue;
+        }
+
+        const columnTreeNode& l = m_tree_nodes[ nd.left ];
+        const columnTreeNode& r = m_tree_nodes[ nd.right ];
+        if( pairDist( vec, l.box_x, l.box_y ) < pairDist( vec, r.box_x, r.box_y ) )
+        {
+            stack.push_back( nd.right );
+            stack.push_back( nd.left );
+        }
+        else
+        {
+            stack.push_back( nd.left );
+            stack.push_back( nd.right );
+        }
+    }
+
+    if( !best.found )
+        return bdist;
+
+    const epsilonnet& layer = *m_layers[ best.layer_id ];
+    const epsilonnet::ri* nb = layer.numbersData();
+    if( best.tw )
+    {
+        result.d[0] = nb[best.j];
+        result.d[1] = nb[best.i];
+    }
+    else
+    {
+        result.d[0] = nb[best.i];
+        result.d[1] = nb[best.j];
+    }
+    result.de = layer.denominator_exponent;
+    return best.dist;
+}
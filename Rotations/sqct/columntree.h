@@ -0,0 +1,138 @@
+//     Copyright (c) 2012 Vadym Kliuchnikov sqct(dot)software(at)gmail(dot)com, Dmitri Maslov, Michele Mosca
+//
+//     This file is part of SQCT.
+// 
+//     SQCT is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     SQCT is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+// 
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with SQCT.  If not, see <http://www.gnu.org/licenses/>.
+// 
+
+
+#ifndef COLUMNTREE_H
+#define COLUMNTREE_H
+
+#include "epsilonnet.h"
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/// \brief Axis aligned box in the complex plane
+struct columnBox
+{
+    double re_min;  ///< Smallest real part
+    double re_max;  ///< Largest real part
+    double im_min;  ///< Smallest imaginary part
+    double im_max;  ///< Largest imaginary part
+};
+
+/// \brief Numbers of one part of an epsilon net node with close arguments,
+/// stored in columnTree in the order they have in the epsilon net
+struct columnBlock
+{
+    columnBox box;  ///< Bounding box of the numbers
+    uint64_t begin; ///< First number in columnTree coordinate arrays
+    uint64_t end;   ///< End of numbers, the interval is [begin,end)
+};
+
+/// \brief Epsilon net node in columnTree
+struct columnEntry
+{
+    columnBox box_x;        ///< Bounding box of the numbers of the node
+    columnBox box_y;        ///< Bounding box of the complementary numbers
+    int32_t  layer_id;      ///< Layer of the node
+    int32_t  node_id;       ///< Number of the node in the layer
+    uint64_t blocks_begin;  ///< First block of the numbers
+    uint64_t blocks_compl;  ///< First block of the complementary numbers
+    uint64_t blocks_end;    ///< End of blocks of the node
+};
+
+/// \brief Node of k-d tree of columnTree, covers entries [begin,end)
+struct columnTreeNode
+{
+    columnBox box_x;    ///< Union of columnEntry::box_x of the entries
+    columnBox box_y;    ///< Union of columnEntry::box_y of the entries
+    uint64_t  begin;    ///< First entry
+    uint64_t  end;      ///< End of entries
+    uint64_t  left;     ///< Left child, zero for leaves
+    uint64_t  right;    ///< Right child, zero for leaves
+};
+
+/// \brief Best column found by columnTree::findApproximation
+struct columnBest;
+
+/// \brief Exact nearest neighbour index over the columns of all epsilon net layers.
+///
+/// Columns of an epsilon net node are pairs of its numbers and complementary
+/// numbers. Both parts of each node are split into blocks of numbers with close
+/// arguments and the nodes form a k-d tree by the centers of their bounding boxes.
+/// The search skips subtrees, nodes and pairs of blocks whose boxes are further
+/// than the best column found so far and gives exactly the same column as the
+/// exhaustive search of unitaryApproximator, including ties.
+/// The tree is saved to file and mapped read-only like epsilonnet.
+class columnTree
+{
+public:
+    /// \brief Type of the layers the tree is built for
+    typedef std::vector< std::unique_ptr< epsilonnet > > layersVector;
+
+    /// \brief Creates empty tree
+    columnTree();
+    /// \brief Builds the tree for all nodes of the layers
+    void build( const layersVector& layers );
+    /// \brief Saves tree to file, returns false on failure
+    bool saveToFile( const char* filename ) const;
+    /// \brief Maps tree from file, returns false if it is missing or was built for other layers
+    bool loadFromFile( const char* filename, const layersVector& layers );
+    /// \brief True if the tree was built or loaded
+    bool isReady() const { return m_entries_count != 0; }
+    /// \brief Finds the column closest to vec amongst columns that are closer than bdist.
+    /// vec must be in canonical form, see epsilonnet::findExhaustiveApproximation
+    /// \returns Euclidean distance squared to the column written into result, bdist if none was found
+    double findApproximation( const epsilonnet::vector2double& vec, epsilonnet::vi& result, double bdist ) const;
+
+private:
+    /// \brief Number of numbers in columnBlock
+    static const size_t block_size = 16;
+    /// \brief Largest number of entries in a leaf of the tree
+    static const size_t leaf_size = 4;
+
+    /// \brief Appends blocks of numbers [b,e) of layer
+    void addBlocks( const epsilonnet& layer, size_t b, size_t e );
+    /// \brief Builds subtree over entries [b,e), returns its index in m_tree_nodes
+    uint64_t buildSubtree( uint64_t b, uint64_t e );
+    /// \brief Points arrays below to vectors filled by build
+    void useBuilt();
+    /// \brief Searches pairs of blocks of an entry
+    void searchEntry( const epsilonnet::vector2double& vec, const columnEntry& en, columnBest& best ) const;
+
+    /// \brief Layers the tree is built for
+    std::vector< const epsilonnet* > m_layers;
+
+    /// \brief Read-only mapping of the file loaded by loadFromFile
+    std::shared_ptr<const void> m_mapping;
+    const columnTreeNode* m_tree_nodes;    ///< Nodes of the tree, root first
+    const columnEntry*    m_entries;       ///< Epsilon net nodes
+    uint64_t              m_entries_count; ///< Number of epsilon net nodes
+    const columnBlock*    m_blocks;        ///< Blocks of all nodes
+    const double*         m_re;            ///< Real parts of numbers of blocks
+    const double*         m_im;            ///< Imaginary parts of numbers of blocks
+    const uint64_t*       m_orig;          ///< Indexes of numbers of blocks in their epsilon nets
+
+    std::vector<columnTreeNode> m_built_tree_nodes; ///< Nodes built by build
+    std::vector<columnEntry>    m_built_entries;    ///< Entries built by build
+    std::vector<columnBlock>    m_built_blocks;     ///< Blocks built by build
+    std::vector<double>         m_built_re;         ///< Real parts built by build
+    std::vector<double>         m_built_im;         ///< Imaginary parts built by build
+    std::vector<uint64_t>       m_built_orig;       ///< Indexes built by build
+};
+
+#endif // COLUMNTREE_H
@@ -18,6 +18,10 @@ struct enetOptions
     /// \brief If one element specified -- upper bound for sde of epsilon net to be
     /// generated. If two elements specified -- interval of sde to be generated.
     std::vector<int> epsilon_net_layers;
+    /// \brief Bound on memory used for candidate numbers while a layer is generated, in megabytes
+    size_t memory_budget_mb;
+
+    enetOptions() : memory_budget_mb( netGenerator::memoryBudget() >> 20 ) {}
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -47,8 +51,8 @@ struct enetApplication
          for( int i = 0; i < 100; ++i )
          {
              std::string name = netGenerator::fileName(i);
-             std::ifstream ifs(name);
-             if( !ifs )
+             // files of an older format or with corrupt data are generated again
+             if( ! epsilonnet::verifyFile( name.c_str() ) )
                  m_layers[i] = 0;
              else
                  m_layers[i] = 1;
@@ -61,15 +65,17 @@ struct enetApplication
         if( ! initial_ok && st < initial_end )
             m_ng.generateInitial();
 
-        for( int i = std::max(initial_end,st) ; i < end; ++i )
+        // copied, std::max would bind a reference to initial_end, which has no definition
+        const int first = initial_end;
+        for( int i = std::max(first,st) ; i < end; ++i )
         {
             if( m_layers[i] == 0 )
             {
                 //std::cout << "\tGenerating Layer " << i << " of " << end << std::endl;
                 epsilonnet base_net;
                 base_net.loadFromFile( netGenerator::fileName(i-1).c_str() );
-                std::unique_ptr<epsilonnet> res( netGenerator::generate( base_net ) );
-                res->saveToFile( netGenerator::fileName(i).c_str() );
+                netGenerator::generate( base_net, netGenerator::fileName(i).c_str(),
+                                        m_options.memory_budget_mb << 20 );
             }
         }
     }
@@ -114,7 +120,8 @@ struct enetApplication
             return false;
         }
 
-        for( int i = std::max(initial_end,st) ; i < end; ++i )
+        const int first = initial_end;
+        for( int i = std::max(first,st) ; i < end; ++i )
         {
             if( m_layers[i] == 0 )
             {
@@ -127,12 +134,10 @@ struct enetApplication
 
     const enetOptions& m_options;       ///< Application options
     std::vector<int> m_layers;          ///< Ones for available layers, zeros for not availible layers
-    static const int initial_end;		///< Maximal layer generated on initial state
+    static const int initial_end = 21;  ///< Maximal layer generated on initial state
     bool initial_ok;                    ///< If all initial layers are availible
     netGenerator m_ng;                  ///< Epsilon net generator
 };
 
-const int enetApplication::initial_end = 21;
-
 #endif // EAPP_H
 
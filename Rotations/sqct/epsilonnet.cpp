@@ -21,7 +21,11 @@
 #include <cassert>
 #include <iostream>
 #include <iterator>
+#include <cstring>
+#include <cstdio>
+#include <stdint.h>
 #include "epsilonnet.h"
+#include "mappedfile.h"
 #include "output.h"
 
 #include <boost/range.hpp>
@@ -29,12 +33,108 @@ using boost::make_iterator_range;
 
 using namespace std;
 
-/// \brief Header of the file with epsilon net
+/// \brief Header of the file with epsilon net.
+/// The file is mapped read-only by epsilonnet::loadFromFile, so nodes,
+/// numbers and their coordinates are stored at offsets aligned to
+/// mappedFile::alignment in the machine format.
 struct epsilonnetHeader
 {
-    size_t nodes_count;
+    char     magic[8];        ///< Always enetMagic
+    uint32_t version;         ///< Format version, enetVersion
+    uint32_t node_size;       ///< sizeof(enetNode) of the writer
+    uint32_t number_size;     ///< sizeof(ring_int<int>) of the writer
+    uint32_t reserved;        ///< Zero
+    uint64_t nodes_count;     ///< Number of nodes, including the terminating one
+    uint64_t numbers_count;   ///< Number of numbers
+    uint64_t nodes_offset;    ///< Offset of nodes from the beginning of the file
+    uint64_t numbers_offset;  ///< Offset of numbers from the beginning of the file
+    uint64_t re_offset;       ///< Offset of real parts of numbers, see epsilonnet::numbersRe
+    uint64_t im_offset;       ///< Offset of imaginary parts of numbers, see epsilonnet::numbersIm
+    uint64_t data_checksum;   ///< Checksum of nodes, numbers and their coordinates
+    uint64_t header_checksum; ///< Checksum of the header with this field set to zero
 };
 
+static const char     enetMagic[8] = { 'S','Q','C','T','E','N','E','T' };
+static const uint32_t enetVersion = 2;
+/// \brief Checksum of the header, computed with header_checksum set to zero
+static uint64_t headerChecksum( const epsilonnetHeader& eh )
+{
+    epsilonnetHeader tmp = eh;
+    tmp.header_checksum = 0;
+    return mappedFile::checksum( &tmp, sizeof(tmp) );
+}
+
+/// \brief Fills in all fields of eh except checksums for a net with given number of nodes and numbers
+static void initHeader( epsilonnetHeader& eh, uint64_t nodes_count, uint64_t numbers_count )
+{
+    memset( &eh, 0, sizeof(eh) );
+    memcpy( eh.magic, enetMagic, sizeof(enetMagic) );
+    eh.version = enetVersion;
+    eh.node_size = sizeof(enetNode);
+    eh.number_size = sizeof(ring_int<int>);
+    eh.nodes_count = nodes_count;
+    eh.numbers_count = numbers_count;
+    eh.nodes_offset = mappedFile::align( sizeof(eh) );
+    eh.numbers_offset = mappedFile::align( eh.nodes_offset + eh.nodes_count * sizeof(enetNode) );
+    eh.re_offset = mappedFile::align( eh.numbers_offset + eh.numbers_count * sizeof(ring_int<int>) );
+    eh.im_offset = mappedFile::align( eh.re_offset + eh.numbers_count * sizeof(double) );
+}
+
+/// \brief Copy of count nodes with zero padding bytes, so that files do not depend on uninitialized memory
+static vector<enetNode> withZeroPadding( const enetNode* nd, size_t count )
+{
+    vector<enetNode> res( count );
+    memset( res.data(), 0, count * sizeof(enetNode) );
+    for( size_t i = 0; i < count; ++i )
+    {
+        res[i].ipxx = nd[i].ipxx;
+        res[i].ipQxx = nd[i].ipQxx;
+        res[i].num_offset = nd[i].num_offset;
+        res[i].compl_offset = nd[i].compl_offset;
+    }
+    return res;
+}
+
+/// \brief Checks that eh is a header of the current version written for the same
+/// layout of enetNode and ring_int<int>, and that the file of file_size bytes is not truncated
+static bool isValidHeader( const epsilonnetHeader& eh, uint64_t file_size )
+{
+    if( memcmp( eh.magic, enetMagic, sizeof(enetMagic) ) != 0 ||
+        eh.version != enetVersion ||
+        eh.node_size != sizeof(enetNode) ||
+        eh.number_size != sizeof(ring_int<int>) ||
+        eh.header_checksum != headerChecksum( eh ) )
+        return false;
+
+    if( eh.nodes_count == 0 ||
+        eh.nodes_offset % mappedFile::alignment != 0 ||
+        eh.numbers_offset % mappedFile::alignment != 0 ||
+        eh.nodes_offset < sizeof(eh) ||
+        eh.numbers_offset < eh.nodes_offset + eh.nodes_count * sizeof(enetNode) ||
+        eh.re_offset < eh.numbers_offset + eh.numbers_count * sizeof(ring_int<int>) ||
+        eh.im_offset < eh.re_offset + eh.numbers_count * sizeof(double) ||
+        eh.re_offset % mappedFile::alignment != 0 ||
+        eh.im_offset % mappedFile::alignment != 0 ||
+        eh.im_offset + eh.numbers_count * sizeof(double) > file_size )
+        return false;
+
+    return true;
+}
+
+/// \brief Reads the header of filename and checks it, see isValidHeader
+static bool readHeader( const char* filename, epsilonnetHeader& eh )
+{
+    ifstream ifs( filename, ios_base::binary );
+    if( !ifs )
+        return false;
+    ifs.seekg( 0, ios_base::end );
+    uint64_t file_size = ifs.tellg();
+    ifs.seekg( 0, ios_base::beg );
+    if( ! ifs.read( (char*) &eh,sizeof(eh)) )
+        return false;
+    return isValidHeader( eh, file_size );
+}
+
 std::ostream& operator<<(std::ostream& out, const enetNode& node )
 {
     out << "enetNode[" << node.ipxx << "," << node.ipQxx << ","
@@ -42,25 +142,50 @@ std::ostream& operator<<(std::ostream& out, const enetNode& node )
     return out;
 }
 
-bool epsilonnet::loadFromFile(const char* filename)
+bool epsilonnet::loadFromFile(const char* filename, bool verify)
 {
+    size_t length = 0;
+    std::shared_ptr<const void> file = mappedFile::map( filename, length );
     epsilonnetHeader eh;
-    ifstream ifs( filename, ios_base::binary );
-    if( !ifs )
+    if( !file || length < sizeof(eh) )
+        return false;
+    memcpy( &eh, file.get(), sizeof(eh) );
+    if( ! isValidHeader( eh, length ) )
         return false;
-    ifs.read( (char*) &eh,sizeof(eh));
+
+    const char* base = (const char*) file.get();
+    if( verify && ! mappedFile::isVerified( filename, eh.data_checksum ) )
+    {
+        // a corrupt net would silently give worse approximations, so every file
+        // is checked once and the result is recorded next to it
+        uint64_t h = mappedFile::checksum( base + eh.nodes_offset, eh.nodes_count * sizeof(enetNode) );
+        h = mappedFile::checksum( base + eh.numbers_offset, eh.numbers_count * sizeof(ri), h );
+        h = mappedFile::checksum( base + eh.re_offset, eh.numbers_count * sizeof(double), h );
+        h = mappedFile::checksum( base + eh.im_offset, eh.numbers_count * sizeof(double), h );
+        if( h != eh.data_checksum )
+            return false;
+        mappedFile::markVerified( filename, eh.data_checksum );
+    }
+
+    mapping = file;
+    mapped_nodes = (const enetNode*)( base + eh.nodes_offset );
+    mapped_nodes_count = eh.nodes_count;
+    mapped_numbers = (const ri*)( base + eh.numbers_offset );
+    mapped_numbers_count = eh.numbers_count;
+    mapped_re = (const double*)( base + eh.re_offset );
+    mapped_im = (const double*)( base + eh.im_offset );
+    mapped_checksum = eh.data_checksum;
     nodes.clear();
-    nodes.resize( eh.nodes_count );
-    ifs.read( (char*) &nodes[0], nodes.size() * sizeof(enetNode) );
     numbers.clear();
-    numbers.resize( nodes.back().num_offset );
-    ifs.read( (char*) &numbers[0], numbers.size() * sizeof(ri) );
-    ifs.close();
+    coords_re.clear();
+    coords_im.clear();
     denominator_exponent = denominatorExponent2();
     return true;
 }
 
-epsilonnet::epsilonnet()
+epsilonnet::epsilonnet() :
+    mapped_nodes(0), mapped_nodes_count(0), mapped_numbers(0), mapped_numbers_count(0),
+    mapped_re(0), mapped_im(0), mapped_checksum(0)
 {
     enetNode nd={0,0,0,0};
     nodes.push_back(nd);
@@ -69,30 +194,61 @@ epsilonnet::epsilonnet()
 size_t epsilonnet::nodesCount(const char* filename) const
 {
     epsilonnetHeader eh;
-    ifstream ifs( filename, ios_base::binary );
-    ifs.read( (char*) &eh,sizeof(eh));
-    ifs.close();
+    if( ! readHeader( filename, eh ) )
+        return 0;
     return eh.nodes_count;
 }
 
-void epsilonnet::saveToFile  (const char* filename) const
+bool epsilonnet::isValidFile(const char* filename)
 {
-    if( numbers.size() == 0 )
-        return;
-
     epsilonnetHeader eh;
-    eh.nodes_count = nodes.size();
-    ofstream ofs( filename, ios_base::binary );
-    ofs.write( (const char*) &eh,sizeof(eh));
+    return readHeader( filename, eh );
+}
+
+bool epsilonnet::verifyFile(const char* filename)
+{
+    epsilonnet net;
+    return net.loadFromFile( filename, true );
+}
 
-    assert( nodes.back().ipxx == 0 );
-    assert( nodes.back().ipQxx == 0 );
-    assert( nodes.back().num_offset == numbers.size() );
+void epsilonnet::saveToFile  (const char* filename) const
+{
+    if( numbersSize() == 0 )
+        return;
 
-    ofs.write( (const char*) &nodes[0], nodes.size() * sizeof(enetNode) );
-    ofs.write( (const char*) &numbers[0], numbers.size() * sizeof(ri) );
+    vector<enetNode> nodes_out = withZeroPadding( nodesData(), nodesSize() );
+    const enetNode* nd = nodes_out.data();
+    const ri* nb = numbersData();
+    assert( nd[nodesSize() - 1].ipxx == 0 );
+    assert( nd[nodesSize() - 1].ipQxx == 0 );
+    assert( nd[nodesSize() - 1].num_offset == numbersSize() );
 
-    ofs.close();
+    epsilonnetHeader eh;
+    initHeader( eh, nodesSize(), numbersSize() );
+
+    // coordinates with the denominator exponent that loadFromFile will use
+    int de = denominatorExponent2();
+    vector<double> re( eh.numbers_count ), im( eh.numbers_count );
+    for( size_t i = 0; i < eh.numbers_count; ++i )
+        nb[i].toComplex( de, re[i], im[i] );
+
+    uint64_t h = mappedFile::checksum( nd, eh.nodes_count * sizeof(enetNode) );
+    h = mappedFile::checksum( nb, eh.numbers_count * sizeof(ri), h );
+    h = mappedFile::checksum( re.data(), re.size() * sizeof(double), h );
+    eh.data_checksum = mappedFile::checksum( im.data(), im.size() * sizeof(double), h );
+    eh.header_checksum = headerChecksum( eh );
+
+    mappedFileWriter out( filename );
+    out.write( &eh,sizeof(eh));
+    out.padTo( eh.nodes_offset );
+    out.write( nd, eh.nodes_count * sizeof(enetNode) );
+    out.padTo( eh.numbers_offset );
+    out.write( nb, eh.numbers_count * sizeof(ri) );
+    out.padTo( eh.re_offset );
+    out.write( re.data(), re.size() * sizeof(double) );
+    out.padTo( eh.im_offset );
+    out.write( im.data(), im.size() * sizeof(double) );
+    out.commit();
 }
 
 /// \brief Comparator based on pointers data
@@ -128,6 +284,7 @@ public:
 
 void epsilonnet::addNode( const pair< ip_type,ip_type>& ip, const nodeRangesPtr &ranges)
 {
+    assert( !mapping && "Mapped epsilon net is read-only." );
     nodes.back().ipxx = ip.first;
     nodes.back().ipQxx = ip.second;
 
@@ -145,6 +302,7 @@ void epsilonnet::addNode( const pair< ip_type,ip_type>& ip, const nodeRangesPtr
 
 void epsilonnet::addNode(epsilonnet::ip_type ipxx, epsilonnet::ip_type ipQxx, const nodeRanges &ranges)
 {
+    assert( !mapping && "Mapped epsilon net is read-only." );
     nodes.back().ipxx = ipxx;
     nodes.back().ipQxx = ipQxx;
 
@@ -160,23 +318,25 @@ void epsilonnet::addNode(epsilonnet::ip_type ipxx, epsilonnet::ip_type ipQxx, co
 
 void epsilonnet::getNode(size_t node_id, nodeRanges &ranges) const
 {
-    const enetNode& node = nodes[ node_id ];
-    ranges.nums_begin = numbers.begin() + node.num_offset;
-    ranges.nums_end = numbers.begin() + complOffset( node_id );
+    const enetNode* nd = nodesData();
+    const ri* nb = numbersData();
+    ranges.nums_begin = nb + nd[ node_id ].num_offset;
+    ranges.nums_end = nb + complOffset( node_id );
     ranges.nums_compl_begin = ranges.nums_end;
-    ranges.nums_compl_end = numbers.begin() + nodes[ node_id + 1 ].num_offset;
+    ranges.nums_compl_end = nb + nd[ node_id + 1 ].num_offset;
 }
 
 size_t epsilonnet::complOffset(size_t nodeId) const
 {
-    const enetNode& node = nodes[ nodeId ];
+    const enetNode& node = nodesData()[ nodeId ];
     return node.num_offset + node.compl_offset;
 }
 
 int epsilonnet::denominatorExponent2() const
 {
     size_t offset = complOffset(0);
-    auto denom = numbers[offset].ipxx() + numbers[0].ipxx();
+    const ri* nb = numbersData();
+    auto denom = nb[offset].ipxx() + nb[0].ipxx();
     int val = ri::gde2( denom );
     // overflow check
     decltype( denom ) d = 1;
@@ -188,30 +348,60 @@ int epsilonnet::denominatorExponent2() const
 
 int epsilonnet::sde() const
 {
-    int res = ::sde( 2 * denominatorExponent2(), numbers[0].abs2().gde() );
+    int res = ::sde( 2 * denominatorExponent2(), numbersData()[0].abs2().gde() );
     if( res == std::numeric_limits<int>::max() ) res = 0;
     return res;
 }
 
+void epsilonnet::initCoordinates()
+{
+    assert( !mapping && "Mapped epsilon net has coordinates in file." );
+    denominator_exponent = denominatorExponent2();
+    coords_re.resize( numbers.size() );
+    coords_im.resize( numbers.size() );
+    for( size_t i = 0; i < numbers.size(); ++i )
+        numbers[i].toComplex( denominator_exponent, coords_re[i], coords_im[i] );
+}
+
 double epsilonnet::findExhaustiveApproximation(const epsilonnet::vector2double &vec, epsilonnet::vi &result) const
 {
-    //denominator_exponent = denominatorExponent2();
-    vi current;
-    double current_dist = 1.0;
     double best_dist = 1.0;
+    int best_node = -1;
     vector2double canonical_vec = vec;
     bool conj_1 = false, conj_2 = false;
     int w_pow1 = 0, w_pow2 = 0;
     canonical_vec.first = canonical( vec.first, w_pow1, conj_1 );
     canonical_vec.second = canonical( vec.second, w_pow2, conj_2 );
 
-    for( int i = 0; i < nodes.size(); ++i )
+    // Nodes are split between threads, each thread keeps the best node of its
+    // part and the one with the smallest id wins ties, as in the serial loop.
+    // The last node only terminates the list.
+    int nodes_count = nodesSize() - 1;
+    #pragma omp parallel if( nodes_count > 64 )
     {
-        current_dist = findExhaustiveApproximation( canonical_vec, current, i );
-        if( best_dist > current_dist )
+        vi current, thread_res;
+        double thread_dist = 1.0;
+        int thread_node = -1;
+
+        #pragma omp for schedule(dynamic,16) nowait
+        for( int i = 0; i < nodes_count; ++i )
+        {
+            double current_dist = findExhaustiveApproximation( canonical_vec, current, i );
+            if( thread_dist > current_dist )
+            {
+                thread_dist = current_dist;
+                thread_node = i;
+                thread_res = current;
+            }
+        }
+
+        #pragma omp critical
+        if( thread_node >= 0 && ( thread_dist < best_dist ||
+                                  ( thread_dist == best_dist && thread_node < best_node ) ) )
         {
-            best_dist = current_dist;
-            result  = current;
+            best_dist = thread_dist;
+            best_node = thread_node;
+            result = thread_res;
         }
     }
 
@@ -230,6 +420,11 @@ double epsilonnet::findExhaustiveApproximation(const epsilonnet::vector2double &
 
 typedef  epsilonnet::vector2double vd;
 
+// The kernels below must compute distances with exactly the same roundings,
+// so that they choose the same approximation; fused multiply-add would change them.
+#pragma GCC push_options
+#pragma GCC optimize ("fp-contract=off")
+
 /// \brief Inline Euclidean distance computation
 inline double dist_squared( const vd& a, const vd& b )
 {
@@ -250,107 +445,295 @@ inline double dist_squared( const vd& a, double fre,  double fim , double sre ,
     return d1*d1 +d2*d2 +d3*d3 + d4*d4;
 }
 
-/// \todo Remove code duplication by changing one of epsilonnet::findExhaustiveApproximation
-double epsilonnet::findExhaustiveApproximation(const epsilonnet::vector2double &vec, epsilonnet::vi &result, int node_id) const
+/// \brief Finds the pair of numbers i in [ib,ie), j in [jb,je) such that (i,j) or (j,i)
+/// is closer to vec than bdist. Numbers are given by their coordinates re, im.
+/// Updates bdist and best if such a pair exists. Among pairs at the same distance
+/// the first one in the order of the loops over i, j and then (i,j), (j,i) is chosen,
+/// so all kernels give the same results.
+typedef void (*enetKernel)( const vd& vec, const double* re, const double* im,
+                            size_t ib, size_t ie, size_t jb, size_t je,
+                            double& bdist, enetPair& best );
+
+/// \brief Scalar kernel, see enetKernel
+static void findPairScalar( const vd& vec, const double* re, const double* im,
+                            size_t ib, size_t ie, size_t jb, size_t je,
+                            double& bdist, enetPair& best )
 {
-    double best = 3.0;
-    nodeRanges nr;
-    getNode( node_id, nr );
-    auto ic = nr.nums_begin;
-    auto jc = nr.nums_compl_begin;
-    bool tw = true;
-    for( auto i = nr.nums_begin; i != nr.nums_end ;++i )
+    for( size_t i = ib; i < ie; ++i )
     {
-        double iim, ire;
-        i->toComplex( denominator_exponent, ire, iim );
-        for( auto j = nr.nums_compl_begin; j != nr.nums_compl_end; ++j )
+        double ire = re[i], iim = im[i];
+        for( size_t j = jb; j < je; ++j )
         {
-            double jim, jre;
-            j->toComplex( denominator_exponent, jre, jim  );
+            double jre = re[j], jim = im[j];
             double d1 = dist_squared( vec, ire, iim, jre, jim );
             double d2 = dist_squared( vec, jre, jim, ire, iim );
 
-            if( d1 < best )
+            if( d1 < bdist )
             {
-                best = d1;
-                ic = i; jc = j;
-                tw = false;
+                bdist = d1;
+                best.i = i; best.j = j;
+                best.tw = false;
+                best.found = true;
             }
 
-            if( d2 < best )
+            if( d2 < bdist )
             {
-                best = d2;
-                ic = i; jc = j;
-                tw = true;
+                bdist = d2;
+                best.i = i; best.j = j;
+                best.tw = true;
+                best.found = true;
             }
         }
     }
+}
 
-    if( tw )
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#include <immintrin.h>
+#define SQCT_ENET_SIMD
+
+/// \brief Picks the best of the lane results of a vector kernel.
+/// Each lane keeps the first pair closest to vec in its order, key encodes
+/// the position of the pair as 2 * ( (i - ib) * (je - jb) + (j - jb) ) + tw,
+/// so the smallest key wins ties. Negative key means nothing was found.
+static void reduceLanes( const double* dist, const double* key, int lanes,
+                         size_t ib, size_t jb, size_t nj,
+                         double& bdist, enetPair& best )
+{
+    double best_key = -1.0;
+    double best_dist = bdist;
+    for( int l = 0; l < lanes; ++l )
     {
-        result.d[0] = *jc;
-        result.d[1] = *ic;
-        //result.de = denominator_exponent; // -avoid extra operations
+        if( key[l] < 0.0 )
+            continue;
+        if( dist[l] < best_dist || ( dist[l] == best_dist && ( best_key < 0.0 || key[l] < best_key ) ) )
+        {
+            best_dist = dist[l];
+            best_key = key[l];
+        }
     }
-    else
+
+    if( best_key < 0.0 )
+        return;
+
+    size_t k = (size_t) best_key;
+    bdist = best_dist;
+    best.i = ib + k / ( 2 * nj );
+    best.j = jb + ( k % ( 2 * nj ) ) / 2;
+    best.tw = ( k % 2 ) != 0;
+    best.found = true;
+}
+
+/// \brief Kernel for AVX2, see enetKernel. Computes distances with the same
+/// operations as dist_squared, for 4 complementary numbers at once.
+__attribute__((target("avx2")))
+static void findPairAvx2( const vd& vec, const double* re, const double* im,
+                          size_t ib, size_t ie, size_t jb, size_t je,
+                          double& bdist, enetPair& best )
+{
+    const size_t nj = je - jb;
+    const size_t nv = nj - nj % 4;
+    const __m256d v1r = _mm256_set1_pd( vec.first.real() );
+    const __m256d v1i = _mm256_set1_pd( vec.first.imag() );
+    const __m256d v2r = _mm256_set1_pd( vec.second.real() );
+    const __m256d v2i = _mm256_set1_pd( vec.second.imag() );
+    const __m256d lane = _mm256_set_pd( 6.0, 4.0, 2.0, 0.0 );
+    const __m256d one = _mm256_set1_pd( 1.0 );
+    __m256d lbest = _mm256_set1_pd( bdist );
+    __m256d lkey = _mm256_set1_pd( -1.0 );
+    double tail_dist = bdist, tail_key = -1.0;
+
+    for( size_t i = ib; i < ie; ++i )
     {
-        result.d[0] = *ic;
-        result.d[1] = *jc;
-        //result.de = denominator_exponent; // -avoid extra operations
+        const __m256d ire = _mm256_set1_pd( re[i] );
+        const __m256d iim = _mm256_set1_pd( im[i] );
+        // differences that do not depend on j
+        const __m256d a1 = _mm256_sub_pd( v1r, ire ), a3 = _mm256_sub_pd( v1i, iim );
+        const __m256d b2 = _mm256_sub_pd( v2r, ire ), b4 = _mm256_sub_pd( v2i, iim );
+        const double row = 2.0 * ( i - ib ) * nj;
+
+        for( size_t j = 0; j < nv; j += 4 )
+        {
+            const __m256d jre = _mm256_loadu_pd( re + jb + j );
+            const __m256d jim = _mm256_loadu_pd( im + jb + j );
+            const __m256d a2 = _mm256_sub_pd( v2r, jre ), a4 = _mm256_sub_pd( v2i, jim );
+            const __m256d b1 = _mm256_sub_pd( v1r, jre ), b3 = _mm256_sub_pd( v1i, jim );
+
+            __m256d d1 = _mm256_add_pd( _mm256_mul_pd( a1, a1 ), _mm256_mul_pd( a2, a2 ) );
+            d1 = _mm256_add_pd( d1, _mm256_mul_pd( a3, a3 ) );
+            d1 = _mm256_add_pd( d1, _mm256_mul_pd( a4, a4 ) );
+            __m256d d2 = _mm256_add_pd( _mm256_mul_pd( b1, b1 ), _mm256_mul_pd( b2, b2 ) );
+            d2 = _mm256_add_pd( d2, _mm256_mul_pd( b3, b3 ) );
+            d2 = _mm256_add_pd( d2, _mm256_mul_pd( b4, b4 ) );
+
+            const __m256d key = _mm256_add_pd( _mm256_set1_pd( row + 2.0 * j ), lane );
+            __m256d m = _mm256_cmp_pd( d1, lbest, _CMP_LT_OQ );
+            lbest = _mm256_blendv_pd( lbest, d1, m );
+            lkey = _mm256_blendv_pd( lkey, key, m );
+            m = _mm256_cmp_pd( d2, lbest, _CMP_LT_OQ );
+            lbest = _mm256_blendv_pd( lbest, d2, m );
+            lkey = _mm256_blendv_pd( lkey, _mm256_add_pd( key, one ), m );
+        }
+
+        for( size_t j = nv; j < nj; ++j )
+        {
+            double jre = re[jb + j], jim = im[jb + j];
+            double d1 = dist_squared( vec, re[i], im[i], jre, jim );
+            double d2 = dist_squared( vec, jre, jim, re[i], im[i] );
+            if( d1 < tail_dist ) { tail_dist = d1; tail_key = row + 2.0 * j; }
+            if( d2 < tail_dist ) { tail_dist = d2; tail_key = row + 2.0 * j + 1.0; }
+        }
     }
 
-    return best;
+    double dist[5], key[5];
+    _mm256_storeu_pd( dist, lbest );
+    _mm256_storeu_pd( key, lkey );
+    dist[4] = tail_dist;
+    key[4] = tail_key;
+    reduceLanes( dist, key, 5, ib, jb, nj, bdist, best );
 }
 
-double epsilonnet::findExhaustiveApproximation(const epsilonnet::vector2double &vec, epsilonnet::vi &result, int node_id, double &bdist) const
+/// \brief Kernel for AVX-512, see enetKernel and findPairAvx2
+__attribute__((target("avx512f")))
+static void findPairAvx512( const vd& vec, const double* re, const double* im,
+                            size_t ib, size_t ie, size_t jb, size_t je,
+                            double& bdist, enetPair& best )
 {
-    nodeRanges nr;
-    getNode( node_id, nr );
-    bool found = false;
-    auto ic = nr.nums_begin;
-    auto jc = nr.nums_compl_begin;
-    bool tw = true;
-    for( auto i = nr.nums_begin; i != nr.nums_end ;++i )
+    const size_t nj = je - jb;
+    const size_t nv = nj - nj % 8;
+    const __m512d v1r = _mm512_set1_pd( vec.first.real() );
+    const __m512d v1i = _mm512_set1_pd( vec.first.imag() );
+    const __m512d v2r = _mm512_set1_pd( vec.second.real() );
+    const __m512d v2i = _mm512_set1_pd( vec.second.imag() );
+    const __m512d lane = _mm512_set_pd( 14.0, 12.0, 10.0, 8.0, 6.0, 4.0, 2.0, 0.0 );
+    const __m512d one = _mm512_set1_pd( 1.0 );
+    __m512d lbest = _mm512_set1_pd( bdist );
+    __m512d lkey = _mm512_set1_pd( -1.0 );
+    double tail_dist = bdist, tail_key = -1.0;
+
+    for( size_t i = ib; i < ie; ++i )
     {
-        double iim, ire;
-        i->toComplex( denominator_exponent, ire, iim );
-        for( auto j = nr.nums_compl_begin; j != nr.nums_compl_end; ++j )
-        {
-            double jim, jre;
-            j->toComplex( denominator_exponent, jre, jim  );
-            double d1 = dist_squared( vec, ire, iim, jre, jim );
-            double d2 = dist_squared( vec, jre, jim, ire, iim );
+        const __m512d ire = _mm512_set1_pd( re[i] );
+        const __m512d iim = _mm512_set1_pd( im[i] );
+        const __m512d a1 = _mm512_sub_pd( v1r, ire ), a3 = _mm512_sub_pd( v1i, iim );
+        const __m512d b2 = _mm512_sub_pd( v2r, ire ), b4 = _mm512_sub_pd( v2i, iim );
+        const double row = 2.0 * ( i - ib ) * nj;
 
-            if( d1 < bdist )
-            {
-                found = true;
-                bdist = d1;
-                ic = i; jc = j;
-                tw = false;
-            }
+        for( size_t j = 0; j < nv; j += 8 )
+        {
+            const __m512d jre = _mm512_loadu_pd( re + jb + j );
+            const __m512d jim = _mm512_loadu_pd( im + jb + j );
+            const __m512d a2 = _mm512_sub_pd( v2r, jre ), a4 = _mm512_sub_pd( v2i, jim );
+            const __m512d b1 = _mm512_sub_pd( v1r, jre ), b3 = _mm512_sub_pd( v1i, jim );
+
+            __m512d d1 = _mm512_add_pd( _mm512_mul_pd( a1, a1 ), _mm512_mul_pd( a2, a2 ) );
+            d1 = _mm512_add_pd( d1, _mm512_mul_pd( a3, a3 ) );
+            d1 = _mm512_add_pd( d1, _mm512_mul_pd( a4, a4 ) );
+            __m512d d2 = _mm512_add_pd( _mm512_mul_pd( b1, b1 ), _mm512_mul_pd( b2, b2 ) );
+            d2 = _mm512_add_pd( d2, _mm512_mul_pd( b3, b3 ) );
+            d2 = _mm512_add_pd( d2, _mm512_mul_pd( b4, b4 ) );
+
+            const __m512d key = _mm512_add_pd( _mm512_set1_pd( row + 2.0 * j ), lane );
+            __mmask8 m = _mm512_cmp_pd_mask( d1, lbest, _CMP_LT_OQ );
+            lbest = _mm512_mask_blend_pd( m, lbest, d1 );
+            lkey = _mm512_mask_blend_pd( m, lkey, key );
+            m = _mm512_cmp_pd_mask( d2, lbest, _CMP_LT_OQ );
+            lbest = _mm512_mask_blend_pd( m, lbest, d2 );
+            lkey = _mm512_mask_blend_pd( m, lkey, _mm512_add_pd( key, one ) );
+        }
 
-            if( d2 < bdist )
-            {
-                found = true;
-                bdist = d2;
-                ic = i; jc = j;
-                tw = true;
-            }
+        for( size_t j = nv; j < nj; ++j )
+        {
+            double jre = re[jb + j], jim = im[jb + j];
+            double d1 = dist_squared( vec, re[i], im[i], jre, jim );
+            double d2 = dist_squared( vec, jre, jim, re[i], im[i] );
+            if( d1 < tail_dist ) { tail_dist = d1; tail_key = row + 2.0 * j; }
+            if( d2 < tail_dist ) { tail_dist = d2; tail_key = row + 2.0 * j + 1.0; }
         }
     }
 
-    if( found )
+    double dist[9], key[9];
+    _mm512_storeu_pd( dist, lbest );
+    _mm512_storeu_pd( key, lkey );
+    dist[8] = tail_dist;
+    key[8] = tail_key;
+    reduceLanes( dist, key, 9, ib, jb, nj, bdist, best );
+}
+#endif
+
+#pragma GCC pop_options
+
+/// \brief Chooses the widest kernel supported by the processor
+static enetKernel selectKernel()
+{
+#ifdef SQCT_ENET_SIMD
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx512f" ) )
+        return findPairAvx512;
+    if( __builtin_cpu_supports( "avx2" ) )
+        return findPairAvx2;
+#endif
+    return findPairScalar;
+}
+
+/// \brief Kernel used by epsilonnet::findClosestPair
+static const enetKernel findPair = selectKernel();
+
+void epsilonnet::findClosestPair( const vector2double& vec, const double* re, const double* im,
+                                  size_t ib, size_t ie, size_t jb, size_t je,
+                                  double& bdist, enetPair& best )
+{
+    findPair( vec, re, im, ib, ie, jb, je, bdist, best );
+}
+
+double epsilonnet::findExhaustiveApproximation(const epsilonnet::vector2double &vec, epsilonnet::vi &result, int node_id) const
+{
+    double best = 3.0;
+    const enetNode* nd = nodesData();
+    size_t ib = nd[ node_id ].num_offset;
+    size_t jb = complOffset( node_id );
+    size_t je = ( (size_t) node_id + 1 < nodesSize() ) ? nd[ node_id + 1 ].num_offset : jb;
+    enetPair bp = { ib, jb, true, false };
+    findPair( vec, numbersRe(), numbersIm(), ib, jb, jb, je, best, bp );
+
+    const ri* nb = numbersData();
+    if( bp.tw )
     {
-        if( tw )
+        result.d[0] = nb[bp.j];
+        result.d[1] = nb[bp.i];
+        //result.de = denominator_exponent; // -avoid extra operations
+    }
+    else
+    {
+        result.d[0] = nb[bp.i];
+        result.d[1] = nb[bp.j];
+        //result.de = denominator_exponent; // -avoid extra operations
+    }
+
+    return best;
+}
+
+double epsilonnet::findExhaustiveApproximation(const epsilonnet::vector2double &vec, epsilonnet::vi &result, int node_id, double &bdist) const
+{
+    const enetNode* nd = nodesData();
+    size_t ib = nd[ node_id ].num_offset;
+    size_t jb = complOffset( node_id );
+    size_t je = ( (size_t) node_id + 1 < nodesSize() ) ? nd[ node_id + 1 ].num_offset : jb;
+    enetPair bp = { ib, jb, true, false };
+    findPair( vec, numbersRe(), numbersIm(), ib, jb, jb, je, bdist, bp );
+
+    if( bp.found )
+    {
+        const ri* nb = numbersData();
+        if( bp.tw )
         {
-            result.d[0] = *jc;
-            result.d[1] = *ic;
+            result.d[0] = nb[bp.j];
+            result.d[1] = nb[bp.i];
             result.de = denominator_exponent;
         }
         else
         {
-            result.d[0] = *ic;
-            result.d[1] = *jc;
+            result.d[0] = nb[bp.i];
+            result.d[1] = nb[bp.j];
             result.de = denominator_exponent;
         }
     }
@@ -441,3 +824,108 @@ double epsilonnet::findExhaustiveApproximation(const epsilonnet::vector2double &
 //        functor( second, first );
 //    }
 //}
+
+/////////////////////////////////////////////////////
+
+epsilonnetWriter::epsilonnetWriter( const char* filename ) :
+    m_target( filename ), m_spill( string( filename ) + ".numbers.tmp" ),
+    m_fs( m_spill.c_str(), ios_base::binary | ios_base::in | ios_base::out | ios_base::trunc ),
+    m_numbers_count(0)
+{
+    enetNode nd={0,0,0,0};
+    m_nodes.push_back(nd);
+}
+
+epsilonnetWriter::~epsilonnetWriter()
+{
+    m_fs.close();
+    remove( m_spill.c_str() );
+}
+
+void epsilonnetWriter::addNode( ip_type ipxx, ip_type ipQxx, const nodeRanges& ranges )
+{
+    m_nodes.back().ipxx = ipxx;
+    m_nodes.back().ipQxx = ipQxx;
+
+    auto bi = back_inserter( m_buffer );
+    size_t size = m_buffer.size();
+    unique_copy( ranges.nums_begin, ranges.nums_end ,bi );
+    m_nodes.back().compl_offset = m_buffer.size() - size;
+    unique_copy( ranges.nums_compl_begin, ranges.nums_compl_end , bi );
+
+    enetNode en = {0,0,m_numbers_count + m_buffer.size(),0};
+    m_nodes.push_back(en);
+
+    if( m_buffer.size() >= chunk_size )
+        flush();
+}
+
+void epsilonnetWriter::flush()
+{
+    m_fs.write( (const char*) m_buffer.data(), m_buffer.size() * sizeof(ri) );
+    m_numbers_count += m_buffer.size();
+    m_buffer.clear();
+}
+
+void epsilonnetWriter::readNumbers( size_t offset, size_t count )
+{
+    m_buffer.resize( count );
+    m_fs.seekg( offset * sizeof(ri) );
+    m_fs.read( (char*) m_buffer.data(), count * sizeof(ri) );
+}
+
+bool epsilonnetWriter::commit()
+{
+    flush();
+    if( m_numbers_count == 0 || !m_fs )
+        return false;
+
+    epsilonnetHeader eh;
+    initHeader( eh, m_nodes.size(), m_numbers_count );
+
+    // same as epsilonnet::denominatorExponent2
+    readNumbers( 0, 1 );
+    ri first = m_buffer[0];
+    readNumbers( m_nodes[0].num_offset + m_nodes[0].compl_offset, 1 );
+    int de = ri::gde2( m_buffer[0].ipxx() + first.ipxx() );
+
+    // header is written again when checksums are known
+    mappedFileWriter out( m_target.c_str() );
+    out.write( &eh,sizeof(eh));
+    out.padTo( eh.nodes_offset );
+    m_nodes = withZeroPadding( m_nodes.data(), m_nodes.size() );
+    out.write( m_nodes.data(), eh.nodes_count * sizeof(enetNode) );
+    uint64_t h = mappedFile::checksum( m_nodes.data(), eh.nodes_count * sizeof(enetNode) );
+
+    // numbers, their real and imaginary parts are streamed from the temporary file
+    const uint64_t offsets[3] = { eh.numbers_offset, eh.re_offset, eh.im_offset };
+    vector<double> re, im;
+    for( int part = 0; part < 3; ++part )
+    {
+        out.padTo( offsets[part] );
+        for( size_t i = 0; i < m_numbers_count; i += chunk_size )
+        {
+            readNumbers( i, min( (size_t) chunk_size, m_numbers_count - i ) );
+            if( part == 0 )
+            {
+                out.write( m_buffer.data(), m_buffer.size() * sizeof(ri) );
+                h = mappedFile::checksum( m_buffer.data(), m_buffer.size() * sizeof(ri), h );
+                continue;
+            }
+
+            re.resize( m_buffer.size() );
+            im.resize( m_buffer.size() );
+            for( size_t j = 0; j < m_buffer.size(); ++j )
+                m_buffer[j].toComplex( de, re[j], im[j] );
+            const vector<double>& c = ( part == 1 ) ? re : im;
+            out.write( c.data(), c.size() * sizeof(double) );
+            h = mappedFile::checksum( c.data(), c.size() * sizeof(double), h );
+        }
+    }
+    m_buffer.clear();
+
+    eh.data_checksum = h;
+    eh.header_checksum = headerChecksum( eh );
+    out.rewrite( 0, &eh, sizeof(eh) );
+    return m_fs && out.commit();
+}
@@ -22,6 +22,9 @@
 #include "rint.h"
 #include "vector2.h"
 #include <vector>
+#include <memory>
+#include <fstream>
+#include <string>
 
 /// \brief Node of epsilon net
 struct enetNode
@@ -44,8 +47,8 @@ struct nodeRanges
 {
     /// \brief Type of the ring elements
     typedef ring_int<int> ri;
-    /// \brief Type of ranges iterator
-    typedef std::vector<ri>::const_iterator cit;
+    /// \brief Type of ranges iterator, points into epsilonnet numbers
+    typedef const ri* cit;
 
     /// \brief First element of numbers range
     cit nums_begin;
@@ -77,6 +80,15 @@ struct nodeRangesPtr
 
 
 
+/// \brief Pair of numbers closest to a vector, see epsilonnet::findClosestPair
+struct enetPair
+{
+    size_t i;   ///< Index of the number from the first part of the node
+    size_t j;   ///< Index of the complementary number
+    bool   tw;  ///< True if the complementary number goes first in the vector
+    bool   found; ///< True if the pair is closer than the initial distance
+};
+
 /// \brief Serializable epsilon net made from the ring elements with a fixed power of \f$ \sqrt{2} \f$ in the denominator
 class epsilonnet
 {
@@ -95,10 +107,17 @@ public:
 
     /// \brief Number of nodes in file
     size_t nodesCount (const char* filename) const;
-    /// \brief Loads epsilon net from file
-    bool loadFromFile(const char* filename);
+    /// \brief Maps epsilon net from file read-only, nodes and numbers are accessed in place.
+    /// If verify is true also checks the checksum of the nodes and numbers, unless
+    /// the file passed this check before and did not change since, see mappedFile::isVerified
+    bool loadFromFile(const char* filename, bool verify = true);
     /// \brief Saves epsilon net to file
     void saveToFile  (const char* filename) const;
+    /// \brief True if filename has the header of an epsilon net file of the current version
+    static bool isValidFile(const char* filename);
+    /// \brief True if filename is a valid epsilon net file whose checksum matches its data,
+    /// \see loadFromFile
+    static bool verifyFile(const char* filename);
 
     /// \brief Adds vectors with P(x) = ip.first and Q(x) = ip.second,
     /// \see ring_int::ipxx() and ring_int::ipQxx()
@@ -118,25 +137,112 @@ public:
     int    denominatorExponent2() const;
     /// \brief Returns sde of a base\f$ \sqrt{2} \f$ for given \f$\varepsilon-\f$ net. Assumes that it is the same for all elements.
     int    sde() const;
+    /// \brief Computes numbersRe() and numbersIm() and denominator_exponent
+    /// for epsilon net created on the fly
+    void   initCoordinates();
     /// \brief Exhaustively finds the best approximating vector withing given epsilon net.
-    /// \note If you create epsilon net on the fly ( not loading it from file ), you need to initialize denominator_exponent before using this method.
+    /// Nodes are split between OpenMP threads.
+    /// \note If you create epsilon net on the fly ( not loading it from file ), you need to call initCoordinates() before using this method.
     /// \returns Euclidean distance squared to the best approximating vector
     double findExhaustiveApproximation( const vector2double& vec, vi& result ) const;
 
-    /// \brief Vector of epsilon node
+    /// \brief Nodes of epsilon net, either mapped from file or built by addNode
+    const enetNode* nodesData() const { return mapping ? mapped_nodes : nodes.data(); }
+    /// \brief Number of nodes, including the terminating one
+    size_t nodesSize() const { return mapping ? mapped_nodes_count : nodes.size(); }
+    /// \brief Numbers that appears in epsilon net, either mapped from file or built by addNode
+    const ri* numbersData() const { return mapping ? mapped_numbers : numbers.data(); }
+    /// \brief Number of numbers
+    size_t numbersSize() const { return mapping ? mapped_numbers_count : numbers.size(); }
+    /// \brief Real parts of numbers, ring_int::toComplex( denominator_exponent, ... )
+    const double* numbersRe() const { return mapping ? mapped_re : coords_re.data(); }
+    /// \brief Imaginary parts of numbers, ring_int::toComplex( denominator_exponent, ... )
+    const double* numbersIm() const { return mapping ? mapped_im : coords_im.data(); }
+    /// \brief Checksum of the data of the file the net was loaded from, zero for nets built by addNode
+    uint64_t dataChecksum() const { return mapping ? mapped_checksum : 0; }
+
+    /// \brief Vector of epsilon node, used while net is built by addNode
     std::vector<enetNode>  nodes;
-    /// \brief Vector of numbers that appears in epsilon net
+    /// \brief Vector of numbers that appears in epsilon net, used while net is built by addNode
     std::vector<ri>        numbers;
     /// \brief Denominator exponent of epsilon net elements
     int                    denominator_exponent;
 
+    /// \brief Finds i in [ib,ie), j in [jb,je) such that vector (i,j) or (j,i) of numbers
+    /// with coordinates re, im is closer to vec than bdist, using the widest SIMD kernel
+    /// the processor supports. Updates bdist and best if such a pair exists.
+    /// Among pairs at the same distance the first one in the order of loops over i, j and
+    /// then (i,j), (j,i) is chosen.
+    static void findClosestPair( const vector2double& vec, const double* re, const double* im,
+                                 size_t ib, size_t ie, size_t jb, size_t je,
+                                 double& bdist, enetPair& best );
+
     /// \brief Finds exhaustive approximation within fixed node
     double findExhaustiveApproximation( const vector2double& vec, vi& result, int node_id ) const;
     /// \brief Finds exhaustive approximation within fixed node only if distance to the best possible vector is less than ndist.
     /// Do nothing otherwise. Useful to reduce amount of copy operations
     double findExhaustiveApproximation( const vector2double& vec, vi& result, int node_id, double& bdist ) const;
 
+private:
+    /// \brief Read-only mapping of the file loaded by loadFromFile, shared by copies
+    std::shared_ptr<const void> mapping;
+    /// \brief Nodes inside mapping
+    const enetNode* mapped_nodes;
+    /// \brief Number of nodes inside mapping
+    size_t mapped_nodes_count;
+    /// \brief Numbers inside mapping
+    const ri* mapped_numbers;
+    /// \brief Number of numbers inside mapping
+    size_t mapped_numbers_count;
+    /// \brief Real parts of numbers inside mapping
+    const double* mapped_re;
+    /// \brief Imaginary parts of numbers inside mapping
+    const double* mapped_im;
+    /// \brief Checksum of nodes, numbers and their coordinates inside mapping
+    uint64_t mapped_checksum;
+    /// \brief Real parts of numbers, computed by initCoordinates
+    std::vector<double> coords_re;
+    /// \brief Imaginary parts of numbers, computed by initCoordinates
+    std::vector<double> coords_im;
 };
 
+/// \brief Writes epsilon net to file node by node. Numbers are kept in memory only in
+/// chunks and spilled to a temporary file until commit() writes the final file.
+/// The file is identical to the one epsilonnet::saveToFile writes for the net built by
+/// the same sequence of epsilonnet::addNode calls.
+class epsilonnetWriter
+{
+public:
+    /// \brief Type of the ring elements
+    typedef ring_int<int> ri;
+    /// \brief Type that is used for P(x) and Q(x) \see ring_int::ipxx() and ring_int::ipQxx()
+    typedef ri::pr_type ip_type;
+    /// \brief Number of numbers kept in memory before they are spilled
+    static const size_t chunk_size = 1 << 16;
+
+    /// \brief Opens temporary file next to filename
+    explicit epsilonnetWriter( const char* filename );
+    /// \brief Removes temporary file
+    ~epsilonnetWriter();
+
+    /// \brief Same as epsilonnet::addNode
+    void addNode( ip_type ipxx, ip_type ipQxx, const nodeRanges& ranges );
+    /// \brief Writes epsilon net to the file, nothing is written for empty net
+    /// \returns False if nothing was written or some of the writes failed
+    bool commit();
+
+private:
+    /// \brief Appends buffered numbers to the temporary file
+    void flush();
+    /// \brief Reads count numbers starting from offset from the temporary file into m_buffer
+    void readNumbers( size_t offset, size_t count );
+
+    std::string m_target;           ///< Name of the file to write
+    std::string m_spill;            ///< Name of the temporary file with numbers
+    std::fstream m_fs;              ///< Temporary file with numbers
+    std::vector<enetNode> m_nodes;  ///< Nodes written so far, including the terminating one
+    std::vector<ri> m_buffer;       ///< Numbers not yet spilled
+    size_t m_numbers_count;         ///< Number of numbers spilled
+};
 
 #endif // EPSILONNET_H
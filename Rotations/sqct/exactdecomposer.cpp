@@ -35,7 +35,7 @@ exactDecomposer::exactDecomposer()
     }
 }
 
-void exactDecomposer::decompose( const matrix2x2<mpz_class>& matr, circuit& c)
+void exactDecomposer::decompose( const matrix2x2<mpz_class>& matr, circuit& c) const
 {
     typedef ring_int< resring<8> > rr8;
     typedef matrix2x2< resring<8> > mrr8;
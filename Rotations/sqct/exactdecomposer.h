@@ -30,7 +30,7 @@ public:
     /// \brief Initializes generators
     exactDecomposer();
     /// \brief Decomposes matr into circuit c
-    void decompose( const matrix2x2<mpz_class> &matr, circuit& c );
+    void decompose( const matrix2x2<mpz_class> &matr, circuit& c ) const;
 private:
     /// \brief Matrix over the ring type used during decomposition
     typedef matrix2x2<mpz_class> M;
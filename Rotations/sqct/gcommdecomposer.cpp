@@ -35,94 +35,125 @@ typedef matrix2x2hpr M;
 /// \brief Type for high precision matrices
 typedef Vector3hpr V;
 
+/// \brief Real constants used by group commutator decomposition, for both
+/// high precision and quadruple precision numbers
+template < class T >
+struct gcConstants
+{
+    /// \brief Returns 1
+    static const T& one() { static const T v(1); return v; }
+    /// \brief Returns 1/2
+    static const T& half() { static const T v( T(1) / T(2) ); return v; }
+    /// \brief Returns -1/2
+    static const T& mhalf() { static const T v( T(-1) / T(2) ); return v; }
+};
+
 /// \brief Returns rotation by angle \f$ \theta \f$ around axis V:
 /// \f$ I\cos\left(\frac{\theta}{2}\right)-i\sin\left(\frac{\theta}{2}\right)\left(n_{x}X+n_{y}Y+n_{z}Z\right) \f$,
 /// where X,Y,Z -- Pauli matrices
 /// \param sinTheta2 \f$ sin(\theta / 2) \f$
-M rot( const mpclass& sinTheta2, V& axis )
+template < class Mt >
+Mt rot( const typename Mt::mpclass& sinTheta2, Vector3<typename Mt::mpclass>& axis )
 {
-    static const mpclass& one = hprHelpers::one();
-    mpclass cosTheta2 = sqrt( one - sinTheta2 * sinTheta2 );
-    return  M::Id() * cosTheta2 + M::scalar(0,-sinTheta2) * ( axis.v[0] *M::X()  + axis.v[1]*M::Y() + axis.v[2]*M::Z() );
+    typedef typename Mt::mpclass real;
+    const real& one = gcConstants<real>::one();
+    real cosTheta2 = realSqrt( one - sinTheta2 * sinTheta2 );
+    return  Mt::Id() * cosTheta2 + typename Mt::scalar(0,-sinTheta2) * ( axis.v[0] *Mt::X()  + axis.v[1]*Mt::Y() + axis.v[2]*Mt::Z() );
 }
 
 /// \brief Returns group comutator of rotations around X and Y axis by angle \f$ \theta \f$
-M gc( const mpclass& sinTheta2 )
+template < class Mt >
+Mt gc( const typename Mt::mpclass& sinTheta2 )
 {
-    static V x(1.,0.,0.);
-    static V y(0.,1.,0.);
-    M r1 = rot(sinTheta2,x);
-    M r2 = rot(sinTheta2,y);
+    typedef Vector3<typename Mt::mpclass> Vt;
+    static Vt x(1.,0.,0.);
+    static Vt y(0.,1.,0.);
+    Mt r1 = rot<Mt>(sinTheta2,x);
+    Mt r2 = rot<Mt>(sinTheta2,y);
     return r1 * r2 * r1.adjoint() * r2.adjoint();
 }
 
 /// \brief Computes rotations by angle \f$ \theta \f$   around X and Y axis conjugated by M
 /// \param sinTheta2 \f$ \sin(\theta / 2 ) \f$
-void corrGC( const M& corr, mpclass sinTheta2, M &U, M &W )
+template < class Mt >
+void corrGC( const Mt& corr, typename Mt::mpclass sinTheta2, Mt &U, Mt &W )
 {
-    static V x(1.,0.,0.);
-    static V y(0.,1.,0.);
-    M r1 = rot(sinTheta2,x);
-    M r2 = rot(sinTheta2,y);
+    typedef Vector3<typename Mt::mpclass> Vt;
+    static Vt x(1.,0.,0.);
+    static Vt y(0.,1.,0.);
+    Mt r1 = rot<Mt>(sinTheta2,x);
+    Mt r2 = rot<Mt>(sinTheta2,y);
     U = corr * r1 * corr.adjoint();
     W = corr * r2 * corr.adjoint();
 }
 
 /// \brief Computes rotation axes of input unitary and stores result
+template < class Mt >
 struct axisAngle
 {
-    /// \brief Type for high precision real numbers
-    typedef ring_int<int>::mpclass mpclass;
-    /// \brief Type for high precision matrices
-    typedef matrix2x2hpr M;
-    /// \brief Type for high precision matrices
-    typedef Vector3hpr V;
+    /// \brief Type for real numbers
+    typedef typename Mt::mpclass mpclass;
+    /// \brief Type for vectors
+    typedef Vector3<mpclass> Vt;
 
     /// \brief Computes rotation axes of input unitary
-    axisAngle( const M& U )
+    axisAngle( const Mt& U )
     {
-        static const mpclass& mh = hprHelpers::mhalf();
-        coeffs = V( mh * ( U * M::X() ).trace().imag(),
-                    mh * ( U * M::Y() ).trace().imag(),
-                    mh * ( U * M::Z() ).trace().imag() );
+        const mpclass& mh = gcConstants<mpclass>::mhalf();
+        coeffs = Vt( mh * ( U * Mt::X() ).trace().imag(),
+                     mh * ( U * Mt::Y() ).trace().imag(),
+                     mh * ( U * Mt::Z() ).trace().imag() );
         s = coeffs.squaredNorm();
-        axis = coeffs / sqrt(s);
+        axis = coeffs / realSqrt(s);
     }
 
-    V coeffs;   ///< Coefficients of matrix decomposition into Pauli basis
+    Vt coeffs;  ///< Coefficients of matrix decomposition into Pauli basis
     mpclass s;  ///< The values \f$ s = \sin( \theta / 2 )^2 \f$, where \f$ \theta \f$ rotation angle of input unitary
-    V axis;     ///< Rotation axis corresponding to input unitary
+    Vt axis;    ///< Rotation axis corresponding to input unitary
 };
 
-void GC::decompose(const M &U, M &Vr, M &W)
+/// \brief Implementation of GC::decompose for both matrix types
+template < class Mt >
+void gcDecompose(const Mt &U, Mt &Vr, Mt &W)
 {
+    typedef typename Mt::mpclass real;
+    typedef Vector3<real> Vt;
     //// step by step check !!!!!!!!!!!!
-    static const mpclass& one = hprHelpers::one();
-    static const mpclass& two = hprHelpers::two();
-    static const mpclass& half = hprHelpers::half();
+    const real& one = gcConstants<real>::one();
+    const real& half = gcConstants<real>::half();
 
-    axisAngle aaU(U);
+    axisAngle<Mt> aaU(U);
 
     // Here we are solving equation (10) from section 4.1 of http://arxiv.org/abs/quant-ph/0505030
     // aaU.s = sin( \theta / 2 )^2
-    mpclass min_root = half * ( one - sqrt(one - aaU.s));
+    real min_root = half * ( one - realSqrt(one - aaU.s));
 
     // p = sin( \phi /2 )
-    mpclass p = sqrt( sqrt( min_root ));
+    real p = realSqrt( realSqrt( min_root ));
 
     // Steps to find matrix S
-    M gcxy = gc(p);
-    axisAngle aaGC(gcxy);
+    Mt gcxy = gc<Mt>(p);
+    axisAngle<Mt> aaGC(gcxy);
 
-    V cr = aaGC.axis.cross( aaU.axis );
-    mpclass ip = aaGC.axis.dot( aaU.axis );
-    mpclass sinTheta2 = sqrt( half *( one - ip ));
-    V newAxis = cr / cr.norm();
-    M S = rot( sinTheta2, newAxis ); //this corresponds to S matrix after equation (11)
+    Vt cr = aaGC.axis.cross( aaU.axis );
+    real ip = aaGC.axis.dot( aaU.axis );
+    real sinTheta2 = realSqrt( half *( one - ip ));
+    Vt newAxis = cr / cr.norm();
+    Mt S = rot<Mt>( sinTheta2, newAxis ); //this corresponds to S matrix after equation (11)
 
     corrGC( S, p, Vr, W ); // Vr = \tilde{V}, W = \tilde{W} from the paper
 }
 
+void GC::decompose(const M &U, M &Vr, M &W)
+{
+    gcDecompose( U, Vr, W );
+}
+
+void GC::decompose(const Mq &U, Mq &Vr, Mq &W)
+{
+    gcDecompose( U, Vr, W );
+}
+
 ///////////////////////////////////////////////////////////////////////
 
 bool eq( double a, double b )
@@ -141,7 +172,7 @@ matrix2x2hpr Rotation::matrix()
     mpclass r = mpfr::sin( ang );
     V vec( nx,ny,nz);
     V vec_n = vec / vec.norm(); //normalize to reduce rounding off errors
-    return rot( r , vec_n );
+    return rot<M>( r , vec_n );
 }
 
 string Rotation::symbolic() const
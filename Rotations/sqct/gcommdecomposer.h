@@ -66,6 +66,12 @@ public:
     /// \see Section 4.1 of http://arxiv.org/abs/quant-ph/0505030
     static void decompose( const M& U, M& Vr, M& W);
 
+    /// \brief Type for quadruple precision matrices
+    typedef matrix2x2qpr Mq;
+    /// \brief Same as decompose for high precision matrices, but with quadruple precision.
+    /// Used by sk on the iterations that do not need high precision.
+    static void decompose( const Mq& U, Mq& Vr, Mq& W);
+
 };
 
 #endif // GCOMMDECOMPOSER_H
@@ -19,6 +19,8 @@
 #define MPFR_REAL_DATA_PUBLIC
 #include "hprhelpers.h"
 
+#include <quadmath.h>
+
 void hprHelpers::convert(const hprHelpers::hpr_complex &in, std::complex<double> &out)
 {
     out = std::complex<double>( mpfr_get_d( in.real()._x , MPFR_RNDN) , mpfr_get_d( in.imag()._x , MPFR_RNDN) );
@@ -92,3 +94,67 @@ const hprHelpers::hpr_real &hprHelpers::sqrt2ov2()
     static hpr_real m_s( sqrt(two()) / two() );
     return m_s;
 }
+
+/////////////////////////////////////////////////////
+
+qprHelpers::qpr_real qprHelpers::fromHpr( const hprHelpers::hpr_real& from )
+{
+    // three doubles hold all bits of the significand of qpr_real
+    hprHelpers::hpr_real rest = from;
+    qpr_real res = 0;
+    for( int i = 0; i < 3; ++i )
+    {
+        double d = mpfr_get_d( rest._x, MPFR_RNDN );
+        res += d;
+        rest -= hprHelpers::hpr_real( d );
+    }
+    return res;
+}
+
+qprHelpers::qpr_complex qprHelpers::fromHpr( const hprHelpers::hpr_complex& from )
+{
+    return qpr_complex( fromHpr( from.real() ), fromHpr( from.imag() ) );
+}
+
+hprHelpers::hpr_real qprHelpers::toHpr( qpr_real from )
+{
+    hprHelpers::hpr_real res( 0.0 );
+    for( int i = 0; i < 3; ++i )
+    {
+        double d = (double) from;
+        res += hprHelpers::hpr_real( d );
+        from -= d;
+    }
+    return res;
+}
+
+hprHelpers::hpr_complex qprHelpers::toHpr( const qpr_complex& from )
+{
+    return hprHelpers::hpr_complex( toHpr( from.real() ), toHpr( from.imag() ) );
+}
+
+void qprHelpers::convert( const qpr_complex& from, std::complex<double>& to )
+{
+    to = std::complex<double>( (double) from.real(), (double) from.imag() );
+}
+
+double qprHelpers::toMachine( qpr_real from )
+{
+    return (double) from;
+}
+
+qprHelpers::qpr_real qprHelpers::sqrt2ov2()
+{
+    static const qpr_real m_s = sqrtq( 2 ) / 2;
+    return m_s;
+}
+
+hprHelpers::hpr_real realSqrt( const hprHelpers::hpr_real& x )
+{
+    return sqrt( x );
+}
+
+qprHelpers::qpr_real realSqrt( qprHelpers::qpr_real x )
+{
+    return sqrtq( x );
+}
@@ -53,4 +53,38 @@ public:
     static const hpr_real& sqrt2ov2();
 };
 
+/// \brief Helper functions for quadruple precision arithmetic. It replaces high precision
+/// arithmetic on the iterations of the Solovay Kitaev algorithm that need less than qpr_bits bits, \see sk
+class qprHelpers
+{
+public:
+    /// \brief Quadruple precision real type
+    typedef __float128 qpr_real;
+    /// \brief Quadruple precision complex type
+    typedef std::complex<qpr_real> qpr_complex;
+    /// \brief Number of bits in the significand of qpr_real
+    static const int qpr_bits = 113;
+
+    /// \brief Rounds high precision real number to quadruple precision
+    static qpr_real fromHpr( const hprHelpers::hpr_real& from );
+    /// \brief Rounds high precision complex number to quadruple precision
+    static qpr_complex fromHpr( const hprHelpers::hpr_complex& from );
+    /// \brief Exact conversion of quadruple precision real number to high precision
+    static hprHelpers::hpr_real toHpr( qpr_real from );
+    /// \brief Exact conversion of quadruple precision complex number to high precision
+    static hprHelpers::hpr_complex toHpr( const qpr_complex& from );
+    /// \brief Transforms quadruple precision complex number into machine complex
+    static void convert( const qpr_complex& from, std::complex<double>& to );
+    /// \brief Transforms quadruple precision real number into double
+    static double toMachine( qpr_real from );
+
+    /// \brief Quadruple precision \f$ \frac{\sqrt{2}}{2} \f$
+    static qpr_real sqrt2ov2();
+};
+
+/// \brief Square root of high precision real number
+hprHelpers::hpr_real realSqrt( const hprHelpers::hpr_real& x );
+/// \brief Square root of quadruple precision real number
+qprHelpers::qpr_real realSqrt( qprHelpers::qpr_real x );
+
 #endif // HPRHELPERS_H
@@ -413,6 +413,10 @@ struct enetOptions
     /// \brief If one element specified -- upper bound for sde of epsilon net to be
     /// generated. If two elements specified -- interval of sde to be generated.
     vector<int> epsilon_net_layers;
+    /// \brief Bound on memory used for candidate numbers while a layer is generated, in megabytes
+    size_t memory_budget_mb;
+
+    enetOptions() : memory_budget_mb( netGenerator::memoryBudget() >> 20 ) {}
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -442,8 +446,8 @@ struct enetApplication
          for( int i = 0; i < 100; ++i )
          {
              string name = netGenerator::fileName(i);
-             ifstream ifs(name);
-             if( !ifs )
+             // files of an older format or with corrupt data are generated again
+             if( ! epsilonnet::verifyFile( name.c_str() ) )
                  m_layers[i] = 0;
              else
                  m_layers[i] = 1;
@@ -462,8 +466,8 @@ struct enetApplication
             {
                 epsilonnet base_net;
                 base_net.loadFromFile( netGenerator::fileName(i-1).c_str() );
-                unique_ptr<epsilonnet> res( netGenerator::generate( base_net ) );
-                res->saveToFile( netGenerator::fileName(i).c_str() );
+                netGenerator::generate( base_net, netGenerator::fileName(i).c_str(),
+                                        m_options.memory_budget_mb << 20 );
             }
         }
     }
@@ -695,6 +699,11 @@ int main(int ac, char* av[])
              "with sde(|.|^2) less or equal than this value. If two values specified then sde(|.|^2) "
              "of result lies in interval [first,second] ")
 
+            ("epsilon-net-memory", po::value< size_t >(&(eopt.memory_budget_mb)),
+             "Bound on memory in megabytes used for candidates while epsilon net layer is generated. "
+             "Layers that need more are generated in several passes. Defaults to SQCT_NET_MEMORY "
+             "environment variable if it is set.")
+
             ("theory-topt",
              "Verifies conjecture about T optimality ")
 
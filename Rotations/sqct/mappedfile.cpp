@@ -0,0 +1,177 @@
+//     Copyright (c) 2012 Vadym Kliuchnikov sqct(dot)software(at)gmail(dot)com, Dmitri Maslov, Michele Mosca
+//
+//     This file is part of SQCT.
+// 
+//     SQCT is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     SQCT is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+// 
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with SQCT.  If not, see <http://www.gnu.org/licenses/>.
+// 
+
+
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+uint64_t mappedFile::align( uint64_t offset )
+{
+    return ( offset + alignment - 1 ) / alignment * alignment;
+}
+
+uint64_t mappedFile::checksum( const void* data, size_t size, uint64_t h )
+{
+    const unsigned char* p = (const unsigned char*) data;
+    for( size_t i = 0; i < size; ++i )
+    {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+shared_ptr<const void> mappedFile::map( const char* filename, size_t& length )
+{
+    int fd = open( filename, O_RDONLY );
+    if( fd < 0 )
+        return shared_ptr<const void>();
+
+    struct stat st;
+    if( fstat( fd, &st ) != 0 || st.st_size == 0 )
+    {
+        close( fd );
+        return shared_ptr<const void>();
+    }
+
+    size_t len = st.st_size;
+    void* addr = mmap( 0, len, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( addr == MAP_FAILED )
+        return shared_ptr<const void>();
+
+    length = len;
+    return shared_ptr<const void>( addr, [len]( const void* p ){ munmap( (void*) p, len ); } );
+}
+
+/// \brief Contents of the verification stamp of filename for checksum, empty if filename cannot be examined
+static string verifiedStamp( const char* filename, uint64_t checksum )
+{
+    struct stat st;
+    if( stat( filename, &st ) != 0 )
+        return string();
+    char buf[128];
+    snprintf( buf, sizeof(buf), "%llu %llu %lld %ld %016llx\n",
+              (unsigned long long) st.st_ino, (unsigned long long) st.st_size,
+              (long long) st.st_mtim.tv_sec, (long) st.st_mtim.tv_nsec,
+              (unsigned long long) checksum );
+    return buf;
+}
+
+bool mappedFile::isVerified( const char* filename, uint64_t checksum )
+{
+    string stamp = verifiedStamp( filename, checksum );
+    if( stamp.empty() )
+        return false;
+    ifstream ifs( ( string( filename ) + ".verified" ).c_str() );
+    string recorded;
+    getline( ifs, recorded );
+    return ifs && recorded + "\n" == stamp;
+}
+
+void mappedFile::markVerified( const char* filename, uint64_t checksum )
+{
+    string stamp = verifiedStamp( filename, checksum );
+    if( stamp.empty() )
+        return;
+    mappedFileWriter w( ( string( filename ) + ".verified" ).c_str() );
+    w.write( stamp.data(), stamp.size() );
+    w.commit();
+}
+
+/////////////////////////////////////////////////////
+
+/// \brief Creates an empty file with a unique name next to filename, so that
+/// processes writing the same file at the same time do not share it.
+/// \returns Name of the file, empty on failure
+static string uniqueTemporary( const char* filename )
+{
+    string name = string( filename ) + ".XXXXXX";
+    vector<char> buf( name.begin(), name.end() );
+    buf.push_back( 0 );
+    int fd = mkstemp( buf.data() );
+    if( fd < 0 )
+        return string();
+    // mkstemp creates the file for the owner only, the target is shared
+    fchmod( fd, 0644 );
+    close( fd );
+    return string( buf.data() );
+}
+
+mappedFileWriter::mappedFileWriter( const char* filename ) :
+    m_target( filename ), m_tmp( uniqueTemporary( filename ) ), m_pos(0), m_done(false)
+{
+    if( ! m_tmp.empty() )
+        m_ofs.open( m_tmp.c_str(), ios_base::binary | ios_base::trunc );
+    else
+        m_ofs.setstate( ios_base::failbit );
+}
+
+mappedFileWriter::~mappedFileWriter()
+{
+    if( !m_done )
+    {
+        m_ofs.close();
+        if( ! m_tmp.empty() )
+            remove( m_tmp.c_str() );
+    }
+}
+
+void mappedFileWriter::write( const void* data, size_t size )
+{
+    m_ofs.write( (const char*) data, size );
+    m_pos += size;
+}
+
+void mappedFileWriter::padTo( uint64_t offset )
+{
+    static const char zeros[mappedFile::alignment] = {0};
+    while( m_pos < offset )
+    {
+        size_t n = min( (uint64_t) sizeof(zeros), offset - m_pos );
+        write( zeros, n );
+    }
+}
+
+void mappedFileWriter::rewrite( uint64_t offset, const void* data, size_t size )
+{
+    assert( offset + size <= m_pos );
+    m_ofs.seekp( offset );
+    m_ofs.write( (const char*) data, size );
+    m_ofs.seekp( m_pos );
+}
+
+bool mappedFileWriter::commit()
+{
+    m_ofs.close();
+    if( !m_ofs )
+        return false;
+    m_done = true;
+    return rename( m_tmp.c_str(), m_target.c_str() ) == 0;
+}
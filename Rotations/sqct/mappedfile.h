@@ -0,0 +1,79 @@
+//     Copyright (c) 2012 Vadym Kliuchnikov sqct(dot)software(at)gmail(dot)com, Dmitri Maslov, Michele Mosca
+//
+//     This file is part of SQCT.
+// 
+//     SQCT is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU Lesser General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+// 
+//     SQCT is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Lesser General Public License for more details.
+// 
+//     You should have received a copy of the GNU Lesser General Public License
+//     along with SQCT.  If not, see <http://www.gnu.org/licenses/>.
+// 
+
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+
+/// \brief Helpers for the binary files of SQCT that are mapped read-only
+/// and shared by all processes through the page cache, see epsilonnet and columnTree
+class mappedFile
+{
+public:
+    /// \brief Alignment of sections inside the files
+    static const uint64_t alignment = 64;
+    /// \brief Rounds offset up to alignment
+    static uint64_t align( uint64_t offset );
+    /// \brief FNV-1a hash of size bytes, continuing from h
+    static uint64_t checksum( const void* data, size_t size, uint64_t h = 14695981039346656037ULL );
+    /// \brief Maps filename read-only and writes its size into length.
+    /// The mapping is released when the last copy of the result is destroyed.
+    /// \returns Empty pointer on failure
+    static std::shared_ptr<const void> map( const char* filename, size_t& length );
+    /// \brief True if markVerified recorded that filename matches checksum and
+    /// filename has not been replaced or modified since
+    static bool isVerified( const char* filename, uint64_t checksum );
+    /// \brief Records in filename + ".verified" that the data of filename matches checksum,
+    /// so that later processes do not verify it again. Failures are ignored.
+    static void markVerified( const char* filename, uint64_t checksum );
+};
+
+/// \brief Writes a file aside and renames it over the target in commit(),
+/// so processes that have the old file mapped keep a consistent view
+class mappedFileWriter
+{
+public:
+    /// \brief Opens a temporary file with a unique name next to filename
+    explicit mappedFileWriter( const char* filename );
+    /// \brief Removes temporary file if commit() was not called
+    ~mappedFileWriter();
+    /// \brief Appends size bytes
+    void write( const void* data, size_t size );
+    /// \brief Appends zeros up to offset from the beginning of the file
+    void padTo( uint64_t offset );
+    /// \brief Overwrites size bytes already written at offset, used to fill in headers
+    /// whose checksums are known only after the data is written
+    void rewrite( uint64_t offset, const void* data, size_t size );
+    /// \brief Closes temporary file and renames it over the target
+    /// \returns False if some of the writes failed
+    bool commit();
+private:
+    std::string m_target;   ///< Name of the file to write
+    std::string m_tmp;      ///< Name of the temporary file, unique to this writer
+    std::ofstream m_ofs;    ///< Temporary file
+    uint64_t m_pos;         ///< Number of bytes written
+    bool m_done;            ///< True after commit()
+};
+
+#endif // MAPPEDFILE_H
@@ -453,6 +453,137 @@ matrix2x2hpr matrix2x2hpr::adjoint() const
                       std::conj( d[0][1]), std::conj( d[1][1]) );
 }
 
+/////////////////////////////////////////////////////
+
+template < class TInt >
+matrix2x2qpr::matrix2x2qpr(const matrix2x2<TInt> &val)
+{
+    for( int i = 0; i < 2; ++i )
+        for( int j = 0; j < 2; ++j )
+        {
+            d[i][j] = val.d[i][j].toQprComplex( val.de );
+        }
+}
+
+matrix2x2qpr::matrix2x2qpr( const matrix2x2hpr& val )
+{
+    for( int i = 0; i < 2; ++i )
+        for( int j = 0; j < 2; ++j )
+        {
+            d[i][j] = qprHelpers::fromHpr( val.d[i][j] );
+        }
+}
+
+matrix2x2hpr matrix2x2qpr::toHpr() const
+{
+    return matrix2x2hpr( qprHelpers::toHpr( d[0][0] ), qprHelpers::toHpr( d[0][1] ),
+                         qprHelpers::toHpr( d[1][0] ), qprHelpers::toHpr( d[1][1] ) );
+}
+
+matrix2x2qpr::matrix2x2qpr( scalar a, scalar b, scalar c, scalar _d)
+{
+    d[0][0] = a;
+    d[0][1] = b;
+    d[1][0] = c;
+    d[1][1] = _d;
+}
+
+matrix2x2qpr::matrix2x2qpr()
+{
+    for( int i = 0; i < 2; ++i )
+        for( int j = 0; j < 2; ++j )
+            d[i][j] = scalar( 0, 0 );
+}
+
+matrix2x2qpr::scalar matrix2x2qpr::trace() const
+{
+    return d[0][0] + d[1][1];
+}
+
+const matrix2x2qpr& matrix2x2qpr::Id()
+{
+    static matrix2x2qpr Idm(scalar(1,0),scalar(0,0),
+                            scalar(0,0),scalar(1,0));
+    return Idm;
+}
+
+const matrix2x2qpr& matrix2x2qpr::X()
+{
+    static matrix2x2qpr Xm(scalar(0,0),scalar(1,0),
+                           scalar(1,0),scalar(0,0));
+    return Xm;
+}
+
+const matrix2x2qpr &matrix2x2qpr::Y()
+{
+    static matrix2x2qpr Ym(scalar(0,0),scalar(0,-1),
+                           scalar(0,1),scalar(0, 0));
+    return Ym;
+}
+
+const matrix2x2qpr &matrix2x2qpr::Z()
+{
+    static matrix2x2qpr Zm(scalar(1,0),scalar(0,0),
+                           scalar(0,0),scalar(-1,0));
+    return Zm;
+}
+
+matrix2x2qpr matrix2x2qpr::operator*( const matrix2x2qpr& b ) const
+{
+    return matrix2x2qpr(
+                b.d[0][0]* d[0][0]+b.d[1][0]* d[0][1], b.d[0][1]* d[0][0]+b.d[1][1]* d[0][1],
+                      b.d[0][0]* d[1][0]+b.d[1][0]* d[1][1], b.d[0][1]* d[1][0]+b.d[1][1]* d[1][1]);
+}
+
+matrix2x2qpr matrix2x2qpr::operator+( const matrix2x2qpr& b ) const
+{
+    matrix2x2qpr res;
+    for( int i = 0; i < 2; ++i )
+        for( int j = 0; j < 2; ++j )
+        {
+            res.d[i][j] = d[i][j] + b.d[i][j];
+        }
+    return res;
+}
+
+matrix2x2qpr matrix2x2qpr::operator*( const scalar& val ) const
+{
+    matrix2x2qpr res;
+    for( int i = 0; i < 2; ++i )
+        for( int j = 0; j < 2; ++j )
+        {
+            res.d[i][j] = d[i][j] * val;
+        }
+    return res;
+}
+
+matrix2x2qpr matrix2x2qpr::operator*( const mpclass& val ) const
+{
+    matrix2x2qpr res;
+    for( int i = 0; i < 2; ++i )
+        for( int j = 0; j < 2; ++j )
+        {
+            res.d[i][j] = d[i][j] * val;
+        }
+    return res;
+}
+
+matrix2x2qpr operator*( const matrix2x2qpr::mpclass& val, const matrix2x2qpr& rhs )
+{
+    return rhs * val;
+}
+
+matrix2x2qpr operator*( const matrix2x2qpr::scalar& val, const matrix2x2qpr& rhs )
+{
+    return rhs * val;
+}
+
+matrix2x2qpr matrix2x2qpr::adjoint() const
+{
+    return matrix2x2qpr( std::conj( d[0][0] ), std::conj( d[1][0]),
+                      std::conj( d[0][1]), std::conj( d[1][1]) );
+}
+
 //////// template compilation requests //////////////////
 
 template class matrix2x2<int>;
@@ -464,6 +595,10 @@ template matrix2x2hpr::matrix2x2hpr( const matrix2x2<int> &val );
 template matrix2x2hpr::matrix2x2hpr( const matrix2x2<long int> &val );
 template matrix2x2hpr::matrix2x2hpr( const matrix2x2<mpz_class> &val );
 
+template matrix2x2qpr::matrix2x2qpr( const matrix2x2<int> &val );
+template matrix2x2qpr::matrix2x2qpr( const matrix2x2<long int> &val );
+template matrix2x2qpr::matrix2x2qpr( const matrix2x2<mpz_class> &val );
+
 template matrix2x2<int>::matrix2x2( const matrix2x2<mpz_class>& );
 template matrix2x2<long>::matrix2x2( const matrix2x2<mpz_class>& );
 template matrix2x2<mpz_class>::matrix2x2( const matrix2x2<int>& );
@@ -490,3 +625,10 @@ void convert(const matrix2x2hpr& in, matrix2x2cd &out)
         for( int j =0; j < 2; ++j )
             hprHelpers::convert( in.d[i][j],out[i][j] );
 }
+
+void convert(const matrix2x2qpr& in, matrix2x2cd &out)
+{
+    for( int i =0; i < 2; ++i )
+        for( int j =0; j < 2; ++j )
+            qprHelpers::convert( in.d[i][j],out[i][j] );
+}
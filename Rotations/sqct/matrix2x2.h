@@ -166,6 +166,55 @@ struct matrix2x2hpr
     static const matrix2x2hpr& Z();
 };
 
+/// \brief Represents 2x2 matrix with quadruple precision entries. It is used instead of
+/// matrix2x2hpr on the iterations of the Solovay Kitaev algorithm that need less precision, \see sk
+struct matrix2x2qpr
+{
+    /// \brief Quadruple precision real type
+    typedef qprHelpers::qpr_real mpclass;
+    /// \brief Quadruple precision complex type
+    typedef qprHelpers::qpr_complex scalar;
+    /// \brief Machine precision complex
+    typedef std::complex<double> cd;
+    /// \brief Matrix entries
+    scalar d[2][2];
+
+    /// \brief Conversion from exact unitaries
+    template < class TInt >
+    matrix2x2qpr( const matrix2x2<TInt>& val );
+    /// \brief Rounds high precision matrix to quadruple precision
+    explicit matrix2x2qpr( const matrix2x2hpr& val );
+    /// \brief Exact conversion to high precision matrix
+    matrix2x2hpr toHpr() const;
+    /// \brief Matrix multiplication
+    matrix2x2qpr operator*( const matrix2x2qpr& b ) const;
+    /// \brief Matrix addition
+    matrix2x2qpr operator+( const matrix2x2qpr& b ) const;
+    /// \brief Multiplication by real scalar
+    matrix2x2qpr operator*( const mpclass& val ) const;
+    /// \brief Multiplication by complex scalar
+    matrix2x2qpr operator*( const scalar& val ) const;
+    /// \brief Conjugate transpose
+    matrix2x2qpr adjoint() const;
+
+    /// \brief Default constructor that sets all entries to 0
+    matrix2x2qpr();
+    /// \brief Sets matrix value to
+    /// \f$ \left(\begin{array}{cc} a & b\\ c & d\end{array}\right) \f$
+    matrix2x2qpr( scalar a, scalar b, scalar c, scalar _d);
+    /// \brief Returns trace of the matrix
+    scalar trace() const;
+
+    /// \brief Returns reference to matrix2x2qpr initialized to Identity matrix
+    static const matrix2x2qpr& Id();
+    /// \brief Returns reference to matrix2x2qpr initialized to Pauli X matrix
+    static const matrix2x2qpr& X();
+    /// \brief Returns reference to matrix2x2qpr initialized to Pauli Y matrix
+    static const matrix2x2qpr& Y();
+    /// \brief Returns reference to matrix2x2qpr initialized to Pauli Z matrix
+    static const matrix2x2qpr& Z();
+};
+
 /// \brief Multiplication by high precision real number from the left side
 matrix2x2hpr operator*( const matrix2x2hpr::mpclass& val, const matrix2x2hpr& rhs );
 /// \brief Multiplication by high precision complex number from the left side
@@ -177,5 +226,13 @@ double trace_dist( const matrix2x2hpr& a, const matrix2x2hpr& b );
 /// \brief Converts high precision complex matrix to machine precision complex matrix
 void convert(const matrix2x2hpr& in, matrix2x2cd &out);
 
+/// \brief Multiplication by quadruple precision real number from the left side
+matrix2x2qpr operator*( const matrix2x2qpr::mpclass& val, const matrix2x2qpr& rhs );
+/// \brief Multiplication by quadruple precision complex number from the left side
+matrix2x2qpr operator*( const matrix2x2qpr::scalar& val, const matrix2x2qpr& rhs );
+
+/// \brief Converts quadruple precision complex matrix to machine precision complex matrix
+void convert(const matrix2x2qpr& in, matrix2x2cd &out);
+
 
 #endif // MATRIX2X2_H
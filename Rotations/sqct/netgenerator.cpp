@@ -21,12 +21,13 @@
 #include "epsilonnet.h"
 
 #include <memory>
-#include <deque>
 #include <vector>
 #include <algorithm>
 #include <sstream>
-#include <functional>
+#include <iterator>
 #include <cassert>
+#include <cstdlib>
+#include <iostream>
 
 using namespace std;
 
@@ -70,7 +71,7 @@ void netGenerator::generateInitial()
             sort( v.begin(), v.end() );
             sort( vc.begin(), vc.end() );
 
-            nodeRanges nr = {v.begin(),v.end(),vc.begin(), vc.end() };
+            nodeRanges nr = {v.data(),v.data() + v.size(),vc.data(), vc.data() + vc.size() };
             assert( ( (i >> de) << de ) == i );
             assert( ( (j >> de) << de ) == j );
             // in the case when ipQxx = 0 we only add numbers such that ipxx <= ng.max_val2 / 2
@@ -96,11 +97,28 @@ string netGenerator::fileName(int sde)
     return s.str();
 }
 
+size_t netGenerator::memoryBudget()
+{
+    char const *mb = getenv("SQCT_NET_MEMORY");
+    if( mb == 0 )
+        return default_memory_budget;
+    char* end = 0;
+    unsigned long long v = strtoull( mb, &end, 10 );
+    if( end == mb || *end != '\0' || v == 0 )
+    {
+        cerr << "SQCT_NET_MEMORY=" << mb << " is not a positive number of megabytes, using default" << endl;
+        return default_memory_budget;
+    }
+    return size_t(v) << 20;
+}
+
 
 ///////////////// internal implementation of generator ///////////////////////////////////
 
 typedef  netGenerator::ri ri;
 
+const size_t netGenerator::default_memory_budget = size_t(1) << 31;
+
 /// \brief Node of generated data
 struct gdata
 {
@@ -112,26 +130,44 @@ struct gdata
     ri num_compl;
 };
 
-/// \brief Order on pointers to gdata based on values of P(x) and Q(x) \see ring_int::ipxx() for defintions of P(x) and Q(x)
+/// \brief Order on gdata based on values of P(x) and Q(x) \see ring_int::ipxx() for defintions of P(x) and Q(x)
 struct gdata_comparator
 {
-    bool operator () ( const gdata* a, const gdata* b) const
+    bool operator () ( const gdata& a, const gdata& b) const
     {
-        return a->ip < b->ip;
+        return a.ip < b.ip;
     }
 };
 
-/// \brief Order on pointers based on data that they point to
-template< class T >
-struct ptr_comp : public binary_function< const T*, const T*, bool >
+/// \brief Splits values of P(x) from [0,max_ipxx] into consecutive bins. Bins are used to
+/// split candidates between generation passes and between threads that sort them.
+struct ip_bins
 {
-    const bool operator() ( const T* a, const T* b)
+    /// \brief Upper bound on number of bins
+    static const int max_bins = 4096;
+
+    ip_bins( ri::pr_type max_ipxx ) : shift(0)
+    {
+        while( ( max_ipxx >> shift ) >= max_bins )
+            ++shift;
+        count = ( max_ipxx >> shift ) + 1;
+    }
+
+    /// \brief Bin of numbers with P(x) = ipxx, values outside of [0,max_ipxx] go to the first or the last bin
+    int bin( ri::pr_type ipxx ) const
     {
-        return *a < *b;
+        if( ipxx < 0 )
+            return 0;
+        return std::min( ipxx >> shift, (ri::pr_type) count - 1 );
     }
+
+    /// \brief Bin of P(x) is P(x) >> shift
+    int shift;
+    /// \brief Number of bins
+    int count;
 };
 
-/// \brief Internal structure for epsilon net generation
+/// \brief Internal structure for epsilon net generation, one per thread
 struct generation_data
 {
     /// \brief Sets sde end denominator exponent used during generation
@@ -140,20 +176,63 @@ struct generation_data
         isGde1 = (sde % 2 == 1);
         pow2n = 1 << (isGde1 ? de2 : de2 + 1 );
         pow2nm1 = pow2n >> 1;
+        bins = 0;
+        bin_begin = bin_end = 0;
     }
 
-    /// \brief Found values of P(x) and Q(x)
-    deque< gdata > ips;
+    /// \brief Sets bins and the range of them [first,last) that are kept in buckets.
+    /// If counts_only is true only the number of candidates in each bin is collected.
+    void set_bins( const ip_bins& b, int first, int last, bool counts_only )
+    {
+        bins = &b;
+        bin_begin = first;
+        bin_end = last;
+        if( counts_only )
+            counts.assign( b.count, 0 );
+        else
+            buckets.resize( last - first );
+    }
+
+    /// \brief Found candidates with P(x) in bins [bin_begin,bin_end), bucket per bin
+    vector< vector< gdata > > buckets;
+    /// \brief Number of candidates in each bin, collected if not empty
+    vector< size_t > counts;
+    /// \brief Bins of P(x)
+    const ip_bins* bins;
+    /// \brief First bin kept in buckets
+    int bin_begin;
+    /// \brief End of the range of bins kept in buckets
+    int bin_end;
     /// \brief Sum of P(x) and P(y) for two complementary numbers \see epsilonnet::compl_offset
     ri::pr_type pow2n;
     /// \brief If P(x) is less than pow2nm1 we store (x,y), and (y,x) otherwise
     ri::pr_type pow2nm1;
-    /// \brief Pointers to computed numbers
-    vector< const gdata* > order;
     /// \brief When sde is even then \f$gde(|\cdot|^2)\f$ 0 and 1 otherwise. See properties of gde and sde in
     /// http://arxiv.org/abs/1206.5236
     bool isGde1;
 
+    /// \brief Adds all numbers that can be generated from pairs of numbers of node node_id of enet
+    void add_node( const epsilonnet& enet, size_t node_id )
+    {
+        nodeRanges r;
+        enet.getNode( node_id, r );
+
+        for( auto i1 = r.nums_begin; i1 != r.nums_end; ++i1 )
+        {
+            const ri& x = *i1;
+
+            for( auto i2 = r.nums_compl_begin; i2 != r.nums_compl_end; ++i2 )
+            {
+                // addes all vectors that can be generated from equivalence class
+                ri omega_k_y(*i2);
+                add_for_all_k( omega_k_y, x );
+
+                ri omega_k_y_c( i2->conjugate() );
+                add_for_all_k( omega_k_y_c, x );
+            }
+        }
+    }
+
     /// \brief Adds all numbers to epsilon net that we can get from unit column based on (omega_k_y,x)
     void add_for_all_k ( ri& omega_k_y, const ri& x )
     {
@@ -192,99 +271,212 @@ struct generation_data
     void push_back( ri::pr_type ipxx, ri::pr_type ipQxx, const ri& a, const ri& ac )
     {
         if( ipQxx > 0 )
-            ips.push_back( { {ipxx, ipQxx}, a.canonical(),ac.canonical()} );
+            store( ipxx, ipQxx, a, ac );
         else if( ipQxx == 0 )
         {
             if( ipxx < pow2nm1 )
-                ips.push_back( {{ipxx, 0},a.canonical(),ac.canonical()} );
+                store( ipxx, 0, a, ac );
             else
-                ips.push_back( {{pow2n - ipxx,0},ac.canonical(),a.canonical()} );
+                store( pow2n - ipxx, 0, ac, a );
 
         } else if ( ipQxx < 0 )
-            ips.push_back( {{pow2n - ipxx,-ipQxx},ac.canonical(),a.canonical()} );
+            store( pow2n - ipxx, -ipQxx, ac, a );
     }
 
-    /// \brief Builds epsilon net from computed data
-    epsilonnet* build_net()
+    /// \brief Counts candidate or puts it into its bucket if its bin is in [bin_begin,bin_end)
+    void store( ri::pr_type ipxx, ri::pr_type ipQxx, const ri& a, const ri& ac )
     {
+        int b = bins->bin( ipxx );
+        if( ! counts.empty() )
+            ++counts[b];
+        else if( b >= bin_begin && b < bin_end )
+            buckets[b - bin_begin].push_back( { {ipxx, ipQxx}, a.canonical(), ac.canonical() } );
+    }
+};
 
-        epsilonnet* enet = new epsilonnet;
-        order.resize( ips.size() );
-        int sz = order.size();
-        for( int i = 0; i < sz; ++i )
-            order[i] = & ips[i];
-
+/// \brief Nodes of the next layer built from candidates of one bin
+struct gchunk
+{
+    /// \brief P(x) and Q(x) of nodes
+    vector< pair<ri::pr_type,ri::pr_type> > ips;
+    /// \brief Numbers of node k are in [offsets[2k],offsets[2k+1]), complementary
+    /// numbers are in [offsets[2k+1],offsets[2k+2])
+    vector< size_t > offsets;
+    /// \brief Sorted unique numbers of all nodes
+    vector< ri > numbers;
+
+    /// \brief Builds nodes from candidates, cands is left sorted
+    void build( vector< gdata >& cands )
+    {
         gdata_comparator gcomp;
-        /// \todo This sort can be avoided with a bit more clever algorithm
-        sort( order.begin(), order.end(), gcomp );
-
-        int j = 0;
-        int j_end = 0;
+        sort( cands.begin(), cands.end(), gcomp );
 
-        for( int i = 0; i < sz - 1; ++i )
+        vector< ri > nums, nums_compl;
+        offsets.push_back( 0 );
+        for( size_t j = 0; j < cands.size(); )
         {
-            if( gcomp( order[i], order[i+1] ) )
+            size_t j_end = j + 1;
+            while( j_end < cands.size() && ! gcomp( cands[j], cands[j_end] ) )
+                ++j_end;
+
+            nums.clear();
+            nums_compl.clear();
+            for( size_t i = j; i < j_end; ++i )
             {
-                j_end = i + 1;
-                add_to_net(j,j_end,enet);
-                j = j_end;
+                nums.push_back( cands[i].num );
+                nums_compl.push_back( cands[i].num_compl );
             }
+            ips.push_back( cands[j].ip );
+            append_unique( nums );
+            append_unique( nums_compl );
+            j = j_end;
         }
-        j_end = sz;
-        add_to_net(j,j_end,enet);
-        return enet;
     }
 
-    /// \brief Adds range from \b order to epsilon net
-    void add_to_net( int j, int j_end ,epsilonnet* enet )
+    /// \brief Sorts v and appends its unique elements to numbers
+    void append_unique( vector< ri >& v )
     {
-        vector< const ri* > nums,nums_compl;
+        sort( v.begin(), v.end() );
+        unique_copy( v.begin(), v.end(), back_inserter( numbers ) );
+        offsets.push_back( numbers.size() );
+    }
 
-        for( int i = j ; i < j_end; ++i )
+    /// \brief Adds nodes to net, Net is epsilonnet or epsilonnetWriter
+    template< class Net >
+    void add_to_net( Net& net ) const
+    {
+        const ri* nb = numbers.data();
+        for( size_t k = 0; k < ips.size(); ++k )
         {
-            nums.push_back( &(order[i]->num) );
-            nums_compl.push_back( &( order[i]->num_compl ) );
+            nodeRanges nr = { nb + offsets[2 * k], nb + offsets[2 * k + 1],
+                              nb + offsets[2 * k + 1], nb + offsets[2 * k + 2] };
+            net.addNode( ips[k].first, ips[k].second, nr );
         }
+    }
+};
 
-        ptr_comp<ri> ri_comp;
-        sort( nums.begin(), nums.end(), ri_comp );
-        sort( nums_compl.begin(), nums_compl.end(), ri_comp );
+/// \brief Generates candidates of bins [first,last) or, if counts_only is true, counts candidates in
+/// each bin. Nodes of enet are split between threads, buckets of all threads are collected in parts.
+static void generate_pass( const epsilonnet& enet, const ip_bins& bins, int first, int last, bool counts_only,
+                           vector< size_t >& counts, vector< vector< vector< gdata > > >& parts )
+{
+    int sde = enet.sde();
+    int de2 = enet.denominatorExponent2();
+    long nodes = enet.nodesSize() - 1;
+    counts.assign( bins.count, 0 );
+    parts.assign( last - first, vector< vector< gdata > >() );
+
+    #pragma omp parallel
+    {
+        generation_data gd( sde, de2 );
+        gd.set_bins( bins, first, last, counts_only );
 
-        nodeRangesPtr nr = { nums.begin(), nums.end(),
-                             nums_compl.begin(), nums_compl.end() };
+        #pragma omp for schedule(dynamic) nowait
+        for( long i = 0; i < nodes; ++i )
+            gd.add_node( enet, i );
 
-        enet->addNode( order[j]->ip, nr);
+        #pragma omp critical
+        {
+            for( size_t b = 0; b < gd.counts.size(); ++b )
+                counts[b] += gd.counts[b];
+            for( size_t b = 0; b < gd.buckets.size(); ++b )
+                if( ! gd.buckets[b].empty() )
+                    parts[b].push_back( std::move( gd.buckets[b] ) );
+        }
     }
-};
+}
 
-epsilonnet* netGenerator::generate(const epsilonnet& enet)
+/// \brief Splits bins into consecutive ranges with at most memory_budget bytes of candidates in each.
+/// A bin that alone exceeds the budget gets its own range.
+/// \returns Boundaries of ranges, range k is [res[k],res[k+1])
+static vector< int > plan_passes( const epsilonnet& enet, const ip_bins& bins, size_t memory_budget )
 {
-    generation_data gdata( enet.sde(), enet.denominatorExponent2() );
+    vector< int > res( 1, 0 );
 
-    for( int i = 0; i < enet.nodes.size() - 1; ++i )
+    // upper bound on number of candidates, each pair of numbers gives at most 16 of them
+    size_t bound = 0;
+    for( size_t i = 0; i + 1 < enet.nodesSize(); ++i )
     {
-        const enetNode& node = enet.nodes[i];
-
         nodeRanges r;
         enet.getNode( i, r );
+        bound += 16 * ( r.nums_end - r.nums_begin ) * ( r.nums_compl_end - r.nums_compl_begin );
+    }
 
-        for( auto i1 = r.nums_begin; i1 != r.nums_end; ++i1 )
-        {
-            const ri& x = *i1;
-            ri x_c = x.conjugate();
+    if( bound * sizeof(gdata) > memory_budget )
+    {
+        vector< size_t > counts;
+        vector< vector< vector< gdata > > > parts;
+        generate_pass( enet, bins, 0, bins.count, true, counts, parts );
 
-            for( auto i2 = r.nums_compl_begin; i2 != r.nums_compl_end; ++i2 )
+        size_t used = 0;
+        for( int b = 0; b < bins.count; ++b )
+        {
+            size_t sz = counts[b] * sizeof(gdata);
+            if( used > 0 && used + sz > memory_budget )
             {
-                // addes all vectors that can be generated from equivalence class
-                ri omega_k_y(*i2);
-                gdata.add_for_all_k( omega_k_y, x );
+                res.push_back( b );
+                used = 0;
+            }
+            used += sz;
+        }
+    }
 
-                ri omega_k_y_c( i2->conjugate() );
-                gdata.add_for_all_k( omega_k_y_c, x );
+    res.push_back( bins.count );
+    return res;
+}
+
+/// \brief Builds the next layer after enet and adds its nodes to net in order of P(x), Q(x)
+template< class Net >
+static void generate_layer( const epsilonnet& enet, Net& net, size_t memory_budget )
+{
+    ip_bins bins( generation_data( enet.sde(), enet.denominatorExponent2() ).pow2n );
+    vector< int > passes = plan_passes( enet, bins, memory_budget );
+
+    for( size_t p = 0; p + 1 < passes.size(); ++p )
+    {
+        int first = passes[p];
+        int count = passes[p + 1] - first;
 
+        vector< size_t > counts;
+        vector< vector< vector< gdata > > > parts;
+        generate_pass( enet, bins, first, passes[p + 1], false, counts, parts );
+
+        // bins are sorted independently, the memory of candidates is released bin by bin
+        vector< gchunk > chunks( count );
+        #pragma omp parallel for schedule(dynamic)
+        for( int b = 0; b < count; ++b )
+        {
+            vector< gdata > cands;
+            size_t sz = 0;
+            for( size_t t = 0; t < parts[b].size(); ++t )
+                sz += parts[b][t].size();
+            cands.reserve( sz );
+            for( size_t t = 0; t < parts[b].size(); ++t )
+            {
+                cands.insert( cands.end(), parts[b][t].begin(), parts[b][t].end() );
+                vector< gdata >().swap( parts[b][t] );
             }
+            chunks[b].build( cands );
+        }
+
+        for( int b = 0; b < count; ++b )
+        {
+            chunks[b].add_to_net( net );
+            chunks[b] = gchunk();
         }
     }
+}
 
-    return gdata.build_net();
+epsilonnet* netGenerator::generate( const epsilonnet& enet, size_t memory_budget )
+{
+    epsilonnet* res = new epsilonnet;
+    generate_layer( enet, *res, memory_budget );
+    return res;
+}
+
+bool netGenerator::generate( const epsilonnet& enet, const char* filename, size_t memory_budget )
+{
+    epsilonnetWriter out( filename );
+    generate_layer( enet, out, memory_budget );
+    return out.commit();
 }
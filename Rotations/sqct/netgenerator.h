@@ -35,8 +35,21 @@ public:
     static void generateInitial();
     /// \brief Filename used for epsilon nets with \f$ sde(|\cdot|^2) \f$
     static std::string fileName( int sde );
+    /// \brief Default bound on memory used for candidate numbers by generate, in bytes
+    static const size_t default_memory_budget;
+    /// \brief Bound on memory used for candidate numbers, in bytes. Taken from the
+    /// SQCT_NET_MEMORY environment variable (megabytes) if it is set, default_memory_budget otherwise.
+    /// Used by every generator of epsilon nets: sqct, rotZ, skbench and libsqct
+    static size_t memoryBudget();
     /// \brief Creates the next layer of epsilon net based on enet
-    static epsilonnet* generate( const epsilonnet& enet );
+    /// \see generate( const epsilonnet&, const char*, size_t )
+    static epsilonnet* generate( const epsilonnet& enet, size_t memory_budget = default_memory_budget );
+    /// \brief Creates the next layer of epsilon net based on enet and streams it to filename.
+    /// Nodes of enet are split between OpenMP threads. If candidate numbers do not fit into
+    /// memory_budget bytes they are generated in several passes, each for a range of P(x).
+    /// The file is the same as the one written by saveToFile for the result of generate( enet ).
+    /// \returns False if the file was not written
+    static bool generate( const epsilonnet& enet, const char* filename, size_t memory_budget = default_memory_budget );
 };
 
 #endif // NETGENERATOR_H
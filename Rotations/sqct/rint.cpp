@@ -24,6 +24,7 @@
 #include <limits>
 #include <algorithm>
 #include <cmath>
+#include <quadmath.h>
 
 #include <iostream>
 
@@ -48,6 +49,13 @@ std::complex<mpclass> toHprComplex( const int_arr4& val, int de);
 std::complex<mpclass> toHprComplex( const long_arr4& val, int de);
 std::complex<mpclass> toHprComplex( const rring8_arr4& val, int de);
 
+typedef qprHelpers::qpr_real qpr_real;
+typedef qprHelpers::qpr_complex qpr_complex;
+qpr_complex toQprComplex( const mpz_arr4& val, int de);
+qpr_complex toQprComplex( const int_arr4& val, int de);
+qpr_complex toQprComplex( const long_arr4& val, int de);
+qpr_complex toQprComplex( const rring8_arr4& val, int de);
+
 /// \brief Precomuted powers of \f$ \frac{1}{\sqrt{2}} \f$
 struct PrecDenom
 {
@@ -179,6 +187,60 @@ std::complex<mpclass> toHprComplex( const rring8_arr4& val, int de)
     assert( !"Not implemented: operation is meaningless" );
 }
 
+/// \brief Rounds integer to the nearest quadruple precision number, ties away from zero
+static qpr_real toQpr( const mpz_class& v )
+{
+    // the integer is rounded to the bits of the significand; a carry gives one
+    // more bit, which still fits into two limbs and is exact as a power of two
+    long shift = std::max( (long) mpz_sizeinbase( v.get_mpz_t(), 2 ) - qprHelpers::qpr_bits, 0L );
+    mpz_class a = abs( v );
+    if( shift > 0 )
+        a += mpz_class( 1 ) << ( shift - 1 );
+    a >>= shift;
+    mpz_class hi = a >> 64;
+    mpz_class lo = a - ( hi << 64 );
+    qpr_real r = ldexpq( (qpr_real) mpz_get_ui( hi.get_mpz_t() ), 64 ) + (qpr_real) mpz_get_ui( lo.get_mpz_t() );
+    r = ldexpq( r, shift );
+    return sgn( v ) < 0 ? -r : r;
+}
+
+/// \brief Computes \f$ \frac{1}{\sqrt{2}^{de} }( a_0 + \frac{a_1 - a_3}{\sqrt{2}} + i ( a_2 + \frac{a_1 + a_3}{\sqrt{2}} ) ) \f$
+/// from exact values of the integer combinations
+static qpr_complex toQprComplex( const mpz_class& a0, const mpz_class& a2,
+                                 const mpz_class& a1m3, const mpz_class& a1p3, int de )
+{
+    static const qpr_real sqrt2ov2 = qprHelpers::sqrt2ov2();
+    qpr_real scale = ldexpq( 1, - ( de / 2 ) );
+    if( de % 2 == 1 )
+        scale *= sqrt2ov2;
+
+    qpr_real real = toQpr( a0 ) + sqrt2ov2 * toQpr( a1m3 );
+    qpr_real img = toQpr( a2 ) + sqrt2ov2 * toQpr( a1p3 );
+    return qpr_complex( real * scale, img * scale );
+}
+
+qpr_complex toQprComplex( const mpz_arr4& val, int de)
+{
+    return toQprComplex( val[0], val[2], val[1] - val[3], val[1] + val[3], de );
+}
+
+qpr_complex toQprComplex( const int_arr4& val, int de)
+{
+    return toQprComplex( mpz_class( val[0] ), mpz_class( val[2] ),
+                         mpz_class( val[1] ) - val[3], mpz_class( val[1] ) + val[3], de );
+}
+
+qpr_complex toQprComplex( const long_arr4& val, int de)
+{
+    return toQprComplex( mpz_class( val[0] ), mpz_class( val[2] ),
+                         mpz_class( val[1] ) - val[3], mpz_class( val[1] ) + val[3], de );
+}
+
+qpr_complex toQprComplex( const rring8_arr4& val, int de)
+{
+    assert( !"Not implemented: operation is meaningless" );
+}
+
 int sde( int denom_exponent, int gde )
 {
   if ( gde != std::numeric_limits<int>::max() )
@@ -400,6 +462,12 @@ std::complex<mpclass> ring_int<T>::toHprComplex(int de) const
     return ::toHprComplex( v, de);
 }
 
+template < class T >
+qpr_complex ring_int<T>::toQprComplex(int de) const
+{
+    return ::toQprComplex( v, de);
+}
+
 template < class T >
 ring_int<T>& ring_int<T>::operator =(const ring_int<T>& b)
 {
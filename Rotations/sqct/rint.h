@@ -161,6 +161,11 @@ struct ring_int
     /// \param d Power of \f$ \sqrt{2} \f$ in the denominator
     std::complex<mpclass> toHprComplex( int d ) const;
 
+    /// \brief Returns complex quadruple precision number approximately equal to
+    /// \f$ \frac{1}{\sqrt{2}^d }( a + \omega b + \omega ^ 2 c + \omega ^3 d)\f$
+    /// \param d Power of \f$ \sqrt{2} \f$ in the denominator
+    qprHelpers::qpr_complex toQprComplex( int d ) const;
+
     /// \brief Lexicographical order. Returns 1 if \f$x < y\f$, 0 if \f$x = y\f$, -1 if \f$x > y.\f$
     int le( const ring_int& y ) const;
     /// \brief Lexicographical order
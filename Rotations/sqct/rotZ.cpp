@@ -3,8 +3,7 @@
 //     SQCT is distributed under LGPL v3
 //
 
-#include "skdecomposer.h"
-#include "eapp.h"
+#include "sqctcontext.h"
 
 #include <stdlib.h>
 #include <iostream>
@@ -38,10 +37,12 @@ int main ( int argc, char** argv ) {
   double angle;
   char axis;
   int iter;
-  circuit c;
+  bool quad;
 
   if ( argc < 3 ) {
-    cerr << "Usage: " << argv[0] << " <angle> <X|Y|Y> [levels]\n";
+    cerr << "Usage: " << argv[0] << " <angle> <X|Y|Y> [levels [-q]]\n";
+    cerr << "  -q  run the shallow iterations in quadruple precision\n";
+    cerr << "Epsilon nets are generated within SQCT_NET_MEMORY megabytes if it is set\n";
     return 1;
   }
   Scaffold::opts.skOpts.levels = 30;
@@ -51,32 +52,20 @@ int main ( int argc, char** argv ) {
     iter = 1;
   else 
     iter = atoi( argv[3] );
+  quad = ( argc > 4 && string( argv[4] ) == "-q" );
 
   if (axis != 'X' && axis != 'Y' && axis != 'Z') {
     cerr << "Axis must be one of X, Y, or Z\n";
     return 1;
   }
 
-  // This stuff goes in the RunOn*Init function
-  enetOptions eopts;
-  eopts.epsilon_net_layers.clear();
-  eopts.epsilon_net_layers.push_back( Scaffold::opts.skOpts.levels );
-  enetApplication eapp( eopts );
-  eapp.process();
-  SKDecompose sk;
+  // Load the epsilon nets, generating missing layers first
+  sqctContext ctx( Scaffold::opts.skOpts.levels, quad );
 
-  // Perform decomposition - circuit will need to be walked to replace the rotation with the decomposed gates
-  // angle = radians to rotate, or fraction of 2*pi to rotate
+  // Perform decomposition
+  // angle = radians to rotate
   // iter = is the number of iterations to perform
-  // frac = true if this is a fraction of 2*pi. False by default.
-  switch (axis) {
-    case 'X': c = sk.rotX( angle, iter ); break;
-    case 'Y': c = sk.rotY( angle, iter ); break;
-    case 'Z': c = sk.rotZ( angle, iter ); break;
-  }
-
-  // Print out
-  cout << c.toString() << endl;
+  cout << ctx.decompose( angle, axis, iter ) << endl;
 
   return 0;
 }
@@ -39,7 +39,7 @@ seqLookupCliff::seqLookupCliff(bool full_init)
     if( full_init ) init();
 }
 
-void seqLookupCliff::find(const matrix2x2<int> &m, circuit &res)
+void seqLookupCliff::find(const matrix2x2<int> &m, circuit &res) const
 {
     std::shared_ptr<optNode> val( new optNode({0,0,m,0}) );
 
@@ -31,7 +31,7 @@ public:
     /// \brief Constructs the class, if full_init is true performes search of optimal sequences
     seqLookupCliff( bool full_init = true );
     /// \brief Finds a circuit for unitary m and writes it into res
-    void find( const matrix2x2<int>& m, circuit& res );
+    void find( const matrix2x2<int>& m, circuit& res ) const;
     /// \brief Performs search of optimal sequences
     void init();
 private:
@@ -21,17 +21,125 @@
 #include "output.h"
 
 #include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace std;
 
-sk::sk(int max_layer) :
-    uapp( max_layer )
+sk::sk(int max_layer, bool adaptive_precision) :
+    uapp( max_layer ),
+    qpr_levels( adaptive_precision ? qprLevels( max_layer ) : -1 )
 {
 }
 
+int sk::qprLevels( int max_layer )
+{
+    // bits of precision the result of each iteration is expected to have
+    static const double guard_bits = 16;
+    double bits = max_layer / 2.;
+    int n = -1;
+    while( bits + guard_bits <= qprHelpers::qpr_bits )
+    {
+        ++n;
+        bits *= 1.5;
+    }
+    return n;
+}
+
 typedef ring_int<int>::mpclass mpclass;
 
-void sk::decompose(const sk::Ma &U, sk::Me &out, int n)
+bool sk::memoKey::operator<( const memoKey& b ) const
 {
+    if( n != b.n ) return n < b.n;
+    for( int i = 0; i < 8; ++i )
+        if( v[i] != b.v[i] ) return v[i] < b.v[i];
+    return false;
+}
+
+template< class M >
+sk::memoKey sk::key( const M& U, int n )
+{
+    memoKey k;
+    k.n = n;
+    matrix2x2cd Ud;
+    convert( U, Ud );
+    for( int i = 0; i < 2; ++i )
+        for( int j = 0; j < 2; ++j )
+        {
+            k.v[4 * i + 2 * j] = Ud[i][j].real();
+            k.v[4 * i + 2 * j + 1] = Ud[i][j].imag();
+        }
+    return k;
+}
+
+template< class M >
+bool sk::recall( const memoKey& k, const M& U, Me& out ) const
+{
+    std::lock_guard<std::mutex> guard( memo_lock );
+    auto range = table( U ).equal_range( k );
+    for( auto it = range.first; it != range.second; ++it )
+    {
+        const M& Um = it->second.U;
+        bool same = true;
+        for( int i = 0; i < 2 && same; ++i )
+            for( int j = 0; j < 2 && same; ++j )
+                same = Um.d[i][j].real() == U.d[i][j].real() &&
+                       Um.d[i][j].imag() == U.d[i][j].imag();
+        if( same )
+        {
+            out = it->second.out;
+            return true;
+        }
+    }
+    return false;
+}
+
+template< class M >
+void sk::memoize( const memoKey& k, const M& U, const Me& out ) const
+{
+    std::lock_guard<std::mutex> guard( memo_lock );
+    memoTable<M>& t = table( U );
+    if( t.size() >= max_memo_size )
+        return;
+    memoValue<M> v = { U, out };
+    t.insert( std::make_pair( k, v ) );
+}
+
+void sk::decompose(const sk::Ma &U, sk::Me &out, int n) const
+{
+#ifdef _OPENMP
+    // base approximation parallelizes its own search, see indexedUnitaryApproximator
+    if( n > 0 && !omp_in_parallel() )
+    {
+        #pragma omp parallel
+        #pragma omp single
+        decompose_i( U, out, n );
+        return;
+    }
+#endif
+    decompose_i( U, out, n );
+}
+
+void sk::decompose_i(const sk::Ma &U, sk::Me &out, int n) const
+{
+    if( n <= qpr_levels )
+        decompose_t( Mq(U), out, n );
+    else
+        decompose_t( U, out, n );
+}
+
+void sk::decompose_i(const sk::Mq &U, sk::Me &out, int n) const
+{
+    decompose_t( U, out, n );
+}
+
+template< class M >
+void sk::decompose_t(const M &U, sk::Me &out, int n) const
+{
+    memoKey k = key( U, n );
+    if( recall( k, U, out ) )
+        return;
+
     if( n == 0 )
     {
         indexedUnitaryApproximator::Ma tmp;
@@ -41,12 +149,17 @@ void sk::decompose(const sk::Ma &U, sk::Me &out, int n)
     else
     {
         Me Ue;
-        decompose(U,Ue,n-1);
-        Ma V,W;
-        GC::decompose( U * Ma(Ue).adjoint() ,V,W);
+        decompose_i(U,Ue,n-1);
+        M V,W;
+        GC::decompose( U * M(Ue).adjoint() ,V,W);
         Me Ve,We;
-        decompose(V,Ve,n-1);
-        decompose(W,We,n-1);
+        // V and W are approximated independently
+        #pragma omp task shared(V,Ve)
+        decompose_i(V,Ve,n-1);
+        decompose_i(W,We,n-1);
+        #pragma omp taskwait
         out = Ve * We * Ve.conjugateTranspose() * We.conjugateTranspose() * Ue;
     }
+
+    memoize( k, U, out );
 }
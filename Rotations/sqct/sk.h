@@ -22,6 +22,9 @@
 #include "matrix2x2.h"
 #include "unitaryapproximator.h"
 
+#include <map>
+#include <mutex>
+
 /// \brief Implements the Solovay Kitaev algorithm
 /// to approximated high precision floating point unitaries
 /// by unitaries over the ring \f$ \mathbb{Z}[\frac{1}{\sqrt{2}},i]\f$.
@@ -32,17 +35,83 @@ class sk
 public:
     /// \brief High precision matrix type
     typedef matrix2x2hpr Ma;
+    /// \brief Quadruple precision matrix type, used on iterations that need less precision
+    typedef matrix2x2qpr Mq;
     /// \brief Matrix over the ring \f$ \mathbb{Z}[\frac{1}{\sqrt{2}},i]\f$ type
     typedef matrix2x2<mpz_class> Me;
     /// \brief Loads epsilon nets up to max_layer non inclusively
     /// \see indexedUnitaryApproximator constructor
-    sk( int max_layer = 31 );
+    /// \param adaptive_precision If true, iterations that need at most quadruple precision
+    /// use matrix2x2qpr instead of matrix2x2hpr, \see qprLevels. Off by default, so that
+    /// results only change for callers that ask for it.
+    sk( int max_layer = 31, bool adaptive_precision = false );
     /// \brief Runs n iteration of the Solovay Kitaev algorithm and writes
-    /// result into out
-    void decompose( const Ma& U, Me& out, int n );
+    /// result into out. Approximations of V and W of each iteration run as
+    /// OpenMP tasks, on the enclosing parallel region if there is one.
+    /// Results of all iterations are memoized, so the same unitary is approximated once.
+    void decompose( const Ma& U, Me& out, int n ) const;
+    /// \brief Largest number of iterations that can run in quadruple precision, when
+    /// epsilon nets up to max_layer are used. The error of the base approximation is assumed to be
+    /// \f$ 2^{-max\_layer/2} \f$ and each iteration to raise the error to the power 3/2;
+    /// iterations with the expected error above \f$ 2^{-97} \f$ ( 16 guard bits ) run in quadruple precision.
+    static int qprLevels( int max_layer );
 private:
+    /// \brief Recursive part of decompose, must be called inside of an OpenMP parallel region.
+    /// Switches to quadruple precision when n is at most qpr_levels.
+    void decompose_i( const Ma& U, Me& out, int n ) const;
+    /// \brief Recursive part of decompose in quadruple precision
+    void decompose_i( const Mq& U, Me& out, int n ) const;
+    /// \brief One iteration of the Solovay Kitaev algorithm in precision of M
+    template< class M >
+    void decompose_t( const M& U, Me& out, int n ) const;
+
+    /// \brief Key of memoized approximation: number of iterations and
+    /// entries of the unitary rounded to machine precision
+    struct memoKey
+    {
+        int n;              ///< Number of iterations
+        double v[8];        ///< Real and imaginary parts of the entries
+        bool operator<( const memoKey& b ) const;
+    };
+    /// \brief Memoized approximation
+    template< class M >
+    struct memoValue
+    {
+        M U;                ///< Exact unitary, keys of different unitaries may coincide
+        Me out;             ///< Its approximation
+    };
+    /// \brief Memoized approximations of unitaries of type M
+    template< class M >
+    struct memoTable : public std::multimap< memoKey, memoValue<M> > {};
+
+    /// \brief Returns the key of U approximated with n iterations
+    template< class M >
+    static memoKey key( const M& U, int n );
+    /// \brief Looks up memoized approximation of U, returns true if found
+    template< class M >
+    bool recall( const memoKey& k, const M& U, Me& out ) const;
+    /// \brief Memoizes approximation of U
+    template< class M >
+    void memoize( const memoKey& k, const M& U, const Me& out ) const;
+    /// \brief Memoized approximations of high precision unitaries
+    memoTable<Ma>& table( const Ma& ) const { return memo; }
+    /// \brief Memoized approximations of quadruple precision unitaries
+    memoTable<Mq>& table( const Mq& ) const { return memo_q; }
+
+    /// \brief Largest number of memoized approximations of each precision
+    static const size_t max_memo_size = 16384;
+    /// \brief Memoized approximations of high precision unitaries
+    mutable memoTable<Ma> memo;
+    /// \brief Memoized approximations of quadruple precision unitaries
+    mutable memoTable<Mq> memo_q;
+    /// \brief Guards memo
+    mutable std::mutex memo_lock;
+
     /// \brief Class used for approximation
     indexedUnitaryApproximator uapp;
+    /// \brief Iterations with at most that many steps left run in quadruple precision,
+    /// -1 if all run in high precision
+    int qpr_levels;
 };
 
 #endif // SK_H
@@ -0,0 +1,105 @@
+//     This file uses SQCT, Copyright (c) 2012 Vadym Kliuchnikov, Dmitri Maslov, Michele Mosca;
+//     SQCT is distributed under LGPL v3
+//
+
+// Compares the Solovay Kitaev decomposition with adaptive precision against
+// the one that runs all iterations in high precision: time per rotation,
+// approximation error and whether both give the same circuit.
+
+#include "eapp.h"
+#include "sk.h"
+#include "gcommdecomposer.h"
+#include "exactdecomposer.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock sclock;
+
+/// \brief Approximations of the rotations and the time they took
+struct benchResult
+{
+    vector<sk::Me> out;     ///< Approximations
+    vector<double> dist;    ///< Trace distance to the rotation
+    double seconds;         ///< Total time
+};
+
+static void run( const sk& skd, const vector<Rotation>& rot, int iterations, benchResult& res )
+{
+    res.out.resize( rot.size() );
+    res.dist.resize( rot.size() );
+    sclock::time_point start = sclock::now();
+    for( size_t i = 0; i < rot.size(); ++i )
+    {
+        Rotation r = rot[i];
+        sk::Ma U = r.matrix();
+        skd.decompose( U, res.out[i], iterations );
+        res.out[i].reduce();
+        res.dist[i] = trace_dist( U, sk::Ma( res.out[i] ) );
+    }
+    res.seconds = chrono::duration<double>( sclock::now() - start ).count();
+}
+
+int main( int argc, char** argv )
+{
+    if( argc < 3 )
+    {
+        fprintf( stderr, "Usage: %s <max layer> <iterations> [rotations]\n", argv[0] );
+        return 1;
+    }
+    int max_layer = atoi( argv[1] );
+    int iterations = atoi( argv[2] );
+    int count = argc > 3 ? atoi( argv[3] ) : 20;
+
+    enetOptions eopts;
+    eopts.epsilon_net_layers.push_back( max_layer );
+    enetApplication eapp( eopts );
+    eapp.process();
+
+    static const double TwoPi = 2. * hprHelpers::toMachine( hprHelpers::pi() );
+    vector<Rotation> rot( count );
+    for( int i = 0; i < count; ++i )
+    {
+        rot[i].num = 0.1 + i * 0.737;
+        rot[i].den = TwoPi;
+        rot[i].nx = ( i % 3 == 0 );
+        rot[i].ny = ( i % 3 == 1 );
+        rot[i].nz = ( i % 3 == 2 );
+    }
+
+    printf( "quadruple precision iterations: %d\n", sk::qprLevels( max_layer + 1 ) );
+
+    benchResult hpr, adaptive;
+    {
+        sk skd( max_layer + 1, false );
+        run( skd, rot, iterations, hpr );
+    }
+    {
+        sk skd( max_layer + 1, true );
+        run( skd, rot, iterations, adaptive );
+    }
+
+    exactDecomposer ed;
+    int same = 0;
+    double worst_hpr = 0, worst_adaptive = 0;
+    for( int i = 0; i < count; ++i )
+    {
+        circuit ch, ca;
+        ed.decompose( hpr.out[i], ch );
+        ed.decompose( adaptive.out[i], ca );
+        if( ch.toString() == ca.toString() )
+            ++same;
+        worst_hpr = max( worst_hpr, hpr.dist[i] );
+        worst_adaptive = max( worst_adaptive, adaptive.dist[i] );
+    }
+
+    printf( "high precision:     %8.3f s, worst trace distance %.3e\n", hpr.seconds, worst_hpr );
+    printf( "adaptive precision: %8.3f s, worst trace distance %.3e\n", adaptive.seconds, worst_adaptive );
+    printf( "same circuits: %d of %d\n", same, count );
+    return 0;
+}
@@ -0,0 +1,174 @@
+//     This file uses SQCT, Copyright (c) 2012 Vadym Kliuchnikov, Dmitri Maslov, Michele Mosca;
+//     SQCT is distributed under LGPL v3
+//
+
+#include "sqctcontext.h"
+#include "eapp.h"
+#include "exactdecomposer.h"
+#include "gcommdecomposer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+struct sqctContext::data
+{
+    data( int max_layer, bool quad_precision ) : skd( max_layer + 1, quad_precision ) {}
+
+    sk skd;                 ///< SK decomposer, holds the epsilon nets and their index
+    exactDecomposer ed;     ///< Exact decomposer, holds the lookup tables
+};
+
+sqctContext::sqctContext( int max_layer, bool quad_precision ) :
+    d(0)
+{
+    enetOptions eopts;
+    eopts.epsilon_net_layers.push_back( max_layer );
+    enetApplication eapp( eopts );
+    eapp.process();
+
+    d = new data( max_layer, quad_precision );
+}
+
+sqctContext::~sqctContext()
+{
+    delete d;
+}
+
+std::string sqctContext::decompose( double angle, char axis, int iterations ) const
+{
+    static const double TwoPi = 2. * hprHelpers::toMachine( hprHelpers::pi() );
+
+    // same rotation as SKDecompose::rotX/rotY/rotZ
+    Rotation r;
+    r.num = angle;
+    r.den = TwoPi;
+    r.nx = ( axis == 'X' ) ? 1 : 0;
+    r.ny = ( axis == 'Y' ) ? 1 : 0;
+    r.nz = ( axis == 'Z' ) ? 1 : 0;
+
+    sk::Me res;
+    d->skd.decompose( r.matrix(), res, iterations );
+    res.reduce();
+
+    circuit c;
+    d->ed.decompose( res, c );
+    return c.toString();
+}
+
+std::vector<std::string> sqctContext::decompose( const std::vector<double>& angles, const std::string& axes,
+                                                 int iterations, int threads ) const
+{
+    std::vector<std::string> res( angles.size() );
+#ifdef _OPENMP
+    if( threads <= 0 )
+        threads = omp_get_max_threads();
+#endif
+
+    #pragma omp parallel num_threads(threads)
+    #pragma omp single
+    for( size_t i = 0; i < angles.size(); ++i )
+    {
+        #pragma omp task firstprivate(i) shared(res)
+        {
+            try
+            {
+                res[i] = decompose( angles[i], axes[i], iterations );
+            }
+            catch( std::exception& )
+            {
+                res[i].clear();
+            }
+        }
+    }
+
+    return res;
+}
+
+void* sqct_context_create( int max_layer )
+{
+    return sqct_context_create_ex( max_layer, 0 );
+}
+
+void* sqct_context_create_ex( int max_layer, int quad_precision )
+{
+    try
+    {
+        return new sqctContext( max_layer, quad_precision != 0 );
+    }
+    catch( std::exception& )
+    {
+        return 0;
+    }
+}
+
+void sqct_context_destroy( void* context )
+{
+    delete static_cast<sqctContext*>( context );
+}
+
+int sqct_decompose( void* context, double angle, char axis, int iterations, char* out, int size )
+{
+    if( !context || ( axis != 'X' && axis != 'Y' && axis != 'Z' ) )
+        return -1;
+
+    std::string gates;
+    try
+    {
+        gates = static_cast<const sqctContext*>( context )->decompose( angle, axis, iterations );
+    }
+    catch( std::exception& )
+    {
+        return -1;
+    }
+
+    if( size > 0 )
+    {
+        size_t n = std::min( gates.size(), (size_t)( size - 1 ) );
+        memcpy( out, gates.data(), n );
+        out[n] = 0;
+    }
+    return gates.size();
+}
+
+int sqct_decompose_batch( void* context, int count, const double* angles, const char* axes,
+                          int iterations, int threads, char** out )
+{
+    if( !context || count < 0 )
+        return -1;
+    for( int i = 0; i < count; ++i )
+        if( axes[i] != 'X' && axes[i] != 'Y' && axes[i] != 'Z' )
+            return -1;
+
+    std::vector<std::string> gates;
+    try
+    {
+        gates = static_cast<const sqctContext*>( context )->decompose(
+                    std::vector<double>( angles, angles + count ), std::string( axes, count ),
+                    iterations, threads );
+    }
+    catch( std::exception& )
+    {
+        return -1;
+    }
+
+    for( int i = 0; i < count; ++i )
+    {
+        out[i] = 0;
+        if( gates[i].empty() )
+            continue;
+        out[i] = (char*) malloc( gates[i].size() + 1 );
+        if( out[i] )
+            memcpy( out[i], gates[i].c_str(), gates[i].size() + 1 );
+    }
+    return count;
+}
+
+void sqct_free( char* gates )
+{
+    free( gates );
+}
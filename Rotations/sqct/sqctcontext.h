@@ -0,0 +1,71 @@
+//     This file uses SQCT, Copyright (c) 2012 Vadym Kliuchnikov, Dmitri Maslov, Michele Mosca;
+//     SQCT is distributed under LGPL v3
+//
+
+#ifndef SQCTCONTEXT_H
+#define SQCTCONTEXT_H
+
+// This header is included by the Scaffold LLVM passes, which are compiled as
+// C++98, so it must not use C++11 features.
+
+#include <string>
+#include <vector>
+
+/// \brief Reusable rotation decomposition context.
+/// Loads the epsilon nets, the index and the lookup tables of the exact
+/// decomposer once, and then decomposes any number of rotations.
+/// decompose() does not modify the context and may be called from several
+/// threads at the same time.
+class sqctContext
+{
+public:
+    /// \brief Generates missing epsilon net layers up to max_layer inclusively
+    /// and loads them
+    /// \param quad_precision Run the shallow Solovay Kitaev iterations in
+    /// quadruple precision, see sk::sk
+    explicit sqctContext( int max_layer = 30, bool quad_precision = false );
+    ~sqctContext();
+
+    /// \brief Decomposes a rotation by angle around the axis 'X', 'Y' or 'Z'
+    /// with the given number of Solovay Kitaev iterations
+    /// \returns Gate string in the same format as printed by rotZ
+    std::string decompose( double angle, char axis, int iterations ) const;
+
+    /// \brief Decomposes rotations by angles[i] around axes[i] as tasks of one
+    /// OpenMP team, which also runs the Solovay Kitaev iterations of all of them
+    /// \param threads Size of the team, 0 for the OpenMP default
+    /// \returns Gate strings, empty for rotations that failed
+    std::vector<std::string> decompose( const std::vector<double>& angles, const std::string& axes,
+                                        int iterations, int threads = 0 ) const;
+
+private:
+    sqctContext( const sqctContext& );
+    sqctContext& operator=( const sqctContext& );
+
+    struct data;
+    data* d;
+};
+
+// C entry points of libsqct.so, for clients that load the library at runtime
+extern "C"
+{
+    /// \brief Creates a sqctContext, returns 0 on failure
+    void* sqct_context_create( int max_layer );
+    /// \brief Creates a sqctContext with the given precision mode, returns 0 on failure
+    void* sqct_context_create_ex( int max_layer, int quad_precision );
+    /// \brief Destroys a context created by sqct_context_create
+    void sqct_context_destroy( void* context );
+    /// \brief Decomposes a rotation, see sqctContext::decompose.
+    /// Writes at most size - 1 characters and a terminating zero into out.
+    /// \returns Length of the gate string (like snprintf), or -1 on failure
+    int sqct_decompose( void* context, double angle, char axis, int iterations, char* out, int size );
+    /// \brief Decomposes count rotations at once, see sqctContext::decompose.
+    /// out[i] receives a gate string to be released by sqct_free, or 0 on failure.
+    /// \returns Number of rotations decomposed, or -1 on failure
+    int sqct_decompose_batch( void* context, int count, const double* angles, const char* axes,
+                              int iterations, int threads, char** out );
+    /// \brief Releases a gate string returned by sqct_decompose_batch
+    void sqct_free( char* gates );
+}
+
+#endif // SQCTCONTEXT_H
@@ -40,6 +40,8 @@ struct indexNodeComparator
 
 unitaryApproximator::unitaryApproximator( int max_layer )
 {
+    // layers are mapped read-only, so processes running at the same time
+    // share them through the page cache
     for( int i = 0; i < max_layer; ++i )
     {
         layers.push_back( unique_ptr<epsilonnet>( new epsilonnet ) );
@@ -48,11 +50,10 @@ unitaryApproximator::unitaryApproximator( int max_layer )
             //cout << "layer# " << i << " skipped" << endl;
             layers.pop_back();
         }
-        layers.back()->denominatorExponent2(); //set up denominator exponent
     }
 }
 
-double unitaryApproximator::approximate(const unitaryApproximator::Ma &m, unitaryApproximator::Me &res)
+double unitaryApproximator::approximate(const unitaryApproximator::Ma &m, unitaryApproximator::Me &res) const
 {
     assert( abs( m[0][0]*m[1][1] - m[0][1]*m[1][0] - 1.0 ) < 1e-9 );
     epsilonnet::vector2double vd( m[0][0], m[1][0] );
@@ -80,22 +81,29 @@ double unitaryApproximator::statistics(const unitaryApproximator::Ma &m, unitary
 
 /////////////////////////////////////////////////////
 
-double indexedUnitaryApproximator::approximate(const unitaryApproximator::Ma &m, unitaryApproximator::Me &res)
+double indexedUnitaryApproximator::approximate(const unitaryApproximator::Ma &m, unitaryApproximator::Me &res) const
 {
     assert( abs( m[0][0]*m[1][1] - m[0][1]*m[1][0] - 1.0 ) < 1e-9 );
-    vec = epsilonnet::vector2double( m[0][0],m[1][0] );
-    bestDist = 10.0;
-    abs2val = norm ( vec.first ); // absolute value squared of the first component of the column
+    searchState st;
+    st.vec = epsilonnet::vector2double( m[0][0],m[1][0] );
+    st.bestDist = 10.0;
+    st.abs2val = norm ( st.vec.first ); // absolute value squared of the first component of the column
 
-    epsilonnet::vector2double tmp = vec;
+    epsilonnet::vector2double tmp = st.vec;
     bool conj_1 = false, conj_2 = false;
     int w_pow1 = 0, w_pow2 = 0;
-    vec.first = canonical( tmp.first, w_pow1, conj_1 );
-    vec.second = canonical( tmp.second, w_pow2, conj_2 );
+    st.vec.first = canonical( tmp.first, w_pow1, conj_1 );
+    st.vec.second = canonical( tmp.second, w_pow2, conj_2 );
 
-    double epsilon0 = 0.001;
-    approximate_i( 0, 0 , epsilon0 );
+    if( tree.isReady() )
+        st.bestDist = tree.findApproximation( st.vec, st.curr_res, st.bestDist );
+    else
+    {
+        double epsilon0 = 0.001;
+        approximate_i( st, 0, 0 , epsilon0 );
+    }
 
+    epsilonnet::vi& curr_res = st.curr_res;
     if( conj_1 ) curr_res.d[0].conjugate_eq();
     if( conj_2 ) curr_res.d[1].conjugate_eq();
     curr_res.d[0].mul_eq_w( w_pow1 );
@@ -106,7 +114,7 @@ double indexedUnitaryApproximator::approximate(const unitaryApproximator::Ma &m,
     res.d[0][1] = (ring_int<mpz_class> ) - curr_res.d[1].conjugate();
     res.d[1][1] = (ring_int<mpz_class> ) curr_res.d[0].conjugate();
     res.de = curr_res.de;
-    return sqrt( 2.0 * bestDist );
+    return sqrt( 2.0 * st.bestDist );
 }
 
 typedef ring_int<int>::mpclass mpclass;
@@ -156,9 +164,9 @@ void indexedUnitaryApproximator::add_nodes_to_index(int layer_id)
 {
     const epsilonnet& enet = *layers[layer_id].get();
     int de = enet.denominatorExponent2();
-    int sz = enet.nodes.size();
-    const auto& nodes = enet.nodes;
-    index_nodes.reserve( index_nodes.size() + nodes.size() );
+    int sz = enet.nodesSize();
+    const enetNode* nodes = enet.nodesData();
+    index_nodes.reserve( index_nodes.size() + 2 * sz );
     for( int i = 0; i < sz; ++i )
     {
         ring_int_real<int> rreal(nodes[i].ipxx,nodes[i].ipQxx);
@@ -176,6 +184,14 @@ struct inxdex_header
     size_t size;
 };
 
+/// \brief Name of the file with columnTree for the given number of layers, next to the index file
+static string treeFileName( size_t layers_count )
+{
+    stringstream filename;
+    filename << "/tmp/index-" << layers_count << ".tree";
+    return filename.str();
+}
+
 void indexedUnitaryApproximator::loadIndex()
 {
     inxdex_header eh = {0};
@@ -196,18 +212,18 @@ void indexedUnitaryApproximator::loadIndex()
     index_nodes.clear();
     index_nodes.resize( eh.size );
     ifs.read( (char*) &index_nodes[0], index_nodes.size() * sizeof(index_node) );
-    is_index_ok = true;
+    is_index_ok = tree.loadFromFile( treeFileName( layers.size() ).c_str(), layers );
 }
 
-void indexedUnitaryApproximator::approximate_i(size_t end1, size_t start2, double epsilon0)
+void indexedUnitaryApproximator::approximate_i(searchState& st, size_t end1, size_t start2, double epsilon0) const
 {
     // In the beginning we make an assumption that there exist approximation
     // within Euclidean distance epsilon0, in this case we can find
     // bounds on absolute value squared of the first entry of approximating vector and
     // reduce amount of nodes that we need to check:
 
-    double upper_bound = min( 1.0, sqrt(abs2val) + epsilon0 );
-    double lower_bound = max( 0.0, sqrt(abs2val) - epsilon0 );
+    double upper_bound = min( 1.0, sqrt(st.abs2val) + epsilon0 );
+    double lower_bound = max( 0.0, sqrt(st.abs2val) - epsilon0 );
     index_node low({lower_bound * lower_bound,0,0,0});
     index_node high({upper_bound * upper_bound,0,0,0});
     indexNodeComparator ic;
@@ -233,27 +249,49 @@ void indexedUnitaryApproximator::approximate_i(size_t end1, size_t start2, doubl
     // On next iteration we update end1 and start2 to exclude intervals that we already checked
     // [loff,end1) U [start2, uoff )
 
-    for( int i = loff; i < end1 ; ++i )
+    // Nodes are split between threads, each thread keeps the best approximation
+    // of its part and the one found first in [loff,end1) U [start2, uoff )
+    // wins ties, as in the serial loop.
+    int n1 = max( 0, (int) end1 - loff );
+    int n = n1 + max( 0, uoff - (int) start2 );
+    double best_dist = st.bestDist;
+    int best_k = n;
+    #pragma omp parallel if( n > 256 )
     {
-        index_node& cn = index_nodes[i];
-        layers[ cn.layer_id ]->findExhaustiveApproximation(vec,curr_res,cn.node_id,bestDist);
-    }
+        epsilonnet::vi thread_res;
+        double thread_dist = st.bestDist;
+        int thread_k = n;
 
-    for( int i = start2; i < uoff; ++i )
-    {
-        index_node& cn = index_nodes[i];
-        layers[ cn.layer_id ]->findExhaustiveApproximation(vec,curr_res,cn.node_id,bestDist);
+        #pragma omp for schedule(dynamic,32) nowait
+        for( int k = 0; k < n; ++k )
+        {
+            const index_node& cn = index_nodes[ k < n1 ? loff + k : start2 + ( k - n1 ) ];
+            double prev_dist = thread_dist;
+            layers[ cn.layer_id ]->findExhaustiveApproximation(st.vec,thread_res,cn.node_id,thread_dist);
+            if( thread_dist < prev_dist )
+                thread_k = k;
+        }
+
+        #pragma omp critical
+        if( thread_k < n && ( thread_dist < best_dist ||
+                              ( thread_dist == best_dist && thread_k < best_k ) ) )
+        {
+            best_dist = thread_dist;
+            best_k = thread_k;
+            st.curr_res = thread_res;
+        }
     }
+    st.bestDist = best_dist;
 
-    auto v1 = curr_res.d[0].toComplex( curr_res.de );
-    auto v2 = curr_res.d[1].toComplex( curr_res.de );
+    auto v1 = st.curr_res.d[0].toComplex( st.curr_res.de );
+    auto v2 = st.curr_res.d[1].toComplex( st.curr_res.de );
 
     // if we find something closer then epsilon0 we finish algorithm
-    if( ( norm(v1-vec.first) + norm(v2-vec.second) ) < epsilon0 * epsilon0 )
+    if( ( norm(v1-st.vec.first) + norm(v2-st.vec.second) ) < epsilon0 * epsilon0 )
         return;
     else
     // otherwise we continue search with bigger epsilon ( we relax initial assumption )
-        approximate_i(loff,uoff,epsilon0 + 0.005 );
+        approximate_i(st,loff,uoff,epsilon0 + 0.005 );
 }
 
 indexedUnitaryApproximator::indexedUnitaryApproximator(int max_layer) :
@@ -286,4 +324,7 @@ void indexedUnitaryApproximator::createIndex()
         ofs.write( (const char*) &index_nodes[0], index_nodes.size() * sizeof(index_node) );
         ofs.close();
     }
+
+    tree.build( layers );
+    tree.saveToFile( treeFileName( layers.size() ).c_str() );
 }
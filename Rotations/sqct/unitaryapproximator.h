@@ -21,13 +21,14 @@
 
 #include "matrix2x2.h"
 #include "epsilonnet.h"
+#include "columntree.h"
 #include <memory>
 #include <vector>
 
 /// \brief Perfors approximation of machine precision unitaries by exact
 /// unitaries over the ring  \f$ \mathbb{Z}[\frac{1}{\sqrt{2}},i]\f$
-/// \note Class is not thread safe now. Possible solution it to write appropriate copy constructor
-/// that will share epsilon nets.
+/// \note approximate() does not modify the object, so one approximator can be shared
+/// by several threads once it is constructed.
 class unitaryApproximator
 {
 public:
@@ -39,7 +40,7 @@ public:
     /// \param max_layer Non inclusive upper bound of \f$ sde(|\cdot|^2) \f$ that will be used for approximation
     unitaryApproximator( int max_layer = 31 );
     /// \brief Performs approximation of the special unitary m and writes result into res
-    virtual double approximate( const Ma& m, Me& res );
+    virtual double approximate( const Ma& m, Me& res ) const;
     /// \brief Outputs statistic about time and approximation quality for each layer
     /// \note Not implemented for this class
     virtual double statistics( const Ma& m, Me& res );
@@ -60,8 +61,8 @@ struct index_node
 /// \brief Perfors approximation of machine precision unitaries by exact
 /// unitaries over the ring  \f$ \mathbb{Z}[\frac{1}{\sqrt{2}},i]\f$.
 /// Uses index based on absolute values of columns entries to speed up search.
-/// \note Class is not thread safe now. Possible solution it to write appropriate copy constructor
-/// that will share epsilon nets.
+/// \note approximate() keeps its search state on the stack, so one approximator can be shared
+/// by several threads once it is constructed.
 class indexedUnitaryApproximator : public unitaryApproximator
 {
 public:
@@ -69,10 +70,11 @@ public:
     /// If there is no index exists creates one automatically.
     /// \param max_layer Non inclusive upper bound of \f$ sde(|\cdot|^2) \f$ that will be used for approximation
     indexedUnitaryApproximator( int max_layer = 31 );
-    /// \brief Computes absolute values squared of column entries and stores them in sorted array
+    /// \brief Computes absolute values squared of column entries and stores them in sorted array,
+    /// builds columnTree over the layers and saves both next to each other
     void createIndex();
     /// \brief Performs approximation of the special unitary m and writes result into res
-    double approximate( const Ma& m, Me& res );
+    double approximate( const Ma& m, Me& res ) const;
     /// \brief Outputs statistics about time, approximation quality and number of T gates in resulting circuits
     double statistics( const Ma& m, Me& res );
 private:
@@ -80,18 +82,25 @@ private:
     void add_nodes_to_index( int layer_id );
     /// \brief Loads index from file
     void loadIndex();
+    /// \brief State of one approximation, see approximate_i
+    struct searchState
+    {
+        epsilonnet::vector2double vec; ///< First column of the special unitary that we approximating
+        double bestDist;///< Best distance to approximation that was laready found
+        double abs2val;///< Absolute value squared of the first component of vec
+        epsilonnet::vi curr_res;///< Current best approximation found
+    };
     /// \brief Assumes that there exist approximation within distance epsilon0
     /// and check nodes from index_nodes with index in \f$ [0,end1) \cup [start2, index size ) \f$.
     /// If it fails to find node within epsilon0 it relaxes intial assumption and search further.
-    void approximate_i( size_t end1, size_t start2, double epsilon0 );
+    void approximate_i( searchState& st, size_t end1, size_t start2, double epsilon0 ) const;
     /// \brief True if index loaded successfully
     bool is_index_ok;
-    epsilonnet::vector2double vec; ///< First column of the special unitary that we approximating
-    double bestDist;///< Best distance to approximation that was laready found
-    double abs2val;///< Absolute value squared of the first component of vec
-    epsilonnet::vi curr_res;///< Current best approximation found
     /// \brief Index nodes sorted by index_node::abs2
     std::vector<index_node> index_nodes;
+    /// \brief Nearest neighbour index over the columns of the layers, used
+    /// instead of index_nodes when it is available
+    columnTree tree;
 };
 
 #endif // UNITARYAPPROXIMATOR_H
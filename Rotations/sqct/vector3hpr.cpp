@@ -18,27 +18,32 @@
 
 #include "vector3hpr.h"
 
-typedef Vector3hpr::mpclass mpclass;
-
-Vector3hpr::Vector3hpr() :
-    v{0,0,0}
-{}
+template < class T >
+Vector3<T>::Vector3()
+{
+    v[0] = 0;
+    v[1] = 0;
+    v[2] = 0;
+}
 
-Vector3hpr::Vector3hpr( const mpclass& x, const mpclass &y, const mpclass& z )
+template < class T >
+Vector3<T>::Vector3( const mpclass& x, const mpclass &y, const mpclass& z )
 {
     v[0] = x;
     v[1] = y;
     v[2] = z;
 }
 
-Vector3hpr Vector3hpr::cross( const Vector3hpr& a )
+template < class T >
+Vector3<T> Vector3<T>::cross( const Vector3& a )
 {
-    return Vector3hpr( v[1]* a.v[2] -v[2]* a.v[1],
-                       v[2]* a.v[0] -v[0]* a.v[2],
-                       v[0]* a.v[1] -v[1]* a.v[0] );
+    return Vector3( v[1]* a.v[2] -v[2]* a.v[1],
+                    v[2]* a.v[0] -v[0]* a.v[2],
+                    v[0]* a.v[1] -v[1]* a.v[0] );
 }
 
-Vector3hpr& Vector3hpr::operator=( const Vector3hpr& val )
+template < class T >
+Vector3<T>& Vector3<T>::operator=( const Vector3& val )
 {
     v[0] = val.v[0];
     v[1] = val.v[1];
@@ -46,26 +51,35 @@ Vector3hpr& Vector3hpr::operator=( const Vector3hpr& val )
     return *this;
 }
 
-Vector3hpr Vector3hpr::operator /( const mpclass& val )
+template < class T >
+Vector3<T> Vector3<T>::operator /( const mpclass& val )
 {
-    Vector3hpr res;
+    Vector3 res;
     res.v[0] =  v[0] /val;
     res.v[1] =  v[1] /val;
     res.v[2] =  v[2] /val;
     return res;
 }
 
-mpclass Vector3hpr::dot( const Vector3hpr& val )
+template < class T >
+T Vector3<T>::dot( const Vector3& val )
 {
-    return v[0] * val.v[0] + v[1] * val.v[1] + v[2] * val.v[2];;
+    return v[0] * val.v[0] + v[1] * val.v[1] + v[2] * val.v[2];
 }
 
-mpclass Vector3hpr::squaredNorm()
+template < class T >
+T Vector3<T>::squaredNorm()
 {
     return v[0] *v[0] + v[1] * v[1] + v[2] * v[2];
 }
 
-mpclass Vector3hpr::norm()
+template < class T >
+T Vector3<T>::norm()
 {
-    return sqrt( v[0] *v[0] + v[1] * v[1] + v[2] * v[2] );
+    return realSqrt( v[0] *v[0] + v[1] * v[1] + v[2] * v[2] );
 }
+
+//////// template compilation requests //////////////////
+
+template struct Vector3< ring_int<int>::mpclass >;
+template struct Vector3< qprHelpers::qpr_real >;
@@ -21,31 +21,37 @@
 
 #include "rint.h"
 
-/// \brief High precision three dimensioal vector
-struct Vector3hpr
+/// \brief Three dimensional vector over real numbers of type T
+template < class T >
+struct Vector3
 {
-    /// \brief High precision real numbers class
-    typedef ring_int<int>::mpclass mpclass;
+    /// \brief Real numbers class
+    typedef T mpclass;
     /// \brief Vector entries
     mpclass v[3];
 
     /// \brief Constructs vector with zero entries
-    Vector3hpr();
+    Vector3();
     /// \brief Set's vector tp (x,y,z)
-    Vector3hpr( const mpclass &x, const mpclass& y, const mpclass& z );
+    Vector3( const mpclass &x, const mpclass& y, const mpclass& z );
     /// \brief Cross product
-    Vector3hpr cross( const Vector3hpr& a );
+    Vector3 cross( const Vector3& a );
     /// \brief Assignment operator
-    Vector3hpr& operator=( const Vector3hpr& val );
+    Vector3& operator=( const Vector3& val );
     /// \brief Element-wise division
-    Vector3hpr operator /( const mpclass& val );
+    Vector3 operator /( const mpclass& val );
 
     /// \brief Dot product
-    mpclass dot( const Vector3hpr& val );
+    mpclass dot( const Vector3& val );
     /// \brief Euclidean norm squared
     mpclass squaredNorm();
     /// \brief Euclidean norm
     mpclass norm();
 };
 
+/// \brief High precision three dimensioal vector
+typedef Vector3< ring_int<int>::mpclass > Vector3hpr;
+/// \brief Quadruple precision three dimensioal vector
+typedef Vector3< qprHelpers::qpr_real > Vector3qpr;
+
 #endif // VECTOR3HPR_H
@@ -7,6 +7,11 @@
 //===----------------------------------------------------------------------===//
 
 #include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
 #include "llvm/Argument.h"
 #include "llvm/Pass.h"
 #include "llvm/Module.h"
@@ -17,12 +22,15 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Support/InstIterator.h"
 #include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/Constants.h"
 #include "llvm/Analysis/DebugInfo.h"
 #include "llvm/IntrinsicInst.h"
+#include "ScaffoldOutput.h"
+#include "QASMBin.h"
 
 using namespace llvm;
 using namespace std;
@@ -32,6 +40,14 @@ using namespace std;
 
 bool debugGenQASM = false;
 
+static cl::opt<unsigned>
+FlatQASMCacheLines("flat-qasm-cache-lines", cl::init(100000), cl::Hidden,
+    cl::desc("Largest module, in lines of flat QASM, gen-flat-qasm expands once and reuses"));
+
+static cl::opt<std::string>
+FlatQASMFormat("flat-qasm-format", cl::init("text"), cl::Hidden,
+    cl::desc("Format of the flat QASM: text, or binary (.qasmb, see QASMBin.h)"));
+
 namespace {
 
   struct qGateArg{ //arguments to qgate calls
@@ -56,6 +72,531 @@ namespace {
     std::vector<qGateArg> qArgs;
   };    
 
+  // Flat QASM (-gen-flat-qasm)
+  //
+  // The flat QASM used to be made by translating the hierarchical QASM to
+  // C with flatten-qasm.py, compiling it and running it: every module became
+  // a C function, qbit arrays became arrays of qubit names and every gate a
+  // printf. The classes below do the same expansion in memory. Modules are
+  // kept with their gates and calls, and are expanded from main with the
+  // parameters bound to the qubit names of the caller, which prints the same
+  // lines the C program prints.
+  //
+  // A module called many times is expanded once into a template: its flat
+  // QASM with holes where the qubits of its parameters go. Later calls only
+  // fill the holes. Modules whose flat QASM is larger than
+  // -flat-qasm-cache-lines are not cached and are expanded every time.
+
+  // argument of a gate or module call, as the C program sees it
+  struct flatArg{
+    enum argKind { ARRAY, QBIT, NUM, BAD };
+    argKind kind;
+    bool local; //array declared in the module, otherwise a parameter
+    int slot; //index of the array or parameter
+    int index; //element of the array, -1 for a qbit parameter
+    double num; //value of a NUM argument
+    flatArg(): kind(BAD), local(false), slot(-1), index(-1), num(0.0){ }
+  };
+
+  enum flatParamKind { PARAM_ARRAY, PARAM_QBIT, PARAM_NUM };
+
+  struct flatOp{
+    int gate; //index in flatGates, -1 for a module call
+    int callee; //index of the called module, -1 if it is not known
+    std::string name;
+    std::vector<flatArg> args;
+  };
+
+  // flat QASM of a module, with holes for the qubits of its parameters. The
+  // text before hole i ends at holes[i].end, the rest of text follows the
+  // last hole.
+  struct flatHole{
+    size_t end;
+    int slot; //parameter
+    int index; //element of an array parameter, -1 for a qbit parameter
+  };
+
+  struct flatTemplate{
+    std::string text;
+    std::vector<flatHole> holes;
+  };
+
+  struct flatModule{
+    std::string name;
+    std::vector<flatParamKind> params;
+    std::vector<std::string> paramNames;
+    std::vector<std::string> localNames;
+    std::vector< std::vector<std::string> > locals; //qubit or cbit names of every array, empty if not supported
+    std::vector<flatOp> ops;
+    uint64_t lines; //lines printed by one call, saturated
+    uint64_t calls; //times the module is called from main, saturated
+    int state; //0 not visited, 1 being visited, 2 done
+    flatTemplate* cache;
+    flatModule(): lines(0), calls(0), state(0), cache(NULL){ }
+  };
+
+  // what a parameter is bound to in a call: a qubit array or qubit name of
+  // the caller, or while a template is made, a parameter of the templated
+  // module (arr and str NULL)
+  struct flatBind{
+    const std::vector<std::string>* arr;
+    const std::string* str;
+    int slot;
+    int index;
+    flatBind(): arr(NULL), str(NULL), slot(-1), index(-1){ }
+  };
+
+  // where the expansion goes: the output, or a template being made
+  class flatSink{
+  public:
+    virtual ~flatSink(){ }
+    virtual void text(const char* s, size_t n) = 0;
+    virtual void hole(int slot, int index) = 0;
+    void text(const std::string& s){ text(s.data(), s.size()); }
+    void text(const char* s){ text(s, strlen(s)); }
+  };
+
+  class flatStream : public flatSink{
+    raw_ostream &out;
+  public:
+    flatStream(raw_ostream &o): out(o){ }
+    void text(const char* s, size_t n){ out.write(s, n); }
+    void hole(int slot, int index){ } //main has no parameters, nothing is left open
+  };
+
+  // binary flat QASM: every line is parsed into a record as it is completed
+  class flatBinarySink : public flatSink{
+    qasmBinWriter &w;
+    std::string part; //start of a line split across calls
+  public:
+    flatBinarySink(qasmBinWriter &writer): w(writer){ }
+    void text(const char* s, size_t n){
+      const char* end = s + n;
+      while(s < end){
+        const char* nl = (const char*)memchr(s, '\n', end - s);
+        if(!nl){
+          part.append(s, end - s);
+          return;
+        }
+        if(part.empty())
+          w.line(s, nl - s);
+        else{
+          part.append(s, nl - s);
+          w.line(part.data(), part.size());
+          part.clear();
+        }
+        s = nl + 1;
+      }
+    }
+    void hole(int slot, int index){ }
+  };
+
+  class qasmBinStream : public qasmBinSink{
+    raw_ostream &out;
+  public:
+    qasmBinStream(raw_ostream &o): out(o){ }
+    void write(const char* data, size_t size){ out.write(data, size); }
+  };
+
+  class flatTemplateSink : public flatSink{
+    flatTemplate &t;
+  public:
+    flatTemplateSink(flatTemplate &tmpl): t(tmpl){ }
+    void text(const char* s, size_t n){ t.text.append(s, n); }
+    void hole(int slot, int index){
+      flatHole h;
+      h.end = t.text.size();
+      h.slot = slot;
+      h.index = index;
+      t.holes.push_back(h);
+    }
+  };
+
+  // qubit argument of a gate: a qubit name, or a hole of the template
+  struct flatQbit{
+    const std::string* str;
+    int slot;
+    int index;
+  };
+
+  // gates of the flat QASM, printed like the qg_ functions of flatten-qasm.py
+  enum flatGateKind { FG_PLAIN, FG_SDAG, FG_PREP, FG_ROT };
+
+  struct flatGate{
+    const char* name; //gate in the hierarchical QASM
+    const char* print; //gate in the flat QASM
+    int qbits; //qbit arguments
+    int nums; //numeric arguments after the qbits
+    flatGateKind kind;
+  };
+
+  const flatGate flatGates[] = {
+    {"H", "H", 1, 0, FG_PLAIN},
+    {"X", "X", 1, 0, FG_PLAIN},
+    {"Y", "Y", 1, 0, FG_PLAIN},
+    {"Z", "Z", 1, 0, FG_PLAIN},
+    {"S", "S", 1, 0, FG_PLAIN},
+    {"T", "T", 1, 0, FG_PLAIN},
+    {"Tdag", "Tdag", 1, 0, FG_PLAIN},
+    {"Sdag", "S", 1, 0, FG_SDAG}, //Sdag = S^3
+    {"CNOT", "CNOT", 2, 0, FG_PLAIN},
+    {"Toffoli", "Tof", 3, 0, FG_PLAIN},
+    {"Fredkin", "Fredkin", 3, 0, FG_PLAIN},
+    {"PrepX", "PrepX", 1, 1, FG_PREP}, //followed by X if prepared to 1
+    {"PrepZ", "PrepZ", 1, 1, FG_PREP},
+    {"MeasX", "MeasX", 1, 0, FG_PLAIN},
+    {"MeasZ", "MeasZ", 1, 0, FG_PLAIN},
+    {"Rz", "Rz", 1, 1, FG_ROT}
+  };
+
+  const int numFlatGates = sizeof(flatGates) / sizeof(flatGates[0]);
+
+  const uint64_t FLAT_MAX = ~(uint64_t)0;
+
+  uint64_t flatAdd(uint64_t a, uint64_t b){ return a > FLAT_MAX - b ? FLAT_MAX : a + b; }
+  uint64_t flatMul(uint64_t a, uint64_t b){ return (b != 0 && a > FLAT_MAX / b) ? FLAT_MAX : a * b; }
+
+  // modules of the program and the qubits and cbits the flat QASM declares
+  class flatQASM{
+    std::vector<std::string> qubitDecls;
+    std::set<std::string> qubitDeclared;
+    std::vector<std::string> cbitDecls;
+    std::vector<unsigned> order; //modules reachable from main, callees first
+    unsigned warnings;
+
+    void warn(const std::string& where, const std::string& msg){
+      if(warnings++ < 20)
+        errs() << "gen-flat-qasm: " << where << ": " << msg << "\n";
+    }
+
+    bool checkOp(flatModule& fm, flatOp& op);
+    bool size(unsigned m);
+    bool getQbit(const flatModule& fm, const flatArg& a, const std::vector<flatBind>& binds, flatQbit& q);
+    void putQbit(const flatQbit& q, flatSink& out){
+      if(q.str)
+        out.text(*q.str);
+      else
+        out.hole(q.slot, q.index);
+    }
+    void expandGate(const flatModule& fm, const flatOp& op, const std::vector<flatBind>& binds, flatSink& out);
+    void expand(unsigned m, const std::vector<flatBind>& binds, flatSink& out);
+    void replay(const flatModule& fm, const std::vector<flatBind>& binds, flatSink& out);
+
+  public:
+    std::vector<flatModule> modules;
+    bool inMain; //main has been added, later arrays are not ancillas
+
+    flatQASM(): warnings(0), inMain(false){ }
+    ~flatQASM(){
+      for(unsigned m = 0; m < modules.size(); m++)
+        delete modules[m].cache;
+    }
+
+    static int gateIndex(const std::string& name){
+      for(int g = 0; g < numFlatGates; g++)
+        if(name == flatGates[g].name)
+          return g;
+      return -1;
+    }
+
+    // declare a local array, named like flatten-qasm.py names the qubits
+    void addArray(flatModule& fm, const std::string& name, bool isQbit, int numElem){
+      fm.localNames.push_back(name);
+      fm.locals.push_back(std::vector<std::string>());
+      std::vector<std::string>& elems = fm.locals.back();
+      for(int i = 0; i < numElem; i++){
+        std::ostringstream ss;
+        ss << name << i;
+        if(isQbit && !inMain)
+          ss << "a"; //ancilla
+        elems.push_back(ss.str());
+        if(!isQbit)
+          cbitDecls.push_back(ss.str());
+        else if(qubitDeclared.insert(ss.str()).second)
+          qubitDecls.push_back(ss.str());
+      }
+    }
+
+    bool link();
+    void buildCaches(uint64_t maxLines);
+    void print(flatSink &out);
+  };
+
+  // calls and gates the C program could not compile or run are dropped
+  bool flatQASM::checkOp(flatModule& fm, flatOp& op){
+    if(op.gate >= 0){
+      const flatGate& g = flatGates[op.gate];
+      if((int)op.args.size() != g.qbits + g.nums){
+        warn(fm.name, "wrong number of arguments to " + op.name + ", gate dropped");
+        return false;
+      }
+      for(int i = 0; i < (int)op.args.size(); i++)
+        if(op.args[i].kind != (i < g.qbits ? flatArg::QBIT : flatArg::NUM)){
+          warn(fm.name, "unsupported argument to " + op.name + ", gate dropped");
+          return false;
+        }
+      return true;
+    }
+    if(op.callee < 0){
+      warn(fm.name, "call to unknown module " + op.name + " dropped");
+      return false;
+    }
+    const flatModule& callee = modules[op.callee];
+    if(op.args.size() != callee.params.size()){
+      warn(fm.name, "wrong number of arguments to " + op.name + ", call dropped");
+      return false;
+    }
+    for(unsigned i = 0; i < op.args.size(); i++){
+      flatArg::argKind k = op.args[i].kind;
+      flatParamKind p = callee.params[i];
+      if(!((k == flatArg::ARRAY && p == PARAM_ARRAY) || (k == flatArg::QBIT && p == PARAM_QBIT)
+           || (k == flatArg::NUM && p == PARAM_NUM))){
+        warn(fm.name, "unsupported argument to " + op.name + ", call dropped");
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // lines printed by one call of module m, callees before their callers
+  bool flatQASM::size(unsigned m){
+    flatModule& fm = modules[m];
+    if(fm.state == 2)
+      return true;
+    if(fm.state == 1){
+      errs() << "gen-flat-qasm: recursive call of module " << fm.name << ", cannot flatten\n";
+      return false;
+    }
+    fm.state = 1;
+    uint64_t lines = 0;
+    for(unsigned i = 0; i < fm.ops.size(); i++){
+      const flatOp& op = fm.ops[i];
+      if(op.gate < 0){
+        if(!size(op.callee))
+          return false;
+        lines = flatAdd(lines, modules[op.callee].lines);
+      }
+      else if(flatGates[op.gate].kind == FG_SDAG)
+        lines = flatAdd(lines, 3);
+      else if(flatGates[op.gate].kind == FG_PREP && (int)op.args[1].num == 1)
+        lines = flatAdd(lines, 2);
+      else
+        lines = flatAdd(lines, 1);
+    }
+    fm.lines = lines;
+    fm.state = 2;
+    order.push_back(m);
+    return true;
+  }
+
+  // resolve calls by name, drop what cannot be flattened, and count the
+  // lines and calls of every module reachable from main
+  bool flatQASM::link(){
+    std::map<std::string, int> byName;
+    for(unsigned m = 0; m < modules.size(); m++)
+      byName[modules[m].name] = m;
+
+    for(unsigned m = 0; m < modules.size(); m++){
+      flatModule& fm = modules[m];
+      std::vector<flatOp> ops;
+      for(unsigned i = 0; i < fm.ops.size(); i++){
+        flatOp& op = fm.ops[i];
+        if(op.gate < 0){
+          std::map<std::string, int>::iterator it = byName.find(op.name);
+          op.callee = it == byName.end() ? -1 : it->second;
+        }
+        if(checkOp(fm, op))
+          ops.push_back(op);
+      }
+      fm.ops.swap(ops);
+    }
+
+    std::map<std::string, int>::iterator mainIt = byName.find("main");
+    if(mainIt == byName.end()){
+      errs() << "gen-flat-qasm: no main module, nothing to flatten\n";
+      return false;
+    }
+    if(!modules[mainIt->second].params.empty()){
+      errs() << "gen-flat-qasm: main has quantum parameters, cannot flatten\n";
+      return false;
+    }
+    if(!size(mainIt->second))
+      return false;
+
+    modules[mainIt->second].calls = 1;
+    for(int o = order.size() - 1; o >= 0; o--){
+      flatModule& fm = modules[order[o]];
+      for(unsigned i = 0; i < fm.ops.size(); i++)
+        if(fm.ops[i].gate < 0){
+          flatModule& callee = modules[fm.ops[i].callee];
+          callee.calls = flatAdd(callee.calls, fm.calls);
+        }
+    }
+    return true;
+  }
+
+  // make the templates of the modules called more than once, callees first
+  // so that their templates are used to make the ones of their callers
+  void flatQASM::buildCaches(uint64_t maxLines){
+    for(unsigned o = 0; o < order.size(); o++){
+      unsigned m = order[o];
+      flatModule& fm = modules[m];
+      if(fm.calls < 2 || fm.lines == 0 || fm.lines > maxLines)
+        continue;
+      std::vector<flatBind> binds(fm.params.size());
+      for(unsigned p = 0; p < binds.size(); p++)
+        binds[p].slot = p;
+      flatTemplate* t = new flatTemplate;
+      flatTemplateSink sink(*t);
+      expand(m, binds, sink);
+      fm.cache = t;
+    }
+  }
+
+  bool flatQASM::getQbit(const flatModule& fm, const flatArg& a, const std::vector<flatBind>& binds, flatQbit& q){
+    q.str = NULL;
+    q.slot = -1;
+    q.index = -1;
+    if(a.local){
+      q.str = &fm.locals[a.slot][a.index];
+      return true;
+    }
+    const flatBind& b = binds[a.slot];
+    if(a.index < 0){ //qbit parameter
+      q.str = b.str;
+      q.slot = b.slot;
+      q.index = b.index;
+      return true;
+    }
+    if(!b.arr){ //element of a parameter of the template
+      q.slot = b.slot;
+      q.index = a.index;
+      return true;
+    }
+    if(a.index >= (int)b.arr->size()){
+      warn(fm.name, "qbit index out of range, gate dropped");
+      return false;
+    }
+    q.str = &(*b.arr)[a.index];
+    return true;
+  }
+
+  void flatQASM::expandGate(const flatModule& fm, const flatOp& op, const std::vector<flatBind>& binds, flatSink& out){
+    const flatGate& g = flatGates[op.gate];
+    flatQbit q[3];
+    for(int i = 0; i < g.qbits; i++)
+      if(!getQbit(fm, op.args[i], binds, q[i]))
+        return;
+
+    int times = g.kind == FG_SDAG ? 3 : 1;
+    for(int t = 0; t < times; t++){
+      out.text(g.print);
+      out.text(" ", 1);
+      putQbit(q[0], out);
+      for(int i = 1; i < g.qbits; i++){
+        out.text(",", 1);
+        putQbit(q[i], out);
+      }
+      if(g.kind == FG_ROT){
+        char buf[512];
+        int n = snprintf(buf, sizeof(buf), ",%f", op.args[1].num);
+        out.text(buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+      }
+      out.text("\n", 1);
+    }
+    if(g.kind == FG_PREP && (int)op.args[1].num == 1){
+      out.text("X ", 2);
+      putQbit(q[0], out);
+      out.text("\n", 1);
+    }
+  }
+
+  void flatQASM::expand(unsigned m, const std::vector<flatBind>& binds, flatSink& out){
+    const flatModule& fm = modules[m];
+    for(unsigned i = 0; i < fm.ops.size(); i++){
+      const flatOp& op = fm.ops[i];
+      if(op.gate >= 0){
+        expandGate(fm, op, binds, out);
+        continue;
+      }
+
+      std::vector<flatBind> calleeBinds(op.args.size());
+      bool ok = true;
+      for(unsigned j = 0; j < op.args.size() && ok; j++){
+        const flatArg& a = op.args[j];
+        flatBind& cb = calleeBinds[j];
+        if(a.kind == flatArg::ARRAY){
+          if(a.local)
+            cb.arr = &fm.locals[a.slot];
+          else
+            cb = binds[a.slot];
+        }
+        else if(a.kind == flatArg::QBIT){
+          flatQbit q;
+          ok = getQbit(fm, a, binds, q);
+          cb.str = q.str;
+          cb.slot = q.slot;
+          cb.index = q.index;
+        }
+      }
+      if(!ok)
+        continue;
+
+      const flatModule& callee = modules[op.callee];
+      if(callee.cache)
+        replay(callee, calleeBinds, out);
+      else
+        expand(op.callee, calleeBinds, out);
+    }
+  }
+
+  // fill the holes of the template of fm with the qubits bound to its parameters
+  void flatQASM::replay(const flatModule& fm, const std::vector<flatBind>& binds, flatSink& out){
+    const flatTemplate& t = *fm.cache;
+    const char* text = t.text.data();
+    size_t pos = 0;
+    for(unsigned i = 0; i < t.holes.size(); i++){
+      const flatHole& h = t.holes[i];
+      out.text(text + pos, h.end - pos);
+      pos = h.end;
+      const flatBind& b = binds[h.slot];
+      if(fm.params[h.slot] == PARAM_QBIT){
+        if(b.str)
+          out.text(*b.str);
+        else
+          out.hole(b.slot, b.index);
+      }
+      else if(!b.arr)
+        out.hole(b.slot, h.index);
+      else if(h.index < (int)b.arr->size())
+        out.text((*b.arr)[h.index]);
+      else
+        warn(fm.name, "qbit index out of range");
+    }
+    out.text(text + pos, t.text.size() - pos);
+  }
+
+  // print the declarations flatten-qasm.py wrote to fdecl.out, then the
+  // gates main runs
+  void flatQASM::print(flatSink &out){
+    for(unsigned i = 0; i < qubitDecls.size(); i++){
+      out.text("qubit ", 6);
+      out.text(qubitDecls[i]);
+      out.text("\n", 1);
+    }
+    for(unsigned i = 0; i < cbitDecls.size(); i++){
+      out.text("cbit ", 5);
+      out.text(cbitDecls[i]);
+      out.text("\n", 1);
+    }
+
+    for(unsigned m = 0; m < modules.size(); m++)
+      if(modules[m].name == "main"){
+        expand(m, std::vector<flatBind>(), out);
+        break;
+      }
+  }
+
   struct GenQASM : public ModulePass {
     static char ID;  // Pass identification, replacement for typeid
     std::vector<Value*> vectQbit;
@@ -71,8 +612,11 @@ namespace {
 
     int btCount; //backtrace count
 
+    bool genFlat; //expand the modules into flat QASM instead of printing them
+    flatQASM flat;
 
-    GenQASM() : ModulePass(ID) {  }
+    GenQASM() : ModulePass(ID), genFlat(false) {  }
+    GenQASM(char &pid, bool flatOut) : ModulePass(pid), genFlat(flatOut) {  }
 
     bool getQbitArrDim(Type* instType, qGateArg* qa);
     bool backtraceOperand(Value* opd, int opOrIndex);
@@ -128,6 +672,9 @@ namespace {
 
     void genQASM(Function* F);
     void getFunctionArguments(Function* F);
+
+    flatArg getFlatArg(const flatModule& fm, const qGateArg& qa);
+    void genFlatModule(Function* F);
     
     void print(raw_ostream &O, const Module* = 0) const { 
       errs() << "Qbits found: ";
@@ -144,12 +691,27 @@ namespace {
       AU.addRequired<CallGraph>();
     }
   };
+
+  // Same analysis as GenQASM, printing flat QASM
+  struct GenFlatQASM : public GenQASM {
+    static char ID; // Pass identification
+    GenFlatQASM() : GenQASM(ID, true) {  }
+  };
 }
 
 char GenQASM::ID = 0;
 static RegisterPass<GenQASM>
 X("gen-qasm", "Generate QASM output code"); //spatil: should be Z or X??
 
+char GenFlatQASM::ID = 0;
+static RegisterPass<GenFlatQASM>
+Y("gen-flat-qasm", "Generate flat QASM output code");
+
+// Lets the scaffold driver pick the format of each flat QASM it emits
+extern "C" void scaffoldSetFlatQASMFormat(const char *format) {
+  FlatQASMFormat = format;
+}
+
 bool GenQASM::backtraceOperand(Value* opd, int opOrIndex)
 {
 
@@ -642,6 +1204,7 @@ void GenQASM::analyzeInst(Function* F, Instruction* pInst){
 
 void GenQASM::printFuncHeader(Function* F)
 {
+  raw_ostream &out = scaffoldOut();
 
   //map<Function*, vector<qGateArg> >::iterator mpItr;
   //map<Function*, vector<qGateArg> >::iterator mpItr2;
@@ -650,11 +1213,11 @@ void GenQASM::printFuncHeader(Function* F)
   //mpItr = qbitsInFunc.find(F);
 
   //print name of function
-  errs()<<"\nmodule "<<F->getName();
+  out<<"\nmodule "<<F->getName();
   
   //print arguments of function
   //mpItr2=funcArgList.find(F);    
-  errs()<<" ( ";    
+  out<<" ( ";    
   unsigned tmp_num_elem = funcArgList.size();
   
   if(tmp_num_elem > 0){
@@ -666,21 +1229,21 @@ void GenQASM::printFuncHeader(Function* F)
 	print_qgateArg(tmpQA);
       
       if(tmpQA.isQbit)
-	errs()<<"qbit";
+	out<<"qbit";
       else if(tmpQA.isCbit)
-	errs()<<"cbit";
+	out<<"cbit";
       else{
 	Type* argTy = tmpQA.argPtr->getType();
-	if(argTy->isDoubleTy()) errs() << "double";
-	else if(argTy->isFloatTy()) errs() << "float";
+	if(argTy->isDoubleTy()) out << "double";
+	else if(argTy->isFloatTy()) out << "float";
 	else
-	  errs()<<"UNRECOGNIZED "<<argTy<<" ";
+	  out<<"UNRECOGNIZED "<<argTy<<" ";
       }
       
       if(tmpQA.isPtr)
-	errs()<<"*";	  
+	out<<"*";	  
       
-      errs()<<" "<<printVarName(tmpQA.argPtr->getName())<<" , ";
+      out<<" "<<printVarName(tmpQA.argPtr->getName())<<" , ";
     }
     
     if(debugGenQASM)
@@ -688,47 +1251,48 @@ void GenQASM::printFuncHeader(Function* F)
     
     
     if((funcArgList[tmp_num_elem-1]).isQbit)
-      errs()<<"qbit";
+      out<<"qbit";
     else if((funcArgList[tmp_num_elem-1]).isCbit)
-      errs()<<"cbit";
+      out<<"cbit";
     else{
       Type* argTy = (funcArgList[tmp_num_elem-1]).argPtr->getType();
-      if(argTy->isDoubleTy()) errs() << "double";
-      else if(argTy->isFloatTy()) errs() << "float";
+      if(argTy->isDoubleTy()) out << "double";
+      else if(argTy->isFloatTy()) out << "float";
       else
-	errs()<<"UNRECOGNIZED "<<argTy<<" ";
+	out<<"UNRECOGNIZED "<<argTy<<" ";
     }
     
     if((funcArgList[tmp_num_elem-1]).isPtr)
-      errs()<<"*";
+      out<<"*";
     
-    errs() <<" "<<printVarName((funcArgList[tmp_num_elem-1]).argPtr->getName());
+    out <<" "<<printVarName((funcArgList[tmp_num_elem-1]).argPtr->getName());
   }
   
-  errs()<<" ) {\n ";   
+  out<<" ) {\n ";   
   
   //print qbits declared in function
   //mvpItr=qbitsInitInFunc.find(F);	    
   for(vector<qGateArg>::iterator vvit=qbitsInitInFunc.begin(),vvitE=qbitsInitInFunc.end();vvit!=vvitE;++vvit)
     {	
       if((*vvit).isQbit)
-	errs()<<"\tqbit "<<printVarName((*vvit).argPtr->getName());
+	out<<"\tqbit "<<printVarName((*vvit).argPtr->getName());
       if((*vvit).isCbit)
-	errs()<<"\tcbit "<<printVarName((*vvit).argPtr->getName());
+	out<<"\tcbit "<<printVarName((*vvit).argPtr->getName());
 
       //if only single-dimensional qbit arrays expected
       //errs()<<"["<<(*vvit).valOrIndex<<"];\n ";
 
       //if n-dimensional qbit arrays expected 
       for(int ndim = 0; ndim < (*vvit).numDim; ndim++)
-	errs()<<"["<<(*vvit).dimSize[ndim]<<"]";
-      errs() << ";\n";
+	out<<"["<<(*vvit).dimSize[ndim]<<"]";
+      out << ";\n";
     }
   //errs() << "//--//-- Fn: " << F->getName() << " --//--//\n";
 }
   
 void GenQASM::genQASM(Function* F)
 {
+  raw_ostream &out = scaffoldOut();
   //map<Function*, vector<qGateArg> >::iterator mpItr;
   //map<Function*, vector<qGateArg> >::iterator mpItr2;
   //map<Function*, vector<qGateArg> >::iterator mvpItr;
@@ -746,7 +1310,7 @@ void GenQASM::genQASM(Function* F)
 	string fToPrint = mapFunction[mIndex].func->getName();
 	if(fToPrint.find("llvm.") != string::npos)
 	  fToPrint = fToPrint.substr(5);
-	errs()<<"\t";
+	out<<"\t";
 
 	//print return operand before printing MeasZ
 	if(fToPrint.find("Meas") != string::npos){
@@ -755,24 +1319,24 @@ void GenQASM::genQASM(Function* F)
 	  //find inst in mapInstRtn
 	  map<Value*, qGateArg>::iterator mvq = mapInstRtn.find(thisInstPtr);
 	  if(mvq!=mapInstRtn.end()){
-	    errs()<<printVarName(((*mvq).second).argPtr->getName());
+	    out<<printVarName(((*mvq).second).argPtr->getName());
 	    if(((*mvq).second).isPtr)
-	      errs()<<"["<<((*mvq).second).valOrIndex<<"]";
-	    errs()<<" = ";
+	      out<<"["<<((*mvq).second).valOrIndex<<"]";
+	    out<<" = ";
 	  }	  
 	}
 
 
-	errs()<<fToPrint<<" ( ";
+	out<<fToPrint<<" ( ";
 
 	//print all but last argument
 	for(vector<qGateArg>::iterator vpIt=mapFunction[mIndex].qArgs.begin(), vpItE=mapFunction[mIndex].qArgs.end();vpIt!=vpItE-1;++vpIt)
 	  {
 	    if((*vpIt).isUndef)
-	      errs() << " UNDEF ";
+	      out << " UNDEF ";
 	    else{
 	      if((*vpIt).isQbit || (*vpIt).isCbit){
-		errs()<<printVarName((*vpIt).argPtr->getName());
+		out<<printVarName((*vpIt).argPtr->getName());
 		if(!((*vpIt).isPtr)){		  
 		  //if only single-dimensional qbit arrays expected
 		  //--if((*vpIt).numDim == 0)
@@ -780,30 +1344,30 @@ void GenQASM::genQASM(Function* F)
 		  //--else
 		    //if n-dimensional qbit arrays expected 
 		    for(int ndim = 0; ndim < (*vpIt).numDim; ndim++)
-		      errs()<<"["<<(*vpIt).dimSize[ndim]<<"]";
+		      out<<"["<<(*vpIt).dimSize[ndim]<<"]";
 		}
 	      }
 	      else{
 		//assert(!(*vpIt).isPtr); 
 		if((*vpIt).isPtr) //NOTE: not expecting non-quantum pointer variables as arguments to quantum functions. If they exist, then print out name of variable
-		  errs() << " UNRECOGNIZED ";
+		  out << " UNRECOGNIZED ";
 		else if((*vpIt).isDouble)
-		  errs() << (*vpIt).val;
+		  out << (*vpIt).val;
 		else
-		  errs()<<(*vpIt).valOrIndex;	      
+		  out<<(*vpIt).valOrIndex;	      
 	      }
 	    }	    	    
-	    errs()<<" , ";
+	    out<<" , ";
 	  }
 
 	//print last element	
 	qGateArg tmpQA = mapFunction[mIndex].qArgs.back();
 
 	if(tmpQA.isUndef)
-	  errs() << " UNDEF ";
+	  out << " UNDEF ";
 	else{
 	  if(tmpQA.isQbit || tmpQA.isCbit){
-	    errs()<<printVarName(tmpQA.argPtr->getName());
+	    out<<printVarName(tmpQA.argPtr->getName());
 	    if(!(tmpQA.isPtr)){
 	      //if only single-dimensional qbit arrays expected
 	      //--if(tmpQA.numDim == 0)
@@ -811,26 +1375,132 @@ void GenQASM::genQASM(Function* F)
 	      //--else
 		//if n-dimensional qbit arrays expected 
 		for(int ndim = 0; ndim < tmpQA.numDim; ndim++)
-		  errs()<<"["<<tmpQA.dimSize[ndim]<<"]";	      	      	      
+		  out<<"["<<tmpQA.dimSize[ndim]<<"]";	      	      	      
 	    }
 	  }
 	  else{
 	    //assert(!tmpQA.isPtr); //NOTE: not expecting non-quantum pointer variables as arguments to quantum functions. If they exist, then print out name of variable
 	    if(tmpQA.isPtr)
-	      errs() << " UNRECOGNIZED ";
+	      out << " UNRECOGNIZED ";
 	    else if(tmpQA.isDouble) 
-	      errs() << tmpQA.val;
+	      out << tmpQA.val;
 	    else
-	      errs()<<tmpQA.valOrIndex;	    
+	      out<<tmpQA.valOrIndex;	    
 	  }
 	  
 	}
-	errs()<<" );\n ";	      
+	out<<" );\n ";	      
       }
     }
 
     //errs() << "//--//-- End Fn: " << F->getName() << " --//--// \n";
-    errs()<<"}\n";
+    out<<"}\n";
+  }
+}
+
+
+// argument of a gate or call the way the C program made from the
+// hierarchical QASM sees it
+flatArg GenQASM::getFlatArg(const flatModule& fm, const qGateArg& qa)
+{
+  flatArg a;
+  if(qa.isUndef)
+    return a;
+
+  if(qa.isQbit || qa.isCbit){
+    if(!qa.argPtr)
+      return a;
+    string name = printVarName(qa.argPtr->getName());
+    int dims = qa.isPtr ? 0 : qa.numDim; //indices printed after the name
+    if(dims > 1)
+      return a;
+
+    for(unsigned l = 0; l < fm.localNames.size(); l++)
+      if(fm.localNames[l] == name){
+	a.local = true;
+	a.slot = l;
+	if(dims == 0)
+	  a.kind = flatArg::ARRAY;
+	else if(qa.dimSize[0] >= 0 && qa.dimSize[0] < (int)fm.locals[l].size()){
+	  a.kind = flatArg::QBIT;
+	  a.index = qa.dimSize[0];
+	}
+	return a;
+      }
+
+    for(unsigned p = 0; p < fm.paramNames.size(); p++)
+      if(fm.paramNames[p] == name){
+	a.slot = p;
+	if(fm.params[p] == PARAM_ARRAY){
+	  a.kind = dims == 0 ? flatArg::ARRAY : flatArg::QBIT;
+	  if(dims == 1 && qa.dimSize[0] >= 0)
+	    a.index = qa.dimSize[0];
+	  else if(dims == 1)
+	    a.kind = flatArg::BAD;
+	}
+	else if(fm.params[p] == PARAM_QBIT && dims == 0)
+	  a.kind = flatArg::QBIT;
+	return a;
+      }
+    return a;
+  }
+
+  if(qa.isPtr)
+    return a;
+  a.kind = flatArg::NUM;
+  if(qa.isDouble){
+    //the hierarchical QASM prints doubles with %e and the C compiler reads them back
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%e", qa.val);
+    a.num = strtod(buf, NULL);
+  }
+  else
+    a.num = qa.valOrIndex;
+  return a;
+}
+
+// add F to the flat QASM the way printFuncHeader and genQASM print it
+void GenQASM::genFlatModule(Function* F)
+{
+  flat.modules.push_back(flatModule());
+  flatModule& fm = flat.modules.back();
+  fm.name = F->getName();
+  if(fm.name == "main")
+    flat.inMain = true;
+
+  for(unsigned i = 0; i < funcArgList.size(); i++){
+    const qGateArg& qa = funcArgList[i];
+    if(qa.isQbit || qa.isCbit)
+      fm.params.push_back(qa.isPtr ? PARAM_ARRAY : PARAM_QBIT);
+    else
+      fm.params.push_back(PARAM_NUM);
+    fm.paramNames.push_back(printVarName(qa.argPtr->getName()));
+  }
+
+  for(unsigned i = 0; i < qbitsInitInFunc.size(); i++){
+    const qGateArg& qa = qbitsInitInFunc[i];
+    string name = printVarName(qa.argPtr->getName());
+    if(qa.numDim == 1)
+      flat.addArray(fm, name, qa.isQbit, qa.dimSize[0]);
+    else{
+      //only one dimensional arrays are declared in the flat QASM
+      fm.localNames.push_back(name);
+      fm.locals.push_back(vector<string>());
+    }
+  }
+
+  for(unsigned mIndex = 0; mIndex < mapFunction.size(); mIndex++){
+    if(mapFunction[mIndex].qArgs.empty())
+      continue;
+    flatOp op;
+    op.name = mapFunction[mIndex].func->getName();
+    if(op.name.find("llvm.") != string::npos)
+      op.name = op.name.substr(5);
+    op.gate = flatQASM::gateIndex(op.name);
+    op.callee = -1;
+    for(unsigned i = 0; i < mapFunction[mIndex].qArgs.size(); i++)
+      op.args.push_back(getFlatArg(fm, mapFunction[mIndex].qArgs[i]));
+    fm.ops.push_back(op);
   }
 }
 
@@ -894,7 +1564,8 @@ bool GenQASM::runOnModule(Module &M) {
   CallGraphNode* rootNode = getAnalysis<CallGraph>().getRoot();
   unsigned sccNum = 0;
 
-  errs() << "-------QASM Generation Pass:\n";
+  if(!genFlat)
+    scaffoldOut() << "-------QASM Generation Pass:\n";
 
   for (scc_iterator<CallGraphNode*> sccIb = scc_begin(rootNode),
          E = scc_end(rootNode); sccIb != E; ++sccIb)
@@ -938,7 +1609,8 @@ bool GenQASM::runOnModule(Module &M) {
 
 	    //map<Function*, vector<qGateArg> >::iterator mpItr = qbitsInFunc.find(F);
 	    if(qbitsInFunc.size()>0){ //Is Quantum Function
-	      printFuncHeader(F);
+	      if(!genFlat)
+		printFuncHeader(F);
 	    
 	      for(inst_iterator instIb = inst_begin(F),instIe=inst_end(F); instIb!=instIe;++instIb){
 
@@ -952,7 +1624,10 @@ bool GenQASM::runOnModule(Module &M) {
 	      }
 	      
 
-	      genQASM(F);	      
+	      if(genFlat)
+		genFlatModule(F);
+	      else
+		genQASM(F);
 
 	    }
 	    
@@ -966,8 +1641,26 @@ bool GenQASM::runOnModule(Module &M) {
       if (nextSCC.size() == 1 && sccIb.hasLoop())
 	errs() << " (Has self-loop).";
     }
-  errs()<<"\n--------End of QASM generation";
-  errs() << "\n";
+  if(genFlat){
+    if(flat.link()){
+      flat.buildCaches(FlatQASMCacheLines);
+      if(FlatQASMFormat == "binary"){
+	qasmBinStream bin(scaffoldOut());
+	qasmBinWriter writer(bin);
+	flatBinarySink sink(writer);
+	flat.print(sink);
+	writer.finish();
+      }
+      else{
+	flatStream sink(scaffoldOut());
+	flat.print(sink);
+      }
+    }
+    return false;
+  }
+
+  scaffoldOut()<<"\n--------End of QASM generation";
+  scaffoldOut() << "\n";
 
   
   return false;
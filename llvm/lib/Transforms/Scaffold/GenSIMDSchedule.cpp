@@ -12,7 +12,9 @@
 
 #define DEBUG_TYPE "GenSIMDSched"
 #include <vector>
+#include <set>
 #include <limits>
+#include <algorithm>
 #include "llvm/Pass.h"
 #include "llvm/Function.h"
 #include "llvm/Module.h"
@@ -26,11 +28,13 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Support/CFG.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Argument.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/Constants.h"
 #include "llvm/IntrinsicInst.h"
 #include "llvm/Support/CommandLine.h"
+#include "ScaffoldOutput.h"
 
 
 using namespace llvm;
@@ -45,7 +49,6 @@ static cl::opt<unsigned>
 DATA_CONSTRAINT("simd-dconstraint", cl::init(1024), cl::Hidden,
   cl::desc("k in SIMD-k Resource Constrained Scheduling"));
 
-#define MAX_RES_CONSTRAINT 2000 
 #define SSCHED_THRESH 10000000
 
 #define MAX_GATE_ARGS 30
@@ -106,9 +109,34 @@ namespace {
   };
   
 struct qArgInfo{
-  string name;
+  int reg;  //qubit register in funcRegs
+  int qbit; //qubit id in funcQbitIds, -1 for the entire register
+  qArgInfo(): reg(-1), qbit(-1){ }
+};
+
+struct qRegister{ //qbit array or qbit argument of current function
+  Value* ptr;
+  int argNum; //-1 if not a function argument
+  vector<int> qbits; //qubit id for each index, -1 if not used yet
+  qRegister(Value* p, int n): ptr(p), argNum(n) { }
+};
+
+struct qbitId{ //qubit of current function
+  int reg;
   int index;
-  qArgInfo(): name("none"), index(-1){ }
+};
+
+struct qbitTimes{ //timesteps of qubits of current function
+  vector<uint64_t> whole; //per register, timestep of qubits not used individually yet
+  vector<uint64_t> max; //per register, max timestep over all its qubits
+  vector<uint64_t> ts; //per qubit id
+};
+
+struct qArgTable{ //timesteps of qubits of a function argument
+  uint64_t whole;
+  uint64_t max;
+  vector<pair<int,uint64_t> > qbits; //(index, timestep) in increasing index order
+  qArgTable(): whole(0), max(0) { }
 };
 
 struct qGate{
@@ -119,9 +147,100 @@ struct qGate{
   qGate():qFunc(NULL), numArgs(0), angle(0.0) { }
 };
 
+  // Gates scheduled in the timesteps of a leaf module. Every timestep has
+  // RES_CONSTRAINT slots, each slot holds gates of one type. Slots are
+  // filled in order, so the used slots of a timestep are a prefix.
   struct ArrParGates{
-    int typeOfGate[MAX_RES_CONSTRAINT];
-    uint64_t numGates[MAX_RES_CONSTRAINT];
+    vector<int> typeOfGate; //RES_CONSTRAINT entries per timestep
+    vector<uint64_t> numGates; //RES_CONSTRAINT entries per timestep
+    vector<unsigned> slotsUsed; //used slots per timestep
+    set<uint64_t> openSteps; //timesteps with an unused slot
+    map<int, set<uint64_t> > openTypeSteps; //timesteps with a non-full slot of the gate type
+
+    static unsigned slots(){
+      unsigned k = RES_CONSTRAINT;
+      return k > 0 ? k : 1;
+    }
+
+    static bool isFull(int type, uint64_t n){
+      if(type == _CNOT)
+        return 2*n >= DATA_CONSTRAINT;
+      return n >= DATA_CONSTRAINT;
+    }
+
+    uint64_t size() const { return slotsUsed.size(); }
+
+    void clear(){
+      typeOfGate.clear();
+      numGates.clear();
+      slotsUsed.clear();
+      openSteps.clear();
+      openTypeSteps.clear();
+    }
+
+    int type(uint64_t ts, unsigned j) const {
+      return j < slotsUsed[ts] ? typeOfGate[ts*slots()+j] : -1;
+    }
+
+    uint64_t count(uint64_t ts, unsigned j) const {
+      return j < slotsUsed[ts] ? numGates[ts*slots()+j] : 0;
+    }
+
+    //first timestep from ts where a gate of the type fits, size() if none
+    uint64_t find(int type, uint64_t ts) const {
+      uint64_t res = size();
+      if(RES_CONSTRAINT == 0)
+        return res;
+      set<uint64_t>::const_iterator sit = openSteps.lower_bound(ts);
+      if(sit != openSteps.end())
+        res = *sit;
+      map<int, set<uint64_t> >::const_iterator mit = openTypeSteps.find(type);
+      if(mit != openTypeSteps.end()){
+        sit = (*mit).second.lower_bound(ts);
+        if(sit != (*mit).second.end() && *sit < res)
+          res = *sit;
+      }
+      return res;
+    }
+
+    //first non-full slot of the type in timestep ts, or the first unused slot
+    unsigned slotFor(int type, uint64_t ts) const {
+      uint64_t base = ts*slots();
+      for(unsigned j = 0; j < slotsUsed[ts]; j++)
+        if(typeOfGate[base+j] == type && !isFull(type, numGates[base+j]))
+          return j;
+      return slotsUsed[ts];
+    }
+
+    //adds a gate of the type to slot j of timestep ts, j is either
+    //a non-full slot of the type or the first unused slot
+    void add(int type, uint64_t ts, unsigned j){
+      uint64_t base = ts*slots();
+      if(j == slotsUsed[ts]){
+        typeOfGate[base+j] = type;
+        numGates[base+j] = 1;
+        slotsUsed[ts]++;
+        if(slotsUsed[ts] >= RES_CONSTRAINT)
+          openSteps.erase(ts);
+        if(!isFull(type, 1))
+          openTypeSteps[type].insert(ts);
+        return;
+      }
+      numGates[base+j]++;
+      if(isFull(type, numGates[base+j]) && slotFor(type, ts) == slotsUsed[ts])
+        openTypeSteps[type].erase(ts);
+    }
+
+    //creates a new timestep with one gate of the type, returns its index
+    uint64_t push_back(int type){
+      uint64_t ts = size();
+      typeOfGate.resize(typeOfGate.size()+slots(), -1);
+      numGates.resize(numGates.size()+slots(), 0);
+      slotsUsed.push_back(0);
+      openSteps.insert(ts);
+      add(type, ts, 0);
+      return ts;
+    }
   };
 
   struct GenSIMDSched : public ModulePass {
@@ -138,11 +257,13 @@ struct qGate{
 
     map<string, int> gate_index;    
 
-    map<string, map<int,uint64_t> > funcQbits; //qbits in current function
-    map<Function*, map<unsigned int, map<int,uint64_t> > > tableFuncQbits;
-    map<string, unsigned int> funcArgs;
+    vector<qRegister> funcRegs; //qbit registers in current function
+    DenseMap<Value*, int> funcRegIds; //index of register in funcRegs
+    vector<qbitId> funcQbitIds; //qbits in current function, by id
+    qbitTimes funcQbits; //last ts of qbits in current function
+    map<Function*, map<unsigned int, qArgTable> > tableFuncQbits;
 
-    vector<ArrParGates> currArrParGates;
+    ArrParGates currArrParGates;
 
     map<Instruction*, qGate> mapInstSet;
     vector<InstPri> priorityVector;
@@ -164,6 +285,12 @@ struct qGate{
     void analyzeCallInst(Function* F,Instruction* pinst);
     void getFunctionArguments(Function *F);
     
+    int addRegister(Value* ptr, int argNum);
+    int getQbit(int reg, int index);
+    void clear_funcQbits();
+    uint64_t compute_max_ts_of_all_args(const qGate& qg);
+    void update_ts_of_all_args(const qGate& qg, uint64_t ts);
+
     void saveTableFuncQbits(Function* F);
     void print_tableFuncQbits();
     void print_parallelism(Function* F);
@@ -269,7 +396,6 @@ void GenSIMDSched::getFunctionArguments(Function* F)
     {    
       //if(ait) errs() << "Argument: "<<ait->getName()<< " ";
 
-      string argName = (ait->getName()).str();
       Type* argType = ait->getType();
       unsigned int argNum=ait->getArgNo();         
 
@@ -285,32 +411,22 @@ void GenSIMDSched::getFunctionArguments(Function* F)
           tmpQArg.isQbit = true;
           vectQbit.push_back(ait);
           
-          map<int,uint64_t> tmpMap;
-          tmpMap[-1] = 0; //add entry for entire array
-          tmpMap[-2] = 0; //add entry for max     
-          funcQbits[argName]=tmpMap;      
-          funcArgs[argName] = argNum;
+          addRegister(ait, argNum);
         }
         else if (elementType->isIntegerTy(1)){ //cbit*
           tmpQArg.isCbit = true;
           vectQbit.push_back(ait);
-          funcArgs[argName] = argNum;
         }
       }
       else if (argType->isIntegerTy(16)){ //qbit
         tmpQArg.isQbit = true;
         vectQbit.push_back(ait);
 
-          map<int,uint64_t> tmpMap;
-          tmpMap[-1] = 0; //add entry for entire array
-          tmpMap[-2] = 0; //add entry for max
-          funcQbits[argName]=tmpMap;
-          funcArgs[argName] = argNum;
+          addRegister(ait, argNum);
       }
       else if (argType->isIntegerTy(1)){ //cbit
         tmpQArg.isCbit = true;
         vectQbit.push_back(ait);
-          funcArgs[argName] = argNum;
       }
       
     }
@@ -454,11 +570,7 @@ void GenSIMDSched::analyzeAllocInst(Function* F, Instruction* pInst){
         tmpQArg.argPtr = AI;
         tmpQArg.valOrIndex = arraySize;
 
-        map<int,uint64_t> tmpMap; //add qbit to funcQbits
-        tmpMap[-1] = 0; //entry for entire array ops
-        tmpMap[-2] = 0; //entry for max
-        funcQbits[AI->getName()]=tmpMap;
-
+        addRegister(AI, -1); //add qbit to funcQbits
       }
       
       if (elementType->isIntegerTy(1)){
@@ -493,11 +605,45 @@ void GenSIMDSched::init_critical_path_algo(Function* F){
   hasPrimitivesOnly = true;
 }
 
+int GenSIMDSched::addRegister(Value* ptr, int argNum){
+  int reg = funcRegs.size();
+  funcRegs.push_back(qRegister(ptr, argNum));
+  funcRegIds[ptr] = reg;
+  funcQbits.whole.push_back(0); //entire array ops
+  funcQbits.max.push_back(0); //max over all indices
+  return reg;
+}
+
+int GenSIMDSched::getQbit(int reg, int index){
+  vector<int>& qbits = funcRegs[reg].qbits;
+  if((unsigned)index >= qbits.size())
+    qbits.resize(index+1, -1);
+  if(qbits[index] == -1){
+    //first use of the qbit, it gets the value for entire array
+    qbitId id;
+    id.reg = reg;
+    id.index = index;
+    qbits[index] = funcQbitIds.size();
+    funcQbitIds.push_back(id);
+    funcQbits.ts.push_back(funcQbits.whole[reg]);
+  }
+  return qbits[index];
+}
+
+void GenSIMDSched::clear_funcQbits(){
+  funcRegs.clear();
+  funcRegIds.clear();
+  funcQbitIds.clear();
+  funcQbits = qbitTimes();
+}
+
 void GenSIMDSched::print_funcQbits(){
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbits.begin(); mIter!=funcQbits.end(); ++mIter){
-    errs() << "Var "<< (*mIter).first << " ---> ";
-    for(map<int,uint64_t>::iterator indexIter  = (*mIter).second.begin(); indexIter!=(*mIter).second.end(); ++indexIter){
-      errs() << (*indexIter).first << ":"<<(*indexIter).second<< "  ";
+  for(unsigned int r = 0; r<funcRegs.size(); r++){
+    errs() << "Var "<< funcRegs[r].ptr->getName() << " ---> ";
+    errs() << "-2:" << funcQbits.max[r] << "  -1:" << funcQbits.whole[r] << "  ";
+    for(unsigned int k = 0; k<funcRegs[r].qbits.size(); k++){
+      if(funcRegs[r].qbits[k] != -1)
+        errs() << k << ":" << funcQbits.ts[funcRegs[r].qbits[k]] << "  ";
     }
     errs() << "\n";
   }
@@ -505,11 +651,10 @@ void GenSIMDSched::print_funcQbits(){
 
 void GenSIMDSched::print_ArrParGates(){
   errs() << "Printing ArrParGate Vector \n";
-    int j = 0;
-    for(vector<ArrParGates>::iterator vit = currArrParGates.begin(); vit!=currArrParGates.end(); ++vit, j++){
+    for(uint64_t j = 0; j<currArrParGates.size(); j++){
       errs() << j << " -- ";
       for(unsigned int i=0;i<RES_CONSTRAINT;i++)
-        errs() << (*vit).typeOfGate[i] << " : " << (*vit).numGates[i] << " ; ";
+        errs() << currArrParGates.type(j,i) << " : " << currArrParGates.count(j,i) << " ; ";
       errs() << "\n";
     }
   
@@ -518,7 +663,8 @@ void GenSIMDSched::print_ArrParGates(){
 void GenSIMDSched::print_qgate(qGate qg){
   errs() << qg.qFunc->getName() << " : ";
   for(int i=0;i<qg.numArgs;i++){
-    errs() << qg.args[i].name << qg.args[i].index << ", "  ;
+    int index = (qg.args[i].qbit == -1) ? -1 : funcQbitIds[qg.args[i].qbit].index;
+    errs() << funcRegs[qg.args[i].reg].ptr->getName() << index << ", "  ;
   }
   errs() << "\n";
 }
@@ -668,38 +814,29 @@ uint64_t GenSIMDSched::get_ts_to_schedule_leaf(Function* F, uint64_t ts, Functio
   
     int searchFuncIndex = funcIndex+c*20;
   
-    for(uint64_t i = ts; (i<currArrParGates.size() && !foundEntry); i++){
-      for(unsigned int j = 0; (j<RES_CONSTRAINT && !foundEntry); j++){
-        //if((currArrParGates[i].typeOfGate[j] == searchFuncIndex) && (currArrParGates[i].numGates[j] < DATA_CONSTRAINT)){
-        if((currArrParGates[i].typeOfGate[j] == searchFuncIndex) && ((searchFuncIndex == _CNOT && 2*currArrParGates[i].numGates[j] < DATA_CONSTRAINT)
-                                || (searchFuncIndex != _CNOT && currArrParGates[i].numGates[j]< DATA_CONSTRAINT))){
-          currArrParGates[i].numGates[j] += 1;
-          if(!FirstEntrySched){
-            first_step = i;
-            FirstEntrySched = true;
-          }
-          
+    //first timestep from ts with a non-full slot of this type or an unused slot
+    uint64_t i = currArrParGates.find(searchFuncIndex, ts);
+    if(i < currArrParGates.size()){
+      unsigned int j = currArrParGates.slotFor(searchFuncIndex, i);
+      bool newSlot = (currArrParGates.type(i,j) == -1);
+      currArrParGates.add(searchFuncIndex, i, j);
+      if(!FirstEntrySched){
+        first_step = i;
+        FirstEntrySched = true;
+      }
+
+      if(!newSlot){
           if((c==0) && (funcIndex == _T || funcIndex == _Tdag)){
-            if(currArrParGates[i].numGates[j] > currSched.tgates_par){
-              currSched.tgates_par = currArrParGates[i].numGates[j];
-              currSched.tgates_par_ub = currArrParGates[i].numGates[j];
+            if(currArrParGates.count(i,j) > currSched.tgates_par){
+              currSched.tgates_par = currArrParGates.count(i,j);
+              currSched.tgates_par_ub = currArrParGates.count(i,j);
               //errs() << "Incr tgate_par \n";
             }
           }
 
           //errs() << "GateType Parallelism. TS = " << i << " K-factor=" << j << " Tpar=" << currSched.tgates_par << " TparUB=" << currSched.tgates_par_ub <<"\n";
-          foundEntry = true;
-          retVal = i;
-          ts = i+1; //update value of ts to start with in next iteration
-          //return i;
-        }
-        else if(currArrParGates[i].typeOfGate[j] == -1){
-          currArrParGates[i].typeOfGate[j] = searchFuncIndex;
-          currArrParGates[i].numGates[j] = 1;
-          if(!FirstEntrySched){
-            first_step = i;
-            FirstEntrySched = true;
-          }
+      }
+      else{
           if(j >= currSched.width) //update currSched.width
             currSched.width = j+1;
           
@@ -709,8 +846,8 @@ uint64_t GenSIMDSched::get_ts_to_schedule_leaf(Function* F, uint64_t ts, Functio
             
             bool prevTgateFound = false;
             for(unsigned int jcheck=0; jcheck<RES_CONSTRAINT; jcheck++){
-              if(currArrParGates[i].typeOfGate[jcheck] == _T
-                 || currArrParGates[i].typeOfGate[jcheck] == _Tdag)
+              if(currArrParGates.type(i,jcheck) == _T
+                 || currArrParGates.type(i,jcheck) == _Tdag)
                 prevTgateFound = true;
             }
             if(!prevTgateFound){
@@ -725,27 +862,17 @@ uint64_t GenSIMDSched::get_ts_to_schedule_leaf(Function* F, uint64_t ts, Functio
           }
           
           //errs() << "Unscheduled. New Width = " << currSched.width << " New Length = " << currSched.length << " Tgates=" << currSched.tgates << " TgatesUB=" << currSched.tgates_ub << " TgatesPar=" << currSched.tgates_par << " TgatesParUB=" << currSched.tgates_par_ub <<" K-factor=" << j <<"\n";
-          foundEntry = true;
-          retVal = i;
-          ts = i+1;
-          //return i;
-        }
       }
+      foundEntry = true;
+      retVal = i;
+      ts = i+1; //update value of ts to start with in next iteration
     }
   
     if(!foundEntry){
       //suitable ts not found, create a new ts for this type of gate
       //add entry to vectArrParGates
       
-      ArrParGates tmpArrPar; //initialize
-      for(unsigned int k=0;k<RES_CONSTRAINT; k++){
-        tmpArrPar.typeOfGate[k] = -1;
-        tmpArrPar.numGates[k] = 0;
-      }
-  
-      tmpArrPar.typeOfGate[0] = searchFuncIndex;
-      tmpArrPar.numGates[0] = 1;
-      currArrParGates.push_back(tmpArrPar);
+      currArrParGates.push_back(searchFuncIndex);
       if(!FirstEntrySched){
         first_step = currArrParGates.size()-1;
         FirstEntrySched = true;
@@ -829,7 +956,7 @@ void GenSIMDSched::print_critical_info(){
     for(unsigned int i = 0; i<currArrParGates.size(); i++){
         errs() << i << " :";
         for(unsigned int k=0;k<RES_CONSTRAINT;k++){      
-          errs() << currArrParGates[i].typeOfGate[k] << " : " << currArrParGates[i].numGates[k] << " / ";
+          errs() << currArrParGates.type(i,k) << " : " << currArrParGates.count(i,k) << " / ";
         }
         errs() << "\n";
     }
@@ -840,10 +967,10 @@ void GenSIMDSched::print_parallelism(Function* F){
   for(int k = 0; k<NUM_QGATES; k++)
     maxGates[k] = 0;
 
-  for(vector<ArrParGates>::iterator vit = currArrParGates.begin(); vit!=currArrParGates.end(); ++vit){
-    for(unsigned int i = 0; i<RES_CONSTRAINT; i++)
-      if((*vit).numGates[i] > maxGates[(*vit).typeOfGate[i]])
-        maxGates[(*vit).typeOfGate[i]] = (*vit).numGates[i];
+  for(uint64_t ts = 0; ts<currArrParGates.size(); ts++){
+    for(unsigned int i = 0; i<currArrParGates.slotsUsed[ts]; i++)
+      if(currArrParGates.count(ts,i) > maxGates[currArrParGates.type(ts,i)])
+        maxGates[currArrParGates.type(ts,i)] = currArrParGates.count(ts,i);
   }
 
   errs() << "\nMax Parallelism Factors: \n";
@@ -854,10 +981,9 @@ void GenSIMDSched::print_parallelism(Function* F){
 
 uint64_t GenSIMDSched::find_max_funcQbits(){
   uint64_t max_timesteps = 0;
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbits.begin(); mIter!=funcQbits.end(); ++mIter){
-    map<int,uint64_t>::iterator arrIter = (*mIter).second.find(-2); //max ts is in -2 entry
-    if((*arrIter).second > max_timesteps)
-      max_timesteps = (*arrIter).second;
+  for(vector<uint64_t>::iterator it = funcQbits.max.begin(); it!=funcQbits.max.end(); ++it){
+    if((*it) > max_timesteps)
+      max_timesteps = (*it);
   }
 
   //print_funcQbits();
@@ -867,21 +993,57 @@ uint64_t GenSIMDSched::find_max_funcQbits(){
 }
 
 void GenSIMDSched::memset_funcQbits(uint64_t val){
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbits.begin(); mIter!=funcQbits.end(); ++mIter){
-    for(map<int,uint64_t>::iterator arrIter = (*mIter).second.begin(); arrIter!=(*mIter).second.end();++arrIter)
-      (*arrIter).second = val;
+  fill(funcQbits.whole.begin(), funcQbits.whole.end(), val);
+  fill(funcQbits.max.begin(), funcQbits.max.end(), val);
+  fill(funcQbits.ts.begin(), funcQbits.ts.end(), val);
+}
+
+uint64_t GenSIMDSched::compute_max_ts_of_all_args(const qGate& qg){
+  uint64_t max_ts_of_all_args = 0;
+  for(int i=0;i<qg.numArgs; i++){
+    uint64_t ts;
+    if(qg.args[i].qbit == -1) //operation on entire array
+      ts = funcQbits.max[qg.args[i].reg]; //max for the array
+    else
+      ts = funcQbits.ts[qg.args[i].qbit];
+    if(ts > max_ts_of_all_args)
+      max_ts_of_all_args = ts;
+  }
+  return max_ts_of_all_args;
+}
+
+void GenSIMDSched::update_ts_of_all_args(const qGate& qg, uint64_t ts){
+  for(int i=0;i<qg.numArgs; i++){
+    int reg = qg.args[i].reg;
+    if(qg.args[i].qbit == -1){
+      funcQbits.whole[reg] = ts;
+      funcQbits.max[reg] = ts;
+      for(vector<int>::iterator qit = funcRegs[reg].qbits.begin(); qit!=funcRegs[reg].qbits.end(); ++qit){
+        if((*qit) != -1)
+          funcQbits.ts[*qit] = ts;
+      }
+    }
+    else{
+      //update the timestep number for that argument
+      funcQbits.ts[qg.args[i].qbit] = ts;
+
+      //update max ts over all indices of the array
+      if(funcQbits.max[reg] < ts)
+        funcQbits.max[reg] = ts;
+    }
   }
 }
 
 void GenSIMDSched::print_scheduled_gate(qGate qg, uint64_t ts){
+  raw_ostream &out = scaffoldOut();
   string tmpGateName = qg.qFunc->getName();
   if(tmpGateName.find("llvm.")!=string::npos)
     tmpGateName = tmpGateName.substr(5);
-  errs() << ts << " " << tmpGateName;
+  out << ts << " " << tmpGateName;
   for(int i = 0; i<qg.numArgs; i++){
-    errs() << " " << qg.args[i].name;
-    if(qg.args[i].index != -1)
-      errs() << qg.args[i].index;
+    out << " " << funcRegs[qg.args[i].reg].ptr->getName();
+    if(qg.args[i].qbit != -1)
+      out << funcQbitIds[qg.args[i].qbit].index;
   }
 
   /*
@@ -895,15 +1057,16 @@ void GenSIMDSched::print_scheduled_gate(qGate qg, uint64_t ts){
     errs() << " "<<qg.angle;
   */
 
-  errs() << "\n";
+  out << "\n";
 }
 
 void GenSIMDSched::print_tableFuncQbits(){
-  for(map<Function*, map<unsigned int, map<int, uint64_t> > >::iterator m1 = tableFuncQbits.begin(); m1!=tableFuncQbits.end(); ++m1){
+  for(map<Function*, map<unsigned int, qArgTable> >::iterator m1 = tableFuncQbits.begin(); m1!=tableFuncQbits.end(); ++m1){
     errs() << "Function " << (*m1).first->getName() << " \n  ";
-    for(map<unsigned int, map<int, uint64_t> >::iterator m2 = (*m1).second.begin(); m2!=(*m1).second.end(); ++m2){
+    for(map<unsigned int, qArgTable>::iterator m2 = (*m1).second.begin(); m2!=(*m1).second.end(); ++m2){
       errs() << "\tArg# "<< (*m2).first << " -- ";
-      for(map<int, uint64_t>::iterator m3 = (*m2).second.begin(); m3!=(*m2).second.end(); ++m3){
+      errs() << " ; -2 : " << (*m2).second.max << " ; -1 : " << (*m2).second.whole;
+      for(vector<pair<int, uint64_t> >::iterator m3 = (*m2).second.qbits.begin(); m3!=(*m2).second.qbits.end(); ++m3){
         errs() << " ; " << (*m3).first << " : " << (*m3).second;
       }
       errs() << "\n";
@@ -935,19 +1098,14 @@ void GenSIMDSched::calc_critical_time(Function* F, qGate qg, bool isLeafFunc){
     memset_funcQbits(max_ts_sched);
 
     //set this Meas in this max_ts_sched+1
-    map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[0].name);
-    assert(mIter != funcQbits.end() && "Meas Gate Var not found in funcQbits");
-
-    int argIndex = qg.args[0].index; //must have only one argument
-    assert(argIndex != -1 && "Meas gate has array argument");
+    int qbit = qg.args[0].qbit; //must have only one argument
+    assert(qbit != -1 && "Meas gate has array argument");
 
     //update the timestep number for that argument
-    map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-    (*indexIter).second =  max_ts_sched + 1;
+    funcQbits.ts[qbit] = max_ts_sched + 1;
     
-    //update -2 entry for the array, i.e. max ts over all indices
-    indexIter = (*mIter).second.find(-2);
-    (*indexIter).second = max_ts_sched + 1;
+    //update max ts over all indices of the array
+    funcQbits.max[qg.args[0].reg] = max_ts_sched + 1;
     
     //errs() << "Scheduled in "<< max_ts_sched+1 << "\n";
     //print_funcQbits();
@@ -958,37 +1116,7 @@ void GenSIMDSched::calc_critical_time(Function* F, qGate qg, bool isLeafFunc){
   }
   else{
     //find last timestep for all arguments of qgate
-    for(int i=0;i<qg.numArgs; i++){
-      map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-      assert(mIter!=funcQbits.end()); //should already have an entry for the name of the qbit
-      
-      int argIndex = qg.args[i].index;
-      
-      //find the index of argument in the map<int,int>
-      if(argIndex == -1) //operation on entire array
-        {
-          //find max for the array        
-          map<int,uint64_t>::iterator indexIter = (*mIter).second.find(-2);
-          if((*indexIter).second > max_ts_of_all_args)
-            max_ts_of_all_args = (*indexIter).second;     
-        }
-      else
-        {
-          map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-          if(indexIter!=(*mIter).second.end()){
-            if((*indexIter).second > max_ts_of_all_args)
-              max_ts_of_all_args = (*indexIter).second;
-          }
-          else{
-            //find the value for entire array
-            map<int,uint64_t>::iterator fullArrayIndexIter = (*mIter).second.find(-1);  
-            ((*mIter).second)[argIndex] = (*fullArrayIndexIter).second;
-            //((*mIter).second)[argIndex] = 0;
-            if((*fullArrayIndexIter).second > max_ts_of_all_args)
-              max_ts_of_all_args = (*fullArrayIndexIter).second;
-          }
-        }
-    }
+    max_ts_of_all_args = compute_max_ts_of_all_args(qg);
     
     if(debugGenSIMDSched){
       errs() << "Before Scheduling: \n";
@@ -1014,28 +1142,7 @@ void GenSIMDSched::calc_critical_time(Function* F, qGate qg, bool isLeafFunc){
       //if(currArrParGates.size() != 0){
       
       //update last timestep for all arguments of qgate
-      for(int i=0;i<qg.numArgs; i++){
-        map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-        
-        int argIndex = qg.args[i].index;
-        
-        if(argIndex == -1){
-          for(map<int,uint64_t>::iterator entryIter = (*mIter).second.begin(); entryIter!=(*mIter).second.end();++entryIter){
-            (*entryIter).second = ts_sched + 1;
-          }
-          
-        }
-        else{
-          //update the timestep number for that argument
-          map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-          (*indexIter).second =  ts_sched + 1;
-          
-          //update -2 entry for the array, i.e. max ts over all indices
-          indexIter = (*mIter).second.find(-2);
-          if((*indexIter).second < ts_sched + 1)
-            (*indexIter).second = ts_sched + 1;
-        }  
-      }
+      update_ts_of_all_args(qg, ts_sched + 1);
       //}
       } // not first MeasX gate
   
@@ -1059,36 +1166,7 @@ uint64_t GenSIMDSched::calc_critical_time_unbounded(Function* F, qGate qg){
   uint64_t max_ts_of_all_args = 0;
   
   //find last timestep for all arguments of qgate
-  for(int i=0;i<qg.numArgs; i++){
-    map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-    assert(mIter!=funcQbits.end()); //should already have an entry for the name of the qbit
-    
-    int argIndex = qg.args[i].index;
-    
-    //find the index of argument in the map<int,int>
-    if(argIndex == -1) //operation on entire array
-      {
-        //find max for the array          
-        map<int,uint64_t>::iterator indexIter = (*mIter).second.find(-2);
-        if((*indexIter).second > max_ts_of_all_args)
-          max_ts_of_all_args = (*indexIter).second;       
-      }
-    else
-      {
-        map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-        if(indexIter!=(*mIter).second.end()){
-          if((*indexIter).second > max_ts_of_all_args)
-            max_ts_of_all_args = (*indexIter).second;
-        }
-        else{
-          //find the value for entire array
-          map<int,uint64_t>::iterator fullArrayIndexIter = (*mIter).second.find(-1);      
-          ((*mIter).second)[argIndex] = (*fullArrayIndexIter).second;
-          if((*fullArrayIndexIter).second > max_ts_of_all_args)
-            max_ts_of_all_args = (*fullArrayIndexIter).second;
-        }
-      }
-    }
+  max_ts_of_all_args = compute_max_ts_of_all_args(qg);
     
     if(debugGenSIMDSched){
       errs() << "Before Scheduling: \n";
@@ -1101,28 +1179,7 @@ uint64_t GenSIMDSched::calc_critical_time_unbounded(Function* F, qGate qg){
       //--print_scheduled_gate(qg,max_ts_of_all_args+1);
       
       //update last timestep for all arguments of qgate
-      for(int i=0;i<qg.numArgs; i++){
-        map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-        
-        int argIndex = qg.args[i].index;
-        
-        if(argIndex == -1){
-          for(map<int,uint64_t>::iterator entryIter = (*mIter).second.begin(); entryIter!=(*mIter).second.end();++entryIter){
-            (*entryIter).second = max_ts_of_all_args + 1;
-          }
-          
-        }
-        else{
-          //update the timestep number for that argument
-          map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-          (*indexIter).second =  max_ts_of_all_args + 1;
-          
-          //update -2 entry for the array, i.e. max ts over all indices
-          indexIter = (*mIter).second.find(-2);
-          if((*indexIter).second < max_ts_of_all_args + 1)
-            (*indexIter).second = max_ts_of_all_args + 1;
-        }  
-      }
+      update_ts_of_all_args(qg, max_ts_of_all_args + 1);
 
   
   if(debugGenSIMDSched)
@@ -1271,10 +1328,12 @@ void GenSIMDSched::analyzeCallInst(Function* F, Instruction* pInst){
               //errs() << allDepQbit[vb].valOrIndex <<"\n";
                 qGateArg param =  allDepQbit[vb];       
                 //errs() << "1\n";
-                thisGate.args[thisGate.numArgs].name = param.argPtr->getName();
+                DenseMap<Value*, int>::iterator regIt = funcRegIds.find(param.argPtr);
+                assert(regIt!=funcRegIds.end()); //should already have an entry for the qbit
+                thisGate.args[thisGate.numArgs].reg = (*regIt).second;
                 //errs() << "2\n";
-                if(!param.isPtr)
-                  thisGate.args[thisGate.numArgs].index = param.valOrIndex;
+                if(!param.isPtr && param.valOrIndex >= 0)
+                  thisGate.args[thisGate.numArgs].qbit = getQbit((*regIt).second, param.valOrIndex);
                 //errs() << "3\n";
                 thisGate.numArgs++;
                 //errs() << "4\n";
@@ -1297,16 +1356,20 @@ void GenSIMDSched::analyzeCallInst(Function* F, Instruction* pInst){
 
 
 void GenSIMDSched::saveTableFuncQbits(Function* F){
-  map<unsigned int, map<int, uint64_t> > tmpFuncQbitsMap;
-
-  for(map<string, map<int, uint64_t> >::iterator mapIt = funcQbits.begin(); mapIt!=funcQbits.end(); ++mapIt){
-    map<string, unsigned int>::iterator argIt = funcArgs.find((*mapIt).first);
-    if(argIt!=funcArgs.end()){
-      unsigned int argNum = (*argIt).second;
-      tmpFuncQbitsMap[argNum] = (*mapIt).second;
+  map<unsigned int, qArgTable>& table = tableFuncQbits[F];
+  table.clear();
+
+  for(unsigned int r = 0; r<funcRegs.size(); r++){
+    if(funcRegs[r].argNum == -1)
+      continue;
+    qArgTable& entry = table[funcRegs[r].argNum];
+    entry.whole = funcQbits.whole[r];
+    entry.max = funcQbits.max[r];
+    for(unsigned int k = 0; k<funcRegs[r].qbits.size(); k++){
+      if(funcRegs[r].qbits[k] != -1)
+        entry.qbits.push_back(make_pair((int)k, funcQbits.ts[funcRegs[r].qbits[k]]));
     }
   }
-  tableFuncQbits[F] = tmpFuncQbitsMap;
 }
 
 
@@ -1402,11 +1465,10 @@ bool GenSIMDSched::runOnModule (Module &M) {
             
       if(F && !F->isDeclaration()){
         //errs() << "SIMD_K " << RES_CONSTRAINT << ", SIMD_D " << DATA_CONSTRAINT << "\n";      
-        errs() << "#Function " << F->getName() << "\n";      
+        scaffoldOut() << "#Function " << F->getName() << "\n";      
         //errs() << "#Timestep GateName Operand1 Operand2 \n";
         
-        funcQbits.clear();
-        funcArgs.clear();
+        clear_funcQbits();
         vectCalls.clear();
         mapInstSet.clear();
         priorityVector.clear();
@@ -1422,7 +1484,7 @@ bool GenSIMDSched::runOnModule (Module &M) {
         }
 
         //print_critical_info();
-        errs() << "#EndFunction\n";
+        scaffoldOut() << "#EndFunction\n";
         cleanupCurrArrParGates(); 
       }
       else{
@@ -23,10 +23,12 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Support/CFG.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Argument.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/Constants.h"
 #include "llvm/IntrinsicInst.h"
+#include "ScaffoldOutput.h"
 
 
 using namespace llvm;
@@ -69,9 +71,34 @@ namespace {
   };
 
   struct qArgInfo{
-    string name;
+    int reg;  //qubit register in funcRegs
+    int qbit; //qubit id in funcQbitIds, -1 for the entire register
+    qArgInfo(): reg(-1), qbit(-1){ }
+  };
+
+  struct qRegister{ //qbit array or qbit argument of current function
+    Value* ptr;
+    int argNum; //-1 if not a function argument
+    vector<int> qbits; //qubit id for each index, -1 if not used yet
+    qRegister(Value* p, int n): ptr(p), argNum(n) { }
+  };
+
+  struct qbitId{ //qubit of current function
+    int reg;
     int index;
-    qArgInfo(): name("none"), index(-1){ }
+  };
+
+  struct qbitTimes{ //timesteps of qubits of current function
+    vector<uint64_t> whole; //per register, timestep of qubits not used individually yet
+    vector<uint64_t> max; //per register, max timestep over all its qubits
+    vector<uint64_t> ts; //per qubit id
+  };
+
+  struct qArgTable{ //timesteps of qubits of a function argument
+    uint64_t whole;
+    uint64_t max;
+    vector<pair<int,uint64_t> > qbits; //(index, timestep) in increasing index order
+    qArgTable(): whole(0), max(0) { }
   };
 
   struct qGate{
@@ -116,14 +143,15 @@ namespace {
     map<string, allTSParallelism > funcParallelFactor; //string is function name
     map<string, MaxInfo> funcMaxParallelFactor;
 
-    map<string, map<int,uint64_t> > funcQbits; //qbits in current function
-    map<string, map<int,uint64_t> > funcQbitsStart; //start ts of qbits in current function
-    map<string, map<int,uint64_t> > funcQbitsHalf; //qbits in current function
-    map<Function*, map<unsigned int, map<int,uint64_t> > > tableFuncQbits;
-    map<Function*, map<unsigned int, map<int,uint64_t> > > tableFuncQbitsStart;
-    map<string, unsigned int> funcArgs;
+    vector<qRegister> funcRegs; //qbit registers in current function
+    DenseMap<Value*, int> funcRegIds; //index of register in funcRegs
+    vector<qbitId> funcQbitIds; //qbits in current function, by id
+    qbitTimes funcQbits; //last ts of qbits in current function
+    qbitTimes funcQbitsHalf; //start ts of qbits in current function
+    map<Function*, map<unsigned int, qArgTable> > tableFuncQbits;
+    map<Function*, map<unsigned int, qArgTable> > tableFuncQbitsStart;
 
-    map<uint64_t, vector<qGate> > tsGates;
+    vector<vector<qGate> > tsGates; //gates of leaf function by timestep
     map<Function*, uint64_t> crit_path_f; 
 
     allTSParallelism currTS;
@@ -140,6 +168,13 @@ namespace {
     void analyzeCallInst(Function* F,Instruction* pinst);
     void getFunctionArguments(Function *F);
 
+    int addRegister(Value* ptr, int argNum);
+    int getQbit(int reg, int index);
+    void clear_funcQbits();
+    void saveTable(const qbitTimes& times, map<unsigned int, qArgTable>& table);
+    void print_qbitTimes(const qbitTimes& times);
+    void print_qArgTables(map<Function*, map<unsigned int, qArgTable> >& tables);
+
     void saveTableFuncQbits(Function* F);
     void saveTableFuncQbitsStart(Function* F);
     void print_tableFuncQbits();
@@ -245,7 +280,6 @@ void GetCriticalPath::getFunctionArguments(Function* F)
   {    
     //if(ait) errs() << "Argument: "<<ait->getName()<< " ";
 
-    string argName = (ait->getName()).str();
     Type* argType = ait->getType();
     unsigned int argNum=ait->getArgNo();         
 
@@ -261,41 +295,22 @@ void GetCriticalPath::getFunctionArguments(Function* F)
         tmpQArg.isQbit = true;
         vectQbit.push_back(ait);
 
-        map<int,uint64_t> tmpMap;
-        tmpMap[-1] = 0; //add entry for entire array
-        tmpMap[-2] = 0; //add entry for max
-        funcQbits[argName]=tmpMap;
-
-        map<int,uint64_t> tmpMapHalf;
-        funcQbitsHalf[argName]=tmpMapHalf;
-
-        funcArgs[argName] = argNum;
-
+        addRegister(ait, argNum);
       }
       else if (elementType->isIntegerTy(1)){ //cbit*
         tmpQArg.isCbit = true;
         vectQbit.push_back(ait);
-        funcArgs[argName] = argNum;
       }
     }
     else if (argType->isIntegerTy(16)){ //qbit
       tmpQArg.isQbit = true;
       vectQbit.push_back(ait);
 
-      map<int,uint64_t> tmpMap;
-      tmpMap[-1] = 0; //add entry for entire array
-      tmpMap[-2] = 0; //add entry for max
-      funcQbits[argName]=tmpMap;
-
-      map<int,uint64_t> tmpMapHalf;
-      funcQbitsHalf[argName]=tmpMapHalf;
-
-      funcArgs[argName] = argNum;
+      addRegister(ait, argNum);
     }
     else if (argType->isIntegerTy(1)){ //cbit
       tmpQArg.isCbit = true;
       vectQbit.push_back(ait);
-      funcArgs[argName] = argNum;
     }
 
   }
@@ -439,14 +454,7 @@ void GetCriticalPath::analyzeAllocInst(Function* F, Instruction* pInst){
         tmpQArg.argPtr = AI;
         tmpQArg.valOrIndex = arraySize;
 
-        map<int,uint64_t> tmpMap; //add qbit to funcQbits
-        tmpMap[-1] = 0; //entry for entire array
-        tmpMap[-2] = 0; //entry for max
-        funcQbits[AI->getName()]=tmpMap;
-
-        map<int,uint64_t> tmpMapHalf;
-        funcQbitsHalf[AI->getName()]=tmpMapHalf;
-
+        addRegister(AI, -1); //add qbit to funcQbits
       }
 
       if (elementType->isIntegerTy(1)){
@@ -471,9 +479,6 @@ void GetCriticalPath::init_critical_path_algo(Function* F){
   highestDelay = 0;
 
   //clear tsGates
-  for(map<uint64_t, vector<qGate> >::iterator mit=tsGates.begin(); mit!=tsGates.end(); ++mit){
-    (*mit).second.clear();
-  }
   tsGates.clear();
 
   currTimeStep.clear(); //initialize critical time steps   
@@ -493,31 +498,66 @@ void GetCriticalPath::init_critical_path_algo(Function* F){
   currParallelFunc.clear();
 }
 
-void GetCriticalPath::print_funcQbits(){
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbits.begin(); mIter!=funcQbits.end(); ++mIter){
-    errs() << "Var "<< (*mIter).first << " ---> ";
-    for(map<int,uint64_t>::iterator indexIter  = (*mIter).second.begin(); indexIter!=(*mIter).second.end(); ++indexIter){
-      errs() << (*indexIter).first << ":"<<(*indexIter).second<< "  ";
+int GetCriticalPath::addRegister(Value* ptr, int argNum){
+  int reg = funcRegs.size();
+  funcRegs.push_back(qRegister(ptr, argNum));
+  funcRegIds[ptr] = reg;
+  funcQbits.whole.push_back(0); //entire array
+  funcQbits.max.push_back(0); //max over all indices
+  return reg;
+}
+
+int GetCriticalPath::getQbit(int reg, int index){
+  vector<int>& qbits = funcRegs[reg].qbits;
+  if((unsigned)index >= qbits.size())
+    qbits.resize(index+1, -1);
+  if(qbits[index] == -1){
+    //first use of the qbit, it gets the value for entire array
+    qbitId id;
+    id.reg = reg;
+    id.index = index;
+    qbits[index] = funcQbitIds.size();
+    funcQbitIds.push_back(id);
+    funcQbits.ts.push_back(funcQbits.whole[reg]);
+  }
+  return qbits[index];
+}
+
+void GetCriticalPath::clear_funcQbits(){
+  funcRegs.clear();
+  funcRegIds.clear();
+  funcQbitIds.clear();
+  funcQbits = qbitTimes();
+  funcQbitsHalf = qbitTimes();
+}
+
+void GetCriticalPath::print_qbitTimes(const qbitTimes& times){
+  for(unsigned int r = 0; r<funcRegs.size(); r++){
+    errs() << "Var "<< funcRegs[r].ptr->getName() << " ---> ";
+    errs() << "-2:" << times.max[r] << "  -1:" << times.whole[r] << "  ";
+    for(unsigned int k = 0; k<funcRegs[r].qbits.size(); k++){
+      if(funcRegs[r].qbits[k] != -1)
+        errs() << k << ":" << times.ts[funcRegs[r].qbits[k]] << "  ";
     }
     errs() << "\n";
   }
 }
 
+void GetCriticalPath::print_funcQbits(){
+  print_qbitTimes(funcQbits);
+}
+
 void GetCriticalPath::print_funcQbitsHalf(){
   errs() << "Printing funcQbitsHalf ---- \n";
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbitsHalf.begin(); mIter!=funcQbitsHalf.end(); ++mIter){
-    errs() << "Var "<< (*mIter).first << " ---> ";
-    for(map<int,uint64_t>::iterator indexIter  = (*mIter).second.begin(); indexIter!=(*mIter).second.end(); ++indexIter){
-      errs() << (*indexIter).first << ":"<<(*indexIter).second<< "  ";
-    }
-    errs() << "\n";
-  }
+  if(!funcQbitsHalf.max.empty())
+    print_qbitTimes(funcQbitsHalf);
 }
 
 void GetCriticalPath::print_qgate(qGate qg){
   errs() << "--Gate: " << qg.qFunc->getName() << " : ";
   for(int i=0;i<qg.numArgs;i++){
-    errs() << qg.args[i].name << " idx=" << qg.args[i].index 
+    int index = (qg.args[i].qbit == -1) ? -1 : funcQbitIds[qg.args[i].qbit].index;
+    errs() << funcRegs[qg.args[i].reg].ptr->getName() << " idx=" << index 
       << ", "  ;
   }
   errs() << "ASAP=" << qg.asap_num << " ALAP=" << qg.alap_num;
@@ -583,10 +623,9 @@ void GetCriticalPath::update_critical_info(string currFunc, uint64_t ts, string
 
 uint64_t GetCriticalPath::find_max_funcQbits(){
   uint64_t max_timesteps = 0;
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbits.begin(); mIter!=funcQbits.end(); ++mIter){
-    map<int,uint64_t>::iterator arrIter = (*mIter).second.find(-2);
-    if((*arrIter).second > max_timesteps)
-      max_timesteps = (*arrIter).second;
+  for(vector<uint64_t>::iterator it = funcQbits.max.begin(); it!=funcQbits.max.end(); ++it){
+    if((*it) > max_timesteps)
+      max_timesteps = (*it);
   }
 
   return max_timesteps;
@@ -594,38 +633,39 @@ uint64_t GetCriticalPath::find_max_funcQbits(){
 }
 
 void GetCriticalPath::memset_funcQbits(uint64_t val){
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbits.begin(); mIter!=funcQbits.end(); ++mIter){
-    for(map<int,uint64_t>::iterator arrIter = (*mIter).second.begin(); arrIter!=(*mIter).second.end();++arrIter)
-      (*arrIter).second = val;
-  }
+  fill(funcQbits.whole.begin(), funcQbits.whole.end(), val);
+  fill(funcQbits.max.begin(), funcQbits.max.end(), val);
+  fill(funcQbits.ts.begin(), funcQbits.ts.end(), val);
 }
 
 void GetCriticalPath::memset_funcQbitsHalf(uint64_t val){
-  for(map<string, map<int,uint64_t> >::iterator mIter = funcQbitsHalf.begin(); mIter!=funcQbitsHalf.end(); ++mIter){
-    for(map<int,uint64_t>::iterator arrIter = (*mIter).second.begin(); arrIter!=(*mIter).second.end();++arrIter)
-      (*arrIter).second = val;
-  }
+  fill(funcQbitsHalf.whole.begin(), funcQbitsHalf.whole.end(), val);
+  fill(funcQbitsHalf.max.begin(), funcQbitsHalf.max.end(), val);
+  fill(funcQbitsHalf.ts.begin(), funcQbitsHalf.ts.end(), val);
 }
 
 void GetCriticalPath::print_scheduled_gate(qGate qg, uint64_t ts){
+  raw_ostream &out = scaffoldOut();
   string tmpGateName = qg.qFunc->getName();
   if(tmpGateName.find("llvm.")!=string::npos)
     tmpGateName = tmpGateName.substr(5);
-  errs() << ts << " : " << tmpGateName;
+  out << ts << " : " << tmpGateName;
   for(int i = 0; i<qg.numArgs; i++){
-    //if(qg.args[i].index != -1)
-    errs() << " " << qg.args[i].name << qg.args[i].index;
+    int index = (qg.args[i].qbit == -1) ? -1 : funcQbitIds[qg.args[i].qbit].index;
+    //if(index != -1)
+    out << " " << funcRegs[qg.args[i].reg].ptr->getName() << index;
   }
 
-  errs() << "\n";
+  out << "\n";
 }
 
-void GetCriticalPath::print_tableFuncQbits(){
-  for(map<Function*, map<unsigned int, map<int, uint64_t> > >::iterator m1 = tableFuncQbits.begin(); m1!=tableFuncQbits.end(); ++m1){
+void GetCriticalPath::print_qArgTables(map<Function*, map<unsigned int, qArgTable> >& tables){
+  for(map<Function*, map<unsigned int, qArgTable> >::iterator m1 = tables.begin(); m1!=tables.end(); ++m1){
     errs() << "Function " << (*m1).first->getName() << " \n  ";
-    for(map<unsigned int, map<int, uint64_t> >::iterator m2 = (*m1).second.begin(); m2!=(*m1).second.end(); ++m2){
+    for(map<unsigned int, qArgTable>::iterator m2 = (*m1).second.begin(); m2!=(*m1).second.end(); ++m2){
       errs() << "\tArg# "<< (*m2).first << " -- ";
-      for(map<int, uint64_t>::iterator m3 = (*m2).second.begin(); m3!=(*m2).second.end(); ++m3){
+      errs() << " ; -2 : " << (*m2).second.max << " ; -1 : " << (*m2).second.whole;
+      for(vector<pair<int, uint64_t> >::iterator m3 = (*m2).second.qbits.begin(); m3!=(*m2).second.qbits.end(); ++m3){
         errs() << " ; " << (*m3).first << " : " << (*m3).second;
       }
       errs() << "\n";
@@ -633,18 +673,13 @@ void GetCriticalPath::print_tableFuncQbits(){
   }
 }
 
+void GetCriticalPath::print_tableFuncQbits(){
+  print_qArgTables(tableFuncQbits);
+}
+
 void GetCriticalPath::print_tableFuncQbitsStart(){
   errs() << "Printing tableFuncQbitsStart\n";
-  for(map<Function*, map<unsigned int, map<int, uint64_t> > >::iterator m1 = tableFuncQbitsStart.begin(); m1!=tableFuncQbitsStart.end(); ++m1){
-    errs() << "Function " << (*m1).first->getName() << " \n  ";
-    for(map<unsigned int, map<int, uint64_t> >::iterator m2 = (*m1).second.begin(); m2!=(*m1).second.end(); ++m2){
-      errs() << "\tArg# "<< (*m2).first << " -- ";
-      for(map<int, uint64_t>::iterator m3 = (*m2).second.begin(); m3!=(*m2).second.end(); ++m3){
-        errs() << " ; " << (*m3).first << " : " << (*m3).second;
-      }
-      errs() << "\n";
-    }
-  }
+  print_qArgTables(tableFuncQbitsStart);
 }
 
 void GetCriticalPath::calc_max_parallelism_statistic()
@@ -679,9 +714,11 @@ void GetCriticalPath::calc_max_parallelism_statistic()
 
 void GetCriticalPath::print_tsGates()
 {
-  for(map<uint64_t, vector<qGate> >::iterator mit = tsGates.begin(); mit!=tsGates.end(); ++mit){
-    errs() << "TS#"<<(*mit).first << " --> ";
-    for(vector<qGate>::iterator vit = (*mit).second.begin(); vit!=(*mit).second.end();++vit)
+  for(uint64_t ts = 0; ts<tsGates.size(); ts++){
+    if(tsGates[ts].empty())
+      continue;
+    errs() << "TS#"<<ts << " --> ";
+    for(vector<qGate>::iterator vit = tsGates[ts].begin(); vit!=tsGates[ts].end();++vit)
       print_qgate(*vit);
   }
 
@@ -691,15 +728,9 @@ void GetCriticalPath::addToTSGates(qGate qg, uint64_t ts)
 {
   if(isLeaf){
     //add to tsGates
-    map<uint64_t, vector<qGate> >::iterator git = tsGates.find(ts);
-    if(git!=tsGates.end()){
-      (*git).second.push_back(qg); //add to vector
-    }
-    else{
-      vector<qGate> tmpVect;
-      tmpVect.push_back(qg);
-      tsGates[ts] = tmpVect; //add to map	
-    } 
+    if(ts >= tsGates.size())
+      tsGates.resize(ts+1);
+    tsGates[ts].push_back(qg);
   } //isLeaf
 }
 
@@ -710,36 +741,13 @@ uint64_t GetCriticalPath::compute_max_ts_of_all_args(qGate qg)
 
   //find last timestep for all arguments of qgate
   for(int i=0;i<qg.numArgs; i++){
-    map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-    assert(mIter!=funcQbits.end()); //should already have an entry for the name of the qbit
-
-    int argIndex = qg.args[i].index;
-
-    //find the index of argument in the map<int,int>
-    if(argIndex == -1) //operation on entire array
-    {
-      //find max for the array
-      map<int,uint64_t>::iterator indexIter = (*mIter).second.find(-2);
-      if((*indexIter).second > max_ts_of_all_args)
-        max_ts_of_all_args = (*indexIter).second;	  
-    }
+    uint64_t ts;
+    if(qg.args[i].qbit == -1) //operation on entire array
+      ts = funcQbits.max[qg.args[i].reg]; //max for the array
     else
-    {
-      map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-      if(indexIter!=(*mIter).second.end()){
-        if((*indexIter).second > max_ts_of_all_args)
-          max_ts_of_all_args = (*indexIter).second;
-      }
-      else{
-        //find the value for entire array
-        map<int,uint64_t>::iterator fullArrayIndexIter = (*mIter).second.find(-1);
-
-        ((*mIter).second)[argIndex] = (*fullArrayIndexIter).second;
-        if((*fullArrayIndexIter).second > max_ts_of_all_args)
-          max_ts_of_all_args = (*fullArrayIndexIter).second;
-        //((*mIter).second)[argIndex] = 0;
-      }
-    }
+      ts = funcQbits.ts[qg.args[i].qbit];
+    if(ts > max_ts_of_all_args)
+      max_ts_of_all_args = ts;
   }
 
   if(debugGetCriticalPath){
@@ -771,29 +779,26 @@ uint64_t GetCriticalPath::compute_least_slack(Function* F, qGate qg, uint64_t tm
   //compute startsAt
   //print_tableFuncQbitsStart();
 
-  map<Function*, map<unsigned int, map<int, uint64_t> > >::iterator tableIt = tableFuncQbitsStart.find(qg.qFunc);
+  map<Function*, map<unsigned int, qArgTable> >::iterator tableIt = tableFuncQbitsStart.find(qg.qFunc);
   assert(tableIt!=tableFuncQbitsStart.end() && "No previous entry for this function");
 
   for(int i=0;i<qg.numArgs; i++){    
-    map<unsigned int, map<int, uint64_t> >::iterator entryIt = (*tableIt).second.find(i);
+    map<unsigned int, qArgTable>::iterator entryIt = (*tableIt).second.find(i);
     if(entryIt!=(*tableIt).second.end()){
 
       //differentiate for qbit and qbit*
 
-      if(qg.args[i].index == -1){ //qbit*
+      if(qg.args[i].qbit == -1){ //qbit*
 
         //errs() << "Array\n";
 
-        map<int, uint64_t>::iterator lookUpIt = (*entryIt).second.find(-2);
-        startsAt[i] = tmax + (*lookUpIt).second;			
+        startsAt[i] = tmax + (*entryIt).second.max;			
       }
       else{ //qbit was passed
-        //errs() << "i = " << i << " Qbit\n";
-        //errs() << "index = " << qg.args[i].index << " Qbit\n";
         //take the 0th entry and add that to the index entry
-        map<int, uint64_t>::iterator lookUpQbitIt = (*entryIt).second.find(0);
-        assert(lookUpQbitIt!=(*entryIt).second.end() && "arg index not found in tablefuncqbitshalf"); //there exists entry for reqd index in the func table of called func
-        startsAt[i] = tmax + (*lookUpQbitIt).second;
+        vector<pair<int, uint64_t> >& qbits = (*entryIt).second.qbits;
+        assert(!qbits.empty() && qbits[0].first == 0 && "arg index not found in tablefuncqbitshalf"); //there exists entry for reqd index in the func table of called func
+        startsAt[i] = tmax + qbits[0].second;
 
       }
     }
@@ -805,32 +810,10 @@ uint64_t GetCriticalPath::compute_least_slack(Function* F, qGate qg, uint64_t tm
   //compute endsAt
   //find last timestep for all arguments of qgate
   for(int i=0;i<qg.numArgs; i++){
-    map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-    assert(mIter!=funcQbits.end()); //should already have an entry for the name of the qbit
-
-    int argIndex = qg.args[i].index;
-
-    //find the index of argument in the map<int,int>
-    if(argIndex == -1) //operation on entire array
-    {
-      //find max for the array
-      map<int,uint64_t>::iterator indexIter = (*mIter).second.find(-2);
-      endsAt[i] = (*indexIter).second;	  
-    }
+    if(qg.args[i].qbit == -1) //operation on entire array
+      endsAt[i] = funcQbits.max[qg.args[i].reg]; //max for the array
     else
-    {
-      map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-      if(indexIter!=(*mIter).second.end()){
-        endsAt[i] = (*indexIter).second;
-      }
-      else{
-        //find the value for entire array
-        map<int,uint64_t>::iterator fullArrayIndexIter = (*mIter).second.find(-1);
-
-        ((*mIter).second)[argIndex] = (*fullArrayIndexIter).second;
-        endsAt[i] = (*fullArrayIndexIter).second;
-      }
-    }
+      endsAt[i] = funcQbits.ts[qg.args[i].qbit];
   }
 
   //print_tableFuncQbits();
@@ -868,17 +851,14 @@ void GetCriticalPath::calc_critical_time(Function* F, qGate qg){
     //--print_scheduled_gate(qg,maxFQ+1);
     addToTSGates(qg,maxFQ+1);
 
-    map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[0].name);
-
-    int argIndex = qg.args[0].index;
-
     //update the timestep number for that argument
-    map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-    (*indexIter).second =  maxFQ + 1;
+    if(qg.args[0].qbit == -1)
+      funcQbits.whole[qg.args[0].reg] = maxFQ + 1;
+    else
+      funcQbits.ts[qg.args[0].qbit] = maxFQ + 1;
 
-    //update -2 entry for the array, i.e. max ts over all indices
-    indexIter = (*mIter).second.find(-2);
-    (*indexIter).second = maxFQ + 1;
+    //update max ts over all indices of the array
+    funcQbits.max[qg.args[0].reg] = maxFQ + 1;
 
     //update_critical_info(F->getName().str(), maxFQ, qg.qFunc->getName(), qg.angle);   
     isFirstMeas = false;
@@ -899,25 +879,24 @@ void GetCriticalPath::calc_critical_time(Function* F, qGate qg){
 
       //find last timestep for all arguments of qgate
       for(int i=0;i<qg.numArgs; i++){
-        map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-
-        int argIndex = qg.args[i].index;
-
-        if(argIndex == -1){
-          for(map<int,uint64_t>::iterator entryIter = (*mIter).second.begin(); entryIter!=(*mIter).second.end();++entryIter){
-            (*entryIter).second = max_ts_of_all_args + 1;
+        int reg = qg.args[i].reg;
+
+        if(qg.args[i].qbit == -1){
+          funcQbits.whole[reg] = max_ts_of_all_args + 1;
+          funcQbits.max[reg] = max_ts_of_all_args + 1;
+          for(vector<int>::iterator qit = funcRegs[reg].qbits.begin(); qit!=funcRegs[reg].qbits.end(); ++qit){
+            if((*qit) != -1)
+              funcQbits.ts[*qit] = max_ts_of_all_args + 1;
           }
 
         }
         else{
           //update the timestep number for that argument
-          map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-          (*indexIter).second =  max_ts_of_all_args + 1;
+          funcQbits.ts[qg.args[i].qbit] =  max_ts_of_all_args + 1;
 
-          //update -2 entry for the array, i.e. max ts over all indices
-          indexIter = (*mIter).second.find(-2);
-          if((*indexIter).second < max_ts_of_all_args + 1)
-            (*indexIter).second = max_ts_of_all_args + 1;
+          //update max ts over all indices of the array
+          if(funcQbits.max[reg] < max_ts_of_all_args + 1)
+            funcQbits.max[reg] = max_ts_of_all_args + 1;
         }  
       }
     } //intrinsic func
@@ -944,41 +923,35 @@ void GetCriticalPath::calc_critical_time(Function* F, qGate qg){
       if(tmpDelay > highestDelay) highestDelay = tmpDelay;
 
       //check tableFuncQbits for values to update with
-      map<Function*, map<unsigned int, map<int, uint64_t> > >::iterator tableIt = tableFuncQbits.find(qg.qFunc);
+      map<Function*, map<unsigned int, qArgTable> >::iterator tableIt = tableFuncQbits.find(qg.qFunc);
       assert(tableIt!=tableFuncQbits.end() && "No previous entry for this function");
 
       for(int i=0;i<qg.numArgs; i++){
-        map<string, map<int,uint64_t> >::iterator mIter = funcQbits.find(qg.args[i].name);
-        assert(mIter!=funcQbits.end()); //should already have an entry for the name of the qbit
+        int reg = qg.args[i].reg;
 
-        map<unsigned int, map<int, uint64_t> >::iterator entryIt = (*tableIt).second.find(i);
+        map<unsigned int, qArgTable>::iterator entryIt = (*tableIt).second.find(i);
         if(entryIt!=(*tableIt).second.end()){
 
           //differentiate for qbit and qbit*
 
-          if(qg.args[i].index == -1){ //qbit*
-            for(map<int, uint64_t>::iterator indexIt = (*entryIt).second.begin(); indexIt!=(*entryIt).second.end(); ++indexIt){
-              map<int,uint64_t>::iterator currEntryIt = (*mIter).second.find((*indexIt).first);
-              if(currEntryIt!=(*mIter).second.end())
-                (*currEntryIt).second = max_ts_of_all_args + (*indexIt).second - least_slack + 1;
-              else
-                (*mIter).second[(*indexIt).first] = max_ts_of_all_args + (*indexIt).second - least_slack + 1;
+          if(qg.args[i].qbit == -1){ //qbit*
+            qArgTable& entry = (*entryIt).second;
+            funcQbits.max[reg] = max_ts_of_all_args + entry.max - least_slack + 1;
+            funcQbits.whole[reg] = max_ts_of_all_args + entry.whole - least_slack + 1;
+            for(vector<pair<int, uint64_t> >::iterator indexIt = entry.qbits.begin(); indexIt!=entry.qbits.end(); ++indexIt){
+              funcQbits.ts[getQbit(reg, (*indexIt).first)] = max_ts_of_all_args + (*indexIt).second - least_slack + 1;
             }
           }
           else{ //qbit was passed
             //take the 0th entry and add that to the index entry
-            map<int, uint64_t>::iterator lookUpQbitIt = (*entryIt).second.find(0);
-            assert(lookUpQbitIt!=(*entryIt).second.end()); //there exists entry for 0 in the func table of called func
-            map<int, uint64_t>::iterator currEntryIt = (*mIter).second.find(qg.args[i].index);
-            if(currEntryIt!=(*mIter).second.end())
-              (*currEntryIt).second = max_ts_of_all_args + (*lookUpQbitIt).second - least_slack + 1;
-            else
-              (*mIter).second[qg.args[i].index] = max_ts_of_all_args + (*lookUpQbitIt).second - least_slack + 1;
-
-            //update -2 entry for the array, i.e. max ts over all indices
-            currEntryIt = (*mIter).second.find(-2);
-            if((*currEntryIt).second < max_ts_of_all_args + (*lookUpQbitIt).second)
-              (*currEntryIt).second = max_ts_of_all_args + (*lookUpQbitIt).second- least_slack + 1;	    
+            vector<pair<int, uint64_t> >& qbits = (*entryIt).second.qbits;
+            assert(!qbits.empty() && qbits[0].first == 0); //there exists entry for 0 in the func table of called func
+            uint64_t lookUpQbit = qbits[0].second;
+            funcQbits.ts[qg.args[i].qbit] = max_ts_of_all_args + lookUpQbit - least_slack + 1;
+
+            //update max ts over all indices of the array
+            if(funcQbits.max[reg] < max_ts_of_all_args + lookUpQbit)
+              funcQbits.max[reg] = max_ts_of_all_args + lookUpQbit- least_slack + 1;	    
           }
         } 
       }
@@ -1084,9 +1057,11 @@ void GetCriticalPath::analyzeCallInst(Function* F, Instruction* pInst){
       for(unsigned int vb=0; vb<allDepQbit.size(); vb++){
         if(allDepQbit[vb].argPtr){
           qGateArg param =  allDepQbit[vb];       
-          thisGate.args[thisGate.numArgs].name = param.argPtr->getName();
-          if(!param.isPtr)
-            thisGate.args[thisGate.numArgs].index = param.valOrIndex;
+          DenseMap<Value*, int>::iterator regIt = funcRegIds.find(param.argPtr);
+          assert(regIt!=funcRegIds.end()); //should already have an entry for the qbit
+          thisGate.args[thisGate.numArgs].reg = (*regIt).second;
+          if(!param.isPtr && param.valOrIndex >= 0)
+            thisGate.args[thisGate.numArgs].qbit = getQbit((*regIt).second, param.valOrIndex);
           thisGate.numArgs++;
         }
       }
@@ -1099,31 +1074,28 @@ void GetCriticalPath::analyzeCallInst(Function* F, Instruction* pInst){
   }
 
 
-  void GetCriticalPath::saveTableFuncQbits(Function* F){
-    map<unsigned int, map<int, uint64_t> > tmpFuncQbitsMap;
-
-    for(map<string, map<int, uint64_t> >::iterator mapIt = funcQbits.begin(); mapIt!=funcQbits.end(); ++mapIt){
-      map<string, unsigned int>::iterator argIt = funcArgs.find((*mapIt).first);
-      if(argIt!=funcArgs.end()){
-        unsigned int argNum = (*argIt).second;
-        tmpFuncQbitsMap[argNum] = (*mapIt).second;
+  void GetCriticalPath::saveTable(const qbitTimes& times, map<unsigned int, qArgTable>& table){
+    table.clear();
+    for(unsigned int r = 0; r<funcRegs.size(); r++){
+      if(funcRegs[r].argNum == -1)
+        continue;
+      qArgTable& entry = table[funcRegs[r].argNum];
+      entry.whole = times.whole[r];
+      entry.max = times.max[r];
+      for(unsigned int k = 0; k<funcRegs[r].qbits.size(); k++){
+        if(funcRegs[r].qbits[k] != -1)
+          entry.qbits.push_back(make_pair((int)k, times.ts[funcRegs[r].qbits[k]]));
       }
     }
-    tableFuncQbits[F] = tmpFuncQbitsMap;
   }
 
+  void GetCriticalPath::saveTableFuncQbits(Function* F){
+    saveTable(funcQbits, tableFuncQbits[F]);
+  }
 
-  void GetCriticalPath::saveTableFuncQbitsStart(Function* F){
-    map<unsigned int, map<int, uint64_t> > tmpFuncQbitsMap;
 
-    for(map<string, map<int, uint64_t> >::iterator mapIt = funcQbitsHalf.begin(); mapIt!=funcQbitsHalf.end(); ++mapIt){
-      map<string, unsigned int>::iterator argIt = funcArgs.find((*mapIt).first);
-      if(argIt!=funcArgs.end()){
-        unsigned int argNum = (*argIt).second;
-        tmpFuncQbitsMap[argNum] = (*mapIt).second;
-      }
-    }
-    tableFuncQbitsStart[F] = tmpFuncQbitsMap;
+  void GetCriticalPath::saveTableFuncQbitsStart(Function* F){
+    saveTable(funcQbitsHalf, tableFuncQbitsStart[F]);
   }
 
 
@@ -1131,39 +1103,25 @@ void GetCriticalPath::analyzeCallInst(Function* F, Instruction* pInst){
     //copy all entries of funcQbit
     //print_funcQbitsHalf();
 
-    for(map<string, map<int,uint64_t> >::iterator inItr = funcQbits.begin(); inItr!=funcQbits.end(); ++inItr){
-      //find string in funcQbitsHalf
-      //errs() << "Looking for string " << (*inItr).first << "\n";
-      map<string, map<int,uint64_t> >::iterator outItr = funcQbitsHalf.find((*inItr).first);
-      assert(outItr != funcQbitsHalf.end() && "funcQbitsHalf does not have entry");
-
-      for(map<int,uint64_t>::iterator in2Itr = (*inItr).second.begin(); in2Itr!=(*inItr).second.end(); ++in2Itr){
-        (*outItr).second[(*in2Itr).first] = i;
-      }
-    }
+    funcQbitsHalf.whole.assign(funcRegs.size(), i);
+    funcQbitsHalf.max.assign(funcRegs.size(), i);
+    funcQbitsHalf.ts.assign(funcQbitIds.size(), i);
 
   }
 
   void GetCriticalPath::gen_half_funcQbits(uint64_t ct, uint64_t hct){
     init_funcQbitsHalf(ct);
 
-    for(uint64_t i=hct+1; i<ct; i++){
-      map<uint64_t, vector<qGate> >::iterator mit=tsGates.find(i);
-      for(vector<qGate>::iterator vit = (*mit).second.begin(); vit!=(*mit).second.end(); ++vit){
+    for(uint64_t i=hct+1; i<ct && i<tsGates.size(); i++){
+      for(vector<qGate>::iterator vit = tsGates[i].begin(); vit!=tsGates[i].end(); ++vit){
         //iterate over the args
         for(int j=0; j<(*vit).numArgs; j++){
-          string argName = (*vit).args[j].name;
-          int argIndex = (*vit).args[j].index;
-          map<string, map<int,uint64_t> >::iterator fit = funcQbitsHalf.find(argName);
-          assert(fit!=funcQbitsHalf.end() && "arg not found in funQbitsHalf");
+          int qbit = (*vit).args[j].qbit;
+          assert(qbit != -1 && "argindex is -1");
 
-          assert(argIndex != -1 && "argindex is -1");
-
-          map<int,uint64_t>::iterator mfit = (*fit).second.find(argIndex);
-          assert(mfit != (*fit).second.end() && "arg index not found in funcQbitsHalf");
-
-          if(i < (*mfit).second){ //gate scheduled in TS=i
-            (*mfit).second = i;	  
+          uint64_t& ts = funcQbitsHalf.ts[qbit];
+          if(i < ts){ //gate scheduled in TS=i
+            ts = i;	  
           }
 
         }
@@ -1181,34 +1139,19 @@ void GetCriticalPath::analyzeCallInst(Function* F, Instruction* pInst){
     assert(hct!=0 && "ZERO hct");
 
     for(uint64_t i=hct; i>=1; i--){
-      map<uint64_t, vector<qGate> >::iterator mit=tsGates.find(i);
-      for(vector<qGate>::iterator vit = (*mit).second.begin(); vit!=(*mit).second.end(); ++vit){
+      if(i >= tsGates.size())
+        continue;
+      for(vector<qGate>::iterator vit = tsGates[i].begin(); vit!=tsGates[i].end(); ++vit){
         //iterate over the args and get ALAP num
         uint64_t min_ts_of_all_args = ct;
 
         for(int j=0; j<(*vit).numArgs; j++){
-          string argName = (*vit).args[j].name;
-          int argIndex = (*vit).args[j].index;
-
-          map<string, map<int,uint64_t> >::iterator fit = funcQbitsHalf.find(argName);
-          assert(fit!=funcQbitsHalf.end() && "arg not found in funQbitsHalf");
-          assert(argIndex != -1 && "argIndex = -1 in sched_alap");
-
-          //if(argIndex == -1) //operation on entire array
-          //{
-          //find min for the array
-          //map<int,uint64_t>::iterator indexIter = (*fit).second.find(-2);
-          //  if((*indexIter).second < min_ts_of_all_args)
-          //    min_ts_of_all_args = (*indexIter).second;	  
-          //}
-          //else
-          //{
-          map<int,uint64_t>::iterator mfit = (*fit).second.find(argIndex);
-          assert(mfit != (*fit).second.end() && "arg index not found in funcQbitsHalf");
+          int qbit = (*vit).args[j].qbit;
+          assert(qbit != -1 && "argIndex = -1 in sched_alap");
 
-          if((*mfit).second < min_ts_of_all_args)
-            min_ts_of_all_args = (*mfit).second;
-          //}
+          uint64_t ts = funcQbitsHalf.ts[qbit];
+          if(ts < min_ts_of_all_args)
+            min_ts_of_all_args = ts;
         }
         //print_qgate((*vit));
         //errs() << "min_ts_of_all_args = " << min_ts_of_all_args << "\n";
@@ -1219,25 +1162,24 @@ void GetCriticalPath::analyzeCallInst(Function* F, Instruction* pInst){
 
         //find last timestep for all arguments of qgate
         for(int j=0;j<(*vit).numArgs; j++){
-          map<string, map<int,uint64_t> >::iterator mIter = funcQbitsHalf.find((*vit).args[j].name);
-
-          int argIndex = (*vit).args[j].index;
-
-          if(argIndex == -1){
-            for(map<int,uint64_t>::iterator entryIter = (*mIter).second.begin(); entryIter!=(*mIter).second.end();++entryIter){
-              (*entryIter).second = min_ts_of_all_args - 1;
+          int reg = (*vit).args[j].reg;
+
+          if((*vit).args[j].qbit == -1){
+            funcQbitsHalf.whole[reg] = min_ts_of_all_args - 1;
+            funcQbitsHalf.max[reg] = min_ts_of_all_args - 1;
+            for(vector<int>::iterator qit = funcRegs[reg].qbits.begin(); qit!=funcRegs[reg].qbits.end(); ++qit){
+              if((*qit) != -1)
+                funcQbitsHalf.ts[*qit] = min_ts_of_all_args - 1;
             }
 
           }
           else{
             //update the timestep number for that argument
-            map<int,uint64_t>::iterator indexIter = (*mIter).second.find(argIndex);
-            (*indexIter).second =  min_ts_of_all_args - 1;
+            funcQbitsHalf.ts[(*vit).args[j].qbit] =  min_ts_of_all_args - 1;
 
-            //update -2 entry for the array, i.e. min ts over all indices
-            indexIter = (*mIter).second.find(-2);
-            if((*indexIter).second > min_ts_of_all_args - 1)
-              (*indexIter).second = min_ts_of_all_args - 1;
+            //update min ts over all indices of the array
+            if(funcQbitsHalf.max[reg] > min_ts_of_all_args - 1)
+              funcQbitsHalf.max[reg] = min_ts_of_all_args - 1;
           }  
         }
       }
@@ -1351,9 +1293,7 @@ void GetCriticalPath::analyzeCallInst(Function* F, Instruction* pInst){
         if(F && !F->isDeclaration()){
           //errs() << "\nFunction: " << F->getName() << "\n";      
 
-          funcQbits.clear();
-          funcQbitsHalf.clear();
-          funcArgs.clear();
+          clear_funcQbits();
 
           getFunctionArguments(F);
 
@@ -1363,7 +1303,7 @@ void GetCriticalPath::analyzeCallInst(Function* F, Instruction* pInst){
           crit_path_f[F] = max(find_max_funcQbits(), highestDelay);
           //if(F->getName() == "main")
           //errs() << F->getName() << ": " << "Critical Path Length : " << find_max_funcQbits() << "\n";
-          errs() << F->getName() << " " << max(find_max_funcQbits(),highestDelay) << " isLeaf= " << isLeaf <<"\n";	
+          scaffoldOut() << F->getName() << " " << max(find_max_funcQbits(),highestDelay) << " isLeaf= " << isLeaf <<"\n";	
         }
         else{
           if(debugGetCriticalPath)
@@ -0,0 +1,1070 @@
+//===------------------------- MultiSIMDSchedule.cpp ----------------------===//
+// This file implements the Scaffold pass that computes communication-aware
+// Multi-SIMD schedules of leaf modules with the SS, LPFS and RCP schedulers
+// of scripts/sched.pl. The dependency DAG of each leaf module is built once
+// from the IR and shared by all the configurations that are swept, which
+// are scheduled in parallel threads.
+//
+//        This file was created by Scaffold Compiler Working Group
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "MultiSIMDSchedule"
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Module.h"
+#include "llvm/Instruction.h"
+#include "llvm/Instructions.h"
+#include "llvm/Argument.h"
+#include "llvm/Constants.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "ScaffoldOutput.h"
+#include "ScaffoldWorkQueue.h"
+
+
+using namespace llvm;
+using namespace std;
+
+
+// The options of scripts/sched.pl. Every option takes a comma separated
+// list, and one schedule is generated for every combination of values.
+static cl::list<unsigned>
+SimdK("msimd-k", cl::CommaSeparated, cl::Hidden,
+    cl::desc("k, number of SIMD regions (sched.pl -k, default 4)"));
+
+static cl::list<unsigned>
+SimdD("msimd-d", cl::CommaSeparated, cl::Hidden,
+    cl::desc("d, capacity of each SIMD region (sched.pl -d, default 1024)"));
+
+static cl::list<string>
+SchedNames("msimd-sched", cl::CommaSeparated, cl::Hidden,
+    cl::desc("Schedulers to run: ss, lpfs, rcp (sched.pl -n, default lpfs)"));
+
+static cl::list<unsigned>
+SimdL("msimd-l", cl::CommaSeparated, cl::Hidden,
+    cl::desc("SIMD regions LPFS allocates to longest paths (sched.pl -l, default 2)"));
+
+static cl::list<bool>
+LpfsOpp("msimd-opp", cl::CommaSeparated, cl::Hidden,
+    cl::desc("LPFS adds ready gates of the same type to scheduled regions (sched.pl -opp)"));
+
+static cl::list<bool>
+LpfsRefill("msimd-refill", cl::CommaSeparated, cl::Hidden,
+    cl::desc("LPFS finds a new longest path when a path region is done (sched.pl -refill)"));
+
+static cl::list<int>
+RcpOp("msimd-op", cl::CommaSeparated, cl::Hidden,
+    cl::desc("RCP weight of a gate (sched.pl --op, default 1)"));
+
+static cl::list<int>
+RcpDist("msimd-dist", cl::CommaSeparated, cl::Hidden,
+    cl::desc("RCP weight of a gate whose qubits are in the region (sched.pl --dist, default -1)"));
+
+static cl::list<int>
+RcpSlack("msimd-slack", cl::CommaSeparated, cl::Hidden,
+    cl::desc("RCP weight of the slack of a gate (sched.pl --slack, default 1)"));
+
+static cl::opt<bool>
+PrintSchedule("msimd-print-schedule", cl::init(false), cl::Hidden,
+    cl::desc("Print the schedules besides the metrics (sched.pl -s)"));
+
+static cl::opt<string>
+SchedOutput("msimd-out", cl::init(""), cl::Hidden,
+    cl::desc("Write every configuration to <prefix>.simd.<k>.<d>.leaves.<config> "
+             "as regress.sh names them, instead of to the Scaffold output"));
+
+static cl::opt<unsigned>
+SchedThreads("msimd-threads", cl::init(0), cl::Hidden,
+    cl::desc("Number of configurations scheduled in parallel (0 = number of CPUs)"));
+
+#define MAX_BT_COUNT 15 //max backtrace allowed - to avoid infinite recursive loops
+#define NUM_QGATES 13
+#define _PrepZ 0
+#define _MeasX 1
+#define _MeasZ 2
+#define _CNOT 3
+#define _H 4
+#define _S 5
+#define _Sdag 6
+#define _T 7
+#define _Tdag 8
+#define _X 9
+#define _Y 10
+#define _Z 11
+#define _Fredkin 12
+
+bool debugMultiSIMDSched = false;
+
+namespace {
+
+  // gates of leaf modules, the ones scripts/leaves.pl keeps
+  const char* const gate_name[NUM_QGATES] = {
+    "PrepZ", "MeasX", "MeasZ", "CNOT", "H", "S", "Sdag", "T", "Tdag",
+    "X", "Y", "Z", "Fredkin" };
+
+  // formats a number the way perl prints it
+  string perlNum(double x){
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", x);
+    return buf;
+  }
+
+  // Dependency DAG of the gates of a leaf module in program order. A gate
+  // depends on the previous gate on each of its qubits. Arguments and edges
+  // of gate g are in [begin[g], begin[g+1]) of the flat arrays.
+  struct msDag{
+    string name;
+    unsigned firstId; //id of gate 0, gate ids are unique in the module
+    int length; //length of the ASAP schedule
+    vector<int> type; //index in gate_name
+    vector<unsigned> argBegin;
+    vector<int> args; //qubits
+    vector<unsigned> inBegin;
+    vector<int> inEdges;
+    vector<unsigned> outBegin;
+    vector<int> outEdges;
+    vector<int> asap;
+    vector<int> alap;
+    vector<int> top; //gates without predecessors
+    vector<string> qubitNames;
+
+    msDag(): firstId(1), length(0) { }
+
+    unsigned size() const { return type.size(); }
+    unsigned numQubits() const { return qubitNames.size(); }
+
+    string text(int g) const {
+      string res = utostr(firstId + g) + ": " + gate_name[type[g]];
+      for(unsigned a = argBegin[g]; a < argBegin[g+1]; a++)
+        res += " " + qubitNames[args[a]];
+      return res;
+    }
+  };
+
+  // Configuration of one schedule, the options of one sched.pl run
+  struct msConfig{
+    enum Algo { SS, LPFS, RCP };
+    Algo algo;
+    unsigned k;
+    unsigned d;
+    unsigned l; //LPFS: regions allocated to longest paths
+    bool opp; //LPFS: opportunistic SIMD scheduling
+    bool refill; //LPFS: refill path regions
+    int wOp; //RCP weights
+    int wDist;
+    int wSlack;
+
+    msConfig(): algo(LPFS), k(4), d(1024), l(2), opp(false), refill(false), wOp(1), wDist(-1), wSlack(1) { }
+
+    //extension of the regress.sh output file
+    string tag() const {
+      if(algo == SS)
+        return "ss";
+      if(algo == RCP)
+        return "o" + itostr(wOp) + ".d" + itostr(wDist) + ".s" + itostr(wSlack) + ".rcp";
+      string res;
+      if(refill) res += "r";
+      if(opp) res += "s";
+      if(!res.empty()) res += ".";
+      return res + "l" + utostr(l) + ".lpfs";
+    }
+
+    string fileName(const string& prefix) const {
+      return prefix + ".simd." + utostr(k) + "." + utostr(d) + ".leaves." + tag();
+    }
+  };
+
+  // Move of a qubit between SIMD regions, region 0 is the memory
+  struct msMove{
+    int qubit;
+    unsigned src;
+    unsigned dst;
+    msMove(int q, unsigned s, unsigned t): qubit(q), src(s), dst(t) { }
+  };
+
+  // Ready gates, ordered by id, also kept per gate type
+  struct msReady{
+    set<int> all;
+    vector<set<int> > byType;
+
+    msReady(): byType(NUM_QGATES) { }
+
+    bool empty() const { return all.empty(); }
+
+    void insert(const msDag& dag, int g){
+      all.insert(g);
+      byType[dag.type[g]].insert(g);
+    }
+
+    void erase(const msDag& dag, int g){
+      all.erase(g);
+      byType[dag.type[g]].erase(g);
+    }
+
+    //removes up to limit gates of the type, lowest ids first
+    void extract(const msDag& dag, int type, unsigned limit, vector<int>& res){
+      res.clear();
+      set<int>& s = byType[type];
+      while(!s.empty() && res.size() < limit){
+        int g = *s.begin();
+        res.push_back(g);
+        erase(dag, g);
+      }
+    }
+  };
+
+  // One schedule of a leaf module. Gates are scheduled in timesteps on the k
+  // SIMD regions, a region runs gates of one type per timestep. After each
+  // timestep, qubits used by the next gates are moved into their regions and
+  // qubits left in regions that run other gates are moved to the memory.
+  class msScheduler{
+  public:
+    msScheduler(const msDag& g, const msConfig& c);
+
+    void run();
+    void print(raw_ostream& os, bool schedule) const;
+
+  private:
+    const msDag& dag;
+    const msConfig& cfg;
+
+    vector<int> ts; //timestep of each gate, -1 if not scheduled
+    vector<int> simd; //region of each gate
+    vector<char> followed; //LPFS: gate is scheduled or on a longest path
+    vector<int> dist; //LPFS: longest path ending in the gate
+    unsigned path; //LPFS: id of the next longest path
+    vector<vector<int> > steps; //gates of each region, k+1 entries per timestep
+    vector<unsigned> moveCounts; //moves after each timestep
+    vector<vector<msMove> > moveLists; //moves after each timestep, kept for printing
+
+    vector<unsigned> loc; //region of each qubit
+    vector<vector<int> > residents; //qubits in each region, has stale entries
+    vector<unsigned> qubitStamp; //timestep+1 the qubit was last looked at
+    vector<unsigned> qubitDst; //region the qubit is used in this timestep
+
+    unsigned opCnt; //scheduled gates and moves
+    unsigned moves;
+    unsigned mts; //timesteps with moves
+    unsigned len;
+    unsigned tgates; //timesteps with a T or Tdag gate
+    unsigned width; //regions used
+
+    vector<int>& gates(unsigned t, unsigned s) { return steps[t*(cfg.k+1)+s]; }
+    const vector<int>& gates(unsigned t, unsigned s) const { return steps[t*(cfg.k+1)+s]; }
+    void newStep(){ steps.resize(steps.size()+cfg.k+1); }
+
+    bool isReady(int g, int t) const;
+    bool parentsScheduled(int g) const;
+    void schedule(int g, unsigned t, unsigned s);
+    void updateMoves(unsigned t);
+    void addReadyChildren(unsigned t, msReady& ready);
+    void countTGates();
+
+    void ss();
+    void lpfs();
+    bool findLongestPath(const vector<int>& top, vector<int>& res);
+    void rcp();
+  };
+
+  msScheduler::msScheduler(const msDag& g, const msConfig& c):
+    dag(g), cfg(c), path(1), opCnt(0), moves(0), mts(0), len(0), tgates(0), width(0) {
+    ts.assign(dag.size(), -1);
+    simd.assign(dag.size(), -1);
+    loc.assign(dag.numQubits(), 0);
+    residents.resize(cfg.k+1);
+    qubitStamp.assign(dag.numQubits(), 0);
+    qubitDst.assign(dag.numQubits(), 0);
+  }
+
+  void msScheduler::run(){
+    if(cfg.algo == msConfig::SS)
+      ss();
+    else if(cfg.algo == msConfig::LPFS)
+      lpfs();
+    else
+      rcp();
+    countTGates();
+  }
+
+  //all predecessors finished before timestep t
+  bool msScheduler::isReady(int g, int t) const {
+    for(unsigned e = dag.inBegin[g]; e < dag.inBegin[g+1]; e++){
+      int p = dag.inEdges[e];
+      if(ts[p] == -1 || ts[p] >= t)
+        return false;
+    }
+    return true;
+  }
+
+  bool msScheduler::parentsScheduled(int g) const {
+    for(unsigned e = dag.inBegin[g]; e < dag.inBegin[g+1]; e++)
+      if(ts[dag.inEdges[e]] == -1)
+        return false;
+    return true;
+  }
+
+  void msScheduler::schedule(int g, unsigned t, unsigned s){
+    ts[g] = t;
+    simd[g] = s;
+    followed[g] = 1;
+    gates(t,s).push_back(g);
+    opCnt++;
+    if(s > width)
+      width = s;
+  }
+
+  //children of the gates of timestep t whose predecessors are all scheduled
+  void msScheduler::addReadyChildren(unsigned t, msReady& ready){
+    for(unsigned s = 1; s <= cfg.k; s++){
+      const vector<int>& gs = gates(t,s);
+      for(unsigned i = 0; i < gs.size(); i++){
+        int g = gs[i];
+        for(unsigned e = dag.outBegin[g]; e < dag.outBegin[g+1]; e++){
+          int c = dag.outEdges[e];
+          if(!followed[c] && parentsScheduled(c))
+            ready.insert(dag, c);
+        }
+      }
+    }
+  }
+
+  // Moves for timestep t, update_moves in sched.pl: qubits used in t are
+  // brought to their regions, qubits in regions that are active in t but
+  // not used are stored to memory, other qubits stay where they are.
+  void msScheduler::updateMoves(unsigned t){
+    unsigned k = cfg.k;
+    unsigned stamp = t+1;
+    vector<char> active(k+1, 0);
+    vector<int> candidates;
+
+    for(unsigned s = 1; s <= k; s++){
+      const vector<int>& gs = gates(t,s);
+      active[s] = !gs.empty();
+      for(unsigned i = 0; i < gs.size(); i++){
+        for(unsigned a = dag.argBegin[gs[i]]; a < dag.argBegin[gs[i]+1]; a++){
+          int q = dag.args[a];
+          if(qubitStamp[q] != stamp){
+            qubitStamp[q] = stamp;
+            candidates.push_back(q);
+          }
+          qubitDst[q] = s;
+        }
+      }
+    }
+
+    //qubits left in active regions go to memory
+    unsigned used = candidates.size();
+    for(unsigned s = 1; s <= k; s++){
+      if(!active[s])
+        continue;
+      for(unsigned i = 0; i < residents[s].size(); i++){
+        int q = residents[s][i];
+        if(loc[q] != s || qubitStamp[q] == stamp)
+          continue;
+        qubitStamp[q] = stamp;
+        qubitDst[q] = 0;
+        candidates.push_back(q);
+      }
+      residents[s].clear();
+    }
+
+    unsigned count = 0;
+    for(unsigned i = 0; i < candidates.size(); i++){
+      int q = candidates[i];
+      unsigned dst = i < used ? qubitDst[q] : 0;
+      if(loc[q] != dst){
+        if(PrintSchedule){
+          moveLists.resize(t+1);
+          moveLists[t].push_back(msMove(q, loc[q], dst));
+        }
+        count++;
+        loc[q] = dst;
+      }
+      if(dst != 0)
+        residents[dst].push_back(q);
+    }
+
+    moveCounts.push_back(count);
+    moves += count;
+    opCnt += count;
+    if(count > 0)
+      mts++;
+  }
+
+  void msScheduler::countTGates(){
+    for(unsigned t = 0; t < len; t++){
+      for(unsigned s = 1; s <= cfg.k; s++){
+        const vector<int>& gs = gates(t,s);
+        if(!gs.empty() && (dag.type[gs[0]] == _T || dag.type[gs[0]] == _Tdag)){
+          tgates++;
+          break;
+        }
+      }
+    }
+  }
+
+  // SS: gates in order of their ALAP timestep are put in the first timestep
+  // after their predecessors with a free region or a region running the same
+  // gate type with room left, like GenSIMDSchedule schedules leaf modules.
+  void msScheduler::ss(){
+    vector<pair<int,int> > order;
+    for(unsigned g = 0; g < dag.size(); g++)
+      order.push_back(make_pair(dag.alap[g], (int)g));
+    sort(order.begin(), order.end());
+    followed.assign(dag.size(), 0);
+
+    for(unsigned i = 0; i < order.size(); i++){
+      int g = order[i].second;
+      unsigned t = 0;
+      for(unsigned e = dag.inBegin[g]; e < dag.inBegin[g+1]; e++)
+        t = max(t, (unsigned)ts[dag.inEdges[e]] + 1);
+      for(bool done = false; !done; t++){
+        if(t >= len){
+          newStep();
+          len = t+1;
+        }
+        for(unsigned s = 1; s <= cfg.k && !done; s++){
+          vector<int>& gs = gates(t,s);
+          if(gs.empty() || (gs.size() < cfg.d && dag.type[gs[0]] == dag.type[g])){
+            schedule(g, t, s);
+            done = true;
+          }
+        }
+      }
+    }
+
+    for(unsigned t = 0; t < len; t++)
+      updateMoves(t);
+  }
+
+  // Finds the longest path of gates not followed yet, starting from the
+  // lowest id in top, and marks it followed. find_lp in sched.pl.
+  bool msScheduler::findLongestPath(const vector<int>& top, vector<int>& res){
+    res.clear();
+    if(top.empty())
+      return false;
+    int first = *min_element(top.begin(), top.end());
+    int best = -1;
+    for(unsigned g = 0; g < dag.size(); g++)
+      if(!followed[g])
+        dist[g] = 1;
+    for(unsigned g = first; g < dag.size(); g++){
+      if(followed[g]){
+        dist[g] = 0;
+        continue;
+      }
+      for(unsigned e = dag.outBegin[g]; e < dag.outBegin[g+1]; e++){
+        int c = dag.outEdges[e];
+        dist[c] = max(dist[c], dist[g]+1);
+      }
+      if(best == -1 || dist[g] > dist[best])
+        best = g;
+    }
+    if(best == -1)
+      return false;
+
+    //walk back along predecessors one shorter
+    res.push_back(best);
+    for(int g = best; dist[g] > 1; ){
+      int d = dist[g]-1;
+      int pred = -1;
+      for(unsigned e = dag.inBegin[g]; e < dag.inBegin[g+1] && pred == -1; e++){
+        int p = dag.inEdges[e];
+        if(!followed[p] && dist[p] == d)
+          pred = p;
+      }
+      followed[g] = 1;
+      dist[g] = 0;
+      assert(pred != -1 && "Longest path predecessor not found");
+      res.push_back(pred);
+      g = pred;
+    }
+    followed[res.back()] = 1;
+    dist[res.back()] = 0;
+    reverse(res.begin(), res.end());
+    path++;
+    return true;
+  }
+
+  // LPFS: the l first regions follow the longest paths of the DAG, the other
+  // regions take the ready gates with the lowest ids. With opp, regions also
+  // take ready gates of the type they run, with refill, a path region that is
+  // done follows the longest path from the ready gates.
+  void msScheduler::lpfs(){
+    unsigned k = cfg.k;
+    unsigned l = cfg.l;
+    followed.assign(dag.size(), 0);
+    dist.assign(dag.size(), 0);
+
+    vector<vector<int> > paths(l+1);
+    vector<unsigned> pathPos(l+1, 0);
+    bool pathsearch = true;
+    for(unsigned s = 1; pathsearch && s <= l; s++)
+      pathsearch = findLongestPath(dag.top, paths[s]);
+
+    msReady ready;
+    for(unsigned i = 0; i < dag.top.size(); i++)
+      if(!followed[dag.top[i]])
+        ready.insert(dag, dag.top[i]);
+
+    unsigned scheduled = 0;
+    vector<int> batch;
+    unsigned t = 0;
+    while(!ready.empty() || scheduled < dag.size()){
+      if(t > dag.size()){
+        errs() << "E: LPFS timestep " << t << " > op count " << dag.size() << ". Aborting.\n";
+        break;
+      }
+      newStep();
+
+      //assigned paths
+      for(unsigned s = 1; s <= l; s++){
+        if(pathsearch && cfg.refill && pathPos[s] == paths[s].size()){
+          vector<int> top(ready.all.begin(), ready.all.end());
+          pathsearch = findLongestPath(top, paths[s]);
+          pathPos[s] = 0;
+          for(unsigned i = 0; i < paths[s].size(); i++)
+            ready.erase(dag, paths[s][i]);
+        }
+        if(pathPos[s] == paths[s].size())
+          continue;
+        int g = paths[s][pathPos[s]];
+        if(!isReady(g, t))
+          continue;
+        schedule(g, t, s);
+        pathPos[s]++;
+        scheduled++;
+        if(cfg.opp){
+          ready.extract(dag, dag.type[g], cfg.d, batch);
+          for(unsigned i = 0; i < batch.size(); i++)
+            schedule(batch[i], t, s);
+          scheduled += batch.size();
+        }
+      }
+
+      //remaining ready gates
+      for(unsigned s = l+1; s <= k && !ready.empty(); s++){
+        int g = *ready.all.begin();
+        if(cfg.opp){
+          ready.extract(dag, dag.type[g], cfg.d, batch);
+          for(unsigned i = 0; i < batch.size(); i++)
+            schedule(batch[i], t, s);
+          scheduled += batch.size();
+        }
+        else{
+          ready.erase(dag, g);
+          schedule(g, t, s);
+          scheduled++;
+        }
+      }
+
+      updateMoves(t);
+      addReadyChildren(t, ready);
+      t++;
+    }
+    if(scheduled != dag.size())
+      errs() << "E: ops mis-scheduled (" << scheduled << " out of " << dag.size() << ")\n";
+    len = t;
+  }
+
+  // RCP: every timestep, the regions in turn take the gate type with the
+  // highest weight among the ready gates. A gate weighs w_op + w_slack *
+  // slack, plus w_dist if all its qubits are in the region already.
+  void msScheduler::rcp(){
+    unsigned k = cfg.k;
+    followed.assign(dag.size(), 0);
+
+    msReady ready;
+    for(unsigned i = 0; i < dag.top.size(); i++)
+      ready.insert(dag, dag.top[i]);
+
+    vector<long long> base(NUM_QGATES);
+    vector<long long> home((k+1)*NUM_QGATES);
+    vector<char> freeSimd(k+1);
+    vector<int> batch;
+    unsigned scheduled = 0;
+    unsigned t = 0;
+    while(!ready.empty() && scheduled < dag.size()){
+      if(t > dag.size()){
+        errs() << "E: RCP timestep " << t << " > op count " << dag.size() << ". Aborting.\n";
+        break;
+      }
+      newStep();
+
+      //weights of the ready gates, qubits do not move within a timestep
+      fill(base.begin(), base.end(), 0);
+      fill(home.begin(), home.end(), 0);
+      for(set<int>::iterator it = ready.all.begin(); it != ready.all.end(); ++it){
+        int g = *it;
+        base[dag.type[g]] += cfg.wOp + (long long)cfg.wSlack * (dag.alap[g] - dag.asap[g]);
+        unsigned s = loc[dag.args[dag.argBegin[g]]];
+        for(unsigned a = dag.argBegin[g]+1; a < dag.argBegin[g+1]; a++)
+          if(loc[dag.args[a]] != s)
+            s = 0;
+        if(s != 0)
+          home[s*NUM_QGATES + dag.type[g]]++;
+      }
+
+      fill(freeSimd.begin(), freeSimd.end(), 1);
+      for(unsigned n = 0; n < k && !ready.empty(); n++){
+        //region and gate type with the highest weight, lowest region first
+        unsigned bestSimd = 0;
+        int bestType = -1;
+        long long bestWeight = 0;
+        for(unsigned s = 1; s <= k; s++){
+          if(!freeSimd[s])
+            continue;
+          for(int type = 0; type < NUM_QGATES; type++){
+            if(ready.byType[type].empty())
+              continue;
+            long long w = base[type] + cfg.wDist * home[s*NUM_QGATES + type];
+            if(bestType == -1 || w > bestWeight){
+              bestSimd = s;
+              bestType = type;
+              bestWeight = w;
+            }
+          }
+        }
+
+        //as many gates of the type as fit in the region
+        int g = *ready.byType[bestType].begin();
+        unsigned size = dag.argBegin[g+1] - dag.argBegin[g];
+        unsigned limit = 1;
+        while((unsigned long long)size * (limit+1) < cfg.d)
+          limit++;
+        ready.extract(dag, bestType, limit, batch);
+        for(unsigned i = 0; i < batch.size(); i++){
+          g = batch[i];
+          base[bestType] -= cfg.wOp + (long long)cfg.wSlack * (dag.alap[g] - dag.asap[g]);
+          unsigned s = loc[dag.args[dag.argBegin[g]]];
+          for(unsigned a = dag.argBegin[g]+1; a < dag.argBegin[g+1]; a++)
+            if(loc[dag.args[a]] != s)
+              s = 0;
+          if(s != 0)
+            home[s*NUM_QGATES + bestType]--;
+          schedule(g, t, bestSimd);
+        }
+        scheduled += batch.size();
+        freeSimd[bestSimd] = 0;
+      }
+
+      updateMoves(t);
+      addReadyChildren(t, ready);
+      t++;
+    }
+    len = t;
+    width = k;
+  }
+
+  void msScheduler::print(raw_ostream& os, bool schedule) const {
+    const char* names[] = { "ss", "lpfs", "rcp" };
+    const char* titles[] = { "SS:", "LPFS:", "RCP:" };
+    os << titles[cfg.algo] << "\n";
+
+    string msg = "Function: " + dag.name + " (sched: " + names[cfg.algo]
+      + ", op_cnt: " + utostr(opCnt) + ", k: " + utostr(cfg.k) + ", d: " + utostr(cfg.d);
+    if(cfg.algo == msConfig::LPFS)
+      msg += ", l: " + utostr(cfg.l) + ", opp: " + utostr(cfg.opp) + ", refill: " + utostr(cfg.refill);
+    if(cfg.algo == msConfig::RCP)
+      msg += ", w_op: " + itostr(cfg.wOp) + ", w_dist: " + itostr(cfg.wDist) + ", w_slack: " + itostr(cfg.wSlack);
+    msg += ")";
+    os << msg << "\n" << string(msg.size(), '=') << "\n";
+
+    //metrics
+    unsigned k = cfg.k;
+    double t1 = dag.size() * 2.0;
+    double tk = len + 4.0*mts;
+    double wk = opCnt;
+    double ck = 100.0 * moves / opCnt;
+    unsigned peak = 0;
+    for(unsigned t = 0; t < moveCounts.size(); t++)
+      peak = max(peak, moveCounts[t]);
+    os << "ops = " << opCnt - moves << "\n";
+    os << "moves = " << moves << "\n";
+    os << "total = " << opCnt << "\n";
+    os << "ots = " << len << "\n";
+    os << "mts = " << mts << "\n";
+    os << "ts = " << perlNum(tk) << "\n";
+    os << "SIMDs = " << width << "\n";
+    os << "tgates = " << tgates << "\n";
+    os << "T(1) = " << perlNum(t1) << "\n";
+    os << "T(inf) = " << dag.length << "\n";
+    os << "T(" << k << "," << cfg.d << ") = " << perlNum(tk) << "\n";
+    os << "Speedup = " << perlNum(t1 / tk) << "\n";
+    os << "Efficiency = " << perlNum(t1 / (k * tk)) << "\n";
+    os << "Utility = " << perlNum(wk / (k * tk)) << "\n";
+    os << "Quality = " << perlNum(t1*t1*t1 / (k * tk*tk * wk)) << "\n";
+    os << "Overhead = " << perlNum(ck) << "% (reduction: " << perlNum(200.0/3 - ck) << ")\n";
+    os << "Avg load = " << (mts ? perlNum((double)moves / mts) : string("inf")) << "\n";
+    os << "Peak load = " << peak << "\n";
+    os << "mlist =";
+    for(unsigned t = 0; t < moveCounts.size(); t++)
+      os << " " << moveCounts[t];
+    os << "\n\n";
+
+    if(!schedule)
+      return;
+
+    //gates and moves of each timestep and region, sorted by text
+    for(unsigned t = 0; t < len; t++){
+      vector<string> texts;
+      if(t < moveLists.size()){
+        for(unsigned i = 0; i < moveLists[t].size(); i++){
+          const msMove& m = moveLists[t][i];
+          texts.push_back("MOV " + utostr(m.dst) + " " + utostr(m.src) + " " + dag.qubitNames[m.qubit]);
+        }
+      }
+      sort(texts.begin(), texts.end());
+      for(unsigned i = 0; i < texts.size(); i++)
+        os << t << ",0 " << texts[i] << "\n";
+      for(unsigned s = 1; s <= k; s++){
+        const vector<int>& gs = gates(t,s);
+        texts.clear();
+        for(unsigned i = 0; i < gs.size(); i++)
+          texts.push_back(dag.text(gs[i]));
+        sort(texts.begin(), texts.end());
+        for(unsigned i = 0; i < texts.size(); i++)
+          os << t << "," << s << " " << texts[i] << "\n";
+      }
+    }
+    os << "\n";
+  }
+
+  // Configurations to schedule over the DAGs of all leaf modules, the
+  // schedules of configuration i are printed to results[i]
+  struct msJobs {
+    const vector<msDag*> &dags;
+    const vector<msConfig> &configs;
+    vector<string> &results;
+
+    msJobs(const vector<msDag*> &d, const vector<msConfig> &c, vector<string> &r)
+      : dags(d), configs(c), results(r) {}
+
+    static void run(void *arg, unsigned i){
+      msJobs *jobs = static_cast<msJobs*>(arg);
+      raw_string_ostream os(jobs->results[i]);
+      for(unsigned j = 0; j < jobs->dags.size(); j++){
+        msScheduler sched(*jobs->dags[j], jobs->configs[i]);
+        sched.run();
+        sched.print(os, PrintSchedule);
+      }
+      os.flush();
+    }
+  };
+
+  struct GenMultiSIMDSched : public ModulePass {
+    static char ID; // Pass identification
+
+    GenMultiSIMDSched() : ModulePass(ID) {}
+
+    int gateType(Function* CF);
+    bool backtraceQbit(Value* opd, Value*& reg, int& index);
+    bool buildDag(Function* F, msDag& dag);
+    void getConfigs(vector<msConfig>& configs);
+
+    bool runOnModule (Module &M);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.setPreservesAll();
+      AU.addRequired<CallGraph>();
+    }
+  }; // End of struct GenMultiSIMDSched
+} // End of anonymous namespace
+
+
+
+char GenMultiSIMDSched::ID = 0;
+static RegisterPass<GenMultiSIMDSched> X("MultiSIMDSchedule", "Generate communication-aware Multi-SIMD schedules of leaf modules");
+
+//index in gate_name of a leaf gate, -1 for other functions
+int GenMultiSIMDSched::gateType(Function* CF){
+  if(!CF->isIntrinsic())
+    return -1;
+  string fname = CF->getName();
+  if(fname.find("llvm.") == 0)
+    fname = fname.substr(5);
+  for(int i = 0; i < NUM_QGATES; i++)
+    if(fname == gate_name[i])
+      return i;
+  return -1;
+}
+
+//finds the qbit array or argument of a qbit operand, and the index used.
+//As in GenSIMDSchedule, the last index of the outermost getelementptr is
+//the qubit index, -1 if it is not a constant.
+bool GenMultiSIMDSched::backtraceQbit(Value* opd, Value*& reg, int& index){
+  bool indexed = false;
+  for(int btCount = 0; btCount <= MAX_BT_COUNT; btCount++){
+    if(isa<Argument>(opd)){
+      reg = opd;
+      return true;
+    }
+    if(AllocaInst *AI = dyn_cast<AllocaInst>(opd)){
+      if(!AI->getAllocatedType()->isPointerTy()){
+        reg = opd;
+        return true;
+      }
+      //qbit* argument saved in a local, follow the store
+      StoreInst* SI = NULL;
+      for(Value::use_iterator UI = AI->use_begin(), UE = AI->use_end(); UI != UE && !SI; ++UI)
+        SI = dyn_cast<StoreInst>(*UI);
+      if(!SI)
+        return false;
+      opd = SI->getValueOperand();
+    }
+    else if(GetElementPtrInst *GEPI = dyn_cast<GetElementPtrInst>(opd)){
+      if(!indexed){
+        ConstantInt *CI = dyn_cast<ConstantInt>(GEPI->getOperand(GEPI->getNumOperands()-1));
+        index = CI ? (int)CI->getZExtValue() : -1;
+        indexed = true;
+      }
+      opd = GEPI->getPointerOperand();
+    }
+    else if(LoadInst *LI = dyn_cast<LoadInst>(opd))
+      opd = LI->getPointerOperand();
+    else if(CastInst *CI = dyn_cast<CastInst>(opd))
+      opd = CI->getOperand(0);
+    else
+      return false;
+  }
+  return false;
+}
+
+//builds the DAG of F, false if F is not a leaf module or has no gates
+bool GenMultiSIMDSched::buildDag(Function* F, msDag& dag){
+  map<pair<Value*,int>, int> qubitIds;
+  vector<int> last; //last gate on each qubit
+
+  dag.name = F->getName();
+  dag.argBegin.push_back(0);
+  dag.inBegin.push_back(0);
+
+  for (inst_iterator I = inst_begin(*F), E = inst_end(*F); I != E; ++I) {
+    CallInst *CI = dyn_cast<CallInst>(&*I);
+    if(!CI || !CI->getCalledFunction())
+      continue;
+
+    vector<int> gateArgs;
+    for(unsigned iop=0;iop<CI->getNumArgOperands();iop++){
+      Value* opd = CI->getArgOperand(iop);
+      Type* argType = opd->getType();
+      bool isPtr = argType->isPointerTy();
+      if(isPtr)
+        argType = argType->getPointerElementType();
+      if(!argType->isIntegerTy(16)) //not a qbit
+        continue;
+
+      Value* reg = NULL;
+      int index = isPtr ? -1 : 0;
+      if(!backtraceQbit(opd, reg, index)){
+        if(debugMultiSIMDSched)
+          errs() << "WARNING: qbit operand of " << CI->getCalledFunction()->getName()
+                 << " in " << F->getName() << " not found\n";
+        return false;
+      }
+
+      pair<Value*,int> key(reg, index);
+      map<pair<Value*,int>, int>::iterator qit = qubitIds.find(key);
+      int q;
+      if(qit == qubitIds.end()){
+        q = dag.qubitNames.size();
+        qubitIds[key] = q;
+        string name = reg->getName();
+        if(index != -1)
+          name += utostr(index);
+        dag.qubitNames.push_back(name);
+        last.push_back(-1);
+      }
+      else
+        q = (*qit).second;
+      gateArgs.push_back(q);
+    }
+
+    if(gateArgs.empty()) //classical call
+      continue;
+
+    int type = gateType(CI->getCalledFunction());
+    if(type == -1) //calls a module or a non-leaf gate
+      return false;
+
+    int g = dag.type.size();
+    int asap = 0;
+    dag.type.push_back(type);
+    for(unsigned i = 0; i < gateArgs.size(); i++){
+      int q = gateArgs[i];
+      int p = last[q];
+      dag.args.push_back(q);
+      if(p != -1 && p != g && find(dag.inEdges.begin()+dag.inBegin[g], dag.inEdges.end(), p) == dag.inEdges.end()){
+        dag.inEdges.push_back(p);
+        asap = max(asap, dag.asap[p]+1);
+      }
+      last[q] = g;
+    }
+    dag.argBegin.push_back(dag.args.size());
+    dag.inBegin.push_back(dag.inEdges.size());
+    dag.asap.push_back(asap);
+    if(dag.inBegin[g] == dag.inBegin[g+1])
+      dag.top.push_back(g);
+    dag.length = max(dag.length, asap+1);
+  }
+
+  unsigned n = dag.size();
+  if(n == 0)
+    return false;
+
+  //successors, in increasing order
+  dag.outBegin.assign(n+1, 0);
+  for(unsigned e = 0; e < dag.inEdges.size(); e++)
+    dag.outBegin[dag.inEdges[e]+1]++;
+  for(unsigned g = 0; g < n; g++)
+    dag.outBegin[g+1] += dag.outBegin[g];
+  dag.outEdges.resize(dag.inEdges.size());
+  vector<unsigned> pos(dag.outBegin.begin(), dag.outBegin.end()-1);
+  for(unsigned g = 0; g < n; g++)
+    for(unsigned e = dag.inBegin[g]; e < dag.inBegin[g+1]; e++)
+      dag.outEdges[pos[dag.inEdges[e]]++] = g;
+
+  //ALAP timesteps within the ASAP length
+  dag.alap.resize(n);
+  for(unsigned g = n; g-- > 0; ){
+    int t = dag.length-1;
+    for(unsigned e = dag.outBegin[g]; e < dag.outBegin[g+1]; e++)
+      t = min(t, dag.alap[dag.outEdges[e]]-1);
+    dag.alap[g] = t;
+  }
+  return true;
+}
+
+//all combinations of the option values
+void GenMultiSIMDSched::getConfigs(vector<msConfig>& configs){
+  msConfig def;
+  vector<unsigned> ks(SimdK.begin(), SimdK.end());
+  vector<unsigned> ds(SimdD.begin(), SimdD.end());
+  vector<string> names(SchedNames.begin(), SchedNames.end());
+  vector<unsigned> ls(SimdL.begin(), SimdL.end());
+  vector<bool> opps(LpfsOpp.begin(), LpfsOpp.end());
+  vector<bool> refills(LpfsRefill.begin(), LpfsRefill.end());
+  vector<int> wOps(RcpOp.begin(), RcpOp.end());
+  vector<int> wDists(RcpDist.begin(), RcpDist.end());
+  vector<int> wSlacks(RcpSlack.begin(), RcpSlack.end());
+  if(ks.empty()) ks.push_back(def.k);
+  if(ds.empty()) ds.push_back(def.d);
+  if(names.empty()) names.push_back("lpfs");
+  if(ls.empty()) ls.push_back(def.l);
+  if(opps.empty()) opps.push_back(def.opp);
+  if(refills.empty()) refills.push_back(def.refill);
+  if(wOps.empty()) wOps.push_back(def.wOp);
+  if(wDists.empty()) wDists.push_back(def.wDist);
+  if(wSlacks.empty()) wSlacks.push_back(def.wSlack);
+
+  set<string> seen;
+  for(unsigned ki = 0; ki < ks.size(); ki++){
+    for(unsigned di = 0; di < ds.size(); di++){
+      msConfig cfg;
+      cfg.k = ks[ki] > 0 ? ks[ki] : 1;
+      cfg.d = ds[di];
+      vector<msConfig> tmp;
+      for(unsigned ni = 0; ni < names.size(); ni++){
+        if(names[ni] == "ss"){
+          cfg.algo = msConfig::SS;
+          tmp.push_back(cfg);
+        }
+        else if(names[ni] == "lpfs"){
+          cfg.algo = msConfig::LPFS;
+          for(unsigned li = 0; li < ls.size(); li++)
+            for(unsigned oi = 0; oi < opps.size(); oi++)
+              for(unsigned ri = 0; ri < refills.size(); ri++){
+                //half the regions, rounded down, if l is not less than k
+                cfg.l = ls[li] < cfg.k ? ls[li] : cfg.k >> 1;
+                cfg.opp = opps[oi];
+                cfg.refill = refills[ri];
+                tmp.push_back(cfg);
+              }
+        }
+        else if(names[ni] == "rcp"){
+          cfg.algo = msConfig::RCP;
+          for(unsigned oi = 0; oi < wOps.size(); oi++)
+            for(unsigned di2 = 0; di2 < wDists.size(); di2++)
+              for(unsigned si = 0; si < wSlacks.size(); si++){
+                cfg.wOp = wOps[oi];
+                cfg.wDist = wDists[di2];
+                cfg.wSlack = wSlacks[si];
+                tmp.push_back(cfg);
+              }
+        }
+        else
+          errs() << "WARNING: Unknown scheduler " << names[ni] << "\n";
+      }
+      for(unsigned i = 0; i < tmp.size(); i++)
+        if(seen.insert(tmp[i].fileName("")).second)
+          configs.push_back(tmp[i]);
+    }
+  }
+}
+
+bool GenMultiSIMDSched::runOnModule (Module &M) {
+  vector<msConfig> configs;
+  getConfigs(configs);
+
+  // build the DAGs of the leaf modules, in the order GenSIMDSchedule prints them
+  vector<msDag*> dags;
+  unsigned nextId = 1;
+  CallGraphNode* rootNode = getAnalysis<CallGraph>().getRoot();
+
+  //Post-order
+  for (scc_iterator<CallGraphNode*> sccIb = scc_begin(rootNode), E = scc_end(rootNode); sccIb != E; ++sccIb) {
+    const std::vector<CallGraphNode*> &nextSCC = *sccIb;
+    for (std::vector<CallGraphNode*>::const_iterator nsccI = nextSCC.begin(), E = nextSCC.end(); nsccI != E; ++nsccI) {
+      Function *F = (*nsccI)->getFunction();
+      if(F && !F->isDeclaration()){
+        msDag* dag = new msDag;
+        dag->firstId = nextId;
+        if(buildDag(F, *dag)){
+          nextId += dag->size();
+          dags.push_back(dag);
+        }
+        else
+          delete dag;
+      }
+    }
+  }
+
+  if(debugMultiSIMDSched)
+    errs() << dags.size() << " leaf modules, " << configs.size() << " configurations\n";
+
+  vector<string> results(configs.size());
+  msJobs jobs(dags, configs, results);
+  scaffoldParallelFor(configs.size(), SchedThreads, msJobs::run, &jobs);
+
+  for(unsigned i = 0; i < configs.size(); i++){
+    if(SchedOutput.empty()){
+      scaffoldOut() << "#Schedule " << configs[i].fileName("").substr(1) << "\n";
+      scaffoldOut() << results[i];
+      continue;
+    }
+    string fname = configs[i].fileName(SchedOutput);
+    string ErrorInfo;
+    raw_fd_ostream out(fname.c_str(), ErrorInfo);
+    if(!ErrorInfo.empty()){
+      errs() << "ERROR: " << ErrorInfo << "\n";
+      continue;
+    }
+    out << results[i];
+  }
+
+  for(unsigned i = 0; i < dags.size(); i++)
+    delete dags[i];
+
+  return false;
+} // End runOnModule
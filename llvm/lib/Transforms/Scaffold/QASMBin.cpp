@@ -0,0 +1,504 @@
+//===---------------------------- QASMBin.cpp ----------------------------===//
+// This file implements the binary flat QASM writer and reader, see
+// QASMBin.h.
+//
+//        This file was created by Scaffold Compiler Working Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "QASMBin.h"
+
+#define QASMBIN_VERSION 1
+#define QASMBIN_HEADER 16
+#define QASMBIN_TRAILER 72
+#define QASMBIN_WIDE 0x80 //opcode flag of a record with u32 operands
+
+static const char headerMagic[8] = {'S','C','Q','A','S','M','B','1'};
+static const char trailerMagic[8] = {'S','C','Q','A','S','M','E','1'};
+
+static const char* opNames[QB_NUM_OPS] = {
+  "qubit", "cbit",
+  "H", "X", "Y", "Z", "S", "T", "Tdag", "Sdag",
+  "CNOT", "Tof", "Fredkin",
+  "PrepX", "PrepZ", "MeasX", "MeasZ",
+  "Rz", "Rx", "Ry",
+  ""
+};
+
+static const unsigned opArgs[QB_NUM_OPS] = {
+  1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1,
+  2, 3, 3,
+  1, 1, 1, 1,
+  2, 2, 2,
+  1
+};
+
+const char* qasmBinOpName(unsigned op){
+  return op < QB_NUM_OPS ? opNames[op] : "";
+}
+
+unsigned qasmBinOpArgs(unsigned op){
+  return op < QB_NUM_OPS ? opArgs[op] : 0;
+}
+
+bool qasmBinIsRotation(unsigned op){
+  return op == QB_RZ || op == QB_RX || op == QB_RY;
+}
+
+void qasmBinFileSink::write(const char* data, size_t size){
+  fwrite(data, 1, size, f);
+}
+
+static uint32_t hashBytes(const char* s, size_t len, bool text){
+  uint32_t h = text ? 2166136261u ^ 0xff : 2166136261u;
+  for(size_t i = 0; i < len; i++){
+    h ^= (unsigned char)s[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static uint64_t doubleBits(double d){
+  uint64_t b;
+  memcpy(&b, &d, sizeof(b));
+  return b;
+}
+
+static uint16_t getU16(const unsigned char* p){ return p[0] | (p[1] << 8); }
+static uint32_t getU32(const unsigned char* p){
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static uint64_t getU64(const unsigned char* p){
+  return (uint64_t)getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+}
+
+//===----------------------------------------------------------------------===//
+// Writer
+
+qasmBinWriter::qasmBinWriter(qasmBinSink &sink)
+  : out(sink), offset(0), records(0), flags(0), symbolTable(1024, 0), angleTable(64, 0), used(0)
+{
+  put(headerMagic, 8);
+  putU32(QASMBIN_VERSION);
+  putU32(QASMBIN_CHUNK_RECORDS);
+}
+
+void qasmBinWriter::flush(){
+  out.write(buf, used);
+  used = 0;
+}
+
+void qasmBinWriter::put(const void* data, size_t size){
+  offset += size;
+  if(used + size > sizeof(buf)){
+    flush();
+    if(size > sizeof(buf)){
+      out.write((const char*)data, size);
+      return;
+    }
+  }
+  memcpy(buf + used, data, size);
+  used += size;
+}
+
+void qasmBinWriter::putU16(uint16_t v){
+  unsigned char b[2] = { (unsigned char)v, (unsigned char)(v >> 8) };
+  put(b, 2);
+}
+
+void qasmBinWriter::putU32(uint32_t v){
+  unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8),
+                         (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+  put(b, 4);
+}
+
+void qasmBinWriter::putU64(uint64_t v){
+  putU32((uint32_t)v);
+  putU32((uint32_t)(v >> 32));
+}
+
+void qasmBinWriter::growSymbols(){
+  std::vector<uint32_t> table(symbolTable.size() * 2, 0);
+  size_t mask = table.size() - 1;
+  for(uint32_t id = 0; id < symbolNames.size(); id++){
+    const std::string& s = symbolNames[id];
+    size_t i = hashBytes(s.data(), s.size(), symbolKinds[id] == QB_SYM_TEXT) & mask;
+    while(table[i])
+      i = (i + 1) & mask;
+    table[i] = id + 1;
+  }
+  symbolTable.swap(table);
+}
+
+uint32_t qasmBinWriter::symbol(const char* name, size_t len, qasmBinSymbolKind kind){
+  // text lines and names are kept apart, a line may look like a name
+  bool text = kind == QB_SYM_TEXT;
+  size_t mask = symbolTable.size() - 1;
+  size_t i = hashBytes(name, len, text) & mask;
+  while(uint32_t e = symbolTable[i]){
+    uint32_t id = e - 1;
+    const std::string& s = symbolNames[id];
+    if((symbolKinds[id] == QB_SYM_TEXT) == text && s.size() == len && memcmp(s.data(), name, len) == 0){
+      if(symbolKinds[id] == QB_SYM_NAME)
+        symbolKinds[id] = kind; //declared after it was used
+      return id;
+    }
+    i = (i + 1) & mask;
+  }
+  uint32_t id = symbolNames.size();
+  symbolNames.push_back(std::string(name, len));
+  symbolKinds.push_back(kind);
+  symbolTable[i] = id + 1;
+  if(symbolNames.size() * 2 > symbolTable.size())
+    growSymbols();
+  return id;
+}
+
+void qasmBinWriter::growAngles(){
+  std::vector<uint32_t> table(angleTable.size() * 2, 0);
+  size_t mask = table.size() - 1;
+  for(uint32_t id = 0; id < angleValues.size(); id++){
+    uint64_t b = doubleBits(angleValues[id]);
+    size_t i = (size_t)((b ^ (b >> 29)) * 0x9e3779b97f4a7c15ULL >> 32) & mask;
+    while(table[i])
+      i = (i + 1) & mask;
+    table[i] = id + 1;
+  }
+  angleTable.swap(table);
+}
+
+uint32_t qasmBinWriter::angle(double a){
+  uint64_t b = doubleBits(a);
+  size_t mask = angleTable.size() - 1;
+  size_t i = (size_t)((b ^ (b >> 29)) * 0x9e3779b97f4a7c15ULL >> 32) & mask;
+  while(uint32_t e = angleTable[i]){
+    if(doubleBits(angleValues[e - 1]) == b)
+      return e - 1;
+    i = (i + 1) & mask;
+  }
+  uint32_t id = angleValues.size();
+  angleValues.push_back(a);
+  angleTable[i] = id + 1;
+  if(angleValues.size() * 2 > angleTable.size())
+    growAngles();
+  return id;
+}
+
+void qasmBinWriter::gate(unsigned op, const uint32_t* args, unsigned nargs){
+  if(records % QASMBIN_CHUNK_RECORDS == 0){
+    chunks.push_back(offset);
+    chunks.push_back(records);
+  }
+  records++;
+
+  bool wide = false;
+  for(unsigned i = 0; i < nargs; i++)
+    wide |= args[i] > 0xffff;
+
+  unsigned char r[13];
+  size_t n = 1;
+  r[0] = wide ? op | QASMBIN_WIDE : op;
+  for(unsigned i = 0; i < nargs && i < 3; i++){
+    r[n++] = (unsigned char)args[i];
+    r[n++] = (unsigned char)(args[i] >> 8);
+    if(wide){
+      r[n++] = (unsigned char)(args[i] >> 16);
+      r[n++] = (unsigned char)(args[i] >> 24);
+    }
+  }
+  put(r, n);
+}
+
+void qasmBinWriter::line(const char* text, size_t len){
+  // declarations
+  if(len > 6 && memcmp(text, "qubit ", 6) == 0 && !memchr(text + 6, ' ', len - 6)){
+    uint32_t s = symbol(text + 6, len - 6, QB_SYM_QUBIT);
+    gate(QB_QUBIT, &s, 1);
+    return;
+  }
+  if(len > 5 && memcmp(text, "cbit ", 5) == 0 && !memchr(text + 5, ' ', len - 5)){
+    uint32_t s = symbol(text + 5, len - 5, QB_SYM_CBIT);
+    gate(QB_CBIT, &s, 1);
+    return;
+  }
+
+  // gates: name, one space, operands separated by commas
+  const char* sp = (const char*)memchr(text, ' ', len);
+  unsigned op = QB_NUM_OPS;
+  if(sp){
+    size_t n = sp - text;
+    for(unsigned o = QB_H; o < QB_TEXT; o++)
+      if(strlen(opNames[o]) == n && memcmp(opNames[o], text, n) == 0){
+        op = o;
+        break;
+      }
+  }
+  if(op != QB_NUM_OPS){
+    const char* p = sp + 1;
+    const char* end = text + len;
+    const char* field[3];
+    size_t flen[3];
+    unsigned nf = 0;
+    bool ok = true;
+    while(ok){
+      const char* c = (const char*)memchr(p, ',', end - p);
+      const char* e = c ? c : end;
+      if(nf == 3 || e == p)
+        ok = false;
+      else{
+        field[nf] = p;
+        flen[nf] = e - p;
+        nf++;
+      }
+      if(!c)
+        break;
+      p = c + 1;
+    }
+    ok = ok && nf == opArgs[op];
+
+    uint32_t args[3];
+    if(ok && qasmBinIsRotation(op)){
+      // the angle has to print back the same, the way flat QASM prints it
+      char num[64], back[512];
+      if(flen[1] < sizeof(num)){
+        memcpy(num, field[1], flen[1]);
+        num[flen[1]] = 0;
+        double a = strtod(num, NULL);
+        int n = snprintf(back, sizeof(back), "%f", a);
+        if(n >= 0 && (size_t)n == flen[1] && memcmp(back, num, n) == 0)
+          args[1] = angle(a);
+        else
+          ok = false;
+      }
+      else
+        ok = false;
+      nf = 1;
+    }
+    if(ok){
+      for(unsigned i = 0; i < nf; i++)
+        args[i] = symbol(field[i], flen[i], QB_SYM_NAME);
+      gate(op, args, opArgs[op]);
+      return;
+    }
+  }
+
+  uint32_t s = symbol(text, len, QB_SYM_TEXT);
+  gate(QB_TEXT, &s, 1);
+}
+
+void qasmBinWriter::finish(){
+  uint64_t symbolsOffset = offset;
+  for(uint32_t id = 0; id < symbolNames.size(); id++){
+    unsigned char k = symbolKinds[id];
+    put(&k, 1);
+    putU32(symbolNames[id].size());
+    put(symbolNames[id].data(), symbolNames[id].size());
+  }
+  while(offset % 8)
+    put("", 1);
+
+  uint64_t anglesOffset = offset;
+  for(uint32_t id = 0; id < angleValues.size(); id++)
+    putU64(doubleBits(angleValues[id]));
+
+  uint64_t chunksOffset = offset;
+  for(size_t i = 0; i < chunks.size(); i++)
+    putU64(chunks[i]);
+
+  putU64(records);
+  putU64(symbolsOffset);
+  putU64(symbolNames.size());
+  putU64(anglesOffset);
+  putU64(angleValues.size());
+  putU64(chunksOffset);
+  putU64(chunks.size() / 2);
+  putU64(flags);
+  put(trailerMagic, 8);
+  flush();
+}
+
+//===----------------------------------------------------------------------===//
+// Reader
+
+bool qasmBinReader::open(const char* path, std::string& err){
+  close();
+  int fd = ::open(path, O_RDONLY);
+  if(fd < 0){
+    err = std::string("cannot open ") + path;
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size < QASMBIN_HEADER + QASMBIN_TRAILER){
+    ::close(fd);
+    err = std::string(path) + " is not a binary QASM file";
+    return false;
+  }
+  size = st.st_size;
+  void* m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(m == MAP_FAILED){
+    err = std::string("cannot map ") + path;
+    size = 0;
+    return false;
+  }
+  base = (const unsigned char*)m;
+  madvise(m, size, MADV_SEQUENTIAL);
+
+  const unsigned char* t = base + size - QASMBIN_TRAILER;
+  if(memcmp(base, headerMagic, 8) != 0 || memcmp(t + 64, trailerMagic, 8) != 0
+     || getU32(base + 8) != QASMBIN_VERSION){
+    close();
+    err = std::string(path) + " is not a binary QASM file";
+    return false;
+  }
+  chunkRecords = getU32(base + 12);
+  records = getU64(t);
+  uint64_t symbolsOffset = getU64(t + 8);
+  uint64_t nsymbols = getU64(t + 16);
+  uint64_t anglesOffset = getU64(t + 24);
+  numAngles = getU64(t + 32);
+  uint64_t chunksOffset = getU64(t + 40);
+  numChunks = getU64(t + 48);
+  flags = getU64(t + 56);
+
+  uint64_t tail = size - QASMBIN_TRAILER;
+  if(chunkRecords == 0 || symbolsOffset < QASMBIN_HEADER || symbolsOffset > anglesOffset
+     || anglesOffset > chunksOffset || chunksOffset > tail
+     || numAngles > (chunksOffset - anglesOffset) / 8 || numChunks > (tail - chunksOffset) / 16){
+    close();
+    err = std::string(path) + " is damaged";
+    return false;
+  }
+  recordsEnd = base + symbolsOffset;
+  angles = base + anglesOffset;
+  chunks = base + chunksOffset;
+
+  const unsigned char* p = recordsEnd;
+  const unsigned char* end = angles;
+  symbols.reserve(nsymbols);
+  for(uint64_t i = 0; i < nsymbols; i++){
+    if(end - p < 5 || (uint64_t)(end - p - 5) < getU32(p + 1)){
+      close();
+      err = std::string(path) + " is damaged";
+      return false;
+    }
+    symbols.push_back(p);
+    p += 5 + getU32(p + 1);
+  }
+  return true;
+}
+
+void qasmBinReader::close(){
+  if(base)
+    munmap((void*)base, size);
+  base = NULL;
+  size = 0;
+  recordsEnd = NULL;
+  records = flags = numAngles = numChunks = 0;
+  symbols.clear();
+  angles = chunks = NULL;
+}
+
+const char* qasmBinReader::symbolName(uint32_t id, size_t& len) const{
+  if(id >= symbols.size()){
+    len = 0;
+    return "";
+  }
+  len = getU32(symbols[id] + 1);
+  return (const char*)symbols[id] + 5;
+}
+
+qasmBinSymbolKind qasmBinReader::symbolKind(uint32_t id) const{
+  return id < symbols.size() ? (qasmBinSymbolKind)symbols[id][0] : QB_SYM_NAME;
+}
+
+double qasmBinReader::angle(uint32_t id) const{
+  if(id >= numAngles)
+    return 0.0;
+  uint64_t b = getU64(angles + 8 * (uint64_t)id);
+  double d;
+  memcpy(&d, &b, sizeof(d));
+  return d;
+}
+
+static size_t recordSize(unsigned op){
+  return 1 + qasmBinOpArgs(op & ~QASMBIN_WIDE) * ((op & QASMBIN_WIDE) ? 4 : 2);
+}
+
+bool qasmBinReader::iterator::next(qasmBinGate& g){
+  if(p >= end)
+    return false;
+  unsigned op = p[0];
+  g.op = op & ~QASMBIN_WIDE;
+  g.nargs = qasmBinOpArgs(g.op);
+  if((size_t)(end - p) < recordSize(op) || g.op >= QB_NUM_OPS)
+    return false;
+  g.args[0] = g.args[1] = g.args[2] = 0;
+  const unsigned char* a = p + 1;
+  if(op & QASMBIN_WIDE)
+    for(unsigned i = 0; i < g.nargs; i++, a += 4)
+      g.args[i] = getU32(a);
+  else
+    for(unsigned i = 0; i < g.nargs; i++, a += 2)
+      g.args[i] = getU16(a);
+  p = a;
+  return true;
+}
+
+qasmBinReader::iterator qasmBinReader::begin() const{
+  iterator it;
+  it.p = base ? base + QASMBIN_HEADER : NULL;
+  it.end = recordsEnd;
+  return it;
+}
+
+qasmBinReader::iterator qasmBinReader::at(uint64_t n) const{
+  iterator it;
+  it.p = it.end = recordsEnd;
+  if(n >= records || n / chunkRecords >= numChunks)
+    return it;
+  const unsigned char* c = chunks + 16 * (n / chunkRecords);
+  uint64_t offset = getU64(c);
+  uint64_t first = getU64(c + 8);
+  if(offset < QASMBIN_HEADER || base + offset > recordsEnd || first > n)
+    return it;
+  it.p = base + offset;
+  // walk to the record within the chunk
+  for(uint64_t i = first; i < n && it.p < it.end; i++)
+    it.p += recordSize(it.p[0]);
+  return it;
+}
+
+void qasmBinReader::format(const qasmBinGate& g, std::string& line) const{
+  size_t len;
+  const char* s;
+  line.clear();
+  if(g.op == QB_TEXT){
+    s = symbolName(g.args[0], len);
+    line.append(s, len);
+    return;
+  }
+  line += qasmBinOpName(g.op);
+  line += ' ';
+  s = symbolName(g.args[0], len);
+  line.append(s, len);
+  if(qasmBinIsRotation(g.op)){
+    char num[512];
+    int n = snprintf(num, sizeof(num), ",%f", angle(g.args[1]));
+    line.append(num, n < (int)sizeof(num) ? n : sizeof(num) - 1);
+    return;
+  }
+  for(unsigned i = 1; i < g.nargs; i++){
+    line += ',';
+    s = symbolName(g.args[i], len);
+    line.append(s, len);
+  }
+}
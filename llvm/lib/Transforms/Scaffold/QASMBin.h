@@ -0,0 +1,192 @@
+//===----------------------------- QASMBin.h -----------------------------===//
+// Binary flat QASM. A .qasmb file holds the lines of a flat QASM file as
+// fixed-width records, so tools can walk the gates straight out of an mmap
+// instead of parsing text. It does not depend on LLVM: the GenQASM pass
+// writes it, and qasm2bin, bin2qasm and the simulators link it on its own.
+//
+// Layout, all integers little-endian:
+//
+//   header    "SCQASMB1", version (u32), records per chunk (u32)
+//   records   one per line of the flat QASM
+//   symbols   kind (u8), length (u32) and bytes of every symbol
+//   angles    IEEE doubles of the rotation angles
+//   chunks    offset (u64) and number (u64) of the first record of every
+//             chunk of QASMBIN_CHUNK_RECORDS records, for random access
+//   trailer   records, symbols offset, symbols, angles offset, angles,
+//             chunks offset, chunks, flags (u64 each) and "SCQASME1"
+//
+// A record is the opcode (u8) followed by its operands as u16, so its size
+// follows from the opcode: 3 bytes for one qubit gates, 5 for CNOT. When an
+// operand does not fit in 16 bits the opcode has 0x80 set and the operands
+// are u32. Operands are symbol ids, except the second operand of a
+// rotation, which is an angle id. Lines that are
+// not a gate or declaration are kept as QB_TEXT records, so converting a
+// file to binary and back gives the same bytes.
+//
+//        This file was created by Scaffold Compiler Working Group
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCAFFOLD_QASMBIN_H
+#define SCAFFOLD_QASMBIN_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// opcodes, with the text they have in flat QASM
+enum qasmBinOp {
+  QB_QUBIT,   // qubit a
+  QB_CBIT,    // cbit a
+  QB_H, QB_X, QB_Y, QB_Z, QB_S, QB_T, QB_TDAG, QB_SDAG,
+  QB_CNOT,    // CNOT a,b
+  QB_TOF,     // Tof a,b,c
+  QB_FREDKIN, // Fredkin a,b,c
+  QB_PREPX, QB_PREPZ, QB_MEASX, QB_MEASZ,
+  QB_RZ, QB_RX, QB_RY, // Rz a,angle
+  QB_TEXT,    // any other line, kept as a symbol
+  QB_NUM_OPS
+};
+
+enum qasmBinSymbolKind { QB_SYM_QUBIT, QB_SYM_CBIT, QB_SYM_NAME, QB_SYM_TEXT };
+
+#define QASMBIN_CHUNK_RECORDS 65536
+#define QASMBIN_NO_FINAL_NEWLINE 1 //trailer flag: the last line had no newline
+
+struct qasmBinGate {
+  unsigned op;
+  unsigned nargs;
+  uint32_t args[3];
+};
+
+// name of the opcode in flat QASM, and number of operands
+const char* qasmBinOpName(unsigned op);
+unsigned qasmBinOpArgs(unsigned op);
+bool qasmBinIsRotation(unsigned op);
+
+// where a writer puts its bytes
+class qasmBinSink {
+public:
+  virtual ~qasmBinSink() {}
+  virtual void write(const char* data, size_t size) = 0;
+};
+
+class qasmBinFileSink : public qasmBinSink {
+  FILE* f;
+public:
+  qasmBinFileSink(FILE* file) : f(file) {}
+  void write(const char* data, size_t size);
+};
+
+// Appends records to a .qasmb stream. Everything that depends on the whole
+// file comes after the records, so the stream never has to seek and can be
+// piped through a compressor.
+class qasmBinWriter {
+  qasmBinSink &out;
+  uint64_t offset;
+  uint64_t records;
+  uint64_t flags;
+  std::vector<uint64_t> chunks; //offset and first record of every chunk
+
+  std::vector<std::string> symbolNames;
+  std::vector<unsigned char> symbolKinds;
+  std::vector<uint32_t> symbolTable; //open addressing, ids + 1
+  std::vector<double> angleValues;
+  std::vector<uint32_t> angleTable;
+
+  char buf[1 << 16];
+  size_t used;
+
+  void put(const void* data, size_t size);
+  void putU16(uint16_t v);
+  void putU32(uint32_t v);
+  void putU64(uint64_t v);
+  void flush();
+  void growSymbols();
+  void growAngles();
+
+public:
+  qasmBinWriter(qasmBinSink &sink);
+
+  // id of a symbol, added to the symbol table the first time it is seen
+  uint32_t symbol(const char* name, size_t len, qasmBinSymbolKind kind);
+  uint32_t symbol(const std::string& name, qasmBinSymbolKind kind) {
+    return symbol(name.data(), name.size(), kind);
+  }
+  uint32_t angle(double a);
+
+  void gate(unsigned op, const uint32_t* args, unsigned nargs);
+
+  // parse one line of flat QASM, without its newline, and append it
+  void line(const char* text, size_t len);
+
+  // the last line of the file has no newline
+  void noFinalNewline() { flags |= QASMBIN_NO_FINAL_NEWLINE; }
+
+  // write the tables and the trailer; the writer cannot be used afterwards
+  void finish();
+
+  uint64_t numRecords() const { return records; }
+};
+
+// Reads a .qasmb file through mmap. Records are decoded in place as the
+// iterator walks them; only the symbol table is indexed when the file is
+// opened.
+class qasmBinReader {
+  const unsigned char* base;
+  size_t size;
+  const unsigned char* recordsEnd;
+  uint64_t records;
+  uint64_t flags;
+  uint32_t chunkRecords;
+  std::vector<const unsigned char*> symbols;
+  const unsigned char* angles;
+  uint64_t numAngles;
+  const unsigned char* chunks;
+  uint64_t numChunks;
+
+  qasmBinReader(const qasmBinReader&);
+  void operator=(const qasmBinReader&);
+
+public:
+  qasmBinReader() : base(NULL), size(0), recordsEnd(NULL), records(0), flags(0),
+    chunkRecords(0), angles(NULL), numAngles(0), chunks(NULL), numChunks(0) {}
+  ~qasmBinReader() { close(); }
+
+  bool open(const char* path, std::string& err);
+  void close();
+
+  uint64_t numRecords() const { return records; }
+  uint32_t numSymbols() const { return symbols.size(); }
+  uint64_t getFlags() const { return flags; }
+
+  const char* symbolName(uint32_t id, size_t& len) const;
+  std::string symbolName(uint32_t id) const {
+    size_t len;
+    const char* s = symbolName(id, len);
+    return std::string(s, len);
+  }
+  qasmBinSymbolKind symbolKind(uint32_t id) const;
+  double angle(uint32_t id) const;
+
+  class iterator {
+    const unsigned char* p;
+    const unsigned char* end;
+    friend class qasmBinReader;
+  public:
+    iterator() : p(NULL), end(NULL) {}
+    // decode the record at the iterator and move past it
+    bool next(qasmBinGate& g);
+  };
+
+  iterator begin() const;
+  // iterator at record n, found through the chunk index
+  iterator at(uint64_t n) const;
+
+  // text of a record in flat QASM, without the newline
+  void format(const qasmBinGate& g, std::string& line) const;
+};
+
+#endif // SCAFFOLD_QASMBIN_H
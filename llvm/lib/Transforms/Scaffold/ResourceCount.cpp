@@ -1,13 +1,21 @@
-//===----------------------------- GateCount.cpp -------------------------===//
+//===----------------------------- ResourceCount.cpp ---------------------===//
 // This file implements the Scaffold Pass of counting the number of qbits and
 // gates in a program in callgraph post-order.
 //
+// Every function gets one row of counters in a flat table. A row holds the
+// qbits and gates of the function itself plus, for every call, the row of
+// the callee times the number of times the call executes. Calls and gates
+// inside loops that were not unrolled are weighted by the trip count that
+// ScalarEvolution finds for the loops around them, so programs do not have
+// to be fully unrolled to be counted. Counters saturate instead of wrapping.
+//
 //        This file was created by Scaffold Compiler Working Group
 //
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "ResourceCount"
 #include <vector>
+#include <string>
 #include <limits>
 #include "llvm/Pass.h"
 #include "llvm/Function.h"
@@ -16,138 +24,322 @@
 #include "llvm/Instruction.h"
 #include "llvm/Instructions.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
-#include "llvm/Support/InstIterator.h"
 #include "llvm/PassAnalysisSupport.h"
 #include "llvm/Analysis/CallGraph.h"
-#include "llvm/Support/CFG.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "ScaffoldOutput.h"
 
 
 using namespace llvm;
 
-// An anonymous namespace for the pass. Things declared inside it are
-// only visible to the current file.
+static cl::opt<std::string>
+ResourceFormat("resource-format", cl::init("text"), cl::Hidden,
+    cl::desc("Format of the resource counts: text, csv or json"));
+
+#define NUM_RESOURCES 11
+
 namespace {
 
+  // Columns of the table, column 0 is qubits, the rest are gates
+  const char* const resource_name[NUM_RESOURCES] = {
+    "Qubit", "X", "Z", "H", "T", "T_dag", "S", "S_dag", "CNOT", "PrepZ", "MeasZ" };
+
+  // Gate intrinsics in the order of the columns 1..NUM_RESOURCES-1
+  const char* const gate_intrinsic[NUM_RESOURCES] = {
+    "", "llvm.X", "llvm.Z", "llvm.H", "llvm.T", "llvm.Tdag", "llvm.S", "llvm.Sdag",
+    "llvm.CNOT", "llvm.PrepZ", "llvm.MeasZ" };
+
+  typedef unsigned long long resCount;
+  const resCount RES_MAX = std::numeric_limits<resCount>::max();
+
+  // saturating arithmetic, RES_MAX stands for "too many to count"
+  resCount satAdd(resCount a, resCount b){
+    return (a > RES_MAX - b) ? RES_MAX : a + b;
+  }
+
+  resCount satMul(resCount a, resCount b){
+    if(a == 0 || b == 0) return 0;
+    return (a > RES_MAX / b) ? RES_MAX : a * b;
+  }
+
+  // Resources of one function including everything it calls
+  struct resourceRow {
+    Function* F;
+    resCount count[NUM_RESOURCES];
+    unsigned unknownLoops; //loops whose trip count was taken to be 1
+    unsigned recursiveCalls; //calls to functions not counted yet, left out
+    bool saturated;
+  };
+
   // Derived from ModulePass to count qbits in functions
   struct ResourceCount : public ModulePass {
     static char ID; // Pass identification
     ResourceCount() : ModulePass(ID) {}
 
+    // Function* ---> row in FunctionResources, rows are in callgraph post-order
+    std::vector<resourceRow> FunctionResources;
+    DenseMap<Function*, unsigned> FunctionIndex;
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
-      AU.setPreservesAll();  
-      AU.addRequired<CallGraph>();    
+      AU.setPreservesAll();
+      AU.addRequired<CallGraph>();
+      AU.addRequired<LoopInfo>();
+      AU.addRequired<ScalarEvolution>();
+    }
+
+    // column of a gate intrinsic, 0 if it is not one that is counted
+    static int gateColumn(Function* callee){
+      StringRef name = callee->getName();
+      for(int l = 1; l < NUM_RESOURCES; l++)
+        if(name == gate_intrinsic[l])
+          return l;
+      return 0;
+    }
+
+    void addCount(resourceRow& row, int l, resCount n){
+      resCount sum = satAdd(row.count[l], n);
+      if(sum == RES_MAX)
+        row.saturated = true;
+      row.count[l] = sum;
     }
-    
-    void CountFunctionResources (Function *F, std::map <Function*, unsigned long long* > FunctionResources) const {
-      // Traverse instruction by instruction
-      for (inst_iterator I = inst_begin(*F), E = inst_end(*F); I != E; ++I) {
-        Instruction *Inst = &*I;                            // Grab pointer to instruction reference
-
-        // Qubits?
-        if (AllocaInst *AI = dyn_cast<AllocaInst>(Inst)) {                  // Filter Allocation Instructions
-          Type *allocatedType = AI->getAllocatedType();
-
-          if (ArrayType *arrayType = dyn_cast<ArrayType>(allocatedType)) { // Filter allocation of arrays
-            Type *elementType = arrayType->getElementType();
-            if (elementType->isIntegerTy(16)) {                           // Filter allocation Type (qbit=i16)
-              uint64_t arraySize = arrayType->getNumElements();            
-              FunctionResources[F][0] += arraySize;                
+
+    // Number of times each block of F executes per call of F: the product of
+    // the trip counts of the loops around it. Loops with a trip count
+    // ScalarEvolution cannot compute count once. Functions without loops,
+    // which is all of them once loops are unrolled, never run the analyses.
+    void computeBlockWeights(Function* F, resourceRow& row, DenseMap<BasicBlock*, resCount>& weights){
+      SmallVector<std::pair<const BasicBlock*, const BasicBlock*>, 8> backedges;
+      FindFunctionBackedges(*F, backedges);
+      if(backedges.empty())
+        return;
+
+      LoopInfo *LI = &getAnalysis<LoopInfo>(*F);
+      ScalarEvolution *SE = &getAnalysis<ScalarEvolution>(*F);
+      // times the exiting block of the loop executes, and whether that block
+      // is the header, in which case the rest of the loop executes once less
+      DenseMap<Loop*, std::pair<resCount, bool> > tripCounts;
+
+      for(Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB){
+        resCount w = 1;
+        for(Loop* L = LI->getLoopFor(&*BB); L; L = L->getParentLoop()){
+          DenseMap<Loop*, std::pair<resCount, bool> >::iterator tc = tripCounts.find(L);
+          if(tc == tripCounts.end()){
+            //rotated loops exit from the latch, others from the header
+            BasicBlock* exiting = L->getLoopLatch();
+            if(!exiting || !L->isLoopExiting(exiting))
+              exiting = L->getHeader();
+            resCount n = L->isLoopExiting(exiting) ? SE->getSmallConstantTripCount(L, exiting) : 0;
+            bool headerExits = (exiting == L->getHeader() && exiting != L->getLoopLatch());
+            if(n == 0){
+              row.unknownLoops++;
+              n = 1;
+              headerExits = false;
             }
+            tc = tripCounts.insert(std::make_pair(L, std::make_pair(n, headerExits))).first;
           }
+          resCount n = tc->second.first;
+          if(tc->second.second && &*BB != L->getHeader())
+            n = n - 1;
+          w = satMul(w, n);
         }
+        if(w != 1)
+          weights[&*BB] = w;
+      }
+    }
+
+    void CountFunctionResources (Function *F, resourceRow& row) {
+      DenseMap<BasicBlock*, resCount> weights;
+      computeBlockWeights(F, row, weights);
+
+      for(Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB){
+        DenseMap<BasicBlock*, resCount>::iterator wi = weights.find(&*BB);
+        resCount w = (wi == weights.end()) ? 1 : wi->second;
+
+        // Traverse instruction by instruction
+        for(BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I){
+          Instruction *Inst = &*I;                            // Grab pointer to instruction reference
+
+          // Qubits?
+          if (AllocaInst *AI = dyn_cast<AllocaInst>(Inst)) {                  // Filter Allocation Instructions
+            Type *allocatedType = AI->getAllocatedType();
+
+            if (ArrayType *arrayType = dyn_cast<ArrayType>(allocatedType)) { // Filter allocation of arrays
+              Type *elementType = arrayType->getElementType();
+              if (elementType->isIntegerTy(16)) {                           // Filter allocation Type (qbit=i16)
+                uint64_t arraySize = arrayType->getNumElements();
+                addCount(row, 0, satMul(arraySize, w));
+              }
+            }
+          }
 
-        // Gates?
-        if (CallInst *CI = dyn_cast<CallInst>(Inst)) {      // Filter Call Instructions
+          // Gates?
+          CallInst *CI = dyn_cast<CallInst>(Inst);
+          if (!CI)
+            continue;
           Function *callee = CI->getCalledFunction();
+          if (!callee)
+            continue;
+
           if (callee->isIntrinsic()) {                      // Intrinsic (Gate) Functions calls
-            if (callee->getName().str() == "llvm.X") 
-              FunctionResources[F][1]++;
-            else if (callee->getName().str() == "llvm.Z") 
-              FunctionResources[F][2]++;
-            else if (callee->getName().str() == "llvm.H") 
-              FunctionResources[F][3]++;
-            else if (callee->getName().str() == "llvm.T") 
-              FunctionResources[F][4]++;
-            else if (callee->getName().str() == "llvm.Tdag")
-              FunctionResources[F][5]++;
-            else if (callee->getName().str() == "llvm.S") 
-              FunctionResources[F][6]++;
-            else if (callee->getName().str() == "llvm.Sdag")
-              FunctionResources[F][7]++;
-            else if (callee->getName().str() == "llvm.CNOT")
-              FunctionResources[F][8]++;            
-            else if (callee->getName().str() == "llvm.PrepZ") 
-              FunctionResources[F][9]++;
-            else if (callee->getName().str() == "llvm.MeasZ") 
-              FunctionResources[F][10]++;
+            if (int l = gateColumn(callee))
+              addCount(row, l, w);
+            continue;
           }
 
-          else {                                              // Non-intrinsic Function Calls
-            // Resource numbers must be previously entered
-            // for this call. Look them up and add to this function's numbers.
-            if (FunctionResources.find(callee) != FunctionResources.end()) {
-              unsigned long long* callee_numbers = FunctionResources.find(callee)->second;
-              for (int l=0; l<11; l++)
-                FunctionResources[F][l] += callee_numbers[l];
-            }
+          // Non-intrinsic Function Calls
+          // Resource numbers must be previously entered
+          // for this call. Look them up and add them weighted by the
+          // number of times the call executes.
+          DenseMap<Function*, unsigned>::iterator ci = FunctionIndex.find(callee);
+          if (ci == FunctionIndex.end()) {
+            if (!callee->isDeclaration())
+              row.recursiveCalls++;
+            continue;
           }
+          const resourceRow& calleeRow = FunctionResources[ci->second];
+          for (int l = 0; l < NUM_RESOURCES; l++)
+            addCount(row, l, satMul(calleeRow.count[l], w));
+          row.unknownLoops += calleeRow.unknownLoops;
+          row.recursiveCalls += calleeRow.recursiveCalls;
+          row.saturated |= calleeRow.saturated;
+        }
+      }
+    }
+
+    resCount totalGates(const resourceRow& row) const {
+      resCount total = 0;
+      for (int j = 1; j < NUM_RESOURCES; j++)
+        total = satAdd(total, row.count[j]);
+      return total;
+    }
 
+    static void printCount(raw_ostream& out, resCount n){
+      if (n == RES_MAX)
+        out << ">=" << n;
+      else
+        out << n;
+    }
+
+    static void printJSONString(raw_ostream& out, StringRef s){
+      out << '"';
+      for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"' || c == '\\')
+          out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+          out << ' ';
+        else
+          out << c;
+      }
+      out << '"';
+    }
+
+    void printText(raw_ostream& out, const resourceRow* mainRow) const {
+      out << "\tQubit\tX\tZ\tH\tT\tT_dag\tS\tS_dag\tCNOT\tPrepZ\tMeasZ\n";
+      for (std::vector<resourceRow>::const_iterator i = FunctionResources.begin(), e = FunctionResources.end(); i!=e; ++i) {
+        out << "Function: " << i->F->getName() << "\n";
+        for (int j=0; j<NUM_RESOURCES; j++) {
+          out << "\t";
+          printCount(out, i->count[j]);
         }
+        out << "\n";
+        if (i->unknownLoops)
+          out << "\t(" << i->unknownLoops << " loops with unknown trip count counted once)\n";
+        if (i->recursiveCalls)
+          out << "\t(" << i->recursiveCalls << " recursive calls not counted)\n";
+      }
 
+      if (mainRow) {
+        out << "\ntotal_gates = ";
+        printCount(out, totalGates(*mainRow));
+        out << "\n";
       }
     }
 
-    virtual bool runOnModule (Module &M) {
-      // Function* ---> Qubits | X | Z | H | T | CNOT | Toffoli | PrepZ | MeasZ
-      std::map <Function*, unsigned long long*> FunctionResources;
+    void printCSV(raw_ostream& out) const {
+      out << "function";
+      for (int j=0; j<NUM_RESOURCES; j++)
+        out << "," << resource_name[j];
+      out << ",total_gates,unknown_loops,recursive_calls,saturated\n";
+      for (std::vector<resourceRow>::const_iterator i = FunctionResources.begin(), e = FunctionResources.end(); i!=e; ++i) {
+        out << i->F->getName();
+        for (int j=0; j<NUM_RESOURCES; j++)
+          out << "," << i->count[j];
+        out << "," << totalGates(*i) << "," << i->unknownLoops << "," << i->recursiveCalls
+            << "," << (i->saturated ? 1 : 0) << "\n";
+      }
+    }
 
-      // unsigned long long is 18x10^18 digits longs. good enough.
-      // errs() << "LONG LONG LIMIT: " << std::numeric_limits<unsigned long long>::max() << "\n";
+    void printJSON(raw_ostream& out, const resourceRow* mainRow) const {
+      out << "{\n  \"functions\": [";
+      for (std::vector<resourceRow>::const_iterator i = FunctionResources.begin(), e = FunctionResources.end(); i!=e; ++i) {
+        out << (i == FunctionResources.begin() ? "\n" : ",\n") << "    {\"name\": ";
+        printJSONString(out, i->F->getName());
+        for (int j=0; j<NUM_RESOURCES; j++)
+          out << ", \"" << resource_name[j] << "\": " << i->count[j];
+        out << ", \"total_gates\": " << totalGates(*i)
+            << ", \"unknown_loops\": " << i->unknownLoops
+            << ", \"recursive_calls\": " << i->recursiveCalls
+            << ", \"saturated\": " << (i->saturated ? "true" : "false") << "}";
+      }
+      out << "\n  ]";
+      if (mainRow)
+        out << ",\n  \"total_gates\": " << totalGates(*mainRow);
+      out << "\n}\n";
+    }
 
-      errs() << "\tQubit\tX\tZ\tH\tT\tT_dag\tS\tS_dag\tCNOT\tPrepZ\tMeasZ\n";
+    virtual bool runOnModule (Module &M) {
+      FunctionResources.clear();
+      FunctionIndex.clear();
 
       // iterate over all functions, and over all instructions in those functions
       // find call sites that have constant integer values. In Post-Order.
       CallGraphNode* rootNode = getAnalysis<CallGraph>().getRoot();
-      
+
       //fill in the gate count bottom-up in the call graph
       for (scc_iterator<CallGraphNode*> sccIb = scc_begin(rootNode), E = scc_end(rootNode); sccIb != E; ++sccIb) {
         const std::vector<CallGraphNode*> &nextSCC = *sccIb;
-        //errs() << "\nSCC #" << ++sccNum << " : ";      
         for (std::vector<CallGraphNode*>::const_iterator nsccI = nextSCC.begin(), E = nextSCC.end(); nsccI != E; ++nsccI) {
-          Function *F = (*nsccI)->getFunction();	  
-          if (F && !F->isDeclaration()) {
-            // dynamically create array holding gate numbers for this function
-            unsigned long long* ResourceNumbers = new unsigned long long[11];
-            for (int k=0; k<11; k++)
-              ResourceNumbers[k] = 0;
-            FunctionResources.insert(std::make_pair(F, ResourceNumbers));
-
-            // count the gates of this function 
-            CountFunctionResources(F, FunctionResources);
+          Function *F = (*nsccI)->getFunction();
+          if (F && !F->isDeclaration() && !FunctionIndex.count(F)) {
+            resourceRow row;
+            row.F = F;
+            for (int k=0; k<NUM_RESOURCES; k++)
+              row.count[k] = 0;
+            row.unknownLoops = 0;
+            row.recursiveCalls = 0;
+            row.saturated = false;
+
+            // count the gates of this function, then publish the row so
+            // that callers, which come later in post-order, can use it
+            CountFunctionResources(F, row);
+            FunctionIndex[F] = FunctionResources.size();
+            FunctionResources.push_back(row);
           }
         }
       }
 
-      // print results      
-      for (std::map<Function*, unsigned long long*>::iterator i = FunctionResources.begin(), e = FunctionResources.end(); i!=e; ++i) {
-        errs() << "Function: " << i->first->getName() << "\n";
-        for (int j=0; j<11; j++)
-          errs() << "\t" << (i->second)[j];
-        errs() << "\n";
+      const resourceRow* mainRow = NULL;
+      if (Function* mainF = M.getFunction("main")) {
+        DenseMap<Function*, unsigned>::iterator mi = FunctionIndex.find(mainF);
+        if (mi != FunctionIndex.end())
+          mainRow = &FunctionResources[mi->second];
       }
 
-      unsigned long long total_gates = 0;
-      for (int j=1; j<11;j++)
-        total_gates += FunctionResources.find(M.getFunction("main"))->second[j];
-      errs() << "\ntotal_gates = " << total_gates << "\n";
-
-      // free memory
-      for (std::map<Function*, unsigned long long*>::iterator i = FunctionResources.begin(), e = FunctionResources.end(); i!=e; ++i)
-        delete [] i->second;
-
+      // print results
+      if (ResourceFormat == "csv")
+        printCSV(scaffoldOut());
+      else if (ResourceFormat == "json")
+        printJSON(scaffoldOut(), mainRow);
+      else
+        printText(scaffoldOut(), mainRow);
 
       return false;
     } // End runOnModule
@@ -158,5 +350,3 @@ namespace {
 
 char ResourceCount::ID = 0;
 static RegisterPass<ResourceCount> X("ResourceCount", "Resource Counter Pass");
-
-
@@ -40,7 +40,7 @@ namespace {
       AU.addRequired<CallGraph>();    
     }
     
-    void CountFunctionResources (Function *F, std::map <Function*, unsigned long long* > FunctionResources) const {
+    void CountFunctionResources (Function *F, std::map <Function*, unsigned long long* >& FunctionResources) const {
       // Traverse instruction by instruction
       for (inst_iterator I = inst_begin(*F), E = inst_end(*F); I != E; ++I) {
         Instruction *Inst = &*I;                            // Grab pointer to instruction reference
@@ -61,6 +61,7 @@ namespace {
         // Gates?
         if (CallInst *CI = dyn_cast<CallInst>(Inst)) {      // Filter Call Instructions
           Function *callee = CI->getCalledFunction();
+          if (!callee) continue;                            // Indirect call
           if (callee->isIntrinsic()) {                      // Intrinsic (Gate) Functions calls
             if (callee->getName().str() == "llvm.X") 
               FunctionResources[F][1]++;
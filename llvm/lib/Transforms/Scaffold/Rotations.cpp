@@ -3,9 +3,19 @@
 // sequences of clifford+T gates
 //
 
+#include <cctype>
+#include <cerrno>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <map>
 #include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "llvm/ADT/ArrayRef.h"
 
@@ -14,6 +24,7 @@
 #include "llvm/Instructions.h"
 #include "llvm/Intrinsics.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
 #include "llvm/Pass.h"
 
 #include "llvm/Support/CallSite.h"
@@ -21,58 +32,268 @@
 #include "llvm/Support/InstVisitor.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicLibrary.h"
 
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
+#include "ScaffoldWorkQueue.h"
+
 using namespace llvm;
 
 static cl::opt<unsigned>
 SqctLevels("sqct-levels", cl::init(1), cl::Hidden,
   cl::desc("The rotation decomposition precision"));
 
+static cl::opt<bool>
+SqctQuadPrecision("sqct-quad-precision", cl::init(false), cl::Hidden,
+  cl::desc("Run the shallow Solovay Kitaev iterations of SQCT in quadruple precision"));
+
+static cl::opt<bool>
+UseSqctLibrary("rotation-sqct-library", cl::init(true), cl::Hidden,
+  cl::desc("Decompose in-process with the libsqct.so next to the sqct binary, if built"));
+
+static cl::opt<unsigned>
+RotationJobs("rotation-jobs", cl::init(0), cl::Hidden,
+  cl::desc("Number of threads decomposing rotations (0 = number of CPUs)"));
+
+static cl::opt<std::string>
+RotationCache("rotation-cache", cl::init(""), cl::Hidden,
+  cl::desc("Directory of the persistent rotation decomposition cache "
+           "(defaults to $ROTATIONCACHE, disabled if neither is set)"));
+
 
 namespace {
+	// Persistent cache of decomposer outputs, shared by all opt processes
+	// using the same directory. The cache file is an append-only log of
+	// lines "<key>\t<gates>\n". Every record is appended with a single
+	// write() on an O_APPEND descriptor under an exclusive flock, so
+	// concurrent builds never interleave records; a reader only consumes
+	// complete lines and picks up records of other processes on a miss.
+	class RotationCacheFile {
+		std::string Path;
+		off_t Offset; // bytes of the file consumed so far
+		std::map<std::string, std::string> Entries;
+
+		// Read the records appended since the last call
+		void refresh() {
+			if (!enabled()) return;
+			int fd = open(Path.c_str(), O_RDONLY);
+			if (fd < 0) return;
+			flock(fd, LOCK_SH);
+			std::string tail;
+			char buffer[4096];
+			if (lseek(fd, Offset, SEEK_SET) == Offset) {
+				ssize_t n;
+				while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+					tail.append(buffer, n);
+			}
+			flock(fd, LOCK_UN);
+			close(fd);
+
+			std::string::size_type start = 0, end;
+			while ((end = tail.find('\n', start)) != std::string::npos) {
+				std::string::size_type tab = tail.find('\t', start);
+				if (tab != std::string::npos && tab < end)
+					Entries[tail.substr(start, tab - start)] = tail.substr(tab + 1, end - tab - 1);
+				start = end + 1;
+			}
+			// a trailing partial record is read again next time
+			Offset += start;
+		}
+
+	public:
+		RotationCacheFile() : Offset(0) {}
+
+		bool enabled() const { return !Path.empty(); }
+
+		void open_dir(const std::string &Dir) {
+			if (Dir.empty()) return;
+			if (mkdir(Dir.c_str(), 0777) != 0 && errno != EEXIST) {
+				errs() << "Cannot create rotation cache " << Dir << ": " << strerror(errno) << "\n";
+				return;
+			}
+			Path = Dir + "/rotations.v1";
+			refresh();
+		}
+
+		bool lookup(const std::string &Key, std::string &Gates) {
+			std::map<std::string, std::string>::const_iterator it = Entries.find(Key);
+			if (it == Entries.end()) {
+				refresh();
+				it = Entries.find(Key);
+				if (it == Entries.end()) return false;
+			}
+			Gates = it->second;
+			return true;
+		}
+
+		void insert(const std::string &Key, const std::string &Gates) {
+			Entries[Key] = Gates;
+			if (!enabled()) return;
+			std::string record = Key + "\t" + Gates + "\n";
+			int fd = open(Path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0666);
+			if (fd < 0) return;
+			flock(fd, LOCK_EX);
+			if (write(fd, record.data(), record.size()) != (ssize_t)record.size())
+				errs() << "Cannot write rotation cache " << Path << "\n";
+			flock(fd, LOCK_UN);
+			close(fd);
+		}
+	}; // class RotationCacheFile
+
+	// One decomposer run, shared by all rotations with the same function name
+	struct Decomposition {
+		std::string Command;
+		std::string Key; // axis, angle and levels, see decomposerKey for the rest
+		std::string Gates;
+		Function *DR;
+		double Angle;
+		char Axis;
+	};
+
+	// SQCT in-process: libsqct.so next to the sqct binary named by ROTATIONPATH.
+	// It is loaded at runtime so that the Scaffold passes do not depend on
+	// SQCT being built. The context, i.e. the epsilon nets, lookup tables and
+	// memoized approximations, is created once per process. A batch of
+	// rotations runs on one OpenMP team inside the library, which also runs
+	// the Solovay Kitaev iterations of each rotation.
+	class SqctLibrary {
+		typedef void *(*CreateFn)(int, int);
+		typedef int (*BatchFn)(void*, int, const double*, const char*, int, int, char**);
+		typedef void (*FreeFn)(char*);
+
+		void *Context;
+		BatchFn DecomposeBatch;
+		FreeFn Free;
+
+	public:
+		SqctLibrary() : Context(0), DecomposeBatch(0), Free(0) {}
+
+		bool loaded() const { return Context != 0; }
+
+		static std::string path(const std::string &Decomposer) {
+			return Decomposer.substr(0, Decomposer.rfind('/') + 1) + "libsqct.so";
+		}
+
+		static bool available(const std::string &Decomposer) {
+			return access(path(Decomposer).c_str(), R_OK) == 0;
+		}
+
+		bool load(const std::string &Decomposer) {
+			if (loaded()) return true;
+			std::string Path = path(Decomposer);
+			if (!available(Decomposer)) return false;
+
+			std::string Err;
+			sys::DynamicLibrary Lib = sys::DynamicLibrary::getPermanentLibrary(Path.c_str(), &Err);
+			if (!Lib.isValid()) {
+				errs() << "Cannot load " << Path << ": " << Err << "\n";
+				return false;
+			}
+			CreateFn Create = (CreateFn)(intptr_t)Lib.getAddressOfSymbol("sqct_context_create_ex");
+			DecomposeBatch = (BatchFn)(intptr_t)Lib.getAddressOfSymbol("sqct_decompose_batch");
+			Free = (FreeFn)(intptr_t)Lib.getAddressOfSymbol("sqct_free");
+			if (!Create || !DecomposeBatch || !Free) return false;
+
+			errs() << "Loading epsilon nets into " << Path << "\n";
+			// same number of epsilon net layers as rotZ
+			Context = Create(30, SqctQuadPrecision);
+			return loaded();
+		}
+
+		// Decomposes all jobs on a team of Threads threads, 0 for the OpenMP default
+		void decompose(const std::vector<Decomposition*> &Jobs, std::vector<std::string> &Results,
+		               int Iterations, unsigned Threads) const {
+			std::vector<double> Angles;
+			std::string Axes;
+			for (unsigned i = 0; i < Jobs.size(); ++i) {
+				Angles.push_back(Jobs[i]->Angle);
+				Axes += Jobs[i]->Axis;
+			}
+			std::vector<char*> Out(Jobs.size(), (char*)0);
+			int n = DecomposeBatch(Context, Jobs.size(), &Angles[0], Axes.data(), Iterations, Threads, &Out[0]);
+			for (unsigned i = 0; i < Jobs.size(); ++i) {
+				Results[i] = (n >= 0 && Out[i]) ? Out[i] : "ERROR";
+				if (n >= 0) Free(Out[i]);
+			}
+		}
+	}; // class SqctLibrary
+
+	// Runs the decomposer commands of a batch through scaffoldParallelFor.
+	// The results are written to disjoint slots of Results.
+	struct DecomposerJobs {
+		const std::vector<Decomposition*> &Jobs;
+		std::vector<std::string> &Results;
+
+		DecomposerJobs(const std::vector<Decomposition*> &jobs, std::vector<std::string> &results)
+			: Jobs(jobs), Results(results) {}
+
+		static std::string exec(const char* cmd) {
+			FILE* pipe = popen(cmd, "r");
+			if (!pipe) return "ERROR";
+			char buffer[128];
+			std::string result = "";
+			while(!feof(pipe)) {
+				if (fgets(buffer, 128, pipe) != NULL)
+					result += buffer;
+			}
+			pclose(pipe);
+			return result;
+		} // exec()
+
+		static void run(void *arg, unsigned i) {
+			DecomposerJobs *jobs = static_cast<DecomposerJobs*>(arg);
+			jobs->Results[i] = exec(jobs->Jobs[i]->Command.c_str());
+		}
+	}; // struct DecomposerJobs
+
+	// Writes the size and modification time of a file, so that cached
+	// decompositions do not outlive a rebuilt decomposer
+	static void writeStamp(raw_ostream &OS, const std::string &Path) {
+		struct stat st;
+		if (stat(Path.c_str(), &st) == 0)
+			OS << Path << ':' << (uint64_t)st.st_size << ':' << (uint64_t)st.st_mtime << '|';
+		else
+			OS << Path << ":-|";
+	}
+
+	// Cache key prefix of the decomposer: its path, the stamps of the
+	// decomposer, the libsqct.so next to it and rotZ, whether it runs
+	// in-process or as a subprocess, and the SQCT precision mode
+	static std::string decomposerKey(const std::string &Decomposer, bool InProcess) {
+		std::string Dir = Decomposer.substr(0, Decomposer.rfind('/') + 1);
+		std::string RotZ = Dir + "rotZ";
+		if (char *sqct = getenv("SQCTPATH"))
+			RotZ = std::string(sqct) + "/rotZ";
+
+		std::string key; raw_string_ostream keyss(key);
+		keyss << Decomposer << '|';
+		writeStamp(keyss, Decomposer);
+		writeStamp(keyss, SqctLibrary::path(Decomposer));
+		writeStamp(keyss, RotZ);
+		keyss << (InProcess ? "lib" : "exec") << '|' << (SqctQuadPrecision ? "qpr" : "hpr") << '|';
+		return keyss.str();
+	}
+
 	// We need to use a ModulePass in order to create new Functions
 	struct Rotations : public ModulePass {
 		static char ID;
 		Rotations() : ModulePass(ID) {}
 
 		struct RotationVisitor : public InstVisitor<RotationVisitor> {
-			// All decompositions will be created as Functions in M's FunctionList
-			Module *M;
-			// The constructor is called once per module (in runOnModule)
-			RotationVisitor(Module *module) : M(module) {}
-
-			// private:
-			std::string exec(const char* cmd) {
-				FILE* pipe = popen(cmd, "r");
-				if (!pipe) return "ERROR";
-				char buffer[128];
-				std::string result = "";
-				while(!feof(pipe)) {
-					if (fgets(buffer, 128, pipe) != NULL)
-						result += buffer;
-				}
-				pclose(pipe);
-				return result;
-			} // exec()
-			// public: 
+			// Rotations with a constant angle, in program order
+			std::vector<CallInst*> Calls;
+
 			void visitCallInst(CallInst &I) {
 				// Determine whether this is an Rz gate
 				Function *CF = I.getCalledFunction();
 				// Is this an intrinsic?
 				if (!CF->isIntrinsic()) return;
-				// If it is a rotation, what is the axis?
-				std::string axis;
+				// Is it a rotation?
 				switch (CF->getIntrinsicID()) {
 					case Intrinsic::Rz:
-						axis = std::string(" Z ");
-						break;
 					case Intrinsic::Rx:
-						axis = std::string(" X ");
-						break;
 					case Intrinsic::Ry:
-						axis = std::string(" Y ");
 						break;
 					default:
 						return;
@@ -82,12 +303,102 @@ namespace {
 					errs() << "Unknown rotation angle\n";
 					return;
 				}
+				Calls.push_back(&I);
+			} // visitCallInst()
+
+		}; // struct RotationVisitor
+
+		// Create the function with the gates of a decomposition
+		static void materialize(Module &M, Function *DR, const std::string &circuit) {
+			Function::arg_iterator args = DR->arg_begin(); //set name of variable
+			Value* qArg = args;
+			qArg->setName("q");
+
+			// Create a BasicBlock and insert it at the end of the Function
+			BasicBlock *BB = BasicBlock::Create(getGlobalContext(), "", DR, 0);
+
+			// For each gate in decomposition:
+			// (the decomposed string is given in the reverse order that ops must be applied)
+			for (int i=circuit.length()-1, e=0; i>=e; i--) {
+				Function *gate = NULL;
+				switch(circuit[i]) {
+					case 'T':
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::T);
+						break;
+					case 't':
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::Tdag);
+						break;
+					case 'P':
+						// TODO: P NOT YET SUPPORTED
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::S);
+						break;
+					case 'p':
+						// TODO: P NOT YET SUPPORTED
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::Sdag);
+						break;
+					case 'H':
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::H);
+						break;
+					case 'X':
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::X);
+						break;
+					case 'Y':
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::Y);
+						break;
+					case 'Z':
+						gate = Intrinsic::getDeclaration(&M, Intrinsic::Z);
+						break;
+					default:
+						continue;
+				}
+				// Insert at end
+				CallInst::Create(gate, ArrayRef<Value*>(DR->arg_begin()), "", BB);
+			}
+			ReturnInst::Create(getGlobalContext(), 0, BB);
+		} // materialize()
+
+		virtual bool runOnModule(Module &M) {
+			RotationCacheFile Cache;
+			if (!RotationCache.empty())
+				Cache.open_dir(RotationCache);
+			else if (char *dir = getenv("ROTATIONCACHE"))
+				Cache.open_dir(dir);
+
+			// Phase 1: collect all rotations of the module
+			RotationVisitor RV;
+			RV.visit(M);
+			if (RV.Calls.empty()) return false;
+
+			char *path = getenv("ROTATIONPATH");
+			if (!path) {
+				errs() << "Rotation decomposer not found!\n";
+				return false;
+			}
+			bool gridsynth = std::string(path).find("gridsynth") != std::string::npos;
+			if (!gridsynth && std::string(path).find("sqct") == std::string::npos) {
+				errs() << "Invalid rotation decomposer!\n";
+				return false;
+			}
+
+			// Create a FunctionType object with 'void' return type and one 'qbit'
+			// parameter
+			FunctionType *FuncType = FunctionType::get(
+				Type::getVoidTy(getGlobalContext()),
+				ArrayRef<Type*>(Type::getInt16Ty(getGlobalContext())),
+				false);
+
+			// Phase 2: one decomposition per unique (angle, axis)
+			std::map<std::string, Decomposition> Pending;
+			std::vector<std::pair<CallInst*, Function*> > Replacements;
+			for (unsigned c = 0; c < RV.Calls.size(); ++c) {
+				CallInst &I = *RV.Calls[c];
+				std::string axis;
+				switch (I.getCalledFunction()->getIntrinsicID()) {
+					case Intrinsic::Rx: axis = std::string(" X "); break;
+					case Intrinsic::Ry: axis = std::string(" Y "); break;
+					default:            axis = std::string(" Z "); break;
+				}
 				// Extract the target qubit from the CallInst
-				// Using CallSite
-				// CallSite CS(&I);
-				// Value *Target = CS.getArgument(0);
-				// errs() << *Target << "\n";
-				// END CallSite
 				Value *Target = I.getArgOperand(0);
 				// Extract the rotation angle from the CallInst
 				double Angle = cast<ConstantFP>(I.getArgOperand(1))
@@ -97,11 +408,12 @@ namespace {
 				if ( Angle == 0.0 || Angle == -0.0 ) {
 					errs() << "Rotation angle is " << Angle << " for " << Target->getName() << "\n";
 					I.eraseFromParent();
-					return;
+					continue;
 				}
 				// Create a unique function name (for lookup later)
+				// Rz keeps the historic name, Rx and Ry get their own
 				std::string buf; raw_string_ostream ss(buf);
-				ss << "DecomposeRotation_" << Angle;
+				ss << "DecomposeRotation" << (axis[1] == 'Z' ? "" : axis.substr(1, 1)) << "_" << Angle;
 				std::string FuncName = ss.str();
 				// Sanitize strings
 				for (std::string::iterator iter = FuncName.begin(); iter < FuncName.end(); iter++) {
@@ -112,107 +424,93 @@ namespace {
 						case '"': FuncName.erase(iter); iter--; break;
 					}
 				}
-				// Create a FunctionType object with 'void' return type and one 'qbit'
-				// parameter
-				FunctionType *FuncType = FunctionType::get(
-					Type::getVoidTy(getGlobalContext()),
-					ArrayRef<Type*>(Type::getInt16Ty(getGlobalContext())),
-					false);
 				// Lookup the Function in the module
-				Function *DR = M->getFunction(FuncName);
-				// If it does not exist perform a decomposition
+				Function *DR = M.getFunction(FuncName);
+				// If it does not exist schedule a decomposition
 				if (!DR) {
-					// Create the new function
 					DR = Function::Create(FuncType, GlobalVariable::ExternalLinkage,
-						FuncName, M);
-
-					Function::arg_iterator args = DR->arg_begin(); //set name of variable
-					Value* qArg = args;
-					qArg->setName("q");
+						FuncName, &M);
 
-					// Create a BasicBlock and insert it at the end of the Function
-					BasicBlock *BB = BasicBlock::Create(getGlobalContext(), "", DR, 0);
-					// Populate the BasicBlock
 					// Build rotation decomposition command
-					std::string buf; std::ostringstream ss2;
-					char *path = getenv("ROTATIONPATH");
-					if (!path) {
-						errs() << "Rotation decomposer not found!\n";
-						return;
+					std::ostringstream ss2;
+					// Cache key: axis, exact angle bits and precision
+					uint64_t AngleBits;
+					memcpy(&AngleBits, &Angle, sizeof(AngleBits));
+					std::string key; raw_string_ostream keyss(key);
+					keyss << axis[1] << '|';
+					keyss.write_hex(AngleBits);
+					keyss << '|';
+					if (gridsynth) {
+						ss2 << path << " \"(" << std::fixed << Angle << ")\"";
+						keyss << 0;
 					}
-          if (std::string(path).find("gridsynth") != std::string::npos) {
-    			  ss2 << path << " \"(" << std::fixed << Angle << ")\"";          
-          }
-          else if (std::string(path).find("sqct") != std::string::npos) {
-            ss2 << path << " " << Angle << axis << SqctLevels;
-          }
-          else {
-            errs() << "Invalid rotation decomposer!\n";
-            return;
-          }
-          
-          buf = ss2.str();
-          raw_string_ostream ss3(buf);          
-					errs() << "Calling '" << ss3.str() << "'\n";
-					// Capture result
-					std::string circuit = exec(ss3.str().c_str());
-
-					// For each gate in decomposition:
-          // (the decomposed string is given in the reverse order that ops must be applied)
-					for (int i=circuit.length()-1, e=0; i>=e; i--) {
-						Function *gate = NULL;
-						switch(circuit[i]) {
-							case 'T':
-								gate = Intrinsic::getDeclaration(M, Intrinsic::T);
-								break;
-							case 't':
-								gate = Intrinsic::getDeclaration(M, Intrinsic::Tdag);
-								break;
-							case 'P':
-								// TODO: P NOT YET SUPPORTED
-								gate = Intrinsic::getDeclaration(M, Intrinsic::S);
-								break;
-							case 'p':
-								// TODO: P NOT YET SUPPORTED
-								gate = Intrinsic::getDeclaration(M, Intrinsic::Sdag);
-								break;
-							case 'H':
-								gate = Intrinsic::getDeclaration(M, Intrinsic::H);
-								break;
-							case 'X':
-								gate = Intrinsic::getDeclaration(M, Intrinsic::X);
-								break;
-							case 'Y':
-								gate = Intrinsic::getDeclaration(M, Intrinsic::Y);
-								break;
-							case 'Z':
-								gate = Intrinsic::getDeclaration(M, Intrinsic::Z);
-								break;
-							default:
-								continue;
-						}
-						CallInst *newCallInst;
-						newCallInst = CallInst::Create(gate, ArrayRef<Value*>(DR->arg_begin()),
-								// Insert at front
-								// "", BB->front());
-								// Insert at end
-								"", BB);
-						//newCallInst->setTailCall();
+					else {
+						ss2 << path << " " << Angle << axis << SqctLevels;
+						if (SqctQuadPrecision) ss2 << " -q";
+						keyss << SqctLevels;
 					}
-					ReturnInst::Create(getGlobalContext(), 0, BB);
-				} // endif 'decomposition not found'
-				// Replace the old Rz call with the new call to Decomposed_Rotation
-				BasicBlock::iterator ii(&I);
-				ReplaceInstWithInst(I.getParent()->getInstList(), ii,
-					CallInst::Create(DR, ArrayRef<Value*>(Target)));
-				// } // endif 'found Rz'
-			} // visitCallInst()
 
-		}; // struct RotationVisitor
+					Decomposition &D = Pending[FuncName];
+					D.Command = ss2.str();
+					D.Key = keyss.str();
+					D.DR = DR;
+					D.Angle = Angle;
+					D.Axis = axis[1];
+				}
+				Replacements.push_back(std::make_pair(&I, DR));
+			}
 
-		virtual bool runOnModule(Module &M) {
-			RotationVisitor RV(&M);
-			RV.visit(M);
+			// Phase 3: run the decomposer for all angles not in the cache
+			static SqctLibrary Sqct;
+			bool inProcess = !gridsynth && UseSqctLibrary && (Sqct.loaded() || SqctLibrary::available(path));
+			std::string Decomposer = decomposerKey(path, inProcess);
+			std::vector<std::string> Results;
+			std::vector<Decomposition*> Missing;
+			for (std::map<std::string, Decomposition>::iterator it = Pending.begin(); it != Pending.end(); ++it) {
+				Decomposition &D = it->second;
+				if (Cache.lookup(Decomposer + D.Key, D.Gates)) {
+					errs() << "Cached '" << D.Command << "'\n";
+					continue;
+				}
+				Missing.push_back(&D);
+			}
+			if (!Missing.empty()) {
+				// the library may fail to load, then the results come from rotZ
+				if (inProcess && !Sqct.load(path)) {
+					inProcess = false;
+					Decomposer = decomposerKey(path, false);
+				}
+				for (unsigned i = 0; i < Missing.size(); ++i)
+					errs() << (inProcess ? "Decomposing '" : "Calling '") << Missing[i]->Command << "'\n";
+
+				Results.resize(Missing.size());
+				if (inProcess)
+					Sqct.decompose(Missing, Results, SqctLevels, scaffoldThreads(RotationJobs));
+				else {
+					DecomposerJobs Jobs(Missing, Results);
+					scaffoldParallelFor(Missing.size(), RotationJobs, DecomposerJobs::run, &Jobs);
+				}
+			}
+			for (unsigned i = 0; i < Missing.size(); ++i) {
+				// Only gate letters are interpreted, drop the whitespace
+				const std::string &output = Results[i];
+				for (std::string::const_iterator c = output.begin(); c != output.end(); ++c)
+					if (!isspace(*c)) Missing[i]->Gates += *c;
+				if (output != "ERROR" && !Missing[i]->Gates.empty())
+					Cache.insert(Decomposer + Missing[i]->Key, Missing[i]->Gates);
+			}
+
+			// Phase 4: materialize the DecomposeRotation_* functions
+			for (std::map<std::string, Decomposition>::iterator it = Pending.begin(); it != Pending.end(); ++it)
+				materialize(M, it->second.DR, it->second.Gates);
+
+			// Replace the old rotation calls with the new calls to Decomposed_Rotation
+			for (unsigned r = 0; r < Replacements.size(); ++r) {
+				CallInst &I = *Replacements[r].first;
+				BasicBlock::iterator ii(&I);
+				ReplaceInstWithInst(I.getParent()->getInstList(), ii,
+					CallInst::Create(Replacements[r].second, ArrayRef<Value*>(I.getArgOperand(0))));
+			}
 
 			return true;
 		} // runOnModule()
@@ -222,4 +520,3 @@ namespace {
 
 char Rotations::ID = 0;
 static RegisterPass<Rotations> X("Rotations", "Rotation Decomposition", false, false);
-
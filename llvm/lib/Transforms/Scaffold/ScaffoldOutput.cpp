@@ -0,0 +1,109 @@
+//===------------------------ ScaffoldOutput.cpp -------------------------===//
+// This file implements the output stream shared by the Scaffold passes, see
+// ScaffoldOutput.h.
+//
+//        This file was created by Scaffold Compiler Working Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <string>
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "ScaffoldOutput.h"
+
+
+using namespace llvm;
+
+static cl::opt<std::string>
+ScaffoldOutput("scaffold-output", cl::init(""), cl::Hidden,
+    cl::desc("File the Scaffold passes write their output to instead of stderr "
+             "(compressed if it ends in .gz or .zst)"));
+
+#define SCAFFOLD_OUTPUT_BUFFER (1 << 20)
+
+namespace {
+
+  // Owns the output file, or the compressor it is piped through, and
+  // flushes it when the library is unloaded
+  struct outputFile {
+    raw_fd_ostream *out;
+    FILE *pipe;
+
+    outputFile() : out(NULL), pipe(NULL) {}
+
+    ~outputFile() { close(); }
+
+    void close() {
+      delete out; //flushes, and closes the file if it owns it
+      out = NULL;
+      if(pipe && pclose(pipe) != 0)
+        errs() << "scaffold-output: compressing " << ScaffoldOutput << " failed\n";
+      pipe = NULL;
+    }
+
+    static bool endsWith(const std::string &s, const char *suffix) {
+      std::string x(suffix);
+      return s.size() > x.size() && s.compare(s.size() - x.size(), x.size(), x) == 0;
+    }
+
+    // quote for the shell that runs the compressor
+    static std::string quote(const std::string &s) {
+      std::string q = "'";
+      for(size_t i = 0; i < s.size(); i++){
+        if(s[i] == '\'')
+          q += "'\\''";
+        else
+          q += s[i];
+      }
+      return q + "'";
+    }
+
+    raw_ostream &open() {
+      const std::string &name = ScaffoldOutput;
+      const char *compressor = NULL;
+      if(endsWith(name, ".gz"))
+        compressor = "gzip -c > ";
+      else if(endsWith(name, ".zst"))
+        compressor = "zstd -q -c > ";
+
+      if(compressor){
+        pipe = popen((compressor + quote(name)).c_str(), "w");
+        if(!pipe){
+          errs() << "scaffold-output: cannot start compressor for " << name << ", writing to stderr\n";
+          return errs();
+        }
+        out = new raw_fd_ostream(fileno(pipe), false);
+      }
+      else{
+        std::string err;
+        out = new raw_fd_ostream(name.c_str(), err);
+        if(!err.empty()){
+          errs() << "scaffold-output: " << err << ", writing to stderr\n";
+          delete out;
+          out = NULL;
+          return errs();
+        }
+      }
+      out->SetBufferSize(SCAFFOLD_OUTPUT_BUFFER);
+      return *out;
+    }
+  };
+
+  outputFile TheOutputFile;
+  raw_ostream *TheOutput = NULL;
+}
+
+raw_ostream &llvm::scaffoldOut() {
+  if(!TheOutput)
+    TheOutput = ScaffoldOutput.empty() ? &errs() : &TheOutputFile.open();
+  return *TheOutput;
+}
+
+void scaffoldSetOutput(const char *file) {
+  if(TheOutput)
+    TheOutput->flush();
+  TheOutputFile.close();
+  TheOutput = NULL;
+  ScaffoldOutput = file ? file : "";
+}
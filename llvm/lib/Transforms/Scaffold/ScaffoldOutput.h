@@ -0,0 +1,30 @@
+//===------------------------- ScaffoldOutput.h --------------------------===//
+// Output stream shared by the Scaffold passes that print QASM, schedules or
+// resource counts. With -scaffold-output=<file> the output goes to <file>
+// through a large buffer, compressed by gzip or zstd when <file> ends in .gz
+// or .zst. Without it the output goes to errs() as before. Diagnostics are
+// always printed to errs(), so they never end up in the output file.
+//
+//        This file was created by Scaffold Compiler Working Group
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCAFFOLD_OUTPUT_H
+#define SCAFFOLD_OUTPUT_H
+
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+
+  // Stream the passes print their output to, opened on first use and
+  // flushed and closed when opt exits
+  raw_ostream &scaffoldOut();
+
+} // End of llvm namespace
+
+// Close the current output and send the output of the passes that run next
+// to <file>, or to errs() when <file> is NULL or empty. The scaffold driver
+// looks it up by name after loading the library, so it has C linkage.
+extern "C" void scaffoldSetOutput(const char *file);
+
+#endif // SCAFFOLD_OUTPUT_H
@@ -0,0 +1,75 @@
+//===---------------------- ScaffoldWorkQueue.cpp ------------------------===//
+// This file implements the work queue shared by the Scaffold passes, see
+// ScaffoldWorkQueue.h.
+//
+//        This file was created by Scaffold Compiler Working Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "ScaffoldWorkQueue.h"
+
+
+using namespace llvm;
+
+namespace {
+
+  struct workQueue {
+    unsigned count;
+    void (*run)(void *arg, unsigned i);
+    void *arg;
+    unsigned next; //next index to hand out
+    sys::Mutex lock;
+
+    static void *worker(void *self){
+      workQueue *q = static_cast<workQueue*>(self);
+      while(true){
+        unsigned i;
+        {
+          MutexGuard guard(q->lock);
+          i = q->next++;
+        }
+        if(i >= q->count)
+          break;
+        q->run(q->arg, i);
+      }
+      return 0;
+    }
+  };
+
+} // End of anonymous namespace
+
+unsigned llvm::scaffoldThreads(unsigned jobs){
+  if(jobs == 0){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = cpus > 0 ? cpus : 1;
+  }
+  return jobs;
+}
+
+void llvm::scaffoldParallelFor(unsigned count, unsigned jobs,
+                               void (*run)(void *arg, unsigned i), void *arg){
+  workQueue q;
+  q.count = count;
+  q.run = run;
+  q.arg = arg;
+  q.next = 0;
+
+  jobs = scaffoldThreads(jobs);
+  if(jobs > count)
+    jobs = count;
+  std::vector<pthread_t> threads;
+  for(unsigned j = 1; j < jobs; j++){
+    pthread_t thread;
+    if(pthread_create(&thread, 0, workQueue::worker, &q) != 0)
+      break; //the threads started so far take the rest
+    threads.push_back(thread);
+  }
+  workQueue::worker(&q);
+  for(unsigned j = 0; j < threads.size(); j++)
+    pthread_join(threads[j], 0);
+}
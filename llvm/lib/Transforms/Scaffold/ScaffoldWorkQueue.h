@@ -0,0 +1,27 @@
+//===----------------------- ScaffoldWorkQueue.h -------------------------===//
+// Work queue shared by the Scaffold passes that run independent jobs, such
+// as rotation decompositions or schedules, on a bounded set of threads.
+//
+//        This file was created by Scaffold Compiler Working Group
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCAFFOLD_WORK_QUEUE_H
+#define SCAFFOLD_WORK_QUEUE_H
+
+namespace llvm {
+
+  // Number of threads to use for a requested number of jobs, 0 meaning
+  // one per online CPU
+  unsigned scaffoldThreads(unsigned jobs);
+
+  // Calls run(arg, i) for every i in [0, count) on at most
+  // scaffoldThreads(jobs) threads, the calling thread being one of them.
+  // Every thread takes the next index until none is left, so slow jobs do
+  // not hold back the rest. Returns when all calls have returned.
+  void scaffoldParallelFor(unsigned count, unsigned jobs,
+                           void (*run)(void *arg, unsigned i), void *arg);
+
+} // End of llvm namespace
+
+#endif // SCAFFOLD_WORK_QUEUE_H
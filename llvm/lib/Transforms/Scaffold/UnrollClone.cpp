@@ -0,0 +1,289 @@
+//===--------------------------- UnrollClone.cpp -------------------------===//
+// This file implements the Scaffold pass that fully unrolls loops and clones
+// functions with constant arguments until the module stops changing. One
+// iteration runs the same passes as one round of the unrolling loop of
+// Scaffold_revkit.makefile:
+//
+//   -mem2reg -loops -loop-simplify -loop-rotate -lcssa -loop-unroll
+//   -unroll-threshold=100000000 -sccp -simplifycfg
+//   -FunctionClone -sccp
+//   -deadargelim
+//
+// but on the module in memory. Instead of printing the module and comparing
+// it to the previous one with diff, every iteration computes a fingerprint
+// of the module and the loop stops when it is the same as the one before.
+//
+//        This file was created by Scaffold Compiler Working Group
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "UnrollClone"
+#include <cstdio>
+#include "llvm/Pass.h"
+#include "llvm/PassManager.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Function.h"
+#include "llvm/Module.h"
+#include "llvm/BasicBlock.h"
+#include "llvm/Instruction.h"
+#include "llvm/Instructions.h"
+#include "llvm/Type.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Constants.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+
+using namespace llvm;
+
+static cl::opt<unsigned>
+UnrollCloneThreshold("unroll-clone-threshold", cl::init(100000000), cl::Hidden,
+    cl::desc("Loop unroll threshold of every iteration"));
+
+static cl::opt<unsigned>
+UnrollCloneMaxIter("unroll-clone-max-iter", cl::init(0), cl::Hidden,
+    cl::desc("Stop after this many iterations even if the module still changes (0 = no limit)"));
+
+static cl::opt<bool>
+UnrollCloneQuiet("unroll-clone-quiet", cl::init(false), cl::Hidden,
+    cl::desc("Do not report the time and module size of every iteration"));
+
+namespace {
+
+  // Size of a module, reported after every iteration
+  struct moduleSize {
+    unsigned functions;
+    unsigned blocks;
+    unsigned instructions;
+  };
+
+  // Hash of the parts of a module the iterations change: functions and
+  // their signatures, global initializers, and the opcode, type and
+  // operands of every instruction. Arguments, blocks and instructions are
+  // numbered within their function and hashed by number, so rewiring a use
+  // changes the hash. Types are hashed with their full structure and
+  // constants by value, recursing into constant expressions.
+  class moduleFingerprint {
+    uint64_t h;
+    DenseMap<const Value*, unsigned> local; //numbers within the current function
+
+    void add(uint64_t v){
+      // FNV-1a over the bytes of v
+      for(int i = 0; i < 8; i++){
+        h ^= (v >> (8 * i)) & 0xff;
+        h *= 1099511628211ULL;
+      }
+    }
+
+    void add(StringRef s){
+      add((uint64_t)s.size());
+      for(size_t i = 0; i < s.size(); i++){
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+      }
+    }
+
+    void addType(Type* T){
+      add((uint64_t)T->getTypeID());
+      if(IntegerType* IT = dyn_cast<IntegerType>(T))
+        add((uint64_t)IT->getBitWidth());
+      else if(StructType* ST = dyn_cast<StructType>(T)){
+        // named structs can be recursive, their name identifies them
+        if(ST->hasName())
+          add(ST->getName());
+        else{
+          add((uint64_t)ST->getNumElements());
+          for(unsigned i = 0; i < ST->getNumElements(); i++)
+            addType(ST->getElementType(i));
+        }
+      }
+      else if(PointerType* PT = dyn_cast<PointerType>(T)){
+        add((uint64_t)PT->getAddressSpace());
+        addType(PT->getElementType());
+      }
+      else if(SequentialType* QT = dyn_cast<SequentialType>(T)){
+        if(ArrayType* AT = dyn_cast<ArrayType>(T))
+          add(AT->getNumElements());
+        else if(VectorType* VT = dyn_cast<VectorType>(T))
+          add((uint64_t)VT->getNumElements());
+        addType(QT->getElementType());
+      }
+      else if(FunctionType* FT = dyn_cast<FunctionType>(T)){
+        add((uint64_t)FT->isVarArg());
+        addType(FT->getReturnType());
+        add((uint64_t)FT->getNumParams());
+        for(unsigned i = 0; i < FT->getNumParams(); i++)
+          addType(FT->getParamType(i));
+      }
+    }
+
+    void addConstant(Constant* C){
+      if(GlobalValue* GV = dyn_cast<GlobalValue>(C)){
+        add(GV->getName());
+        return;
+      }
+      addType(C->getType());
+      if(ConstantInt* CI = dyn_cast<ConstantInt>(C)){
+        const APInt& v = CI->getValue();
+        for(unsigned i = 0; i < v.getNumWords(); i++)
+          add(v.getRawData()[i]);
+      }
+      else if(ConstantFP* CF = dyn_cast<ConstantFP>(C)){
+        APInt v = CF->getValueAPF().bitcastToAPInt();
+        for(unsigned i = 0; i < v.getNumWords(); i++)
+          add(v.getRawData()[i]);
+      }
+      else if(ConstantDataSequential* CD = dyn_cast<ConstantDataSequential>(C))
+        add(CD->getRawDataValues());
+      else{
+        // constant expressions and aggregates
+        if(ConstantExpr* CE = dyn_cast<ConstantExpr>(C)){
+          add((uint64_t)CE->getOpcode());
+          if(CE->isCompare())
+            add((uint64_t)CE->getPredicate());
+        }
+        add((uint64_t)C->getNumOperands());
+        for(unsigned o = 0; o < C->getNumOperands(); o++)
+          addOperand(C->getOperand(o));
+      }
+    }
+
+    void addOperand(Value* V){
+      add((uint64_t)V->getValueID());
+      DenseMap<const Value*, unsigned>::iterator L = local.find(V);
+      if(L != local.end())
+        add((uint64_t)L->second);
+      else if(Constant* C = dyn_cast<Constant>(V))
+        addConstant(C);
+      else
+        addType(V->getType());
+    }
+
+  public:
+    moduleFingerprint() : h(14695981039346656037ULL) {}
+
+    uint64_t value() const { return h; }
+
+    void addModule(Module& M, moduleSize& size){
+      size.functions = size.blocks = size.instructions = 0;
+      for(Module::global_iterator G = M.global_begin(), GE = M.global_end(); G != GE; ++G){
+        add(G->getName());
+        add((uint64_t)G->hasInitializer());
+        if(G->hasInitializer())
+          addConstant(G->getInitializer());
+      }
+      for(Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F){
+        add(F->getName());
+        addType(F->getFunctionType());
+        add((uint64_t)F->isDeclaration());
+        if(F->isDeclaration())
+          continue;
+        size.functions++;
+
+        // number everything first, operands may refer to later blocks and
+        // instructions
+        local.clear();
+        unsigned n = 0;
+        for(Function::arg_iterator A = F->arg_begin(), AE = F->arg_end(); A != AE; ++A)
+          local[A] = n++;
+        for(Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB){
+          local[BB] = n++;
+          for(BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+            local[I] = n++;
+        }
+
+        for(Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB){
+          size.blocks++;
+          add((uint64_t)BB->size());
+          for(BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I){
+            size.instructions++;
+            add((uint64_t)I->getOpcode());
+            if(CmpInst* CI = dyn_cast<CmpInst>(I))
+              add((uint64_t)CI->getPredicate());
+            addType(I->getType());
+            add((uint64_t)I->getNumOperands());
+            for(unsigned o = 0; o < I->getNumOperands(); o++)
+              addOperand(I->getOperand(o));
+          }
+        }
+      }
+      local.clear();
+    }
+  };
+
+  // Derived from ModulePass to run the unroll and clone passes to a fixpoint
+  struct UnrollClone : public ModulePass {
+    static char ID; // Pass identification
+    UnrollClone() : ModulePass(ID) {}
+
+    void addPasses(PassManager& PM);
+
+    bool runOnModule (Module &M);
+  }; // End of struct UnrollClone
+} // End of anonymous namespace
+
+
+char UnrollClone::ID = 0;
+static RegisterPass<UnrollClone> X("UnrollClone", "Unroll loops and clone functions until the module does not change");
+
+
+void UnrollClone::addPasses(PassManager& PM){
+  // -loops and -lcssa are pulled in by the loop passes that require them
+  PM.add(createPromoteMemoryToRegisterPass());
+  PM.add(createLoopSimplifyPass());
+  PM.add(createLoopRotatePass());
+  PM.add(createLCSSAPass());
+  PM.add(createLoopUnrollPass(UnrollCloneThreshold));
+  PM.add(createSCCPPass());
+  PM.add(createCFGSimplificationPass());
+
+  // FunctionClone lives in this library, create it through the registry
+  const PassInfo* PI = PassRegistry::getPassRegistry()->getPassInfo(StringRef("FunctionClone"));
+  if(PI)
+    PM.add(PI->createPass());
+  else
+    errs() << "UnrollClone: FunctionClone pass not registered, not cloning\n";
+  PM.add(createSCCPPass());
+
+  PM.add(createDeadArgEliminationPass());
+}
+
+bool UnrollClone::runOnModule (Module &M){
+  PassManager PM;
+  addPasses(PM);
+
+  moduleSize size;
+  moduleFingerprint start;
+  start.addModule(M, size);
+  uint64_t last = start.value();
+  if(!UnrollCloneQuiet)
+    errs() << "[UnrollClone] start: " << size.functions << " functions, "
+           << size.blocks << " blocks, " << size.instructions << " instructions\n";
+
+  bool changed = false;
+  for(unsigned iter = 1; UnrollCloneMaxIter == 0 || iter <= UnrollCloneMaxIter; iter++){
+    TimeRecord before = TimeRecord::getCurrentTime(true);
+    PM.run(M);
+    TimeRecord after = TimeRecord::getCurrentTime(false);
+
+    moduleFingerprint fp;
+    fp.addModule(M, size);
+    if(!UnrollCloneQuiet){
+      char secs[32];
+      snprintf(secs, sizeof(secs), "%.3f", after.getWallTime() - before.getWallTime());
+      errs() << "[UnrollClone] iteration " << iter << ": " << secs << "s, "
+             << size.functions << " functions, " << size.blocks << " blocks, "
+             << size.instructions << " instructions\n";
+    }
+    if(fp.value() == last)
+      break;
+    last = fp.value();
+    changed = true;
+  }
+  return changed;
+} // End runOnModule
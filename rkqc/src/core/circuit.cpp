@@ -17,9 +17,9 @@
 
 #include "circuit.hpp"
 
+#include <cstdlib>
 #include <iostream>
 #include <string>
-#include <fstream>
 
 #include <boost/bind.hpp>
 #include <boost/range/adaptors.hpp>
@@ -28,6 +28,7 @@
 #include "gate.hpp"
 
 #include "functions/copy_circuit.hpp"
+#include "io/write_qasm.hpp"
 
 namespace revkit
 {
@@ -932,7 +933,6 @@ namespace revkit
     else{
         anc_11.push_back( *input );
     }
-    print_signal( input, classifier );
   }
 
 
@@ -1064,10 +1064,50 @@ namespace revkit
     boost::apply_visitor( annotate_visitor( g, key, value ), circ );
   }
 
+  void circuit::set_gate_sink( const boost::shared_ptr<gate_sink>& sink )
+  {
+    _sink = sink;
+  }
+
+  gate_sink& circuit::gate_output()
+  {
+    if ( !_sink )
+    {
+      _sink.reset( new memory_gate_sink() );
+    }
+    return *_sink;
+  }
+
+  const gate_sink& circuit::gate_output() const
+  {
+    if ( !_sink )
+    {
+      _sink.reset( new memory_gate_sink() );
+    }
+    return *_sink;
+  }
+
 /*----- Qubit Class Operations and Constructors -------*/
 
   circuit global_circuit = circuit( 0 );
-  circuit qint::circ = global_circuit; 
+  circuit& qint::circ = global_circuit;
+
+  // destroyed before global_circuit since it is defined after it
+  struct write_global_circuit_at_exit
+  {
+    ~write_global_circuit_at_exit()
+    {
+      const char* filename = getenv( "RKQC_QASM" );
+      if ( filename )
+      {
+        std::string error;
+        if ( !write_qasm( global_circuit, filename, &error ) )
+        {
+          std::cerr << error << std::endl;
+        }
+      }
+    }
+  } write_global_circuit_at_exit_instance;
 
   qint::qint(void){
 	reg = std::vector<qint*>(1);
@@ -1089,7 +1129,6 @@ namespace revkit
   qbit::qbit(void){
     id = 0;
     circ.initialize_worker(&id, &name);
-    circ.print_signal( &name, 4 );
   }
 
   qbit::qbit( bool flag ){
@@ -1104,7 +1143,6 @@ namespace revkit
     std::string reg_name = reg_prefix + "I0";
     id = circ.workers.size();
     circ.lines_to_inputs[reg[0]->id] = reg_name;
-    circ.print_signal( &reg_name, 4 );
     reg[0]->name = reg_name;
     circ.workers[circ.workers.size()-1] = reg_name;
     while( i < num ){
@@ -1114,7 +1152,6 @@ namespace revkit
       reg[i]->name = reg_bit_name;
       circ.workers[circ.workers.size()-1] = reg_bit_name;
       circ.lines_to_inputs[reg[reg.size()-1]->id] = reg_bit_name;
-      circ.print_signal( &reg_bit_name, 4 );
       i++;
     }
   }
@@ -1221,20 +1258,5 @@ namespace revkit
         i++;
     }
   }
-
-  void circuit::print_signal( std::string* name, int flag ){
-    std::ofstream signals;
-    std::string title;
-    if (flag == 4) title = "workers.txt";
-    else if(flag == 0) title = "ancilla_0g.txt";
-    else if(flag == 1) title = "ancilla_00.txt";
-    else if(flag == 2) title = "ancilla_1g.txt";
-    else title = "ancilla_11.txt";
-    signals.open(title.c_str(), std::ios_base::app);
-    if (signals.is_open()){
-        signals << "qubit " << *name << std::endl;
-        signals.close();
-    }
-  }
 }
 
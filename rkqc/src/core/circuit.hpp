@@ -44,6 +44,7 @@
 #include <boost/variant.hpp>
 
 #include <core/gate.hpp>
+#include <core/gate_sink.hpp>
 #include <core/meta/bus_collection.hpp>
 
 namespace revkit
@@ -757,7 +758,39 @@ namespace revkit
     void remove_worker( int* input );
     void initialize_worker( int* id, std::string* name  ); 
     void initialize_ancilla( int* id, std::string* input, int classifier );
-    void print_signal( std::string* name, int flag );
+
+    /**
+     * @brief Sets the sink for gates emitted by the create_ functions
+     *
+     * By default, i.e. if no sink is set or \p sink is empty, the
+     * gates are recorded in a memory_gate_sink owned by the circuit.
+     *
+     * @param sink Gate sink
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void set_gate_sink( const boost::shared_ptr<gate_sink>& sink );
+
+    /**
+     * @brief Returns the sink for gates emitted by the create_ functions
+     *
+     * @return Gate sink of this circuit
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    gate_sink& gate_output();
+
+    /**
+     * @brief Returns the sink for gates emitted by the create_ functions
+     *
+     * @return Gate sink of this circuit
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const gate_sink& gate_output() const;
 
 
 
@@ -1196,15 +1229,26 @@ namespace revkit
     /** @cond */
     circuit_variant circ;
     std::map<std::string, boost::shared_ptr<circuit> > _modules;
+    mutable boost::shared_ptr<gate_sink> _sink;
     /** @endcond */
   };
 
 
+  /**
+   * @brief Circuit on which all qint operations act
+   *
+   * Signals and gates are recorded in memory. When the program exits
+   * and the environment variable <tt>RKQC_QASM</tt> is set, the circuit
+   * is written with write_qasm to the file named by that variable.
+   *
+   * @author RevKit
+   * @since  1.3
+   */
   extern circuit global_circuit;
 
   class qint{
     public:
-        static circuit circ;
+        static circuit& circ;
         std::vector<qint*> reg;
         std::string name;
     	int id;
@@ -0,0 +1,279 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compact_circuit.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <boost/foreach.hpp>
+
+#include "circuit.hpp"
+#include "target_tags.hpp"
+
+#define foreach BOOST_FOREACH
+
+namespace revkit
+{
+
+  ////////////////////////////// class compact_gate
+  compact_gate::compact_gate( type_tag tag, const gate::line* controls, unsigned nc, unsigned nt, bool swap, const boost::any* other )
+    : _tag( tag ),
+      _controls( controls ),
+      _nc( nc ),
+      _nt( nt ),
+      _swap( swap ),
+      _other( other )
+  {
+  }
+
+  compact_gate::const_iterator compact_gate::begin_controls() const
+  {
+    return _controls;
+  }
+
+  compact_gate::const_iterator compact_gate::end_controls() const
+  {
+    return _controls + _nc;
+  }
+
+  compact_gate::const_iterator compact_gate::begin_targets() const
+  {
+    return _controls + _nc;
+  }
+
+  compact_gate::const_iterator compact_gate::end_targets() const
+  {
+    return _controls + _nc + _nt;
+  }
+
+  unsigned compact_gate::size() const
+  {
+    return _nc + _nt;
+  }
+
+  compact_gate::type_tag compact_gate::tag() const
+  {
+    return _tag;
+  }
+
+  boost::any compact_gate::type() const
+  {
+    switch ( _tag )
+    {
+    case toffoli_type:
+      return toffoli_tag();
+    case cnot_type:
+      return cnot_tag();
+    case not_type:
+      return not_tag();
+    case fredkin_type:
+      return fredkin_tag();
+    case peres_type:
+      {
+        peres_tag tag;
+        tag.swap_targets = _swap;
+        return tag;
+      }
+    case v_type:
+      return v_tag();
+    case vplus_type:
+      return vplus_tag();
+    default:
+      return *_other;
+    }
+  }
+
+  compact_gate compact_gate_at::operator()( unsigned index ) const
+  {
+    const compact_circuit::record& r = circ->_records[index];
+
+    const gate::line* lines = r.lines;
+    if ( r.overflow )
+    {
+      lines = circ->_arena.empty() ? 0 : &circ->_arena[0] + r.lines[0];
+    }
+    const boost::any* other = r.tag == compact_gate::other_type ? &circ->_types[r.lines[1]] : 0;
+
+    return compact_gate( (compact_gate::type_tag)r.tag, lines, r.num_controls, r.num_targets, r.swap, other );
+  }
+
+  ////////////////////////////// class compact_circuit
+  compact_circuit::compact_circuit( unsigned lines )
+    : _lines( lines )
+  {
+  }
+
+  compact_circuit::compact_circuit( const circuit& circ )
+    : lines_to_inputs( circ.lines_to_inputs ),
+      _lines( circ.lines() )
+  {
+    reserve( circ.num_gates() );
+
+    foreach ( const gate& g, circ )
+    {
+      append_gate( g );
+    }
+  }
+
+  unsigned compact_circuit::num_gates() const
+  {
+    return _records.size();
+  }
+
+  void compact_circuit::set_lines( unsigned lines )
+  {
+    _lines = lines;
+  }
+
+  unsigned compact_circuit::lines() const
+  {
+    return _lines;
+  }
+
+  void compact_circuit::reserve( unsigned gates, unsigned lines )
+  {
+    _records.reserve( gates );
+    _arena.reserve( lines );
+  }
+
+  compact_circuit::const_iterator compact_circuit::begin() const
+  {
+    return boost::make_transform_iterator( boost::counting_iterator<unsigned>( 0u ), compact_gate_at( *this ) );
+  }
+
+  compact_circuit::const_iterator compact_circuit::end() const
+  {
+    return boost::make_transform_iterator( boost::counting_iterator<unsigned>( _records.size() ), compact_gate_at( *this ) );
+  }
+
+  compact_gate compact_circuit::operator[]( unsigned index ) const
+  {
+    return compact_gate_at( *this )( index );
+  }
+
+  void compact_circuit::append_gate( compact_gate::type_tag tag, const gate::line* controls, unsigned nc, const gate::line* targets, unsigned nt, bool swap )
+  {
+    assert( tag != compact_gate::other_type );
+    append_record( tag, controls, nc, targets, nt, swap, 0 );
+  }
+
+  void compact_circuit::append_gate( const gate& g )
+  {
+    // the ordered lists are not copied by gate::operator=, use the sets in this case
+    std::vector<gate::line> controls = g.controls_ordered();
+    if ( controls.size() != (unsigned)std::distance( g.begin_controls(), g.end_controls() ) )
+    {
+      controls.assign( g.begin_controls(), g.end_controls() );
+    }
+
+    std::vector<gate::line> targets = g.targets_ordered();
+    if ( targets.size() != (unsigned)std::distance( g.begin_targets(), g.end_targets() ) )
+    {
+      targets.assign( g.begin_targets(), g.end_targets() );
+    }
+
+    const gate::line* pc = controls.empty() ? 0 : &controls[0];
+    const gate::line* pt = targets.empty() ? 0 : &targets[0];
+
+    if ( is_toffoli( g ) )
+    {
+      append_record( compact_gate::toffoli_type, pc, controls.size(), pt, targets.size(), false, 0 );
+    }
+    else if ( is_cnot( g ) )
+    {
+      append_record( compact_gate::cnot_type, pc, controls.size(), pt, targets.size(), false, 0 );
+    }
+    else if ( is_not( g ) )
+    {
+      append_record( compact_gate::not_type, pc, controls.size(), pt, targets.size(), false, 0 );
+    }
+    else if ( is_fredkin( g ) )
+    {
+      append_record( compact_gate::fredkin_type, pc, controls.size(), pt, targets.size(), false, 0 );
+    }
+    else if ( is_peres( g ) )
+    {
+      bool swap = boost::any_cast<peres_tag>( g.type() ).swap_targets;
+
+      // keep the targets in gate order, also if they were taken from the set
+      if ( swap && !targets.empty() && targets.front() < targets.back() )
+      {
+        std::reverse( targets.begin(), targets.end() );
+      }
+      append_record( compact_gate::peres_type, pc, controls.size(), pt, targets.size(), swap, 0 );
+    }
+    else if ( is_v( g ) )
+    {
+      append_record( compact_gate::v_type, pc, controls.size(), pt, targets.size(), false, 0 );
+    }
+    else if ( is_vplus( g ) )
+    {
+      append_record( compact_gate::vplus_type, pc, controls.size(), pt, targets.size(), false, 0 );
+    }
+    else
+    {
+      append_record( compact_gate::other_type, pc, controls.size(), pt, targets.size(), false, &g.type() );
+    }
+  }
+
+  void compact_circuit::clear()
+  {
+    _records.clear();
+    _arena.clear();
+    _types.clear();
+  }
+
+  const std::vector<compact_circuit::record>& compact_circuit::records() const
+  {
+    return _records;
+  }
+
+  void compact_circuit::append_record( compact_gate::type_tag tag, const gate::line* controls, unsigned nc, const gate::line* targets, unsigned nt, bool swap, const boost::any* other )
+  {
+    assert( nc <= 0xFFFFu );
+
+    record r;
+    r.tag = tag;
+    r.swap = swap;
+    r.num_controls = nc;
+    r.num_targets = nt;
+
+    if ( nc + nt <= (unsigned)inline_lines && !other )
+    {
+      r.overflow = 0;
+      std::copy( controls, controls + nc, r.lines );
+      std::copy( targets, targets + nt, r.lines + nc );
+    }
+    else
+    {
+      r.overflow = 1;
+      r.lines[0] = _arena.size();
+      _arena.insert( _arena.end(), controls, controls + nc );
+      _arena.insert( _arena.end(), targets, targets + nt );
+
+      if ( other )
+      {
+        r.lines[1] = _types.size();
+        _types.push_back( *other );
+      }
+    }
+
+    _records.push_back( r );
+  }
+
+}
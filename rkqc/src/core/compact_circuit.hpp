@@ -0,0 +1,432 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file compact_circuit.hpp
+ *
+ * @brief Circuit storage with flat gate records
+ */
+
+#ifndef COMPACT_CIRCUIT_HPP
+#define COMPACT_CIRCUIT_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+
+#include <core/gate.hpp>
+
+namespace revkit
+{
+
+  class circuit;
+  class compact_circuit;
+
+  /**
+   * @brief Gate of a compact_circuit
+   *
+   * This is a light-weight view on one gate record of a
+   * compact_circuit. It is only valid as long as no gate is
+   * added to the circuit it was obtained from. Lines are
+   * enumerated in the order in which they were added to the
+   * original gate, i.e. as by gate::controls_ordered() and
+   * gate::targets_ordered().
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  class compact_gate
+  {
+  public:
+    /**
+     * @brief Kind of the target tag of a gate
+     *
+     * Gates whose target tag has no own kind (e.g. modules) are
+     * stored as \b other_type with their original boost::any.
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    enum type_tag { toffoli_type = 0, cnot_type, not_type, fredkin_type, peres_type, v_type, vplus_type, other_type };
+
+    /**
+     * @brief Iterator over the lines of a gate
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    typedef const gate::line* const_iterator;
+
+    /**
+     * @brief Default constructor
+     *
+     * @param tag      Kind of the target tag
+     * @param controls Pointer to the first control line
+     * @param nc       Number of control lines
+     * @param nt       Number of target lines, stored behind the control lines
+     * @param swap     Swap flag of a Peres gate
+     * @param other    Target tag if \p tag is other_type, otherwise 0
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    compact_gate( type_tag tag, const gate::line* controls, unsigned nc, unsigned nt, bool swap, const boost::any* other );
+
+    /**
+     * @brief Start iterator for the control lines
+     *
+     * @return Iterator
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const_iterator begin_controls() const;
+
+    /**
+     * @brief End iterator for the control lines
+     *
+     * @return Iterator
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const_iterator end_controls() const;
+
+    /**
+     * @brief Start iterator for the target lines
+     *
+     * @return Iterator
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const_iterator begin_targets() const;
+
+    /**
+     * @brief End iterator for the target lines
+     *
+     * @return Iterator
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const_iterator end_targets() const;
+
+    /**
+     * @brief Returns the number of control and target lines
+     *
+     * @return Number of lines
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    unsigned size() const;
+
+    /**
+     * @brief Returns the kind of the target tag
+     *
+     * @return Kind of the target tag
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    type_tag tag() const;
+
+    /**
+     * @brief Returns the target tag
+     *
+     * The tag is constructed from the kind, so this is as
+     * expensive as gate::set_type and should not be used
+     * in hot loops. Use tag() instead.
+     *
+     * @return Target tag as used by gate::type()
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    boost::any type() const;
+
+  private:
+    type_tag _tag;
+    const gate::line* _controls;
+    unsigned _nc;
+    unsigned _nt;
+    bool _swap;
+    const boost::any* _other;
+  };
+
+  /** @cond */
+  struct compact_gate_at
+  {
+    typedef compact_gate result_type;
+
+    compact_gate_at() : circ( 0 ) {}
+    explicit compact_gate_at( const compact_circuit& circ ) : circ( &circ ) {}
+
+    compact_gate operator()( unsigned index ) const;
+
+  private:
+    const compact_circuit* circ;
+  };
+  /** @endcond */
+
+  /**
+   * @brief Circuit storage with flat gate records
+   *
+   * A circuit stores every gate as a shared pointer to a gate object
+   * with line sets and a boost::any target tag, which amounts to several
+   * heap allocations per gate. This class stores each gate as one
+   * fixed-size record in a contiguous vector. The record keeps the
+   * kind of the target tag as a small integer and up to
+   * \ref inline_lines lines inline. Gates with more lines and gates
+   * with other target tags keep their lines in a shared overflow arena.
+   *
+   * Iteration yields compact_gate views with the same begin_controls(),
+   * end_controls(), begin_targets() and end_targets() interface as gate,
+   * so generic code over gates can be used for both. Use
+   * copy_circuit to convert between circuit and compact_circuit.
+   *
+   * Example:
+   * @code
+   * compact_circuit cc( circ );
+   * foreach ( const compact_gate& g, cc )
+   * {
+   *   // ...
+   * }
+   * @endcode
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  class compact_circuit
+  {
+  public:
+    /**
+     * @brief Number of lines which are stored inside the gate record
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    enum { inline_lines = 4 };
+
+    /**
+     * @brief Gate record
+     *
+     * If \b overflow is set, \b lines[0] is the offset of the lines in
+     * the arena and \b lines[1] is the index of the target tag in the
+     * tag list for gates of compact_gate::other_type.
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    struct record
+    {
+      /** @brief Kind of the target tag (a compact_gate::type_tag) */
+      boost::uint8_t tag;
+      /** @brief Swap flag of Peres gates */
+      boost::uint8_t swap : 1;
+      /** @brief Lines are stored in the arena */
+      boost::uint8_t overflow : 1;
+      /** @brief Number of control lines */
+      boost::uint16_t num_controls;
+      /** @brief Number of target lines */
+      boost::uint32_t num_targets;
+      /** @brief Control lines followed by the target lines, or arena offset */
+      boost::uint32_t lines[inline_lines];
+    };
+
+    /**
+     * @brief Const iterator over the gates
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    typedef boost::transform_iterator<compact_gate_at, boost::counting_iterator<unsigned> > const_iterator;
+
+    /**
+     * @brief Iterator over the gates (gates cannot be modified in place)
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    typedef const_iterator iterator;
+
+    /**
+     * @brief Default constructor
+     *
+     * @param lines Number of lines
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    explicit compact_circuit( unsigned lines = 0u );
+
+    /**
+     * @brief Creates a compact copy of the gates of a circuit
+     *
+     * The number of lines and the line names (circuit::lines_to_inputs)
+     * are copied as well.
+     *
+     * @param circ Circuit
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    explicit compact_circuit( const circuit& circ );
+
+    /**
+     * @brief Returns the number of gates
+     *
+     * @return Number of gates
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    unsigned num_gates() const;
+
+    /**
+     * @brief Sets the number of lines
+     *
+     * @param lines Number of lines
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void set_lines( unsigned lines );
+
+    /**
+     * @brief Returns the number of lines
+     *
+     * @return Number of lines
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    unsigned lines() const;
+
+    /**
+     * @brief Reserves memory for gates
+     *
+     * @param gates Number of gates
+     * @param lines Number of lines in the overflow arena
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void reserve( unsigned gates, unsigned lines = 0u );
+
+    /**
+     * @brief Start iterator over the gates
+     *
+     * @return Iterator
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const_iterator begin() const;
+
+    /**
+     * @brief End iterator over the gates
+     *
+     * @return Iterator
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const_iterator end() const;
+
+    /**
+     * @brief Random access to a gate
+     *
+     * @param index Index of the gate
+     * @return View on the gate
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    compact_gate operator[]( unsigned index ) const;
+
+    /**
+     * @brief Appends a gate
+     *
+     * @param tag      Kind of the target tag, must not be compact_gate::other_type
+     * @param controls Control lines
+     * @param nc       Number of control lines
+     * @param targets  Target lines
+     * @param nt       Number of target lines
+     * @param swap     Swap flag for Peres gates
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void append_gate( compact_gate::type_tag tag, const gate::line* controls, unsigned nc, const gate::line* targets, unsigned nt, bool swap = false );
+
+    /**
+     * @brief Appends a copy of a gate
+     *
+     * @param g Gate
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void append_gate( const gate& g );
+
+    /**
+     * @brief Removes all gates
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void clear();
+
+    /**
+     * @brief Returns the gate records
+     *
+     * @return Gate records
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const std::vector<record>& records() const;
+
+    /**
+     * @brief Line names, as circuit::lines_to_inputs
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    std::map<unsigned, std::string> lines_to_inputs;
+
+  private:
+    void append_record( compact_gate::type_tag tag, const gate::line* controls, unsigned nc, const gate::line* targets, unsigned nt, bool swap, const boost::any* other );
+
+    unsigned _lines;
+    std::vector<record> _records;
+    std::vector<gate::line> _arena;
+    std::vector<boost::any> _types;
+
+    friend struct compact_gate_at;
+  };
+
+}
+
+#endif /* COMPACT_CIRCUIT_HPP */
@@ -16,7 +16,6 @@
  */
 
 #include "add_gates.hpp"
-#include <fstream>
 
 #include <boost/assign/std/vector.hpp>
 #include <boost/foreach.hpp>
@@ -153,22 +152,14 @@ namespace revkit
 
   void create_toffoli( circuit& circ, const gate::line& control1, const gate::line& control2, const gate::line& target )
   {
-    std::ofstream gates;
-    gates.open("gates.txt", std::ios_base::app);
-    if (gates.is_open()){
-        gates << "toffoli " << circ.lines_to_inputs.find( control1 )->second << "," << circ.lines_to_inputs.find( control2 )->second << "," << circ.lines_to_inputs.find( target )->second << std::endl;
-        gates.close();
-    }
+    gate::line lines[] = { control1, control2, target };
+    circ.gate_output().add_gate( circ, gate_sink::toffoli_gate, lines, 3u );
   }
   
   void create_toffoli( circuit& circ, const gate::line& control1, const gate::line& control2, const gate::line& control3, const gate::line& target )
   {
-    std::ofstream gates;
-    gates.open("gates.txt", std::ios_base::app);
-    if (gates.is_open()){
-        gates << "toffoli " << circ.lines_to_inputs.find( control1 )->second << "," << circ.lines_to_inputs.find( control2 )->second << "," << circ.lines_to_inputs.find( control3 )->second << "," << circ.lines_to_inputs.find( target )->second << std::endl;
-        gates.close();
-    }
+    gate::line lines[] = { control1, control2, control3, target };
+    circ.gate_output().add_gate( circ, gate_sink::toffoli_gate, lines, 4u );
   }
 
   gate& create_fredkin( gate& g, const gate::line_container& controls, const gate::line& target1, const gate::line& target2 )
@@ -197,12 +188,8 @@ namespace revkit
 
   void create_cnot( circuit& circ, const gate::line& control, const gate::line& target )
   {
-    std::ofstream gates;
-    gates.open("gates.txt", std::ios_base::app);
-    if (gates.is_open()){
-        gates << "cnot " << circ.lines_to_inputs.find( control )->second << "," << circ.lines_to_inputs.find( target )->second << std::endl; 
-        gates.close();
-    }
+    gate::line lines[] = { control, target };
+    circ.gate_output().add_gate( circ, gate_sink::cnot_gate, lines, 2u );
   }
 
   gate& create_v( gate& g, const gate::line& control, const gate::line& target )
@@ -225,12 +212,7 @@ namespace revkit
 
   void create_not( circuit& circ, const gate::line& target )
   {
-    std::ofstream gates;
-    gates.open("gates.txt", std::ios_base::app);
-    if (gates.is_open()){
-        gates << "X " << circ.lines_to_inputs.find( target )->second << std::endl;
-        gates.close();
-    }
+    circ.gate_output().add_gate( circ, gate_sink::not_gate, &target, 1u );
   }
 
   gate& create_module( gate& g, const circuit& circ, const std::string& name, const gate::line_container& controls, const std::vector<unsigned>& targets )
@@ -281,6 +263,18 @@ namespace revkit
 
 
 
+  gate& append_toffoli( circuit& circ, const gate::line_container& controls, const gate::line& target )
+  {
+    gate& g = circ.append_gate();
+
+    std::for_each( controls.begin(), controls.end(),  boost::bind( &gate::add_control, &g, _1) );
+
+    g.add_target( target );
+    g.set_type( toffoli_tag() );
+
+    return g;
+  }
+
   gate& append_fredkin( circuit& circ, const gate::line_container& controls, const gate::line& target1, const gate::line& target2 )
   {
     return create_fredkin( circ.append_gate(), controls, target1, target2 );
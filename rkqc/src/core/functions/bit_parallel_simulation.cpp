@@ -0,0 +1,154 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bit_parallel_simulation.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../target_tags.hpp"
+
+namespace revkit
+{
+
+  // mask = conjunction of all control lines
+  static void control_mask( simulation_word* mask, const std::vector<simulation_word>& state, unsigned words, compact_gate::const_iterator begin, compact_gate::const_iterator end )
+  {
+    std::fill( mask, mask + words, ~simulation_word( 0u ) );
+    for ( compact_gate::const_iterator c = begin; c != end; ++c )
+    {
+      const simulation_word* line = &state[*c * words];
+      for ( unsigned w = 0u; w < words; ++w )
+      {
+        mask[w] &= line[w];
+      }
+    }
+  }
+
+  static bool simulate_module( std::vector<simulation_word>& state, unsigned words, const compact_gate& g, const simulation_word* mask )
+  {
+    boost::any type = g.type();
+    const module_tag* module = boost::any_cast<module_tag>( &type );
+    if ( !module )
+    {
+      return false;
+    }
+
+    // module line i is the target at position target_sort_order[i] in sorted order
+    std::vector<gate::line> targets( g.begin_targets(), g.end_targets() );
+    std::sort( targets.begin(), targets.end() );
+
+    const circuit& ref = *module->reference;
+    std::vector<simulation_word> sub( ref.lines() * words, 0u );
+    for ( unsigned i = 0u; i < module->target_sort_order.size(); ++i )
+    {
+      std::copy( &state[targets[module->target_sort_order[i]] * words], &state[targets[module->target_sort_order[i]] * words] + words, &sub[i * words] );
+    }
+
+    if ( !bit_parallel_simulation( sub, words, ref ) )
+    {
+      return false;
+    }
+
+    for ( unsigned i = 0u; i < module->target_sort_order.size(); ++i )
+    {
+      simulation_word* line = &state[targets[module->target_sort_order[i]] * words];
+      for ( unsigned w = 0u; w < words; ++w )
+      {
+        line[w] = ( line[w] & ~mask[w] ) | ( sub[i * words + w] & mask[w] );
+      }
+    }
+
+    return true;
+  }
+
+  bool bit_parallel_simulation( std::vector<simulation_word>& state, unsigned words, const compact_circuit& circ )
+  {
+    assert( state.size() >= circ.lines() * words );
+
+    std::vector<simulation_word> mask( words );
+
+    for ( compact_circuit::const_iterator it = circ.begin(); it != circ.end(); ++it )
+    {
+      const compact_gate g = *it;
+
+      control_mask( &mask[0], state, words, g.begin_controls(), g.end_controls() );
+
+      switch ( g.tag() )
+      {
+      case compact_gate::toffoli_type:
+      case compact_gate::cnot_type:
+      case compact_gate::not_type:
+        for ( compact_gate::const_iterator t = g.begin_targets(); t != g.end_targets(); ++t )
+        {
+          simulation_word* line = &state[*t * words];
+          for ( unsigned w = 0u; w < words; ++w )
+          {
+            line[w] ^= mask[w];
+          }
+        }
+        break;
+
+      case compact_gate::fredkin_type:
+        {
+          assert( g.end_targets() - g.begin_targets() == 2 );
+          simulation_word* a = &state[g.begin_targets()[0] * words];
+          simulation_word* b = &state[g.begin_targets()[1] * words];
+          for ( unsigned w = 0u; w < words; ++w )
+          {
+            simulation_word d = ( a[w] ^ b[w] ) & mask[w];
+            a[w] ^= d;
+            b[w] ^= d;
+          }
+        }
+        break;
+
+      case compact_gate::peres_type:
+        {
+          // targets are stored in gate order, i.e. the swap flag is already applied
+          assert( g.end_targets() - g.begin_targets() == 2 );
+          simulation_word* a = &state[g.begin_targets()[0] * words];
+          simulation_word* b = &state[g.begin_targets()[1] * words];
+          for ( unsigned w = 0u; w < words; ++w )
+          {
+            b[w] ^= mask[w] & a[w];
+            a[w] ^= mask[w];
+          }
+        }
+        break;
+
+      case compact_gate::other_type:
+        if ( !simulate_module( state, words, g, &mask[0] ) )
+        {
+          return false;
+        }
+        break;
+
+      default:
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool bit_parallel_simulation( std::vector<simulation_word>& state, unsigned words, const circuit& circ )
+  {
+    return bit_parallel_simulation( state, words, compact_circuit( circ ) );
+  }
+
+}
@@ -0,0 +1,95 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bit_parallel_simulation.hpp
+ *
+ * @brief Simulates many input patterns at once with bitwise operations
+ */
+
+#ifndef BIT_PARALLEL_SIMULATION_HPP
+#define BIT_PARALLEL_SIMULATION_HPP
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <core/circuit.hpp>
+#include <core/compact_circuit.hpp>
+
+namespace revkit
+{
+
+  /**
+   * @brief Machine word holding one line value of 64 patterns
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  typedef boost::uint64_t simulation_word;
+
+  /**
+   * @brief Simulates a block of input patterns in place
+   *
+   * \p state holds \p words consecutive words per line, i.e. the value of
+   * line \em l in pattern \em p is bit <tt>p % 64</tt> of
+   * <tt>state[l * words + p / 64]</tt>. So one call simulates
+   * <tt>64 * words</tt> patterns. Every gate is applied as a bitwise
+   * operation over the words of its lines: NOT, CNOT and Toffoli gates XOR
+   * the conjunction of the controls onto the target, Fredkin gates swap
+   * the masked bits of the targets, and Peres gates are a Toffoli gate
+   * followed by a CNOT gate. Modules are simulated recursively.
+   *
+   * The inner loops run over the \p words of a line, so choosing
+   * \p words as a multiple of 4 or 8 lets the compiler use AVX2 or
+   * AVX-512 registers if enabled.
+   *
+   * V and V+ gates have no Boolean semantics, the function returns
+   * false if the circuit contains one of them.
+   *
+   * @param state Line values, will be overwritten by the output values
+   * @param words Number of words per line
+   * @param circ  Circuit in flat storage (see compact_circuit)
+   *
+   * @return true on success, false if the circuit contains a non-Boolean gate
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  bool bit_parallel_simulation( std::vector<simulation_word>& state, unsigned words, const compact_circuit& circ );
+
+  /**
+   * @brief Simulates a block of input patterns in place
+   *
+   * Convenience overload which converts \p circ into a compact_circuit
+   * first. When simulating many blocks, convert once and use
+   * bit_parallel_simulation(std::vector<simulation_word>&, unsigned, const compact_circuit&).
+   *
+   * @param state Line values, will be overwritten by the output values
+   * @param words Number of words per line
+   * @param circ  Circuit
+   *
+   * @return true on success, false if the circuit contains a non-Boolean gate
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  bool bit_parallel_simulation( std::vector<simulation_word>& state, unsigned words, const circuit& circ );
+
+}
+
+#endif /* BIT_PARALLEL_SIMULATION_HPP */
@@ -17,10 +17,17 @@
 
 #include "circuit_to_truth_table.hpp"
 
+#include <algorithm>
+#include <cassert>
+
 #include <boost/format.hpp>
+#include <boost/thread.hpp>
 
+#include <core/compact_circuit.hpp>
 #include <core/properties.hpp>
 
+#include "bit_parallel_simulation.hpp"
+
 namespace revkit
 {
 
@@ -77,4 +84,119 @@ namespace revkit
     return true;
   }
 
+  // simulates the blocks [first, last) of the input space, block b covers
+  // the patterns from b * 64 * words on. Line i takes the weight
+  // 2^(n - 1 - i), so the pattern is the minterm of the truth table and the
+  // output of line i goes straight into the words of column i.
+  struct simulate_blocks
+  {
+    simulate_blocks( const compact_circuit& circ, unsigned words, unsigned long long first, unsigned long long last, std::vector<truth_table_column::word_type*>& columns, char& ok )
+      : circ( circ ), words( words ), first( first ), last( last ), columns( columns ), ok( ok ) {}
+
+    void operator()() const
+    {
+      static const simulation_word patterns[] = {
+        0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+        0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull
+      };
+
+      unsigned n = circ.lines();
+      std::vector<simulation_word> state( n * words );
+
+      for ( unsigned long long b = first; b < last; ++b )
+      {
+        unsigned long long base = b * 64ull * words;
+        for ( unsigned i = 0u; i < n; ++i )
+        {
+          unsigned k = n - 1u - i;
+          for ( unsigned w = 0u; w < words; ++w )
+          {
+            state[i * words + w] = ( k < 6u ) ? patterns[k] : ( ( ( ( base + 64ull * w ) >> k ) & 1ull ) ? ~simulation_word( 0u ) : simulation_word( 0u ) );
+          }
+        }
+
+        if ( !bit_parallel_simulation( state, words, circ ) )
+        {
+          ok = false;
+          return;
+        }
+
+        for ( unsigned i = 0u; i < n; ++i )
+        {
+          std::copy( state.begin() + i * words, state.begin() + ( i + 1u ) * words, columns[i] + b * words );
+        }
+      }
+    }
+
+  private:
+    const compact_circuit& circ;
+    unsigned words;
+    unsigned long long first;
+    unsigned long long last;
+    std::vector<truth_table_column::word_type*>& columns;
+    char& ok;
+  };
+
+  bool circuit_to_truth_table( const circuit& circ, binary_truth_table& spec, unsigned num_threads )
+  {
+    unsigned n = circ.lines();
+    assert( n < 32u );
+
+    compact_circuit ccirc( circ );
+
+    // 4 words (256 patterns) per block, less for small circuits
+    unsigned long long num_patterns = 1ull << n;
+    unsigned words = std::max( 1u, (unsigned)std::min( 4ull, num_patterns / 64ull ) );
+    unsigned long long block_size = 64ull * words;
+    unsigned long long num_blocks = ( num_patterns + block_size - 1ull ) / block_size;
+
+    if ( !num_threads )
+    {
+      num_threads = std::max( 1u, boost::thread::hardware_concurrency() );
+    }
+    num_threads = (unsigned)std::min( (unsigned long long)num_threads, num_blocks );
+
+    // every output is specified, the threads write disjoint words of the columns
+    spec.create_dense( n, n );
+    std::vector<truth_table_column::word_type*> columns( n );
+    for ( unsigned i = 0u; i < n; ++i )
+    {
+      columns[i] = spec.output_column( i ).words();
+    }
+    std::vector<char> ok( num_threads, true );
+
+    unsigned long long chunk = ( num_blocks + num_threads - 1ull ) / num_threads;
+    boost::thread_group threads;
+    for ( unsigned t = 0u; t < num_threads; ++t )
+    {
+      unsigned long long first = t * chunk;
+      unsigned long long last = std::min( num_blocks, first + chunk );
+      simulate_blocks f( ccirc, words, first, last, columns, ok[t] );
+
+      if ( t + 1u == num_threads )
+      {
+        f();
+      }
+      else
+      {
+        threads.create_thread( f );
+      }
+    }
+    threads.join_all();
+
+    if ( std::find( ok.begin(), ok.end(), false ) != ok.end() )
+    {
+      spec.clear();
+      return false;
+    }
+
+    // metadata
+    spec.set_inputs( circ.inputs() );
+    spec.set_outputs( circ.outputs() );
+    spec.set_constants( circ.constants() );
+    spec.set_garbage( circ.garbage() );
+
+    return true;
+  }
+
 }
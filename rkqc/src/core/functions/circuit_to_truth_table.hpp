@@ -50,6 +50,28 @@ namespace revkit
    */
   bool circuit_to_truth_table( const circuit& circ, binary_truth_table& spec, const functor<bool(boost::dynamic_bitset<>&, const circuit&, const boost::dynamic_bitset<>&)>& simulation );
 
+  /**
+   * @brief Generates a truth table from a circuit using bit-parallel simulation
+   *
+   * Instead of simulating each input pattern separately, this function
+   * simulates 256 patterns at once with bit_parallel_simulation. The
+   * input space is split into equally sized chunks which are simulated by
+   * \p num_threads threads. The result is written into a dense truth
+   * table (see truth_table::create_dense), it has the same entries as
+   * with a sequential simulation. Further, the meta is copied.
+   *
+   * @param circ        Circuit to be simulated, must not contain V or V+ gates
+   *                    and must have less than 32 lines
+   * @param spec        Empty truth table to be constructed
+   * @param num_threads Number of simulation threads, 0 uses one thread per core
+   *
+   * @return true on success, false otherwise
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  bool circuit_to_truth_table( const circuit& circ, binary_truth_table& spec, unsigned num_threads = 0u );
+
 }
 
 #endif /* CIRCUIT_TO_TRUTH_TABLE_HPP */
@@ -32,6 +32,19 @@ namespace revkit
     {
       circ.remove_gate_at( 0 );
     }
+
+    circ.lines_to_inputs.clear();
+    circ.workers.clear();
+    circ.anc_zz.clear();
+    circ.anc_zg.clear();
+    circ.anc_11.clear();
+    circ.anc_1g.clear();
+
+    memory_gate_sink* gates = dynamic_cast<memory_gate_sink*>( &circ.gate_output() );
+    if ( gates )
+    {
+      gates->clear();
+    }
   }
 
 }
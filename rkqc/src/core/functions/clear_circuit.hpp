@@ -33,6 +33,9 @@ namespace revkit
    * @brief Clears the circuit \p circ
    *
    * This function clears all lines, gates and meta-data in a circuit.
+   * This includes the signals and the gates recorded by a
+   * memory_gate_sink, so that another oracle can be built on
+   * global_circuit after writing the previous one with write_qasm.
    *
    * @param circ Circuit
    *
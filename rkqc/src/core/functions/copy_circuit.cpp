@@ -41,4 +41,41 @@ namespace revkit
     copy_metadata( src, dest );
   }
 
+  void copy_circuit( const circuit& src, compact_circuit& dest )
+  {
+    assert( !dest.num_gates() );
+
+    dest.set_lines( src.lines() );
+    dest.lines_to_inputs = src.lines_to_inputs;
+    dest.reserve( src.num_gates() );
+
+    foreach ( const gate& g, src )
+    {
+      dest.append_gate( g );
+    }
+  }
+
+  void copy_circuit( const compact_circuit& src, circuit& dest )
+  {
+    assert( !dest.num_gates() );
+    assert( !dest.lines() );
+
+    dest.set_lines( src.lines() );
+    dest.lines_to_inputs = src.lines_to_inputs;
+
+    foreach ( const compact_gate& g, src )
+    {
+      gate& ng = dest.append_gate();
+      foreach ( gate::line l, std::make_pair( g.begin_controls(), g.end_controls() ) )
+      {
+        ng.add_control( l );
+      }
+      foreach ( gate::line l, std::make_pair( g.begin_targets(), g.end_targets() ) )
+      {
+        ng.add_target( l );
+      }
+      ng.set_type( g.type() );
+    }
+  }
+
 }
@@ -26,6 +26,7 @@
 #define COPY_CIRCUIT_HPP
 
 #include <core/circuit.hpp>
+#include <core/compact_circuit.hpp>
 
 namespace revkit
 {
@@ -44,6 +45,34 @@ namespace revkit
    * @since  1.0
    */
   void copy_circuit( const circuit& src, circuit& dest );
+
+  /**
+   * @brief Copies a circuit into flat gate storage
+   *
+   * The gates, the number of lines and the line names of \p src
+   * are copied to \p dest. Other meta information is not kept.
+   *
+   * @param src  Source circuit
+   * @param dest Destination circuit, must be empty
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  void copy_circuit( const circuit& src, compact_circuit& dest );
+
+  /**
+   * @brief Copies a circuit from flat gate storage
+   *
+   * Creates a gate in \p dest for each gate record in \p src and
+   * copies the number of lines and the line names.
+   *
+   * @param src  Source circuit
+   * @param dest Destination circuit, must be empty
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  void copy_circuit( const compact_circuit& src, circuit& dest );
   
 }
 
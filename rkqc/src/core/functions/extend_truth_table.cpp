@@ -79,49 +79,25 @@ namespace revkit
       new_cubes.insert( std::make_pair( in_cube_values, output ) );
     }
 
-    spec.clear();
+    unsigned num_inputs = spec.num_inputs();
+    unsigned num_outputs = spec.num_outputs();
+
+    // the extended table is complete, so it is created densely with all
+    // outputs 0, and the first cube wins for overlapping input cubes
+    spec.create_dense( num_inputs, num_outputs );
+    boost::dynamic_bitset<> assigned( 1ul << num_inputs );
 
     for ( cube_map::const_iterator it = new_cubes.begin(); it != new_cubes.end(); ++it )
     {
       for ( std::vector<binary_truth_table::cube_type>::const_iterator itCube = it->first.begin(); itCube != it->first.end(); ++itCube )
       {
-        spec.add_entry( *itCube, it->second );
-      }
-    }
-
-    // fill the outputs (truth table is ordered)
-    binary_truth_table::cube_type out_cube( spec.num_outputs(), false );
-    unsigned current_pos = 0;
-    for ( binary_truth_table::const_iterator it = spec.begin(); ; ++it )
-    {
-      unsigned pos = 0;
-      unsigned i = spec.num_inputs();
-      
-      // vector to number
-      if ( it == spec.end() ) // after the end
-      {
-        pos = 1u << spec.num_inputs();
-      }
-      else
-      {
-        foreach ( const binary_truth_table::value_type& in_bit, it->first )
+        unsigned minterm = truth_table_cube_to_number( *itCube );
+        if ( !assigned.test( minterm ) )
         {
-          pos |= *in_bit << --i;
+          assigned.set( minterm );
+          spec.set_output( minterm, it->second );
         }
       }
-
-      for ( i = current_pos; i < pos; ++i )
-      {
-        spec.add_entry( number_to_truth_table_cube( i, spec.num_inputs() ), out_cube );
-      }
-
-      current_pos = pos;
-
-      // there is no <= comparison possible
-      if ( it == spec.end() )
-      {
-        break;
-      }
     }
 
   }
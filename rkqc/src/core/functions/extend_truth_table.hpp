@@ -33,6 +33,8 @@ namespace revkit
    * @brief Removes the Don't Care Values of a binary truth table
    *
    * This methods fills the incomplete cubes of a truth table.
+   * The extended truth table is complete and is therefore stored
+   * in the dense representation (see truth_table::is_dense).
    *
    * @param spec Truth table
    *
@@ -0,0 +1,186 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gate_sink.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <boost/cstdint.hpp>
+
+#include "circuit.hpp"
+#include "io/write_qasm.hpp"
+
+namespace revkit
+{
+
+  ////////////////////////////// class gate_sink
+  gate_sink::gate_sink() : _num_gates( 0ull )
+  {
+  }
+
+  gate_sink::~gate_sink()
+  {
+  }
+
+  void gate_sink::add_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n )
+  {
+    ++_num_gates;
+    write_gate( circ, kind, lines, n );
+  }
+
+  unsigned long long gate_sink::num_gates() const
+  {
+    return _num_gates;
+  }
+
+  ////////////////////////////// class text_gate_sink
+  text_gate_sink::text_gate_sink( const std::string& filename, unsigned buffer_size )
+    : filename( filename ),
+      buffer( buffer_size )
+  {
+  }
+
+  text_gate_sink::~text_gate_sink()
+  {
+    flush();
+  }
+
+  void text_gate_sink::flush()
+  {
+    if ( os.is_open() )
+    {
+      os.flush();
+    }
+  }
+
+  void text_gate_sink::write_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n )
+  {
+    if ( !os.is_open() )
+    {
+      // the buffer has to be installed before opening the file
+      os.rdbuf()->pubsetbuf( &buffer[0], buffer.size() );
+      os.open( filename.c_str(), std::ios_base::app );
+      if ( !os.is_open() )
+      {
+        return;
+      }
+    }
+
+    write_qasm_gate( os, circ, kind, lines, n );
+  }
+
+  ////////////////////////////// class binary_gate_sink
+  binary_gate_sink::binary_gate_sink( const std::string& filename, unsigned buffer_size )
+    : filename( filename ),
+      buffer( buffer_size )
+  {
+  }
+
+  binary_gate_sink::~binary_gate_sink()
+  {
+    flush();
+  }
+
+  void binary_gate_sink::flush()
+  {
+    if ( os.is_open() )
+    {
+      os.flush();
+    }
+  }
+
+  void binary_gate_sink::write_name( const circuit& circ, gate::line l )
+  {
+    if ( l >= named.size() )
+    {
+      named.resize( l + 1u, false );
+    }
+    if ( named[l] )
+    {
+      return;
+    }
+    named[l] = true;
+
+    const std::string& name = circ.lines_to_inputs.find( l )->second;
+    boost::uint32_t record[2] = { l, (boost::uint32_t)name.size() };
+    os.put( (char)0xFF );
+    os.write( (const char*)record, sizeof( record ) );
+    os.write( name.data(), name.size() );
+  }
+
+  void binary_gate_sink::write_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n )
+  {
+    if ( !os.is_open() )
+    {
+      os.rdbuf()->pubsetbuf( &buffer[0], buffer.size() );
+      os.open( filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary );
+      if ( !os.is_open() )
+      {
+        return;
+      }
+
+      const boost::uint32_t version = 1u;
+      os.write( "RKQG", 4 );
+      os.write( (const char*)&version, sizeof( version ) );
+    }
+
+    for ( unsigned i = 0u; i < n; ++i )
+    {
+      write_name( circ, lines[i] );
+    }
+
+    os.put( (char)kind );
+    os.put( (char)n );
+    for ( unsigned i = 0u; i < n; ++i )
+    {
+      boost::uint32_t l = lines[i];
+      os.write( (const char*)&l, sizeof( l ) );
+    }
+  }
+
+  ////////////////////////////// class memory_gate_sink
+  memory_gate_sink::memory_gate_sink()
+  {
+  }
+
+  void memory_gate_sink::flush()
+  {
+  }
+
+  const std::vector<memory_gate_sink::record>& memory_gate_sink::gates() const
+  {
+    return _gates;
+  }
+
+  void memory_gate_sink::clear()
+  {
+    _gates.clear();
+  }
+
+  void memory_gate_sink::write_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n )
+  {
+    assert( n <= max_lines );
+
+    record r;
+    r.kind = kind;
+    r.size = n;
+    std::copy( lines, lines + n, r.lines );
+    _gates.push_back( r );
+  }
+
+}
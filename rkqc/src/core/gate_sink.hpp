@@ -0,0 +1,296 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file gate_sink.hpp
+ *
+ * @brief Output sinks for gates emitted by the create_ functions
+ */
+
+#ifndef GATE_SINK_HPP
+#define GATE_SINK_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <core/gate.hpp>
+
+namespace revkit
+{
+
+  class circuit;
+
+  /**
+   * @brief Destination for gates emitted while building a circuit
+   *
+   * create_not, create_cnot and create_toffoli do not store their
+   * gates in the circuit but pass them to the gate sink of the circuit
+   * (see circuit::gate_output). By default this is a memory_gate_sink.
+   * The file based sinks keep their output open for the whole run and
+   * only write to it when their buffer is full or when flush() is called.
+   * They flush in their destructor.
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  class gate_sink
+  {
+  public:
+    /**
+     * @brief Kind of an emitted gate
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    enum gate_kind { not_gate = 0, cnot_gate = 1, toffoli_gate = 2 };
+
+    /**
+     * @brief Default constructor
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    gate_sink();
+
+    /**
+     * @brief Deconstructor
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    virtual ~gate_sink();
+
+    /**
+     * @brief Emits one gate
+     *
+     * @param circ  Circuit the lines belong to, used to look up line names
+     * @param kind  Kind of the gate
+     * @param lines Control lines followed by the target line
+     * @param n     Number of entries in \p lines
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void add_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n );
+
+    /**
+     * @brief Writes all buffered gates to the output
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    virtual void flush() = 0;
+
+    /**
+     * @brief Returns the number of gates emitted to this sink
+     *
+     * @return Number of gates
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    unsigned long long num_gates() const;
+
+  protected:
+    /** @cond */
+    virtual void write_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n ) = 0;
+    /** @endcond */
+
+  private:
+    unsigned long long _num_gates;
+  };
+
+  /**
+   * @brief Gate sink writing the textual gate list
+   *
+   * Each gate is written as one line, e.g. <tt>toffoli a,b,c</tt>,
+   * <tt>cnot a,b</tt> or <tt>X a</tt>, using the signal names of the
+   * circuit. The file is opened in append mode on the first gate, so
+   * no file is created for circuits without gates.
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  class text_gate_sink : public gate_sink
+  {
+  public:
+    /**
+     * @brief Default constructor
+     *
+     * @param filename    File to which the gates are appended
+     * @param buffer_size Size of the stream buffer in bytes
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    explicit text_gate_sink( const std::string& filename, unsigned buffer_size = 1u << 20u );
+
+    /**
+     * @brief Deconstructor
+     *
+     * Flushes the buffer and closes the file.
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    ~text_gate_sink();
+
+    void flush();
+
+  protected:
+    /** @cond */
+    void write_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n );
+    /** @endcond */
+
+  private:
+    std::string filename;
+    std::vector<char> buffer;
+    std::ofstream os;
+  };
+
+  /**
+   * @brief Gate sink writing a compact binary gate list
+   *
+   * The file starts with the magic bytes <tt>RKQG</tt> followed by a
+   * 32-bit format version. Afterwards it consists of records in host
+   * byte order:
+   * - Name record: byte 0xFF, 32-bit line, 32-bit length, name characters.
+   *   It is written once per line before the first gate using that line.
+   * - Gate record: byte gate_kind, byte number of lines, 32-bit line per
+   *   line (controls first, then the target).
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  class binary_gate_sink : public gate_sink
+  {
+  public:
+    /**
+     * @brief Default constructor
+     *
+     * @param filename    File to which the gates are written (truncated)
+     * @param buffer_size Size of the stream buffer in bytes
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    explicit binary_gate_sink( const std::string& filename, unsigned buffer_size = 1u << 20u );
+
+    /**
+     * @brief Deconstructor
+     *
+     * Flushes the buffer and closes the file.
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    ~binary_gate_sink();
+
+    void flush();
+
+  protected:
+    /** @cond */
+    void write_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n );
+    /** @endcond */
+
+  private:
+    void write_name( const circuit& circ, gate::line l );
+
+    std::string filename;
+    std::vector<char> buffer;
+    std::ofstream os;
+    std::vector<bool> named;
+  };
+
+  /**
+   * @brief Gate sink keeping all gates in memory
+   *
+   * This is the default gate sink of a circuit. The gates are stored
+   * as flat records in emission order and are written together with the
+   * signal declarations by write_qasm.
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  class memory_gate_sink : public gate_sink
+  {
+  public:
+    /**
+     * @brief Maximum number of lines of a gate record
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    enum { max_lines = 4 };
+
+    /**
+     * @brief One recorded gate
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    struct record
+    {
+      /** @brief Kind of the gate (a gate_sink::gate_kind) */
+      unsigned char kind;
+      /** @brief Number of used entries in lines */
+      unsigned char size;
+      /** @brief Control lines followed by the target line */
+      gate::line lines[max_lines];
+    };
+
+    /**
+     * @brief Default constructor
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    memory_gate_sink();
+
+    void flush();
+
+    /**
+     * @brief Returns the recorded gates in emission order
+     *
+     * @return Gate records
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const std::vector<record>& gates() const;
+
+    /**
+     * @brief Removes all recorded gates
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void clear();
+
+  protected:
+    /** @cond */
+    void write_gate( const circuit& circ, gate_kind kind, const gate::line* lines, unsigned n );
+    /** @endcond */
+
+  private:
+    std::vector<record> _gates;
+  };
+
+}
+
+#endif /* GATE_SINK_HPP */
@@ -50,4 +50,19 @@ namespace revkit
     print_statistics( std::cout, circ, runtime, settings );
   }
 
+  void print_statistics( std::ostream& os, const compact_circuit& circ, double runtime, const print_statistics_settings& settings )
+  {
+    std::string runtime_string;
+
+    if ( runtime != -1 )
+    {
+      runtime_string = boost::str( boost::format( settings.runtime_template ) % runtime );
+    }
+
+    boost::format fmt( settings.main_template );
+    fmt.exceptions( boost::io::all_error_bits ^ ( boost::io::too_many_args_bit | boost::io::too_few_args_bit ) );
+
+    os << fmt % runtime_string % circ.num_gates() % circ.lines() % costs( circ, quantum_costs() ) % costs( circ, transistor_costs() );
+  }
+
 }
@@ -25,6 +25,7 @@
 #define PRINT_STATISTICS_HPP
 
 #include <core/circuit.hpp>
+#include <core/compact_circuit.hpp>
 
 namespace revkit
 {
@@ -115,6 +116,22 @@ namespace revkit
   void print_statistics( const circuit& circ, double runtime = -1.0,
                          const print_statistics_settings& settings = print_statistics_settings() );
 
+  /**
+   * @brief Print statistics about a compact_circuit to an arbitrary output stream
+   *
+   * Same output as for circuit, the costs are computed directly on the gate records.
+   *
+   * @param os      Output stream where to print the information
+   * @param circ    Circuit to obtain information from
+   * @param runtime Optional, if a run-time has been measured, it will be displayed as well
+   * @param settings Settings for printing the statistics (with templates)
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  void print_statistics( std::ostream& os, const compact_circuit& circ, double runtime = -1.0,
+                         const print_statistics_settings& settings = print_statistics_settings() );
+
 }
 
 #endif /* PRINT_STATISTICS_HPP */
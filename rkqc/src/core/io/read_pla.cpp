@@ -129,6 +129,11 @@ namespace revkit
     {
       extend_truth_table( spec );
     }
+    else
+    {
+      // store complete specifications densely
+      spec.make_dense();
+    }
 
     return true;
   }
@@ -0,0 +1,102 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "write_qasm.hpp"
+
+#include <fstream>
+
+#include <boost/foreach.hpp>
+
+#include "../circuit.hpp"
+#include "../gate_sink.hpp"
+
+#define foreach BOOST_FOREACH
+
+namespace revkit
+{
+
+  void write_qasm_gate( std::ostream& os, const circuit& circ, gate_sink::gate_kind kind, const gate::line* lines, unsigned n )
+  {
+    switch ( kind )
+    {
+    case gate_sink::not_gate:
+      os << "X ";
+      break;
+    case gate_sink::cnot_gate:
+      os << "cnot ";
+      break;
+    case gate_sink::toffoli_gate:
+      os << "toffoli ";
+      break;
+    }
+
+    for ( unsigned i = 0u; i < n; ++i )
+    {
+      if ( i )
+      {
+        os << ',';
+      }
+      os << circ.lines_to_inputs.find( lines[i] )->second;
+    }
+    os << '\n';
+  }
+
+  void write_qasm( const circuit& circ, std::ostream& os )
+  {
+    const std::vector<std::string>* signals[] = { &circ.workers, &circ.anc_zg, &circ.anc_zz, &circ.anc_1g, &circ.anc_11 };
+    for ( unsigned i = 0u; i < 5u; ++i )
+    {
+      foreach ( const std::string& name, *signals[i] )
+      {
+        os << "qubit " << name << '\n';
+      }
+    }
+
+    const memory_gate_sink* gates = dynamic_cast<const memory_gate_sink*>( &circ.gate_output() );
+    if ( gates )
+    {
+      foreach ( const memory_gate_sink::record& r, gates->gates() )
+      {
+        write_qasm_gate( os, circ, (gate_sink::gate_kind)r.kind, r.lines, r.size );
+      }
+    }
+
+    os.flush();
+  }
+
+  bool write_qasm( const circuit& circ, const std::string& filename, std::string* error )
+  {
+    std::filebuf fb;
+    if ( !fb.open( filename.c_str(), std::ios::out ) )
+    {
+      if ( error )
+      {
+        *error = "Cannot open " + filename;
+      }
+      return false;
+    }
+
+    std::ostream os( &fb );
+
+    write_qasm( circ, os );
+
+    fb.close();
+
+    return true;
+  }
+
+}
@@ -0,0 +1,92 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file write_qasm.hpp
+ *
+ * @brief Generator for the QASM output of RKQC
+ *
+ * @author RevKit
+ * @since  1.3
+ */
+
+#ifndef WRITE_QASM_HPP
+#define WRITE_QASM_HPP
+
+#include <iosfwd>
+#include <string>
+
+#include <core/circuit.hpp>
+
+namespace revkit
+{
+
+  /**
+   * @brief Writes a circuit built with qint operations as QASM
+   *
+   * First the signals are declared as <tt>qubit</tt> in the order
+   * workers, zero-to-garbage, zero-to-zero, one-to-garbage and
+   * one-to-one ancillae. Then the gates recorded by the circuit's
+   * memory_gate_sink are written in emission order. If the circuit
+   * emits its gates to another gate_sink, only the declarations are
+   * written.
+   *
+   * @param circ Circuit to write
+   * @param os   Output stream
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  void write_qasm( const circuit& circ, std::ostream& os );
+
+  /**
+   * @brief Writes a circuit built with qint operations as QASM to a file
+   *
+   * This is a wrapper function for write_qasm(const circuit&, std::ostream&).
+   *
+   * @param circ     Circuit to write
+   * @param filename Filename of the file to be created
+   * @param error    If not-null, an error message is written
+   *                 to this parameter in case the function fails
+   *
+   * @return true on success, false otherwise
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  bool write_qasm( const circuit& circ, const std::string& filename, std::string* error = 0 );
+
+  /**
+   * @brief Writes one gate as a QASM line
+   *
+   * The gate is written as e.g. <tt>toffoli a,b,c</tt>, <tt>cnot a,b</tt>
+   * or <tt>X a</tt> using the signal names of \p circ.
+   *
+   * @param os    Output stream
+   * @param circ  Circuit the lines belong to
+   * @param kind  Kind of the gate
+   * @param lines Control lines followed by the target line
+   * @param n     Number of entries in \p lines
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  void write_qasm_gate( std::ostream& os, const circuit& circ, gate_sink::gate_kind kind, const gate::line* lines, unsigned n );
+
+}
+
+#endif /* WRITE_QASM_HPP */
@@ -345,6 +345,63 @@ namespace revkit
 //    os << ".end" << std::endl;
   }
 
+  void write_realization( const compact_circuit& circ, std::ostream& os, const write_realization_settings& settings )
+  {
+    for ( unsigned k = 0u; k < circ.lines(); ++k )
+    {
+      os << "qubit " << circ.lines_to_inputs.find( k )->second << std::endl;
+    }
+
+    std::string cmd;
+
+    for ( compact_circuit::const_iterator it = circ.begin(); it != circ.end(); ++it )
+    {
+      const compact_gate g = *it;
+
+      switch ( g.tag() )
+      {
+      case compact_gate::cnot_type:
+        cmd = "cnot";
+        break;
+      case compact_gate::not_type:
+        cmd = "X";
+        break;
+      case compact_gate::toffoli_type:
+        cmd = "toffoli";
+        break;
+      case compact_gate::fredkin_type:
+        cmd = boost::str( boost::format( "f%d" ) % g.size() );
+        break;
+      case compact_gate::peres_type:
+        cmd = "p";
+        break;
+      case compact_gate::v_type:
+        cmd = "v";
+        break;
+      case compact_gate::vplus_type:
+        cmd = "v+";
+        break;
+      default:
+        {
+          boost::any type = g.type();
+          const module_tag* module = boost::any_cast<module_tag>( &type );
+          cmd = module ? module->name : std::string();
+        }
+      }
+
+      os << cmd << " ";
+      for ( compact_gate::const_iterator l = g.begin_controls(); l != g.end_targets(); ++l )
+      {
+        if ( l != g.begin_controls() )
+        {
+          os << ",";
+        }
+        os << circ.lines_to_inputs.find( *l )->second;
+      }
+      os << std::endl;
+    }
+  }
+
   bool write_realization( const circuit& circ, const std::string& filename, const write_realization_settings& settings, std::string* error )
   {
     std::filebuf fb;
@@ -31,6 +31,7 @@
 #include <string>
 
 #include <core/circuit.hpp>
+#include <core/compact_circuit.hpp>
 
 namespace revkit
 {
@@ -118,6 +119,23 @@ namespace revkit
    */
   void write_realization( const circuit& circ, std::ostream& os, const write_realization_settings& settings = write_realization_settings() );
 
+  /**
+   * @brief Writes a compact_circuit as gate list to an output stream
+   *
+   * Writes the same gate list as write_realization(const circuit&, std::ostream&, const write_realization_settings&),
+   * i.e. one \b qubit declaration per line followed by one gate per line
+   * using the line names. Buses, modules and annotations are not part
+   * of a compact_circuit and are therefore not written.
+   *
+   * @param circ     Circuit to write
+   * @param os       Output stream
+   * @param settings Settings (see write_realization_settings)
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  void write_realization( const compact_circuit& circ, std::ostream& os, const write_realization_settings& settings = write_realization_settings() );
+
   /**
    * @brief Writes a circuit as RevLib realization to a file
    *
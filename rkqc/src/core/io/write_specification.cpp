@@ -135,6 +135,39 @@ namespace revkit
        << ".garbage " << _garbage << std::endl
        << ".begin" << std::endl;
 
+    /* output permutation */
+    std::vector<unsigned> output_order = settings.output_order;
+    if ( output_order.size() != spec.num_outputs() )
+    {
+      output_order.clear();
+      std::copy( boost::make_counting_iterator( 0u ), boost::make_counting_iterator( spec.num_outputs() ), std::back_inserter( output_order ) );
+    }
+
+    if ( spec.is_dense() )
+    {
+      // one line per input assignment, read directly from the output columns
+      std::string outLine;
+      for ( unsigned long long minterm = 0ull; minterm < ( 1ull << spec.num_inputs() ); ++minterm )
+      {
+        outLine.assign( spec.num_inputs(), '-' );
+        for ( unsigned o = 0u; o < spec.num_outputs(); ++o )
+        {
+          unsigned column = spec.permutation().at( o );
+          if ( spec.care_column( column ).test( minterm ) )
+          {
+            outLine.at( output_order.at( o ) ) = spec.output_column( column ).test( minterm ) ? '1' : '0';
+          }
+        }
+        os << outLine << '\n';
+      }
+
+      os << ".end" << std::endl;
+
+      fb.close();
+
+      return true;
+    }
+
     typedef std::map<unsigned, std::pair<binary_truth_table::out_const_iterator, binary_truth_table::out_const_iterator> > table_type;
     table_type table;
 
@@ -153,14 +186,6 @@ namespace revkit
     table_type::const_iterator itTable = table.begin();
     unsigned position = 0;
 
-    /* output permutation */
-    std::vector<unsigned> output_order = settings.output_order;
-    if ( output_order.size() != spec.num_outputs() )
-    {
-      output_order.clear();
-      std::copy( boost::make_counting_iterator( 0u ), boost::make_counting_iterator( spec.num_outputs() ), std::back_inserter( output_order ) );
-    }
-
     do
     {
       // fill free spaces
@@ -28,10 +28,13 @@
 #include <iterator>
 #include <vector>
 
+#include <boost/dynamic_bitset.hpp>
 #include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/iterator_facade.hpp>
 #include <boost/iterator/permutation_iterator.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <core/circuit.hpp>
 
@@ -41,8 +44,92 @@ namespace revkit
   /** @cond */
   template<typename T>
   struct transform_cube;
+
+  template<typename T>
+  class truth_table_iterator;
   /** @endcond */
 
+  /**
+   * @brief Bit vector of one output of a dense truth table
+   *
+   * Bit \em m is stored in word m / 64 at position m % 64, so that
+   * bit-parallel code can write 64 entries at once (see words()).
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  class truth_table_column
+  {
+  public:
+    /**
+     * @brief Type of the words the bits are stored in
+     */
+    typedef unsigned long long word_type;
+
+    /**
+     * @brief Creates an empty bit vector
+     */
+    truth_table_column() : _size( 0ull ) {}
+
+    /**
+     * @brief Creates a bit vector with \p size bits, all set to \p value
+     */
+    truth_table_column( unsigned long long size, bool value )
+      : _size( size ), _words( ( size + 63ull ) / 64ull, value ? ~word_type( 0u ) : word_type( 0u ) ) {}
+
+    /**
+     * @brief Returns the number of bits
+     */
+    unsigned long long size() const
+    {
+      return _size;
+    }
+
+    /**
+     * @brief Returns bit \p pos
+     */
+    bool test( unsigned long long pos ) const
+    {
+      return ( ( _words[pos / 64u] >> ( pos % 64u ) ) & 1ull ) != 0ull;
+    }
+
+    /**
+     * @brief Sets bit \p pos to \p value
+     */
+    void set( unsigned long long pos, bool value )
+    {
+      word_type mask = word_type( 1u ) << ( pos % 64u );
+      if ( value )
+      {
+        _words[pos / 64u] |= mask;
+      }
+      else
+      {
+        _words[pos / 64u] &= ~mask;
+      }
+    }
+
+    /**
+     * @brief Returns the words, bits past size() in the last word are ignored
+     */
+    word_type* words()
+    {
+      return _words.empty() ? 0 : &_words[0];
+    }
+
+    /**
+     * @brief Returns the words, bits past size() in the last word are ignored
+     */
+    const word_type* words() const
+    {
+      return _words.empty() ? 0 : &_words[0];
+    }
+
+  private:
+    unsigned long long _size;
+    std::vector<word_type> _words;
+  };
+
   /**
    * @brief Represents a  truth table
    *
@@ -82,6 +169,17 @@ namespace revkit
    * }
    * @endcode
    *
+   * @section sec_dense_truth_table Dense representation
+   * A table whose input cubes are fully specified and cover all
+   * 2<sup>n</sup> assignments can be stored densely (see make_dense()
+   * and create_dense()). Then each output is stored as a bit vector indexed
+   * by the input assignment (the first input is the most significant bit)
+   * together with a bit vector which is set where the output is specified.
+   * This is used for \ref binary_truth_table, i.e. with T = boost::optional<bool>.
+   * The iterator interface is the same in both representations, in the dense
+   * one the cubes are built on dereferencing and are only valid until the
+   * iterator is changed or destroyed.
+   *
    * @author RevKit
    * @since  1.0
    */
@@ -140,12 +238,22 @@ namespace revkit
     /**
      * @brief Truth Table's constant iterator
      *
-     * A transform iterator which transforms the cube_tuple objects to a pair of iterator pairs of each input and output cube.
+     * Dereferences to a pair of iterator pairs of each input and output cube.
      *
      * @author RevKit
      * @since  1.0
      */
-    typedef boost::transform_iterator<transform_cube<T>, typename cube_vector::const_iterator> const_iterator;
+    typedef truth_table_iterator<T> const_iterator;
+
+    /**
+     * @brief Default constructor
+     *
+     * Creates an empty truth table in the sparse representation.
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    truth_table() : _dense( false ), _dense_inputs( 0u ) {}
 
     /**
      * @brief Returns the number of inputs
@@ -161,7 +269,11 @@ namespace revkit
      */
     unsigned num_inputs() const
     {
-      if ( _cubes.size() )
+      if ( _dense )
+      {
+        return _dense_inputs;
+      }
+      else if ( _cubes.size() )
       {
         return _cubes.begin()->first.size();
       }
@@ -185,7 +297,11 @@ namespace revkit
      */
     unsigned num_outputs() const
     {
-      if ( _cubes.size() )
+      if ( _dense )
+      {
+        return _columns.size();
+      }
+      else if ( _cubes.size() )
       {
         return _cubes.begin()->second.size();
       }
@@ -205,7 +321,7 @@ namespace revkit
      */
     const_iterator begin() const
     {
-      return boost::make_transform_iterator( _cubes.begin(), transform_cube<T>( _permutation ) );
+      return _dense ? const_iterator( *this, 0ull ) : const_iterator( *this, _cubes.begin() );
     }
 
     /**
@@ -218,7 +334,7 @@ namespace revkit
      */
     const_iterator end() const
     {
-      return boost::make_transform_iterator( _cubes.end(), transform_cube<T>( _permutation ) );
+      return _dense ? const_iterator( *this, 1ull << _dense_inputs ) : const_iterator( *this, _cubes.end() );
     }
 
     /**
@@ -229,6 +345,9 @@ namespace revkit
      * it has to make sure that the dimensions fit, else
      * an assertion is thrown and false is returned.
      *
+     * A dense truth table is converted back to the sparse
+     * representation before the entry is added.
+     *
      * @param input Input assignment
      * @param output Output assignment
      * @return Returns whether the assignment could be added or not
@@ -238,6 +357,8 @@ namespace revkit
      */
     bool add_entry( const cube_type& input, const cube_type& output )
     {
+      make_sparse();
+
       if ( _cubes.size() &&
            ( input.size() != _cubes.begin()->first.size() ||
              output.size() != _cubes.begin()->second.size() ) )
@@ -276,6 +397,227 @@ namespace revkit
       _permutation.clear();
       _constants.clear();
       _garbage.clear();
+
+      _dense = false;
+      _dense_inputs = 0u;
+      _columns.clear();
+      _care.clear();
+    }
+
+    /**
+     * @brief Returns whether the truth table is in the dense representation
+     *
+     * @return true, if the truth table is dense
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    bool is_dense() const
+    {
+      return _dense;
+    }
+
+    /**
+     * @brief Creates an empty dense truth table
+     *
+     * Clears the truth table and creates all 2<sup>\p num_inputs</sup>
+     * entries with all outputs set to 0. The permutation, constant and
+     * garbage information are initialized as when adding the first entry.
+     *
+     * @param num_inputs  Number of inputs
+     * @param num_outputs Number of outputs
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void create_dense( unsigned num_inputs, unsigned num_outputs )
+    {
+      assert( num_inputs < 32u );
+
+      clear();
+
+      _dense = true;
+      _dense_inputs = num_inputs;
+      _columns.assign( num_outputs, truth_table_column( 1ull << num_inputs, false ) );
+      _care.assign( num_outputs, truth_table_column( 1ull << num_inputs, true ) );
+
+      std::copy( boost::counting_iterator<unsigned>( 0 ),
+                 boost::counting_iterator<unsigned>( num_outputs ),
+                 std::back_inserter( _permutation ) );
+
+      _constants.resize( num_inputs, constant() );
+      _garbage.resize( num_outputs, false );
+    }
+
+    /**
+     * @brief Sets one output value of a dense truth table
+     *
+     * @param minterm Input assignment as number, the first input is the most significant bit
+     * @param output  Output index (without permutation)
+     * @param value   Output value, the default value of T is a don't care
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void set_output( unsigned long long minterm, unsigned output, const T& value )
+    {
+      assert( _dense );
+
+      _care[output].set( minterm, (bool)value );
+      _columns[output].set( minterm, value && *value );
+    }
+
+    /**
+     * @brief Sets the output cube of a dense truth table
+     *
+     * @param minterm Input assignment as number, the first input is the most significant bit
+     * @param output  Output assignment (without permutation)
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void set_output( unsigned long long minterm, const cube_type& output )
+    {
+      assert( output.size() == _columns.size() );
+
+      for ( unsigned o = 0u; o < output.size(); ++o )
+      {
+        set_output( minterm, o, output[o] );
+      }
+    }
+
+    /**
+     * @brief Returns the values of an output of a dense truth table
+     *
+     * Bit \em m is the value of the output for the input assignment \em m
+     * (the first input is the most significant bit). It is only meaningful
+     * where care_column() is set.
+     *
+     * @param output Output index (without permutation)
+     *
+     * @return Output values
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const truth_table_column& output_column( unsigned output ) const
+    {
+      return _columns.at( output );
+    }
+
+    /**
+     * @brief Returns the values of an output of a dense truth table for writing
+     *
+     * Lets bit-parallel code fill a table made by create_dense() a whole
+     * word at a time. The output stays specified everywhere.
+     *
+     * @param output Output index (without permutation)
+     *
+     * @return Output values
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    truth_table_column& output_column( unsigned output )
+    {
+      return _columns.at( output );
+    }
+
+    /**
+     * @brief Returns where an output of a dense truth table is specified
+     *
+     * @param output Output index (without permutation)
+     *
+     * @return Bit vector which is set for each specified output value
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    const truth_table_column& care_column( unsigned output ) const
+    {
+      return _care.at( output );
+    }
+
+    /**
+     * @brief Converts the truth table into the dense representation
+     *
+     * This is only possible if all input cubes are fully specified and
+     * the truth table has an entry for every input assignment.
+     *
+     * @return true, if the truth table is dense afterwards
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    bool make_dense()
+    {
+      if ( _dense )
+      {
+        return true;
+      }
+
+      unsigned n = num_inputs();
+      if ( n >= 32u || _cubes.size() != ( 1ul << n ) )
+      {
+        return false;
+      }
+
+      for ( typename cube_vector::const_iterator it = _cubes.begin(); it != _cubes.end(); ++it )
+      {
+        if ( std::find( it->first.begin(), it->first.end(), T() ) != it->first.end() )
+        {
+          return false;
+        }
+      }
+
+      // the keys are unique and fully specified, so the map is ordered by minterm
+      unsigned m = num_outputs();
+      _columns.assign( m, truth_table_column( 1ull << n, false ) );
+      _care.assign( m, truth_table_column( 1ull << n, false ) );
+
+      unsigned long long minterm = 0ull;
+      for ( typename cube_vector::const_iterator it = _cubes.begin(); it != _cubes.end(); ++it, ++minterm )
+      {
+        for ( unsigned o = 0u; o < m; ++o )
+        {
+          _care[o].set( minterm, (bool)it->second[o] );
+          _columns[o].set( minterm, it->second[o] && *it->second[o] );
+        }
+      }
+
+      _cubes.clear();
+      _dense_inputs = n;
+      _dense = true;
+
+      return true;
+    }
+
+    /**
+     * @brief Converts the truth table into the sparse representation
+     *
+     * Does nothing if the truth table is not dense.
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    void make_sparse()
+    {
+      if ( !_dense )
+      {
+        return;
+      }
+
+      cube_vector cubes;
+      for ( const_iterator it = begin(); it != end(); ++it )
+      {
+        cubes.insert( cubes.end(), std::make_pair( cube_type( it->first.first, it->first.second ), cube_type( it.dense_output().begin(), it.dense_output().end() ) ) );
+      }
+
+      _cubes.swap( cubes );
+      _dense = false;
+      _dense_inputs = 0u;
+      _columns.clear();
+      _care.clear();
     }
 
     /**
@@ -486,6 +828,13 @@ namespace revkit
     std::vector<std::string> _outputs;
     std::vector<constant> _constants;
     std::vector<bool> _garbage;
+
+    bool _dense;
+    unsigned _dense_inputs;
+    std::vector<truth_table_column> _columns;
+    std::vector<truth_table_column> _care;
+
+    friend class truth_table_iterator<T>;
     /** @endcond */
   };
 
@@ -513,6 +862,105 @@ namespace revkit
   private:
     const std::vector<unsigned>& permutation;
   };
+
+  template<typename T>
+  class truth_table_iterator
+    : public boost::iterator_facade<truth_table_iterator<T>, typename transform_cube<T>::result_type, boost::forward_traversal_tag, typename transform_cube<T>::result_type>
+  {
+  public:
+    typedef typename truth_table<T>::cube_type cube_type;
+
+    truth_table_iterator() : table( 0 ), minterm( 0ull ) {}
+
+    truth_table_iterator( const truth_table<T>& table, typename truth_table<T>::cube_vector::const_iterator pos )
+      : table( &table ), pos( pos ), minterm( 0ull ) {}
+
+    truth_table_iterator( const truth_table<T>& table, unsigned long long minterm )
+      : table( &table ), minterm( minterm ) {}
+
+    // the cubes of a dense table are not shared between copies
+    truth_table_iterator( const truth_table_iterator& other )
+      : table( other.table ), pos( other.pos ), minterm( other.minterm ) {}
+
+    truth_table_iterator& operator=( const truth_table_iterator& other )
+    {
+      table = other.table;
+      pos = other.pos;
+      minterm = other.minterm;
+      cubes.reset();
+      return *this;
+    }
+
+    // output cube of a dense table without permutation
+    const cube_type& dense_output() const
+    {
+      fill();
+      return cubes->second;
+    }
+
+  private:
+    friend class boost::iterator_core_access;
+
+    void increment()
+    {
+      if ( table->_dense )
+      {
+        ++minterm;
+      }
+      else
+      {
+        ++pos;
+      }
+    }
+
+    bool equal( const truth_table_iterator& other ) const
+    {
+      return table == other.table && ( table && table->_dense ? minterm == other.minterm : pos == other.pos );
+    }
+
+    typename transform_cube<T>::result_type dereference() const
+    {
+      if ( !table->_dense )
+      {
+        return transform_cube<T>( table->_permutation )( *pos );
+      }
+
+      fill();
+      return std::make_pair(
+               std::make_pair( cubes->first.begin(), cubes->first.end() ),
+               std::make_pair(
+                 boost::make_permutation_iterator( cubes->second.begin(), table->_permutation.begin() ),
+                 boost::make_permutation_iterator( cubes->second.end(), table->_permutation.end() )
+               )
+             );
+    }
+
+    void fill() const
+    {
+      unsigned n = table->_dense_inputs;
+      unsigned m = table->_columns.size();
+
+      if ( !cubes )
+      {
+        cubes.reset( new std::pair<cube_type, cube_type>( cube_type( n ), cube_type( m ) ) );
+      }
+
+      for ( unsigned i = 0u; i < n; ++i )
+      {
+        cubes->first[i] = T( ( ( minterm >> ( n - 1u - i ) ) & 1ull ) != 0ull );
+      }
+
+      for ( unsigned o = 0u; o < m; ++o )
+      {
+        cubes->second[o] = table->_care[o].test( minterm ) ? T( table->_columns[o].test( minterm ) ) : T();
+      }
+    }
+
+    const truth_table<T>* table;
+    typename truth_table<T>::cube_vector::const_iterator pos;
+    unsigned long long minterm;
+    mutable boost::shared_ptr<std::pair<cube_type, cube_type> > cubes;
+  };
   /** @endcond */
 
   /**
@@ -40,14 +40,13 @@ namespace revkit
   {
   }
 
-  cost_t quantum_costs::operator()( const gate& g, unsigned lines ) const
+  static cost_t quantum_costs_for( unsigned c, bool fredkin, int controls_offset, unsigned lines )
   {
     cost_t costs = 0ull;
 
     unsigned n = lines;
-    unsigned c = std::distance( g.begin_controls(), g.end_controls() );
 
-    if ( is_fredkin( g ) )
+    if ( fredkin )
     {
       costs = 2ull;
       c += 1u;
@@ -130,11 +129,26 @@ namespace revkit
     return costs;
   }
 
+  cost_t quantum_costs::operator()( const gate& g, unsigned lines ) const
+  {
+    return quantum_costs_for( std::distance( g.begin_controls(), g.end_controls() ), is_fredkin( g ), controls_offset, lines );
+  }
+
+  cost_t quantum_costs::operator()( const compact_gate& g, unsigned lines ) const
+  {
+    return quantum_costs_for( g.end_controls() - g.begin_controls(), g.tag() == compact_gate::fredkin_type, controls_offset, lines );
+  }
+
   cost_t transistor_costs::operator()( const gate& g, unsigned lines ) const
   {
     return 8ull * std::distance( g.begin_controls(), g.end_controls() );
   }
 
+  cost_t transistor_costs::operator()( const compact_gate& g, unsigned lines ) const
+  {
+    return 8ull * ( g.end_controls() - g.begin_controls() );
+  }
+
   struct costs_visitor : public boost::static_visitor<cost_t>
   {
     explicit costs_visitor( const circuit& circ ) : circ( circ ) {}
@@ -29,6 +29,8 @@
 #include <boost/variant.hpp>
 
 #include <core/circuit.hpp>
+#include <core/compact_circuit.hpp>
+#include <core/target_tags.hpp>
 
 namespace revkit
 {
@@ -162,6 +164,19 @@ namespace revkit
      */
     cost_t operator()( const gate& g, unsigned lines ) const;
 
+    /**
+     * @brief Returns the quantum costs for gate \p g of a compact_circuit
+     *
+     * @param g Gate
+     * @param lines Number of lines in the circuit
+     *
+     * @return Quantum Costs for gate \p g
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    cost_t operator()( const compact_gate& g, unsigned lines ) const;
+
     /**
      * @brief Offset for control lines
      *
@@ -207,6 +222,19 @@ namespace revkit
      * @since  1.0
      */
     cost_t operator()( const gate& g, unsigned lines ) const;
+
+    /**
+     * @brief Returns the transistor costs for gate \p g of a compact_circuit
+     *
+     * @param g Gate
+     * @param lines Number of lines in the circuit
+     *
+     * @return Transistor Costs for gate \p g
+     *
+     * @author RevKit
+     * @since  1.3
+     */
+    cost_t operator()( const compact_gate& g, unsigned lines ) const;
   };
 
   /**
@@ -231,6 +259,45 @@ namespace revkit
    */
   cost_t costs( const circuit& circ, const cost_function& f );
 
+  /**
+   * @brief Calculates the costs of a compact_circuit by a gate cost function
+   *
+   * Sums up the costs of all gates. \p f has to provide an operator()
+   * for compact_gate, e.g. quantum_costs or transistor_costs. The costs of
+   * modules are calculated on the referenced circuit.
+   *
+   * @param circ Circuit
+   * @param f Cost function for one gate
+   *
+   * @return The costs for the circuit in respect to the given cost function
+   *
+   * @author RevKit
+   * @since  1.3
+   */
+  template<typename CostsByGate>
+  cost_t costs( const compact_circuit& circ, const CostsByGate& f )
+  {
+    cost_t sum = 0ull;
+    for ( compact_circuit::const_iterator it = circ.begin(); it != circ.end(); ++it )
+    {
+      const compact_gate g = *it;
+
+      // respect modules
+      if ( g.tag() == compact_gate::other_type )
+      {
+        boost::any type = g.type();
+        if ( const module_tag* module = boost::any_cast<module_tag>( &type ) )
+        {
+          sum += costs( *module->reference.get(), costs_by_gate_func( f ) );
+          continue;
+        }
+      }
+
+      sum += f( g, circ.lines() );
+    }
+    return sum;
+  }
+
 }
 
 #endif /* COSTS_HPP */
@@ -0,0 +1,83 @@
+/* RevKit: A Toolkit for Reversible Circuit Design (www.revkit.org)
+ * Copyright (C) 2009-2011  The RevKit Developers <revkit@informatik.uni-bremen.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <iostream>
+
+#include <core/circuit.hpp>
+#include <core/gate_sink.hpp>
+#include <core/functions/add_gates.hpp>
+#include <core/utils/timer.hpp>
+#include <boost/lexical_cast.hpp>
+
+using namespace revkit;
+
+/* Emits the e007 multiplier at 64 and 128 bits into the memory, the text
+ * and the binary gate sink and reports the emission rate in gates per second.
+ * The optional argument gives the number of multiplications per run. */
+
+void run( const std::string& title, gate_sink* sink, int width, int runs )
+{
+    boost::shared_ptr<gate_sink> ptr( sink );
+    qint::circ.set_gate_sink( ptr );
+
+    qbit a(width);
+    qbit b(width);
+    qbit c(width);
+
+    double runtime;
+    {
+        reference_timer rt( &runtime );
+        timer<reference_timer> t;
+        t.set_measure_method( measure_method::user_time | measure_method::system_time );
+        t.start( rt );
+
+        for ( int i = 0; i < runs; ++i )
+        {
+            a_eq_a_plus_b_times_c(a, b, c, width);
+        }
+        sink->flush();
+    }
+
+    std::cout << width << " bit, " << title << ": " << sink->num_gates() << " gates in " << runtime << " secs";
+    if ( runtime > 0.0 )
+    {
+        std::cout << " (" << (unsigned long long)( sink->num_gates() / runtime ) << " gates/sec)";
+    }
+    std::cout << std::endl;
+
+    qint::circ.set_gate_sink( boost::shared_ptr<gate_sink>() );
+}
+
+int main( int argc, char ** argv )
+{
+    int runs = argc > 1 ? boost::lexical_cast<int>( argv[1] ) : 10;
+
+    int widths[] = { 64, 128 };
+    for ( unsigned i = 0; i < 2; ++i )
+    {
+        run( "memory sink", new memory_gate_sink(), widths[i], runs );
+
+        run( "text sink", new text_gate_sink( "benchmark_gates.txt" ), widths[i], runs );
+        std::remove( "benchmark_gates.txt" );
+
+        run( "binary sink", new binary_gate_sink( "benchmark_gates.bin" ), widths[i], runs );
+        std::remove( "benchmark_gates.bin" );
+    }
+
+    return 0;
+}
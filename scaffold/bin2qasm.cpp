@@ -0,0 +1,42 @@
+// bin2qasm: convert binary flat QASM (.qasmb) back to flat QASM text
+//
+//   bin2qasm <in.qasmb> [first record] [number of records]
+//
+// Without a range the whole file is printed; with one, the chunk index is
+// used to start at the first record without walking the ones before it.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "QASMBin.h"
+
+int main(int argc, char *argv[]) {
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "Usage: %s <in.qasmb> [first record] [number of records]\n", argv[0]);
+		return 1;
+	}
+
+	qasmBinReader reader;
+	std::string err;
+	if (!reader.open(argv[1], err)) {
+		fprintf(stderr, "bin2qasm: %s\n", err.c_str());
+		return 1;
+	}
+
+	uint64_t first = argc > 2 ? strtoull(argv[2], NULL, 10) : 0;
+	uint64_t count = argc > 3 ? strtoull(argv[3], NULL, 10) : reader.numRecords();
+	uint64_t last = first + count < first || first + count > reader.numRecords() ?
+		reader.numRecords() : first + count;
+
+	qasmBinReader::iterator it = first ? reader.at(first) : reader.begin();
+	qasmBinGate g;
+	std::string line;
+	for (uint64_t n = first; n < last && it.next(g); n++) {
+		reader.format(g, line);
+		if (n + 1 < reader.numRecords() || !(reader.getFlags() & QASMBIN_NO_FINAL_NEWLINE))
+			line += '\n';
+		fwrite(line.data(), 1, line.size(), stdout);
+	}
+	return fflush(stdout) == 0 ? 0 : 1;
+}
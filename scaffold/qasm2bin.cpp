@@ -0,0 +1,70 @@
+// qasm2bin: convert flat QASM (.qasmf) to binary flat QASM (.qasmb)
+//
+//   qasm2bin <in.qasmf> <out.qasmb>
+//
+// The input is mapped and read line by line; lines that are not gates or
+// declarations are stored as text, so bin2qasm gives back the same file.
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "QASMBin.h"
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <in.qasmf> <out.qasmb>\n", argv[0]);
+		return 1;
+	}
+
+	int fd = open(argv[1], O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "qasm2bin: cannot open %s\n", argv[1]);
+		return 1;
+	}
+	size_t size = st.st_size;
+	const char *text = "";
+	if (size > 0) {
+		void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (m == MAP_FAILED) {
+			fprintf(stderr, "qasm2bin: cannot map %s\n", argv[1]);
+			return 1;
+		}
+		madvise(m, size, MADV_SEQUENTIAL);
+		text = (const char *)m;
+	}
+	close(fd);
+
+	FILE *out = fopen(argv[2], "wb");
+	if (!out) {
+		fprintf(stderr, "qasm2bin: cannot create %s\n", argv[2]);
+		return 1;
+	}
+
+	qasmBinFileSink sink(out);
+	qasmBinWriter writer(sink);
+	const char *p = text, *end = text + size;
+	while (p < end) {
+		const char *nl = (const char *)memchr(p, '\n', end - p);
+		if (!nl) {
+			writer.line(p, end - p);
+			writer.noFinalNewline();
+			break;
+		}
+		writer.line(p, nl - p);
+		p = nl + 1;
+	}
+	writer.finish();
+
+	if (fclose(out) != 0) {
+		fprintf(stderr, "qasm2bin: error writing %s\n", argv[2]);
+		return 1;
+	}
+	if (size > 0)
+		munmap((void *)text, size);
+	return 0;
+}
@@ -1,62 +1,443 @@
-#include <iostream>
+// scaffold: compile a Scaffold program in a single process
+//
+//   scaffold [-emit=resources,qasmh,qasmf,qasmb] [-o <base>] [-I<dir>]
+//            [-disable-rotations] [-disable-toffoli] [-dump-stages]
+//            <file>.scaffold
+//
+// Runs the same stages as Scaffold_revkit.makefile, with the same pass lists,
+// but the clang frontend and all the opt stages work on one Module that stays
+// in memory, instead of printing and parsing a textual .ll between every
+// stage. The Scaffold passes are loaded from Scaffold.so before the command
+// line is parsed, so their options (-rotation-cache, -flat-qasm-cache-lines,
+// ...) can be given to the driver as well. With -dump-stages the module is
+// written as bitcode after every stage, to <base>1.bc ... <base>11.bc, with
+// the numbers of the makefile's .ll files.
+//
+// Revkit blocks are not extracted; compile those programs with
+// scaffold_rkqc.sh.
 
-#include "llvm/Support/Host.h"
-#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+#include <sys/stat.h>
 
+#include "clang/CodeGen/CodeGenAction.h"
+#include "clang/Driver/Compilation.h"
+#include "clang/Driver/Driver.h"
+#include "clang/Driver/Tool.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/DiagnosticOptions.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
-#include "clang/Frontend/CompilerInstance.h"
-#include "clang/Basic/TargetOptions.h"
-#include "clang/Basic/TargetInfo.h"
-#include "clang/Basic/FileManager.h"
-#include "clang/AST/ASTConsumer.h"
-#include "clang/Parse/ParseAST.h"
-
-#include "clang/Lex/Preprocessor.h"
-#include "clang/AST/ASTContext.h"
-
-int main(int argc, char *argv[]) {
-	using clang::CompilerInstance;
-	using clang::TargetOptions;
-	using clang::TargetInfo;
-	using clang::FileEntry;
-	using clang::ASTConsumer;
-	using clang::DiagnosticOptions;
-	using clang::TextDiagnosticPrinter;
-
-	CompilerInstance CI;
-	DiagnosticOptions diagnosticOptions;
-	TextDiagnosticPrinter *pTextDiagnosticPrinter =
-		new TextDiagnosticPrinter(
-			llvm::outs(), diagnosticOptions, true);
-	CI.createDiagnostics(0, NULL, pTextDiagnosticPrinter);
-
-	TargetOptions targetOptions;
-	targetOptions.Triple = llvm::sys::getDefaultTargetTriple();
-	TargetInfo *pTargetInfo = TargetInfo::CreateTargetInfo(
-			CI.getDiagnostics(), targetOptions);
-	CI.setTarget(pTargetInfo);
-
-	CI.createFileManager();
-	CI.createSourceManager(CI.getFileManager());
-	CI.createPreprocessor();
-	CI.getPreprocessorOpts().UsePredefines = false;
-	ASTConsumer *astConsumer = new ASTConsumer();
-	CI.setASTConsumer(astConsumer);
-
-	CI.createASTContext();
-	CI.createSema(clang::TU_Complete, NULL);
-
-	const FileEntry *pFile = CI.getFileManager().getFile(argv[1]);
-	CI.getSourceManager().createMainFileID(pFile);
-
-	CI.getASTContext().BuiltinInfo.InitializeBuiltins(
-		CI.getPreprocessor().getIdentifierTable(), CI.getLangOpts());
-
-	CI.getDiagnosticClient().BeginSourceFile(
-			CI.getLangOpts(), &(CI.getPreprocessor()));
-	clang::ParseAST(CI.getSema());
-	CI.getDiagnosticClient().EndSourceFile();
 
-	return 0;
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Target/TargetData.h"
+#include "llvm/Target/TargetLibraryInfo.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+enum emitKind { EmitResources, EmitQASMH, EmitQASMF, EmitQASMB };
+
+static cl::opt<std::string>
+InputFilename(cl::Positional, cl::Required, cl::desc("<file>.scaffold"));
+
+static cl::list<emitKind>
+Emit("emit", cl::CommaSeparated, cl::desc("Outputs to generate (default: resources)"),
+	cl::values(
+		clEnumValN(EmitResources, "resources", "Resource counts, <base>.resources"),
+		clEnumValN(EmitQASMH, "qasmh", "Hierarchical QASM, <base>.qasmh"),
+		clEnumValN(EmitQASMF, "qasmf", "Flat QASM, <base>.qasmf"),
+		clEnumValN(EmitQASMB, "qasmb", "Binary flat QASM, <base>.qasmb"),
+		clEnumValEnd));
+
+static cl::opt<std::string>
+OutputBase("o", cl::value_desc("base"),
+	cl::desc("Base name of the outputs (default: input file name without .scaffold)"));
+
+static cl::list<std::string>
+IncludeDirs("I", cl::Prefix, cl::value_desc("dir"), cl::desc("Add a directory to the include path"));
+
+static cl::list<std::string>
+Defines("D", cl::Prefix, cl::value_desc("macro[=value]"), cl::desc("Define a macro"));
+
+static cl::opt<bool>
+DisableRotations("disable-rotations", cl::desc("Do not decompose rotations"));
+
+static cl::opt<bool>
+DisableToffoli("disable-toffoli", cl::desc("Do not decompose Toffoli gates"));
+
+static cl::opt<bool>
+DumpStages("dump-stages", cl::desc("Write the module as bitcode after every stage"));
+
+static cl::opt<bool>
+Quiet("q", cl::desc("Do not report the stages and their times"));
+
+// read before the command line is parsed, see findOption
+static cl::opt<std::string>
+ScaffoldRoot("scaffold-root", cl::value_desc("dir"),
+	cl::desc("Scaffold source tree (default: the directory above the driver)"));
+
+static cl::opt<std::string>
+ScaffoldLib("scaffold-lib", cl::value_desc("file"),
+	cl::desc("Library of the Scaffold passes (default: <root>/build/Release+Asserts/lib/Scaffold.so)"));
+
+#ifdef __APPLE__
+#define SCAFFOLD_LIB_NAME "Scaffold.dylib"
+#else
+#define SCAFFOLD_LIB_NAME "Scaffold.so"
+#endif
+
+// Stages of Scaffold_revkit.makefile. dump is the number of the .ll file the
+// makefile writes after the stage.
+struct stage {
+	const char *dump;
+	const char *message;
+	const char *passes;
+};
+
+static const stage frontStages[] = {
+	{ "1", "Transforming cbits", "xform-cbit-stores" },
+	{ "1a", "O1 optimizations", "no-aa tbaa targetlibinfo basicaa" },
+	{ "1b", NULL, "simplifycfg domtree" },
+	{ "2", NULL, "early-cse lower-expect" },
+	{ "3", NULL, "targetlibinfo no-aa tbaa basicaa globalopt ipsccp" },
+	{ "4", NULL, "instcombine simplifycfg basiccg prune-eh always-inline functionattrs domtree "
+		"early-cse lazy-value-info jump-threading correlated-propagation simplifycfg instcombine "
+		"tailcallelim simplifycfg reassociate domtree loops loop-simplify lcssa loop-rotate licm "
+		"lcssa loop-unswitch instcombine scalar-evolution loop-simplify lcssa iv-users indvars "
+		"loop-idiom loop-deletion loop-unroll memdep memcpyopt sccp instcombine lazy-value-info "
+		"jump-threading correlated-propagation domtree memdep dse adce simplifycfg instcombine "
+		"strip-dead-prototypes preverify domtree verify" },
+	{ "6", "Unrolling Loops and Cloning Functions", "UnrollClone internalize globaldce deadargelim" },
+};
+
+static const stage rotationStage =
+	{ "7", "Decomposing Rotations", "Rotations" };
+static const stage cleanupStage =
+	{ "10", "Internalizing and Removing Unused Functions", "internalize globaldce deadargelim" };
+static const stage toffoliStage =
+	{ "11", "Toffoli Decomposition", "ToffoliReplace" };
+
+// This function isn't referenced outside its translation unit, but it can't
+// use the "static" keyword because its address is used for GetMainExecutable.
+sys::Path GetExecutablePath(const char *argv0) {
+	void *MainAddr = (void *)(intptr_t)GetExecutablePath;
+	return sys::Path::GetMainExecutable(argv0, MainAddr);
+}
+
+// value of -name=value or -name value in argv, for the options needed before
+// the command line can be parsed
+static std::string findOption(int argc, char **argv, const char *name) {
+	std::string flag = std::string("-") + name;
+	for (int i = 1; i < argc; i++) {
+		StringRef arg(argv[i]);
+		if (arg.startswith("--"))
+			arg = arg.substr(1);
+		if (arg == flag && i + 1 < argc)
+			return argv[i + 1];
+		if (arg.startswith(flag + "="))
+			return arg.substr(flag.size() + 1);
+	}
+	return "";
+}
+
+static bool exists(const std::string &path) {
+	struct stat st;
+	return stat(path.c_str(), &st) == 0;
+}
+
+static void report(const char *message) {
+	if (!Quiet && message)
+		errs() << "[scaffold] " << message << " ...\n";
+}
+
+static void reportTime(const TimeRecord &before) {
+	if (Quiet)
+		return;
+	char secs[32];
+	snprintf(secs, sizeof(secs), "%.3f",
+		TimeRecord::getCurrentTime(false).getWallTime() - before.getWallTime());
+	errs() << "[scaffold]   " << secs << "s\n";
+}
+
+// Run the frontend the way the makefile does (clang -c -emit-llvm) and take
+// the module it generates
+static Module *compile(const std::string &clangPath, LLVMContext &Context) {
+	using namespace clang;
+	using namespace clang::driver;
+
+	static DiagnosticOptions DiagOpts;
+	TextDiagnosticPrinter *DiagClient = new TextDiagnosticPrinter(errs(), DiagOpts);
+	IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+	DiagnosticsEngine Diags(DiagID, DiagClient);
+	Driver TheDriver(clangPath, sys::getDefaultTargetTriple(), "a.out",
+		/*IsProduction=*/false, Diags);
+	TheDriver.setTitle("scaffold");
+
+	std::vector<std::string> flags;
+	for (unsigned i = 0; i < IncludeDirs.size(); i++)
+		flags.push_back("-I" + IncludeDirs[i]);
+	for (unsigned i = 0; i < Defines.size(); i++)
+		flags.push_back("-D" + Defines[i]);
+
+	SmallVector<const char *, 16> Args;
+	Args.push_back(clangPath.c_str());
+	Args.push_back("-c");
+	Args.push_back("-emit-llvm");
+	Args.push_back("-I/usr/include");
+	Args.push_back("-I/usr/include/x86_64-linux-gnu");
+	Args.push_back("-I/usr/lib/gcc/x86_64-linux-gnu/4.6/include");
+	for (unsigned i = 0; i < flags.size(); i++)
+		Args.push_back(flags[i].c_str());
+	Args.push_back(InputFilename.c_str());
+
+	OwningPtr<Compilation> C(TheDriver.BuildCompilation(Args));
+	if (!C)
+		return NULL;
+
+	// -c gives exactly one clang -cc1 job
+	const JobList &Jobs = C->getJobs();
+	if (Jobs.size() != 1 || !isa<Command>(*Jobs.begin())) {
+		SmallString<256> Msg;
+		raw_svector_ostream OS(Msg);
+		C->PrintJob(OS, C->getJobs(), "; ", true);
+		Diags.Report(diag::err_fe_expected_compiler_job) << OS.str();
+		return NULL;
+	}
+	const Command *Cmd = cast<Command>(*Jobs.begin());
+	if (StringRef(Cmd->getCreator().getName()) != "clang") {
+		Diags.Report(diag::err_fe_expected_clang_command);
+		return NULL;
 	}
+
+	const ArgStringList &CCArgs = Cmd->getArguments();
+	OwningPtr<CompilerInvocation> CI(new CompilerInvocation);
+	CompilerInvocation::CreateFromArgs(*CI,
+		const_cast<const char **>(CCArgs.data()),
+		const_cast<const char **>(CCArgs.data()) + CCArgs.size(),
+		Diags);
+
+	CompilerInstance Clang;
+	Clang.setInvocation(CI.take());
+	Clang.createDiagnostics(int(CCArgs.size()), const_cast<char **>(CCArgs.data()));
+	if (!Clang.hasDiagnostics())
+		return NULL;
+
+	// the Scaffold passes create their types in the global context, so the
+	// module has to live there too
+	OwningPtr<CodeGenAction> Act(new EmitLLVMOnlyAction(&Context));
+	if (!Clang.ExecuteAction(*Act))
+		return NULL;
+	return Act->takeModule();
+}
+
+// Run the passes of one stage, as opt would: target library info and data
+// layout first, and the verifier last
+static bool runPasses(Module &M, const char *passes) {
+	PassManager PM;
+	PM.add(new TargetLibraryInfo(Triple(M.getTargetTriple())));
+	if (!M.getDataLayout().empty())
+		PM.add(new TargetData(M.getDataLayout()));
+
+	SmallVector<StringRef, 64> names;
+	StringRef(passes).split(names, " ", -1, false);
+	for (unsigned i = 0; i < names.size(); i++) {
+		const PassInfo *PI = PassRegistry::getPassRegistry()->getPassInfo(names[i]);
+		if (!PI || !PI->getNormalCtor()) {
+			errs() << "scaffold: unknown pass " << names[i] << "\n";
+			return false;
+		}
+		PM.add(PI->getNormalCtor()());
+	}
+	PM.add(createVerifierPass());
+	PM.run(M);
+	return true;
+}
+
+static bool dump(Module &M, const char *name) {
+	if (!DumpStages)
+		return true;
+	std::string file = OutputBase + name + ".bc";
+	std::string err;
+	raw_fd_ostream out(file.c_str(), err, raw_fd_ostream::F_Binary);
+	if (!err.empty()) {
+		errs() << "scaffold: " << err << "\n";
+		return false;
+	}
+	WriteBitcodeToFile(&M, out);
+	return true;
+}
+
+static bool runStage(Module &M, const stage &s) {
+	report(s.message);
+	TimeRecord before = TimeRecord::getCurrentTime(true);
+	if (!runPasses(M, s.passes))
+		return false;
+	reportTime(before);
+	return dump(M, s.dump);
+}
+
+typedef void (*setOutputFn)(const char *);
+
+int main(int argc, char **argv) {
+	sys::PrintStackTraceOnErrorSignal();
+	PrettyStackTraceProgram X(argc, argv);
+	llvm_shutdown_obj Y;
+
+	// The library has to be loaded before the command line is parsed, so that
+	// the options of the passes are known
+	std::string root = findOption(argc, argv, "scaffold-root");
+	if (root.empty()) {
+		sys::Path dir = GetExecutablePath(argv[0]);
+		dir.eraseComponent();
+		dir.appendComponent("..");
+		root = dir.str();
+	}
+	std::string build = root + "/build/Release+Asserts";
+	std::string lib = findOption(argc, argv, "scaffold-lib");
+	if (lib.empty())
+		lib = build + "/lib/" SCAFFOLD_LIB_NAME;
+
+	std::string err;
+	if (sys::DynamicLibrary::LoadLibraryPermanently(lib.c_str(), &err)) {
+		errs() << "scaffold: cannot load " << lib << ": " << err << "\n";
+		return 1;
+	}
+	setOutputFn setOutput =
+		(setOutputFn)(intptr_t)sys::DynamicLibrary::SearchForAddressOfSymbol("scaffoldSetOutput");
+	setOutputFn setFlatFormat =
+		(setOutputFn)(intptr_t)sys::DynamicLibrary::SearchForAddressOfSymbol("scaffoldSetFlatQASMFormat");
+	if (!setOutput || !setFlatFormat) {
+		errs() << "scaffold: " << lib << " does not have the output hooks\n";
+		return 1;
+	}
+
+	PassRegistry &Registry = *PassRegistry::getPassRegistry();
+	initializeCore(Registry);
+	initializeScalarOpts(Registry);
+	initializeVectorization(Registry);
+	initializeIPO(Registry);
+	initializeAnalysis(Registry);
+	initializeIPA(Registry);
+	initializeTransformUtils(Registry);
+	initializeInstCombine(Registry);
+	initializeInstrumentation(Registry);
+	initializeTarget(Registry);
+
+	cl::ParseCommandLineOptions(argc, argv, "Scaffold compiler\n");
+
+	if (OutputBase.empty()) {
+		StringRef base = sys::path::filename(InputFilename);
+		if (base.endswith(".scaffold"))
+			base = base.drop_back(strlen(".scaffold"));
+		OutputBase = base.str();
+	}
+	if (Emit.empty())
+		Emit.push_back(EmitResources);
+
+	LLVMContext &Context = getGlobalContext();
+	report("Compiling");
+	TimeRecord before = TimeRecord::getCurrentTime(true);
+	OwningPtr<Module> M(compile(build + "/bin/clang", Context));
+	if (!M)
+		return 1;
+	reportTime(before);
+	if (!dump(*M, ""))
+		return 1;
+
+	for (unsigned i = 0; i < sizeof(frontStages) / sizeof(frontStages[0]); i++)
+		if (!runStage(*M, frontStages[i]))
+			return 1;
+
+	// Rotations finds SQCT and its cache the way the makefile sets them up
+	std::string sqct = root + "/Rotations/sqct";
+	if (getenv("SQCTPATH"))
+		sqct = getenv("SQCTPATH");
+	if (DisableRotations) {
+		if (!dump(*M, rotationStage.dump))
+			return 1;
+	}
+	else if (!exists(sqct + "/rotZ")) {
+		report("SQCT not built, skipping rotation decomposition");
+		if (!dump(*M, rotationStage.dump))
+			return 1;
+	}
+	else {
+		setenv("SQCTPATH", sqct.c_str(), 1);
+		setenv("ROTATIONPATH", (sqct + "/rotZ").c_str(), 0);
+		setenv("ROTATIONCACHE", (root + "/Rotations/cache").c_str(), 0);
+		if (!runStage(*M, rotationStage))
+			return 1;
+	}
+
+	if (!runStage(*M, cleanupStage))
+		return 1;
+
+	if (DisableToffoli) {
+		if (!dump(*M, toffoliStage.dump))
+			return 1;
+	}
+	else if (!runStage(*M, toffoliStage))
+		return 1;
+
+	// Every output is one more pass over the final module, writing to its
+	// own file through the shared Scaffold output stream
+	bool done[EmitQASMB + 1] = { false, false, false, false };
+	for (unsigned i = 0; i < Emit.size(); i++) {
+		emitKind kind = Emit[i];
+		if (done[kind])
+			continue;
+		done[kind] = true;
+
+		const char *ext, *pass, *message;
+		switch (kind) {
+		case EmitResources:
+			ext = ".resources"; pass = "ResourceCount"; message = "Generating resource count";
+			break;
+		case EmitQASMH:
+			ext = ".qasmh"; pass = "gen-qasm"; message = "Generating hierarchical QASM";
+			break;
+		case EmitQASMF:
+			ext = ".qasmf"; pass = "gen-flat-qasm"; message = "Generating flat QASM";
+			break;
+		default:
+			ext = ".qasmb"; pass = "gen-flat-qasm"; message = "Generating binary flat QASM";
+			break;
+		}
+		std::string file = OutputBase + ext;
+		setFlatFormat(kind == EmitQASMB ? "binary" : "text");
+		setOutput(file.c_str());
+		report(message);
+		before = TimeRecord::getCurrentTime(true);
+		if (!runPasses(*M, pass))
+			return 1;
+		setOutput(NULL);
+		reportTime(before);
+		if (!Quiet)
+			errs() << "[scaffold] Written to " << file << "\n";
+	}
+
+	return 0;
+}
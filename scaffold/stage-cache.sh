@@ -0,0 +1,167 @@
+#!/bin/bash
+
+# Content-addressed cache for the stages of Scaffold_revkit.makefile.
+#
+#   stage-cache.sh <input> <output> <command ...>
+#       Run <command>, with the arguments @IN@ and @OUT@ standing for <input>
+#       and <output> (also inside an argument, as in -scaffold-output=@OUT@),
+#       unless a stage with the same key already ran; then <output> is copied
+#       from the cache. The key is a hash of
+#         - the contents of <input>,
+#         - the command, with @IN@ and @OUT@ left in so file names do not
+#           matter, and every argument that names a file (opt, Scaffold.so)
+#           replaced by its name, size and time, as the version of the tool,
+#         - the environment the passes read (ROTATIONPATH, SQCTPATH), and
+#           the size and time of the SQCT decomposer they name: the
+#           $ROTATIONPATH binary, the libsqct.so next to it that Rotations
+#           loads, and $SQCTPATH/rotZ.
+#       -rotation-cache= arguments are left out: they only make Rotations
+#       faster. The rotation cache keys its entries on the same decomposer
+#       stamps, so a stage that misses because SQCT was rebuilt does not get
+#       the old gates back from it.
+#   stage-cache.sh stats
+#       Print the hits and misses so far and the size of the cache.
+#   stage-cache.sh clear
+#       Remove every entry and reset the counters.
+#
+# SCAFFOLD_CACHE is the cache directory; when it is empty the command just
+# runs. Entries are evicted least recently used first when the cache grows
+# past SCAFFOLD_CACHE_SIZE megabytes (default 4096); a hit touches its entry.
+
+CACHE=${SCAFFOLD_CACHE}
+BUDGET=${SCAFFOLD_CACHE_SIZE:-4096}
+VERSION=1
+
+function usage {
+    echo "Usage: $0 <input> <output> <command ...>"
+    echo "       $0 stats|clear"
+    exit 1
+}
+
+function count {
+    # count hit|miss: add one to the counter in the stats file, under a lock
+    # so that parallel stages do not lose updates
+    (
+        flock 9
+        local hits=0 misses=0
+        if [ -e ${CACHE}/stats ]; then
+            read hits misses < ${CACHE}/stats
+        fi
+        if [ "$1" = "hit" ]; then
+            hits=$((hits + 1))
+        else
+            misses=$((misses + 1))
+        fi
+        echo "${hits} ${misses}" > ${CACHE}/stats.$$
+        mv -f ${CACHE}/stats.$$ ${CACHE}/stats
+    ) 9> ${CACHE}/stats.lock
+}
+
+function stamp {
+    # version of a tool the command does not name: its size and time
+    if [ -e "$1" ]; then
+        echo "tool $1 $(stat -L -c '%s %Y' $1)"
+    fi
+}
+
+function evict {
+    local used=$(du -sk ${CACHE} | cut -f1)
+    local budget=$((BUDGET * 1024))
+    if [ ${used} -le ${budget} ]; then
+        return
+    fi
+    # oldest first; the entries are the files named by their key
+    for entry in $(ls -tr ${CACHE} | grep -E '^[0-9a-f]{64}$'); do
+        local size=$(du -sk ${CACHE}/${entry} | cut -f1)
+        rm -f ${CACHE}/${entry}
+        used=$((used - size))
+        if [ ${used} -le ${budget} ]; then
+            break
+        fi
+    done
+}
+
+if [ "$1" = "stats" ] || [ "$1" = "clear" ]; then
+    if [ -z "${CACHE}" ] || [ ! -d ${CACHE} ]; then
+        echo "[stage-cache] no cache"
+        exit 0
+    fi
+    if [ "$1" = "clear" ]; then
+        rm -f ${CACHE}/[0-9a-f]* ${CACHE}/stats ${CACHE}/stats.lock
+        exit 0
+    fi
+    hits=0
+    misses=0
+    if [ -e ${CACHE}/stats ]; then
+        read hits misses < ${CACHE}/stats
+    fi
+    entries=$(ls ${CACHE} | grep -cE '^[0-9a-f]{64}$')
+    used=$(du -sk ${CACHE} | cut -f1)
+    echo "[stage-cache] ${hits} hits, ${misses} misses, ${entries} entries, $((used / 1024))M of ${BUDGET}M in ${CACHE}"
+    exit 0
+fi
+
+if [ $# -lt 3 ]; then
+    usage
+fi
+in=$1
+out=$2
+shift 2
+
+# The command with the real file names
+cmd=()
+for arg in "$@"; do
+    arg=${arg//@IN@/${in}}
+    cmd+=("${arg//@OUT@/${out}}")
+done
+
+if [ -z "${CACHE}" ]; then
+    exec "${cmd[@]}"
+fi
+mkdir -p ${CACHE}
+
+key=$( {
+    echo "stage-cache ${VERSION}"
+    sha256sum < ${in}
+    for arg in "$@"; do
+        case "${arg}" in
+        -rotation-cache=*) ;;
+        *)  if [ -f "${arg}" ]; then
+                echo "tool $(basename ${arg}) $(stat -L -c '%s %Y' ${arg})"
+            else
+                echo "arg ${arg}"
+            fi
+            ;;
+        esac
+    done
+    echo "ROTATIONPATH=${ROTATIONPATH}"
+    echo "SQCTPATH=${SQCTPATH}"
+    if [ -n "${ROTATIONPATH}" ]; then
+        stamp ${ROTATIONPATH}
+        stamp $(dirname ${ROTATIONPATH})/libsqct.so
+    fi
+    if [ -n "${SQCTPATH}" ]; then
+        stamp ${SQCTPATH}/rotZ
+    fi
+} | sha256sum | cut -d' ' -f1)
+entry=${CACHE}/${key}
+
+# A hit copies the entry out, unless it was evicted in the meantime
+if [ -e ${entry} ] && cp ${entry} ${out}.cache$$ 2>/dev/null; then
+    touch ${entry}
+    mv -f ${out}.cache$$ ${out}
+    count hit
+    echo "[stage-cache] hit: ${out}" >&2
+    exit 0
+fi
+rm -f ${out}.cache$$
+
+"${cmd[@]}" || exit $?
+count miss
+if cp ${out} ${entry}.$$ 2>/dev/null; then
+    mv -f ${entry}.$$ ${entry}
+    evict
+else
+    rm -f ${entry}.$$
+fi
+exit 0
@@ -9,7 +9,7 @@ if [ $(echo $PATH | grep ${Revkit_PATH} | wc -l) -eq 0 ]; then
 fi
 
 function show_help {
-    echo "Usage: $0 [-h] [-rqfRFcpd] [-L #] <filename>.scaffold"
+    echo "Usage: $0 [-h] [-rqfRFCcpd] [-L #] <filename>.scaffold"
     echo "    -r   Generate resource estimate (default)"
     echo "    -q   Generate QASM"
     echo "    -f   Generate flattened QASM"
@@ -17,6 +17,7 @@ function show_help {
     echo "    -T   Disable Toffoli decomposition"    
 	  echo "    -l   Levels of recursion to run (default=1)"
     echo "    -F   Force running all steps"
+    echo "    -C   Do not use the stage cache (SCAFFOLD_CACHE, default ${ROOT}/stage-cache)"
     echo "    -c   Clean all files (no other actions)"
     echo "    -p   Purge all intermediate files (preserves specified output,"
     echo "         but requires recompilation for any new output)"
@@ -30,11 +31,12 @@ clean=0
 dryrun=""
 force=0
 purge=0
+cache=1
 res=0
 rot=1
 toff=1
 targets=""
-while getopts "h?cdfFpqrRTl:" opt; do
+while getopts "h?cCdfFpqrRTl:" opt; do
     case "$opt" in
     h|\?)
         show_help
@@ -42,6 +44,8 @@ while getopts "h?cdfFpqrRTl:" opt; do
         ;;
     c) clean=1
         ;;
+    C) cache=0
+        ;;
 	  d) dryrun="--dry-run"
 		;;
     F) force=1
@@ -81,6 +85,12 @@ fi
 if [ -z "${targets}" ]; then
     targets="resources"
 fi
+# Report the stage cache after the outputs
+if [ ${cache} -eq 1 ]; then
+    targets="${targets} cache-stats"
+else
+    targets="${targets} SCAFFOLD_CACHE="
+fi
 
 if [ $# -lt 1 ]; then 
     echo "Error: Missing filename argument" 
@@ -14,6 +14,8 @@ K=(2)
 THRESHOLDS=(010k 2M)
 # Full schedule? otherwise only generates metrics (faster)
 FULL_SCHED=true
+# Schedule with the MultiSIMDSchedule pass instead of GenSIMD, leaves.pl and sched.pl?
+NATIVE_SCHED=false
 
 # Create directory to put all byproduct and output files in
 for f in $*; do
@@ -31,7 +33,7 @@ for f in $*; do
     # Generate compiled files
     $ROOT/scaffold.sh -r $f
     mv ${b}11.ll ${b}11.ll.keep_me
-    # clean intermediary compilation files (comment out for speed)
+    # clean intermediary compilation files (the stage cache keeps them for the next run)
     $ROOT/scaffold.sh -c $f
     # Keep the final output for the compilation
     mv ${b}11.ll.keep_me ${b}/${b}.ll
@@ -62,13 +64,16 @@ for f in $*; do
   for th in ${THRESHOLDS[@]}; do      
     if [ -n ${b}/${b}_flat${th}.resources ]; then
       echo "[gen-scheds.sh] Resource count for Threshold = $th flattening ..."
-      $OPT -S -load $SCAF -ResourceCount ${b}/${b}_flat${th}.ll > /dev/null 2> ${b}/${b}_flat${th}.resources
+      $OPT -S -load $SCAF -ResourceCount -scaffold-output=${b}/${b}_flat${th}.resources ${b}/${b}_flat${th}.ll > /dev/null
     fi
   done
 done
 
 # For different K and D values specified above, generate MultiSIMD schedules
 for f in $*; do
+  if [ "$NATIVE_SCHED" = true ]; then
+    break
+  fi
   b=$(basename $f .scaffold)
   for d in ${D[@]}; do
     for k in ${K[@]}; do
@@ -76,7 +81,7 @@ for f in $*; do
       for th in ${THRESHOLDS[@]}; do
         if [ ! -e ${b}/${b}_flat${th}.simd.${k}.${d}.leaves ]; then
           echo "[gen-scheds.sh] GenSIMD for Threshold = $th flattening ..."
-          $OPT -load $SCAF -GenSIMDSchedule -simd-kconstraint $k -simd-dconstraint $d ${b}/${b}_flat${th}.ll > /dev/null 2> ${b}/${b}_flat${th}.simd.${k}.${d}
+          $OPT -load $SCAF -GenSIMDSchedule -simd-kconstraint $k -simd-dconstraint $d -scaffold-output=${b}/${b}_flat${th}.simd.${k}.${d} ${b}/${b}_flat${th}.ll > /dev/null
           ${DIR}/leaves.pl ${b}/${b}_flat${th}.simd.${k}.${d} > ${b}/${b}_flat${th}.simd.${k}.${d}.leaves
         fi
       done
@@ -87,6 +92,21 @@ done
 # Perform different kinds of LPFS, RCP, SS scheduling, as specified in the regress.sh file
 for f in $*; do
   b=$(basename $f .scaffold)
+  if [ "$NATIVE_SCHED" = true ]; then
+    echo "[gen-scheds.sh] $b: Generating LPFS, RCP, SS schedules in the compiler ..."
+    for d in ${D[@]}; do
+      for k in ${K[@]}; do
+        for th in ${THRESHOLDS[@]}; do
+          if [ "$FULL_SCHED" = true ]; then
+            $OPT -load $SCAF -MultiSIMDSchedule -msimd-k $k -msimd-d $d -msimd-sched lpfs -msimd-l 1 -msimd-opp 1 -msimd-refill 1 -msimd-print-schedule -msimd-out ${b}/${b}_flat${th} ${b}/${b}_flat${th}.ll > /dev/null
+          else
+            $OPT -load $SCAF -MultiSIMDSchedule -msimd-k $k -msimd-d $d -msimd-sched ss,lpfs,rcp -msimd-l $(seq -s, 1 $(( k > 1 ? k - 1 : 1 ))) -msimd-opp 0,1 -msimd-refill 0,1 -msimd-op 1,10 -msimd-dist 1,10 -msimd-slack 1,10 -msimd-out ${b}/${b}_flat${th} ${b}/${b}_flat${th}.ll > /dev/null
+          fi
+        done
+      done
+    done
+    continue
+  fi
   echo "[gen-scheds.sh] $b: Generating LPFS, RCP, SS leaves ..."
   cd ${b}
   if [ "$FULL_SCHED" = true ]; then